@@ -0,0 +1,355 @@
+//----------------------------------------------------------------------------
+/// \file   alloc_arena.hpp
+/// \author Serge Aleynikov
+//----------------------------------------------------------------------------
+/// \brief Monotonic (bump-pointer) arena allocator.
+///
+/// Memory is handed out sequentially from a chain of chunks obtained from
+/// malloc(3).  Individual deallocations are no-ops (except for the most
+/// recent allocation), and the whole arena is recycled in O(1) by reset(),
+/// which keeps the chunks for reuse, so that after warming up the arena
+/// processing of a message doesn't call malloc at all.  An arena can also be
+/// rewound to a marker taken earlier, releasing everything allocated after
+/// the marker.
+///
+/// The fixed_arena manages a single region of memory given at construction
+/// and can be placed in shared memory (see shmem_fixed_arena).  The
+/// arena_allocator adapts either arena for use with STL containers.
+//----------------------------------------------------------------------------
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#pragma once
+
+#include <boost/noncopyable.hpp>
+#include <boost/interprocess/offset_ptr.hpp>
+#include <boost/type_traits/is_same.hpp>
+#include <utxx/compiler_hints.hpp>
+#include <utxx/error.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <stdlib.h>
+
+namespace utxx   {
+namespace memory {
+
+//----------------------------------------------------------------------------
+/// Chained bump-pointer arena.
+///
+/// The arena is not thread-safe. Use local() to get an arena owned by the
+/// calling thread.
+//----------------------------------------------------------------------------
+class arena : private boost::noncopyable {
+    struct chunk {
+        chunk*  next;
+        size_t  size;       ///< Number of usable bytes following the header
+        char*   data() { return reinterpret_cast<char*>(this + 1); }
+    };
+
+    chunk*      m_head;
+    chunk*      m_cur;
+    uintptr_t   m_ptr;
+    uintptr_t   m_end;
+    uintptr_t   m_last;         ///< Most recent allocation
+    size_t      m_chunk_size;
+    size_t      m_capacity;
+    size_t      m_chunks;
+
+    static uintptr_t align_up(uintptr_t a_p, size_t a_align) {
+        return (a_p + a_align - 1) & ~uintptr_t(a_align - 1);
+    }
+
+    void use(chunk* a_chunk) {
+        m_cur = a_chunk;
+        m_ptr = reinterpret_cast<uintptr_t>(a_chunk->data());
+        m_end = m_ptr + a_chunk->size;
+    }
+
+    // Advance to the next chunk in the chain if it fits the request,
+    // otherwise link a new chunk after the current one
+    void* allocate_slow(size_t a_size, size_t a_align) {
+        size_t need = a_size + a_align - 1;
+        chunk* next = m_cur ? m_cur->next : m_head;
+        if (!next || next->size < need) {
+            size_t n = std::max(m_chunk_size, need);
+            chunk* c = static_cast<chunk*>(::malloc(sizeof(chunk) + n));
+            if (unlikely(!c))
+                throw std::bad_alloc();
+            c->next = next;
+            c->size = n;
+            (m_cur ? m_cur->next : m_head) = c;
+            m_capacity += n;
+            ++m_chunks;
+            next = c;
+        }
+        use(next);
+        uintptr_t p = align_up(m_ptr, a_align);
+        m_ptr  = p + a_size;
+        m_last = p;
+        return reinterpret_cast<void*>(p);
+    }
+
+public:
+    /// @param a_chunk_size size of chunks requested from malloc(3).
+    ///                     Larger allocations get a chunk of their own.
+    explicit arena(size_t a_chunk_size = 64*1024)
+        : m_head(NULL), m_cur(NULL), m_ptr(0), m_end(0), m_last(0)
+        , m_chunk_size(a_chunk_size), m_capacity(0), m_chunks(0)
+    {}
+
+    ~arena() { release(); }
+
+    /// Allocate \a a_size bytes aligned at \a a_align (a power of 2)
+    void* allocate(size_t a_size, size_t a_align = alignof(std::max_align_t)) {
+        uintptr_t p = align_up(m_ptr, a_align);
+        if (likely(p + a_size <= m_end && m_cur)) {
+            m_ptr  = p + a_size;
+            m_last = p;
+            return reinterpret_cast<void*>(p);
+        }
+        return allocate_slow(a_size, a_align);
+    }
+
+    /// Memory is reclaimed by reset(). Only the most recent allocation is
+    /// returned to the arena immediately.
+    void deallocate(void* a_p, size_t a_size) {
+        uintptr_t p = reinterpret_cast<uintptr_t>(a_p);
+        if (p == m_last && p + a_size == m_ptr)
+            m_ptr = p;
+    }
+
+    /// Position of the arena that can be restored by rewind()
+    struct marker {
+        chunk*    cur;
+        uintptr_t ptr;
+    };
+
+    /// Get the current position of the arena
+    marker mark() const { return marker{m_cur, m_ptr}; }
+
+    /// Release all memory allocated after \a a_mark was taken, keeping the
+    /// chunks for reuse
+    void rewind(const marker& a_mark) {
+        if (!a_mark.cur)
+            return reset();
+        use(a_mark.cur);
+        m_ptr  = a_mark.ptr;
+        m_last = 0;
+    }
+
+    /// Recycle all memory allocated from the arena keeping its chunks
+    void reset() {
+        m_last = 0;
+        if (m_head)
+            use(m_head);
+    }
+
+    /// Free all chunks
+    void release() {
+        for (chunk* c = m_head, *next; c; c = next) {
+            next = c->next;
+            ::free(c);
+        }
+        m_head = m_cur = NULL;
+        m_ptr  = m_end = m_last = 0;
+        m_capacity = m_chunks = 0;
+    }
+
+    /// Total size of chunks owned by the arena
+    size_t capacity()   const { return m_capacity; }
+    /// Number of chunks owned by the arena
+    size_t chunks()     const { return m_chunks;   }
+    /// Default chunk size
+    size_t chunk_size() const { return m_chunk_size; }
+
+    /// Arena owned by the calling thread
+    static arena& local() {
+        static thread_local arena s_arena;
+        return s_arena;
+    }
+};
+
+namespace detail {
+
+//----------------------------------------------------------------------------
+/// Bump-pointer arena managing a fixed region of memory.
+///
+/// Template arguments:
+///    PointerType - must be either offset_ptr<char> or char*. With offset_ptr
+///                  the arena can be placed in shared memory mapped at
+///                  different addresses in different processes.
+/// The arena is not thread-safe.
+//----------------------------------------------------------------------------
+template <class PointerType>
+class fixed_arena : private boost::noncopyable {
+    typedef PointerType pointer_type;
+
+    static const unsigned int s_magic = 0xA4E7A001;
+
+    const unsigned int  m_magic;
+    const pointer_type  m_begin;
+    const pointer_type  m_end;
+    pointer_type        m_ptr;
+
+    explicit fixed_arena(size_t a_bytes)
+        : m_magic(s_magic)
+        , m_begin(reinterpret_cast<char*>(this + 1))
+        , m_end  (reinterpret_cast<char*>(this) + a_bytes)
+        , m_ptr  (m_begin)
+    {
+        static_assert(boost::is_same<PointerType, char*>::value ||
+                      boost::is_same<PointerType,
+                        boost::interprocess::offset_ptr<char>>::value,
+                      "Invalid pointer type");
+    }
+
+public:
+    /// Offset of the position of the arena from the beginning of its region
+    typedef size_t marker;
+
+    /// Initialize the arena in \a a_storage of \a a_bytes
+    static fixed_arena& create(void* a_storage, size_t a_bytes) {
+        if (!a_storage)
+            throw badarg_error("Empty storage provided!");
+        if (a_bytes <= sizeof(fixed_arena))
+            throw badarg_error("Arena size too small: ", a_bytes);
+        return *new (a_storage) fixed_arena(a_bytes);
+    }
+
+    /// Attach to an arena created in \a a_storage (possibly by another process)
+    static fixed_arena& attach(void* a_storage, size_t a_bytes) {
+        fixed_arena* p = static_cast<fixed_arena*>(a_storage);
+        if (!a_storage)
+            throw badarg_error("Empty storage provided!");
+        if (p->m_magic != s_magic)
+            throw badarg_error("Invalid arena magic: ", p->m_magic);
+        if (p->capacity() + sizeof(fixed_arena) != a_bytes)
+            throw badarg_error("Wrong arena size (requested: ", a_bytes,
+                               ", found: ", p->capacity() + sizeof(fixed_arena), ')');
+        return *p;
+    }
+
+    /// Allocate \a a_size bytes aligned at \a a_align (a power of 2)
+    /// @return NULL if the arena is exhausted
+    void* allocate(size_t a_size, size_t a_align = alignof(std::max_align_t)) {
+        uintptr_t p = (uintptr_t(&*m_ptr) + a_align - 1) & ~uintptr_t(a_align - 1);
+        if (unlikely(p + a_size > uintptr_t(&*m_end)))
+            return NULL;
+        m_ptr = reinterpret_cast<char*>(p + a_size);
+        return reinterpret_cast<void*>(p);
+    }
+
+    /// Memory is reclaimed by reset() or rewind(). Only the most recent
+    /// allocation is returned to the arena immediately.
+    void deallocate(void* a_p, size_t a_size) {
+        if (static_cast<char*>(a_p) + a_size == &*m_ptr)
+            m_ptr = static_cast<char*>(a_p);
+    }
+
+    marker mark()                    const { return m_ptr - m_begin;   }
+    void   rewind(marker a_mark)           { m_ptr = m_begin + a_mark; }
+    void   reset()                         { m_ptr = m_begin;          }
+
+    /// Bytes allocated from the arena
+    size_t used()                    const { return m_ptr - m_begin;   }
+    /// Bytes left in the arena
+    size_t available()               const { return m_end - m_ptr;     }
+    /// Total size of the arena's region
+    size_t capacity()                const { return m_end - m_begin;   }
+};
+
+} // namespace detail
+
+/// Fixed arena in heap memory
+typedef detail::fixed_arena<char*> heap_fixed_arena;
+
+/// Fixed arena in shared memory
+typedef detail::fixed_arena<
+    boost::interprocess::offset_ptr<char> > shmem_fixed_arena;
+
+//----------------------------------------------------------------------------
+/// Rewinds an arena to the position it had at construction of the scope.
+//----------------------------------------------------------------------------
+template <class Arena = arena>
+class arena_scope : private boost::noncopyable {
+    Arena&                  m_arena;
+    typename Arena::marker  m_mark;
+public:
+    explicit arena_scope(Arena& a_arena)
+        : m_arena(a_arena), m_mark(a_arena.mark())
+    {}
+    ~arena_scope() { m_arena.rewind(m_mark); }
+};
+
+//----------------------------------------------------------------------------
+/// STL-compatible allocator allocating memory from an arena.
+//----------------------------------------------------------------------------
+template <typename T, class Arena = arena>
+class arena_allocator {
+    template <typename U, class A> friend class arena_allocator;
+    Arena* m_arena;
+public:
+    typedef T               value_type;
+    typedef T*              pointer;
+    typedef const T*        const_pointer;
+    typedef T&              reference;
+    typedef const T&        const_reference;
+    typedef size_t          size_type;
+    typedef std::ptrdiff_t  difference_type;
+
+    typedef std::true_type  propagate_on_container_copy_assignment;
+    typedef std::true_type  propagate_on_container_move_assignment;
+    typedef std::true_type  propagate_on_container_swap;
+
+    template <typename U>
+    struct rebind { typedef arena_allocator<U, Arena> other; };
+
+    explicit arena_allocator(Arena& a_arena) : m_arena(&a_arena) {}
+
+    template <typename U>
+    arena_allocator(const arena_allocator<U, Arena>& a) : m_arena(a.m_arena) {}
+
+    T* allocate(size_t n) {
+        void* p = m_arena->allocate(n*sizeof(T), alignof(T));
+        if (unlikely(!p))
+            throw std::bad_alloc();
+        return static_cast<T*>(p);
+    }
+
+    void deallocate(T* p, size_t n) { m_arena->deallocate(p, n*sizeof(T)); }
+
+    Arena& get_arena() const { return *m_arena; }
+
+    template <typename U>
+    bool operator==(const arena_allocator<U, Arena>& a) const { return m_arena == a.m_arena; }
+    template <typename U>
+    bool operator!=(const arena_allocator<U, Arena>& a) const { return m_arena != a.m_arena; }
+};
+
+} // namespace memory
+} // namespace utxx
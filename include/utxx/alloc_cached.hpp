@@ -9,6 +9,15 @@
 /// for cases when a pool of the requested size class is empty. A size class
 /// is a power of 2.  This allocator is not suitable for shared memory
 /// interprocess allocations.
+///
+/// Optionally each thread keeps a small LIFO magazine of free nodes per size
+/// class, exchanging batches of nodes with the shared free lists, so that most
+/// allocations and deallocations don't touch shared cache lines.  When a
+/// thread exits its magazines are flushed to the shared free lists, and its
+/// cache is reused by the next thread that registers with the allocator.
+///
+/// Allocation statistics are collected when an alloc_stats instance is
+/// attached by calling stats() (see alloc_stats.hpp).
 //----------------------------------------------------------------------------
 // Created: 2009-11-21
 //----------------------------------------------------------------------------
@@ -41,10 +50,13 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <boost/type_traits.hpp>
 
+#include <atomic>
 #include <stdexcept>
+#include <thread>
 #include <utxx/math.hpp>
 #include <utxx/meta.hpp>
 #include <utxx/atomic.hpp>
+#include <utxx/alloc_stats.hpp>
 #include <utxx/container/concurrent_stack.hpp>
 #include <utxx/compiler_hints.hpp>
 #ifdef DEBUG
@@ -69,25 +81,96 @@ using namespace container;
 /// @tparam   SizeClasses - Max number of size class managed by the allocator.
 ///                         Objects of size >= 2^SizeClasses are allocated/freed
 ///                         directly using the AllocT bypassing caching.
+/// @tparam   FreeList    - Type of the per-size-class free list. The default
+///                         elimination_stack keeps alloc/free throughput
+///                         scaling under heavy multi-threaded churn, use
+///                         versioned_stack for a smaller footprint.
+/// @tparam   MagazineSize- Number of nodes in a batch exchanged between a
+///                         per-thread magazine and the shared free lists.
+///                         A thread caches up to 2*MagazineSize nodes of each
+///                         size class.  0 disables per-thread caching.
 template <
     class T, 
     class AllocT        = std::allocator<T>,
     int   MinSize       = 3 * sizeof(long), 
-    int   SizeClasses   = 21>
+    int   SizeClasses   = 21,
+    class FreeList      = elimination_stack<>,
+    int   MagazineSize  = 0>
 class cached_allocator {
     typedef typename AllocT::template rebind<T>::other UserAllocT;
     typedef versioned_stack::node_t node_t;
 
-    versioned_stack  m_freelist[SizeClasses];
+    // Per-thread LIFO list of free nodes of one size class
+    struct magazine {
+        node_t*   head;
+        unsigned  count;
+    };
+
+    // Life cycle of a thread_cache
+    enum cache_state {
+        LIVE,       ///< Used by the owner thread
+        EXITING,    ///< The owner thread is flushing it on exit
+        DEAD,       ///< The owner thread exited, the cache can be reused
+        ORPHAN      ///< The allocator is gone, the owner thread deletes it
+    };
+
+    // Magazines of a thread.  Owned by the allocator, which keeps them
+    // in a list, so that a thread finds its cache again after a miss in
+    // the thread-local lookup table.
+    struct thread_cache {
+        thread_cache*                   next;   ///< Next cache of allocator
+        thread_cache*                   tnext;  ///< Next cache of the thread
+        cached_allocator*               parent;
+        std::atomic<int>                state;
+        std::atomic<std::thread::id>    owner;
+        magazine                        mags[SizeClasses];
+
+        explicit thread_cache(cached_allocator* a_parent)
+            : next(NULL), tnext(NULL), parent(a_parent), state(LIVE)
+            , owner(std::this_thread::get_id()), mags()
+        {}
+    };
+
+    // Caches registered by a thread, released when the thread exits
+    struct thread_caches {
+        thread_cache* head = NULL;
+        ~thread_caches();
+    };
+
+    struct tls_slot {
+        unsigned long   id;
+        thread_cache*   cache;
+    };
+
+    FreeList         m_freelist[SizeClasses];
+    /// Batches of MagazineSize nodes (empty without per-thread caching)
+    FreeList         m_depot[MagazineSize > 0 ? SizeClasses : 0];
     UserAllocT&      m_alloc;
     volatile long    m_large_objects;
+    const unsigned long   m_id;             ///< Unique id of this allocator
+    thread_cache*volatile m_caches;
+    alloc_stats*          m_stats;          ///< Optional statistics
 
     static UserAllocT& default_allocator() {
         static std::allocator<T> allocator;
         return allocator;
     }
 
+    static unsigned long next_id() {
+        static volatile long s_id;
+        return atomic::add(&s_id, 1) + 1;
+    }
+
     void* alloc_size_class(size_t size_class);
+    void* alloc_node(size_t size_class, unsigned& a_retries, bool& a_miss);
+
+    thread_cache* local_cache();
+    thread_cache* register_cache();
+    bool          refill(magazine& a_mag, size_t a_size_class, unsigned& a_retries);
+    unsigned      flush (magazine& a_mag, size_t a_size_class);
+    void          flush (thread_cache& a_cache);
+    void          release(node_t* a_node, size_t a_size_class);
+    void          release(thread_cache& a_cache);
 public:
     typedef ::std::size_t    size_type;
     typedef ::std::ptrdiff_t difference_type;
@@ -105,15 +188,40 @@ public:
 
     static const unsigned int max_size_class = SizeClasses-1;
     static const unsigned int min_size       = MinSize;
+    static const unsigned int min_size_class =
+        log<upper_power<MinSize, 2>::value, 2>::value;
+
+    static const unsigned int magazine_size  = MagazineSize;
+
+    static_assert(MagazineSize >= 0, "Invalid magazine size");
+    static_assert(MagazineSize == 0 || (1 << min_size_class) >=
+                  int(sizeof(node_t) + sizeof(node_t*)), "MinSize too small");
 
     template <typename U>
     struct rebind {
         typedef typename AllocT::template rebind<U>::other ArenaAlloc;
-        typedef cached_allocator<U, ArenaAlloc, MinSize, SizeClasses> other;
+        typedef cached_allocator<U, ArenaAlloc, MinSize, SizeClasses, FreeList,
+                                 MagazineSize> other;
     };
 
-    cached_allocator() : m_alloc(default_allocator()), m_large_objects(0) {}
-    cached_allocator(AllocT& alloc) : m_alloc(alloc),  m_large_objects(0) {}
+    cached_allocator()
+        : m_alloc(default_allocator()), m_large_objects(0)
+        , m_id(next_id()), m_caches(NULL), m_stats(NULL)
+    {}
+    cached_allocator(AllocT& alloc)
+        : m_alloc(alloc), m_large_objects(0), m_id(next_id()), m_caches(NULL)
+        , m_stats(NULL)
+    {}
+    /// The copy shares the user allocator and statistics but not the cached nodes
+    cached_allocator(const cached_allocator& a)
+        : m_alloc(a.m_alloc), m_large_objects(0), m_id(next_id()), m_caches(NULL)
+        , m_stats(a.m_stats)
+    {}
+
+    /// Return all cached nodes to the user allocator.
+    /// The allocator must not be used concurrently with its destruction,
+    /// but threads that used it may still be running or exiting.
+    ~cached_allocator();
 
     /// Allocate a count number of objects T. This operation is thread-safe.
     T* allocate(size_t count);
@@ -147,10 +255,38 @@ public:
         return size_class > max_size_class ? -1 : m_freelist[size_class].unsafe_size();
     }
 
+    /// Number of batches of MagazineSize nodes in the shared depot.
+    /// For debugging only (not thread safe).
+    int depot_size(size_t size_class) const {
+        return size_class > max_size_class ? -1
+             : MagazineSize == 0           ? 0
+             : m_depot[size_class].unsafe_size();
+    }
+
+    /// Number of per-thread caches (live or reusable).
+    /// For debugging only (not thread safe).
+    int thread_caches_count() const {
+        int n = 0;
+        for (thread_cache* p = m_caches; p; p = p->next) ++n;
+        return n;
+    }
+
+    /// Number of nodes in the calling thread's magazine of a size class
+    int magazine_count(size_t size_class) {
+        return MagazineSize == 0 || size_class > max_size_class
+             ? 0 : local_cache()->mags[size_class].count;
+    }
+
     static size_t size_class(void* p) {
         return node_t::to_node(p)->size_class();
     }
 
+    /// Attach statistics collector indexed by size_class() (NULL detaches).
+    /// Must not be called concurrently with allocations.  A miss is counted
+    /// when a chunk is obtained from the user allocator.
+    void         stats(alloc_stats* a_stats) { m_stats = a_stats; }
+    alloc_stats* stats() const               { return m_stats;    }
+
     #ifdef DEBUG
     void dump() const;
     #endif
@@ -160,21 +296,62 @@ public:
 // IMPLEMENTATION
 //-----------------------------------------------------------------------------
 
-template <class T, class AllocT, int MinSize, int SizeClasses>
-inline T* cached_allocator<T, AllocT, MinSize, SizeClasses>
+template <class T, class AllocT, int MinSize, int SizeClasses, class FreeList,
+          int MagazineSize>
+cached_allocator<T, AllocT, MinSize, SizeClasses, FreeList, MagazineSize>
+::~cached_allocator()
+{
+    // Caches first, since exiting threads flush them to the free lists
+    for (thread_cache* p = m_caches, *next; p; p = next) {
+        next = p->next;
+        int s = LIVE;
+        // Wait for an exiting owner to finish its flush
+        while (!p->state.compare_exchange_weak(s, ORPHAN, std::memory_order_acq_rel)) {
+            if (s == DEAD || s == ORPHAN)
+                break;
+            s = LIVE;
+            std::this_thread::yield();
+        }
+        release(*p);
+        // A live owner thread deletes its orphaned cache on exit
+        if (s == DEAD)
+            delete p;
+    }
+
+    unsigned retries = 0;
+    for (size_t i = 0; i < SizeClasses; ++i) {
+        while (node_t* nd = m_freelist[i].pop(retries))
+            release(nd, i);
+        if (MagazineSize == 0)
+            continue;
+        while (node_t* nd = m_depot[i].pop(retries)) {
+            node_t* rest = *static_cast<node_t**>(nd->data());
+            release(nd, i);
+            for (node_t* next; rest; rest = next) {
+                next = rest->next;
+                release(rest, i);
+            }
+        }
+    }
+}
+
+template <class T, class AllocT, int MinSize, int SizeClasses, class FreeList,
+          int MagazineSize>
+inline T* cached_allocator<T, AllocT, MinSize, SizeClasses, FreeList, MagazineSize>
 ::allocate(size_t count) 
 {
     using namespace container;
 
     size_t alloc_sz = sizeof(T)*count + versioned_stack::header_size();
     char size_class = (alloc_sz < min_size)
-              ? upper_power<min_size, 2>::value 
+              ? min_size_class
               : math::upper_log2(alloc_sz);
     return static_cast<T*>(alloc_size_class(size_class));
 }
 
-template <class T, class AllocT, int MinSize, int SizeClasses>
-inline void cached_allocator<T, AllocT, MinSize, SizeClasses>
+template <class T, class AllocT, int MinSize, int SizeClasses, class FreeList,
+          int MagazineSize>
+inline void cached_allocator<T, AllocT, MinSize, SizeClasses, FreeList, MagazineSize>
 ::free(void* p)
 {
     using namespace container;
@@ -185,8 +362,9 @@ inline void cached_allocator<T, AllocT, MinSize, SizeClasses>
     free_node(nd);
 }
 
-template <class T, class AllocT, int MinSize, int SizeClasses>
-void* cached_allocator<T, AllocT, MinSize, SizeClasses>
+template <class T, class AllocT, int MinSize, int SizeClasses, class FreeList,
+          int MagazineSize>
+void* cached_allocator<T, AllocT, MinSize, SizeClasses, FreeList, MagazineSize>
 ::reallocate(void* p, size_t sz) 
 {
     using namespace container;
@@ -201,7 +379,7 @@ void* cached_allocator<T, AllocT, MinSize, SizeClasses>
     char old_size_class = nd->size_class();
     size_t alloc_sz     = sz + versioned_stack::header_size();
     char new_size_class = (alloc_sz < min_size)
-                        ? log<min_size, 2>::value
+                        ? min_size_class
                         : math::upper_log2(alloc_sz);
     if (new_size_class <= old_size_class)
         return p;
@@ -213,26 +391,57 @@ void* cached_allocator<T, AllocT, MinSize, SizeClasses>
     // Copy old data
     node_t* nnd = node_t::to_node(pnew);
     void* data = nnd->data();
-    memcpy(data, nd->data(), old_size_class - versioned_stack::header_size());
+    memcpy(data, nd->data(), (1 << old_size_class) - versioned_stack::header_size());
     // Free old node
     free(p);
     return data;
 }
 
-template <class T, class AllocT, int MinSize, int SizeClasses>
-void* cached_allocator<T, AllocT, MinSize, SizeClasses>
+template <class T, class AllocT, int MinSize, int SizeClasses, class FreeList,
+          int MagazineSize>
+void* cached_allocator<T, AllocT, MinSize, SizeClasses, FreeList, MagazineSize>
 ::alloc_size_class(size_t size_class) 
+{
+    unsigned retries = 0;
+    bool     miss    = false;
+
+    if (likely(m_stats == NULL))
+        return alloc_node(size_class, retries, miss);
+
+    bool  timed = m_stats->sample_start();
+    void* p     = alloc_node(size_class, retries, miss);
+    if (timed)
+        m_stats->sample_stop();
+    m_stats->on_alloc(size_class, retries, miss);
+    return p;
+}
+
+template <class T, class AllocT, int MinSize, int SizeClasses, class FreeList,
+          int MagazineSize>
+inline void* cached_allocator<T, AllocT, MinSize, SizeClasses, FreeList, MagazineSize>
+::alloc_node(size_t size_class, unsigned& a_retries, bool& a_miss)
 {
     using namespace container;
 
     size_t size = 1 << size_class;
 
+    if (MagazineSize > 0 && likely(size_class <= max_size_class)) {
+        magazine& m = local_cache()->mags[size_class];
+        if (likely(m.count > 0) || refill(m, size_class, a_retries)) {
+            node_t* nd = m.head;
+            m.head = nd->next;
+            --m.count;
+            return nd->data();
+        }
+    }
+
     node_t* nd = unlikely(size_class > max_size_class)
-                                ? NULL : m_freelist[size_class].pop();
+                                ? NULL : m_freelist[size_class].pop(a_retries);
     if (nd == NULL) {
+        a_miss = true;
         nd = reinterpret_cast<node_t*>(m_alloc.allocate(size));
         BOOST_ASSERT((reinterpret_cast<unsigned long>(nd) &
-                    versioned_stack::node_t::s_version_mask) == 0);
+                    (alignof(versioned_stack::node_t) - 1)) == 0);
         new (nd) node_t(size_class);
         if (unlikely(size_class > max_size_class))
             atomic::inc(&m_large_objects);
@@ -240,8 +449,9 @@ void* cached_allocator<T, AllocT, MinSize, SizeClasses>
     return nd->data();
 }
 
-template <class T, class AllocT, int MinSize, int SizeClasses>
-void cached_allocator<T, AllocT, MinSize, SizeClasses>
+template <class T, class AllocT, int MinSize, int SizeClasses, class FreeList,
+          int MagazineSize>
+void cached_allocator<T, AllocT, MinSize, SizeClasses, FreeList, MagazineSize>
 ::free_node(node_t* nd)
 {
     using namespace container;
@@ -250,18 +460,171 @@ void cached_allocator<T, AllocT, MinSize, SizeClasses>
 
     char size_class = nd->size_class();
 
+    unsigned retries = 0;
+
     if (unlikely((uint8_t)size_class > max_size_class)) {
         m_alloc.deallocate(reinterpret_cast<T*>(nd), 1 << size_class);
         atomic::add(&m_large_objects, -1);
-        return;
+    } else if (MagazineSize > 0) {
+        magazine& m = local_cache()->mags[(uint8_t)size_class];
+        nd->next = m.head;
+        m.head   = nd;
+        if (unlikely(++m.count == 2*MagazineSize))
+            retries = flush(m, (uint8_t)size_class);
+    } else
+        retries = m_freelist[(uint8_t)size_class].push(nd);
+
+    if (unlikely(m_stats != NULL))
+        m_stats->on_free((uint8_t)size_class, retries);
+}
+
+template <class T, class AllocT, int MinSize, int SizeClasses, class FreeList,
+          int MagazineSize>
+inline typename cached_allocator<T, AllocT, MinSize, SizeClasses, FreeList,
+                                 MagazineSize>::thread_cache*
+cached_allocator<T, AllocT, MinSize, SizeClasses, FreeList, MagazineSize>
+::local_cache()
+{
+    // Small direct-mapped table of caches of allocators used by this thread.
+    // Allocator ids are never reused, so a stale entry never matches.
+    static thread_local tls_slot s_slots[4];
+    tls_slot& slot = s_slots[m_id & 3];
+    if (unlikely(slot.id != m_id)) {
+        slot.cache = register_cache();
+        slot.id    = m_id;
     }
+    return slot.cache;
+}
 
-    m_freelist[(uint8_t)size_class].push(nd);
+template <class T, class AllocT, int MinSize, int SizeClasses, class FreeList,
+          int MagazineSize>
+typename cached_allocator<T, AllocT, MinSize, SizeClasses, FreeList,
+                          MagazineSize>::thread_cache*
+cached_allocator<T, AllocT, MinSize, SizeClasses, FreeList, MagazineSize>
+::register_cache()
+{
+    static thread_local thread_caches s_owned;
+
+    // Reuse this thread's cache if it exists
+    auto me = std::this_thread::get_id();
+    for (thread_cache* p = m_caches; p; p = p->next)
+        if (p->state.load(std::memory_order_acquire) == LIVE &&
+            p->owner.load(std::memory_order_relaxed) == me)
+            return p;
+
+    // Take over the cache of an exited thread, or create a new one
+    thread_cache* p = m_caches;
+    for (int dead = DEAD; p; p = p->next, dead = DEAD)
+        if (p->state.compare_exchange_strong(dead, LIVE, std::memory_order_acq_rel)) {
+            p->owner.store(me, std::memory_order_relaxed);
+            break;
+        }
+
+    if (!p) {
+        p = new thread_cache(this);
+        do    p->next = m_caches;
+        while (!atomic::cas(&m_caches, p->next, p));
+    }
+
+    p->tnext     = s_owned.head;
+    s_owned.head = p;
+    return p;
+}
+
+template <class T, class AllocT, int MinSize, int SizeClasses, class FreeList,
+          int MagazineSize>
+cached_allocator<T, AllocT, MinSize, SizeClasses, FreeList, MagazineSize>
+::thread_caches::~thread_caches()
+{
+    for (thread_cache* p = head, *next; p; p = next) {
+        next  = p->tnext;
+        int s = LIVE;
+        if (p->state.compare_exchange_strong(s, EXITING, std::memory_order_acq_rel)) {
+            p->parent->flush(*p);
+            p->owner.store(std::thread::id(), std::memory_order_relaxed);
+            p->state.store(DEAD, std::memory_order_release);
+        } else if (s == ORPHAN)
+            delete p;
+    }
+}
+
+template <class T, class AllocT, int MinSize, int SizeClasses, class FreeList,
+          int MagazineSize>
+bool cached_allocator<T, AllocT, MinSize, SizeClasses, FreeList, MagazineSize>
+::refill(magazine& a_mag, size_t a_size_class, unsigned& a_retries)
+{
+    // The first node of a batch keeps the link to the rest of the batch
+    // in its data area, since its <next> field links batches in the depot
+    node_t* batch = m_depot[a_size_class].pop(a_retries);
+    if (!batch)
+        return false;
+    batch->next  = *static_cast<node_t**>(batch->data());
+    a_mag.head   = batch;
+    a_mag.count  = MagazineSize;
+    return true;
+}
+
+template <class T, class AllocT, int MinSize, int SizeClasses, class FreeList,
+          int MagazineSize>
+unsigned cached_allocator<T, AllocT, MinSize, SizeClasses, FreeList, MagazineSize>
+::flush(magazine& a_mag, size_t a_size_class)
+{
+    node_t* batch = a_mag.head;
+    node_t* last  = batch;
+    for (int i = 1; i < MagazineSize; ++i)
+        last = last->next;
+    a_mag.head   = last->next;
+    a_mag.count -= MagazineSize;
+    last->next   = NULL;
+    *static_cast<node_t**>(batch->data()) = batch->next;
+    return m_depot[a_size_class].push(batch);
+}
+
+template <class T, class AllocT, int MinSize, int SizeClasses, class FreeList,
+          int MagazineSize>
+void cached_allocator<T, AllocT, MinSize, SizeClasses, FreeList, MagazineSize>
+::flush(thread_cache& a_cache)
+{
+    // Full batches go to the depot, the rest to the free lists
+    for (size_t i = 0; i < SizeClasses; ++i) {
+        magazine& m = a_cache.mags[i];
+        while (MagazineSize > 0 && m.count >= unsigned(MagazineSize))
+            flush(m, i);
+        for (node_t* next; m.head; m.head = next) {
+            next = m.head->next;
+            m_freelist[i].push(m.head);
+        }
+        m.count = 0;
+    }
+}
+
+template <class T, class AllocT, int MinSize, int SizeClasses, class FreeList,
+          int MagazineSize>
+inline void cached_allocator<T, AllocT, MinSize, SizeClasses, FreeList, MagazineSize>
+::release(node_t* a_node, size_t a_size_class)
+{
+    m_alloc.deallocate(reinterpret_cast<T*>(a_node), 1 << a_size_class);
+}
+
+template <class T, class AllocT, int MinSize, int SizeClasses, class FreeList,
+          int MagazineSize>
+void cached_allocator<T, AllocT, MinSize, SizeClasses, FreeList, MagazineSize>
+::release(thread_cache& a_cache)
+{
+    for (size_t i = 0; i < SizeClasses; ++i) {
+        magazine& m = a_cache.mags[i];
+        for (node_t* next; m.head; m.head = next) {
+            next = m.head->next;
+            release(m.head, i);
+        }
+        m.count = 0;
+    }
 }
 
 #ifdef DEBUG
-template <class T, class AllocT, int MinSize, int SizeClasses>
-void cached_allocator<T, AllocT, MinSize, SizeClasses>
+template <class T, class AllocT, int MinSize, int SizeClasses, class FreeList,
+          int MagazineSize>
+void cached_allocator<T, AllocT, MinSize, SizeClasses, FreeList, MagazineSize>
 ::dump() const
 {
     std::cout
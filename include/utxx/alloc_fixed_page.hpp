@@ -37,6 +37,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <boost/noncopyable.hpp>
 #include <boost/cstdint.hpp>
 #include <utxx/atomic.hpp>
+#include <utxx/alloc_page_source.hpp>
+#include <utxx/alloc_stats.hpp>
 #include <stdlib.h>
 #ifdef _ALLOCATOR_MEM_DEBUG
 #include <stdio.h>
@@ -56,10 +58,15 @@ namespace memory {
  * deallocation method is very weak for cases when some of the
  * objects in the page have short lifetime and some have long
  * lifetime.
+ * Pages are obtained from the PageSource (see alloc_page_source.hpp), e.g.
+ * use numa_page_source<PageSize> to allocate pages on the caller's NUMA node.
+ * An attached alloc_stats counts objects in size class 0 and pages in
+ * size class 1 (a miss is an object allocation that required a new page).
  */
 template <
       typename T
-    , size_t   PageSize  = 64*1024
+    , size_t   PageSize   = 64*1024
+    , class    PageSource = heap_page_source<PageSize>
 >
 class aligned_page_allocator : public boost::noncopyable {
     struct header {
@@ -81,7 +88,8 @@ class aligned_page_allocator : public boost::noncopyable {
     BOOST_STATIC_ASSERT(s_begin_offset < PageSize);
     BOOST_STATIC_ASSERT(s_max_chunks > 0);
 
-    header* m_page;
+    header*      m_page;
+    alloc_stats* m_stats;
 
     static header* page_alloc() {
         union {
@@ -90,14 +98,7 @@ class aligned_page_allocator : public boost::noncopyable {
             char*   pc;
             header* p;
         } u;
-        #if defined(_WIN32) || defined (_WIN64)
-        u.pp = _aligned_malloc(PageSize, PageSize);
-        if (!u.pp)
-            throw std::bad_alloc();
-        #else
-        if (posix_memalign(&u.pp, PageSize, PageSize) < 0)
-            throw std::bad_alloc();
-        #endif
+        u.pp = PageSource::allocate();
         BOOST_ASSERT((u.n & s_page_mask) == 0);
         new (u.p) header();
         u.p->avail_chunk = reinterpret_cast<T*>(u.pc + s_begin_offset);
@@ -113,11 +114,7 @@ class aligned_page_allocator : public boost::noncopyable {
         printf("Freeing page %p\n", p);
         #endif
 
-        #if defined(_WIN32) || defined (_WIN64)
-        _aligned_free(p);
-        #else
-        free(p);
-        #endif
+        PageSource::deallocate(p);
     }
 
 public:
@@ -130,10 +127,12 @@ public:
     
     template <typename U>
     struct rebind {
-        typedef aligned_page_allocator<U, PageSize> other;
+        typedef aligned_page_allocator<U, PageSize, PageSource> other;
     };
 
-    aligned_page_allocator() : m_page(page_alloc()) {
+    enum { object_class, page_class };
+
+    aligned_page_allocator() : m_page(page_alloc()), m_stats(NULL) {
         #ifdef _ALLOCATOR_MEM_DEBUG
         printf("Page size: %d\n", PageSize);
         #endif
@@ -150,15 +149,30 @@ public:
     }
             
     pointer allocate(size_type n, const void *hint = 0) {
+        bool miss = false;
+        // The chunk must fit entirely within the page
         if (m_page->avail_chunk >= reinterpret_cast<pointer>(
-                reinterpret_cast<char*>(m_page) + PageSize))
-            m_page = page_alloc();
+                reinterpret_cast<char*>(m_page) + s_begin_offset) + s_max_chunks) {
+            // Reuse the current page if all of its chunks were released
+            if (m_page->alloc_count == 0)
+                m_page->avail_chunk = reinterpret_cast<pointer>(
+                    reinterpret_cast<char*>(m_page) + s_begin_offset);
+            else {
+                m_page = page_alloc();
+                miss   = true;
+            }
+        }
 
         pointer p = m_page->avail_chunk++;
         atomic::inc(&m_page->alloc_count);
         #ifdef _ALLOCATOR_MEM_DEBUG
         printf("  Allocated: %p\n", p);
         #endif
+        if (unlikely(m_stats != NULL)) {
+            if (miss)
+                m_stats->on_alloc(page_class);
+            m_stats->on_alloc(object_class, 0, miss);
+        }
         return p;
     }
 
@@ -169,8 +183,14 @@ public:
         printf("  Deallocating %p, page=%p\n", p, h);
         #endif
         BOOST_ASSERT(h->magic == header::s_magic);
-        if (atomic::add(&h->alloc_count, -1) == 0 && h != m_page)
+        if (unlikely(m_stats != NULL))
+            m_stats->on_free(object_class);
+        // atomic::add() returns the value prior to the update
+        if (atomic::add(&h->alloc_count, -1) == 1 && h != m_page) {
             page_free(h);
+            if (unlikely(m_stats != NULL))
+                m_stats->on_free(page_class);
+        }
     }
 
      void construct(pointer p, const T &val){
@@ -182,6 +202,18 @@ public:
      }
 
      const header* address() const { return m_page; }
+
+     /// Attach statistics collector (NULL detaches).  It must have at least
+     /// two size classes, whose chunk sizes are set to sizeof(T) and PageSize.
+     void stats(alloc_stats* a_stats) {
+         BOOST_ASSERT(!a_stats || a_stats->classes() > page_class);
+         if (a_stats) {
+             a_stats->class_size(object_class, sizeof(T));
+             a_stats->class_size(page_class,   PageSize);
+         }
+         m_stats = a_stats;
+     }
+     alloc_stats* stats() const { return m_stats; }
 };
 
 } // namespace memory
@@ -42,7 +42,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <utxx/math.hpp>
 #include <utxx/meta.hpp>
 #include <utxx/atomic.hpp>
+#include <utxx/alloc_stats.hpp>
 #include <utxx/error.hpp>
+#include <cstdint>
 #ifdef DEBUG
 #include <iomanip>
 #endif
@@ -55,6 +57,10 @@ using namespace boost::interprocess;
 
 /// Template arguments:
 ///    PointerType - must be either offset_ptr<char> or char*
+///
+/// The head of the free list is a 64-bit word holding a 32-bit index of the
+/// first free object and a 32-bit ABA version, so a pool can manage up to
+/// 2^32-1 objects.
 template <class PointerType>
 class fixed_size_object_pool {
     typedef PointerType pointer_type;
@@ -67,10 +73,11 @@ class fixed_size_object_pool {
         pointer_type   next;
     } object_t;
 
-    static const unsigned int   s_magic        = 0xFFEE8899;
-    static const unsigned int   s_index_mask   = 0x0000FFFF;
-    static const unsigned int   s_version_mask = 0xFFFF0000;
-    static const unsigned int   s_version_inc  = 0x00010000;
+    static const unsigned int   s_magic        = 0xFFEE889A;
+    static const uint64_t       s_index_mask   = 0x00000000FFFFFFFFull;
+    static const uint64_t       s_version_mask = 0xFFFFFFFF00000000ull;
+    static const uint64_t       s_version_inc  = 0x0000000100000000ull;
+    static const int            s_version_shift= 32;
 
     const unsigned int          m_magic;
     const size_t                m_object_size;
@@ -79,25 +86,26 @@ class fixed_size_object_pool {
     const pointer_type          m_pool_end;    // end of addressable range managed by pool
     const size_t                m_object_count;
     pointer_type       volatile m_next;
-    size_t             volatile m_free_list;
+    uint64_t           volatile m_free_list;
     long               volatile m_available;   // only valid when compiled with DEBUG
 
     fixed_size_object_pool(size_t bytes, size_t object_size)
         throw(badarg_error);
 
-    size_t object_idx(const pointer_type& p) const {
-        return (1 + (p - m_begin) / m_object_size) & s_index_mask;
+    uint64_t object_idx(const pointer_type& p) const {
+        return uint64_t(1 + (p - m_begin) / m_object_size) & s_index_mask;
     }
 
-    object_t* head_to_object(size_t head) const {
-        return reinterpret_cast<object_t*>(&*m_begin + ((head & s_index_mask)-1)*m_object_size);
+    object_t* head_to_object(uint64_t head) const {
+        return reinterpret_cast<object_t*>
+            (&*m_begin + size_t((head & s_index_mask)-1)*m_object_size);
     }
 
-    size_t object_to_head(size_t head, const pointer_type& p) const {
+    uint64_t object_to_head(uint64_t head, const pointer_type& p) const {
         return new_head_version(head) | object_idx(p);
     }
 
-    static size_t new_head_version(size_t old_head) {
+    static uint64_t new_head_version(uint64_t old_head) {
         return (old_head & s_version_mask) + s_version_inc;
     }
 
@@ -121,6 +129,8 @@ public:
         fixed_size_object_pool* pool = static_cast<fixed_size_object_pool*>(storage);
         if (storage == NULL)
             throw badarg_error("Empty storage provided!");
+        if (pool->m_magic != s_magic)
+            throw badarg_error("Incompatible pool layout (magic: ", pool->m_magic, ')');
         if (pool->end() != static_cast<char*>(storage) + bytes)
             throw badarg_error("Wrong pool size (requested:", bytes,
                                ", found: ", (pool->end() - static_cast<char*>(storage)), ')');
@@ -141,10 +151,13 @@ public:
     };
 
     /// Allocate a object of size object_size(). This operation is thread-safe.
-    void* allocate();
+    /// Since the pool may be shared by processes, statistics of the calling
+    /// process are collected in size class 0 of optional <a_stats>, where
+    /// a miss is a request failed because the pool is exhausted.
+    void* allocate(alloc_stats* a_stats = NULL);
 
     /// Free a object by returning it to the pool. This operation is thread-safe.
-    void free(void* object);
+    void free(void* object, alloc_stats* a_stats = NULL);
 
     /// @return object size managed by this pool.
     size_t object_size() const { return m_object_size - sizeof(object_t); }
@@ -158,6 +171,9 @@ public:
     /// Return maximum pool capacity
     size_t capacity() const { return m_object_count; }
 
+    /// Current ABA version of the free list head
+    uint32_t version()  const { return uint32_t(m_free_list >> s_version_shift); }
+
     #ifdef DEBUG
     void dump(std::ostream& out) const;
     void info(void* p, size_t& obj_idx, size_t& next_idx) const;
@@ -227,15 +243,18 @@ fixed_size_object_pool<PointerType>
 
 template <class PointerType>
 void* fixed_size_object_pool<PointerType>
-::allocate() 
+::allocate(alloc_stats* a_stats) 
 {
     BOOST_ASSERT(m_magic == s_magic);
 
-    while(1) {
-        size_t old_head = m_free_list;
+    for (unsigned retries = 0;; ++retries) {
+        uint64_t old_head = m_free_list;
 
-        if ((old_head & s_index_mask) == 0)
+        if ((old_head & s_index_mask) == 0) {
+            if (a_stats)
+                a_stats->on_exhausted(0, retries);
             return NULL;
+        }
 
         // Free list is not empty
         object_t* p = head_to_object(old_head);
@@ -248,8 +267,8 @@ void* fixed_size_object_pool<PointerType>
             //   (old_head & s_index_mask) << ", ptr_idx=" << 
             //   object_idx(pt) << ")!");
 
-        size_t new_head = p->next ? object_to_head(old_head, p->next)
-                                  : new_head_version(old_head);
+        uint64_t new_head = p->next ? object_to_head(old_head, p->next)
+                                    : new_head_version(old_head);
 
         BOOST_ASSERT((new_head & s_index_mask) >= 0 &&
                (new_head & s_index_mask) <= m_object_count);
@@ -265,6 +284,8 @@ void* fixed_size_object_pool<PointerType>
             #ifdef DEBUG
             atomic::add(&m_available, -1);
             #endif
+            if (a_stats)
+                a_stats->on_alloc(0, retries);
             return (void *)(++p);
         }
     }
@@ -272,7 +293,7 @@ void* fixed_size_object_pool<PointerType>
 
 template <class PointerType>
 void fixed_size_object_pool<PointerType>
-::free(void* object)
+::free(void* object, alloc_stats* a_stats)
 {
     if (object == NULL) return;
 
@@ -286,9 +307,10 @@ void fixed_size_object_pool<PointerType>
     obj->freed = 1;
     #endif
 
-    size_t old_head, new_head;
+    uint64_t old_head, new_head;
+    unsigned retries = 0;
 
-    do {
+    for (;; ++retries) {
         old_head  = m_free_list;
         obj->next = (old_head & s_index_mask) == 0 
                   ? NULL
@@ -300,11 +322,15 @@ void fixed_size_object_pool<PointerType>
             // "Invalid old head of free list: " << (old_head & s_index_mask) <<
             // " (new_head=" << (new_head & s_index_mask) << 
             // ", avail=" << m_available << ')');
-    } while (!atomic::cas(&m_free_list, old_head, new_head));
+        if (atomic::cas(&m_free_list, old_head, new_head))
+            break;
+    }
 
     #ifdef DEBUG
     atomic::inc(&m_available);
     #endif
+    if (a_stats)
+        a_stats->on_free(0, retries);
 }
 
 template <class PointerType>
@@ -342,7 +368,7 @@ void fixed_size_object_pool<PointerType>
         out << "NULL" << std::endl;
     else
         out << (m_free_list & s_index_mask) << " (version: " 
-            << (m_free_list >> 16) << ")" << std::endl;
+            << version() << ")" << std::endl;
 
     for(pointer_type p=m_begin; p < m_end; p += m_object_size) {
         object_t& o = reinterpret_cast<object_t&>(*p);
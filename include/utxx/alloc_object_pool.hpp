@@ -0,0 +1,302 @@
+//----------------------------------------------------------------------------
+/// \file   alloc_object_pool.hpp
+/// \author Serge Aleynikov
+//----------------------------------------------------------------------------
+/// \brief Pool of a compile-time number of objects addressed by handles.
+///
+/// The object_pool<T, N> holds N cache-line aligned slots of type T linked
+/// in an intrusive free list.  Objects are referred to by 32-bit handles
+/// combining a slot index and the slot's generation, which is advanced on
+/// every create and destroy, so that a stale handle of a destroyed object
+/// is detected instead of silently accessing a reused slot.  A policy
+/// template parameter selects a single-threaded or a lock-free free list.
+//----------------------------------------------------------------------------
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#pragma once
+
+#include <boost/noncopyable.hpp>
+#include <utxx/atomic.hpp>
+#include <utxx/compiler_hints.hpp>
+#include <utxx/error.hpp>
+#include <atomic>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace utxx   {
+namespace memory {
+
+namespace detail {
+    /// Number of bits needed to hold values 1..n
+    constexpr uint32_t pool_index_bits(uint32_t n) {
+        return n > 1 ? 1 + pool_index_bits(n >> 1) : 1;
+    }
+}
+
+/// Free list policy of an object_pool used by a single thread
+struct single_thread_pool_policy {
+    class free_list {
+        uint32_t m_head;
+    public:
+        explicit free_list(uint32_t a_head) : m_head(a_head) {}
+
+        /// @param a_next function returning the link of a slot by index
+        /// @return index of a free slot or 0 if the list is empty
+        template <class Next>
+        uint32_t pop(Next&& a_next) {
+            uint32_t i = m_head;
+            if (likely(i))
+                m_head = a_next(i).load(std::memory_order_relaxed);
+            return i;
+        }
+
+        template <class Next>
+        void push(uint32_t a_idx, Next&& a_next) {
+            a_next(a_idx).store(m_head, std::memory_order_relaxed);
+            m_head = a_idx;
+        }
+
+        uint32_t head() const { return m_head; }
+    };
+
+    /// Advance the generation of a live slot <a_gen> if it's still <a_expected>
+    static bool retire(std::atomic<uint32_t>& a_gen, uint32_t a_expected,
+                       uint32_t a_next)
+    {
+        if (a_gen.load(std::memory_order_relaxed) != a_expected)
+            return false;
+        a_gen.store(a_next, std::memory_order_relaxed);
+        return true;
+    }
+};
+
+/// Lock-free free list policy of an object_pool.  The head of the list is a
+/// 64-bit word holding the slot index and an ABA version.
+struct lock_free_pool_policy {
+    class free_list {
+        std::atomic<uint64_t> m_head;
+    public:
+        explicit free_list(uint32_t a_head) : m_head(a_head) {}
+
+        template <class Next>
+        uint32_t pop(Next&& a_next) {
+            uint64_t h = m_head.load(std::memory_order_acquire);
+            while (uint32_t(h)) {
+                // The link may be stale if another thread popped the slot,
+                // in which case the version check fails the CAS
+                uint64_t n = ((h >> 32) + 1) << 32
+                           | a_next(uint32_t(h)).load(std::memory_order_relaxed);
+                if (m_head.compare_exchange_weak(h, n, std::memory_order_acquire,
+                                                       std::memory_order_acquire))
+                    return uint32_t(h);
+            }
+            return 0;
+        }
+
+        template <class Next>
+        void push(uint32_t a_idx, Next&& a_next) {
+            uint64_t h = m_head.load(std::memory_order_relaxed);
+            do    a_next(a_idx).store(uint32_t(h), std::memory_order_relaxed);
+            while (!m_head.compare_exchange_weak(h, ((h >> 32) + 1) << 32 | a_idx,
+                                                 std::memory_order_release,
+                                                 std::memory_order_relaxed));
+        }
+
+        uint32_t head() const { return uint32_t(m_head.load(std::memory_order_acquire)); }
+    };
+
+    /// Only one of the threads destroying the same object succeeds
+    static bool retire(std::atomic<uint32_t>& a_gen, uint32_t a_expected,
+                       uint32_t a_next)
+    {
+        return a_gen.compare_exchange_strong(a_expected, a_next,
+                                             std::memory_order_acq_rel);
+    }
+};
+
+/// Pool of N objects of type T with cache-line aligned slots.
+/// Objects are created and looked up by handles.  A handle holds a 1-based
+/// slot index in the low bits and the generation of the slot in the rest of
+/// 32 bits.  The generation is odd while the slot is in use, and is
+/// incremented on create and destroy, so a stale handle is rejected by get()
+/// and destroy() until the generation wraps around (after
+/// 2^(31-index_bits) reuses of the same slot).
+/// Note that prior to C++17 operator new doesn't honor the extended alignment
+/// of the slots, so the pool should be a static/member/stack object.
+/// @tparam T      object type
+/// @tparam N      capacity of the pool
+/// @tparam Policy single_thread_pool_policy or lock_free_pool_policy
+template <class T, uint32_t N, class Policy = lock_free_pool_policy>
+class object_pool : boost::noncopyable {
+public:
+    /// Number of bits of a handle holding the slot index
+    static constexpr uint32_t index_bits() { return detail::pool_index_bits(N); }
+
+    static_assert(N > 0,                 "Empty pool");
+    static_assert(N < (1u << 24),        "Too many objects for 32-bit handles");
+
+    /// Type-safe handle of an object in the pool
+    class handle {
+        uint32_t m_value;
+        friend class object_pool;
+        explicit handle(uint32_t a_value) : m_value(a_value) {}
+    public:
+        handle() : m_value(0) {}
+
+        /// Raw value of the handle (0 is the null handle)
+        uint32_t      value() const { return m_value; }
+        static handle from_value(uint32_t a_value) { return handle(a_value); }
+
+        explicit operator bool() const { return m_value != 0; }
+        bool operator==(handle a) const { return m_value == a.m_value; }
+        bool operator!=(handle a) const { return m_value != a.m_value; }
+    };
+
+    object_pool() : m_free(1) {
+        for (uint32_t i = 0; i < N; ++i) {
+            m_slots[i].gen.store(0, std::memory_order_relaxed);
+            m_slots[i].next.store(i+1 < N ? i+2 : 0, std::memory_order_relaxed);
+        }
+    }
+
+    /// Destroys objects that are still alive
+    ~object_pool() {
+        for (auto& s : m_slots)
+            if (s.gen.load(std::memory_order_relaxed) & 1)
+                s.object()->~T();
+    }
+
+    static constexpr uint32_t capacity() { return N; }
+
+    /// Create an object constructed from <a_args>.
+    /// @return the handle of the object or null handle if the pool is exhausted
+    template <class... Args>
+    handle create(Args&&... a_args) {
+        uint32_t i = m_free.pop(link());
+        if (unlikely(!i))
+            return handle();
+        slot& s = m_slots[i-1];
+        try {
+            new (s.data) T(std::forward<Args>(a_args)...);
+        } catch (...) {
+            m_free.push(i, link());
+            throw;
+        }
+        uint32_t gen = (s.gen.load(std::memory_order_relaxed) + 1) & s_gen_mask;
+        s.gen.store(gen, std::memory_order_release);
+        return handle(gen << index_bits() | i);
+    }
+
+    /// Destroy the object referred by <a_handle>.
+    /// @return false if the handle is null or stale
+    bool destroy(handle a_handle) {
+        slot* s = to_slot(a_handle);
+        if (unlikely(!s))
+            return false;
+        uint32_t gen = a_handle.m_value >> index_bits();
+        if (unlikely(!Policy::retire(s->gen, gen, (gen + 1) & s_gen_mask)))
+            return false;
+        s->object()->~T();
+        m_free.push(index(a_handle), link());
+        return true;
+    }
+
+    /// @return pointer to the object or NULL if the handle is null or stale
+    T* get(handle a_handle) {
+        slot* s = to_slot(a_handle);
+        return s && s->gen.load(std::memory_order_acquire) ==
+                    a_handle.m_value >> index_bits()
+             ? s->object() : NULL;
+    }
+
+    const T* get(handle a_handle) const {
+        return const_cast<object_pool*>(this)->get(a_handle);
+    }
+
+    /// @return reference to the object.  Throws badarg_error if the handle
+    ///         is null or stale.
+    T& at(handle a_handle) {
+        T* p = get(a_handle);
+        if (unlikely(!p))
+            UTXX_THROW_BADARG_ERROR("Invalid object handle ", a_handle.value());
+        return *p;
+    }
+
+    bool valid(handle a_handle) const { return get(a_handle) != NULL; }
+
+    /// @return handle of a live object <a_obj> located in the pool
+    handle to_handle(const T* a_obj) const {
+        const char* p = reinterpret_cast<const char*>(a_obj);
+        const char* b = reinterpret_cast<const char*>(m_slots);
+        if (p < b || p >= b + sizeof(m_slots) || (p - b) % sizeof(slot))
+            return handle();
+        uint32_t i = uint32_t((p - b) / sizeof(slot));
+        uint32_t g = m_slots[i].gen.load(std::memory_order_acquire);
+        return (g & 1) ? handle(g << index_bits() | (i+1)) : handle();
+    }
+
+    /// Number of free slots.  O(N), for debugging only (not thread-safe).
+    uint32_t unsafe_available() const {
+        uint32_t n = 0;
+        for (uint32_t i = m_free.head(); i; i = m_slots[i-1].next.load())
+            ++n;
+        return n;
+    }
+
+private:
+    static const uint32_t s_index_mask = (1u << detail::pool_index_bits(N)) - 1;
+    static const uint32_t s_gen_mask   = (1u << (32 - detail::pool_index_bits(N))) - 1;
+
+    struct alignas(alignof(T) > UTXX_CL_SIZE ? alignof(T) : UTXX_CL_SIZE) slot {
+        alignas(T) char         data[sizeof(T)];
+        std::atomic<uint32_t>   gen;    // Odd while the object is alive
+        std::atomic<uint32_t>   next;   // Index of the next free slot
+
+        T* object() { return reinterpret_cast<T*>(data); }
+    };
+
+    slot                        m_slots[N];
+    typename Policy::free_list  m_free;
+
+    static uint32_t index(handle a_handle) { return a_handle.m_value & s_index_mask; }
+
+    slot* to_slot(handle a_handle) {
+        uint32_t i = index(a_handle);
+        return likely(i && i <= N) ? &m_slots[i-1] : NULL;
+    }
+
+    struct next_link {
+        slot* slots;
+        std::atomic<uint32_t>& operator()(uint32_t i) const { return slots[i-1].next; }
+    };
+
+    next_link link() { return next_link{m_slots}; }
+};
+
+} // namespace memory
+} // namespace utxx
@@ -0,0 +1,279 @@
+//----------------------------------------------------------------------------
+/// \file   alloc_owner_pool.hpp
+/// \author Serge Aleynikov
+//----------------------------------------------------------------------------
+/// \brief Single-owner object allocator with a cross-thread return queue.
+///
+/// The owner_pool<T> is allocated from by one (owner) thread and may be
+/// freed to by any thread.  The owner's free list is a plain singly-linked
+/// list, so allocation and owner-side frees use no atomic operations.
+/// Chunks freed by other threads are pushed to an intrusive MPSC return
+/// queue (concurrent_mpsc_queue) at the cost of one CAS, and are taken back
+/// by the owner in a single batch when its local free list runs dry.
+//----------------------------------------------------------------------------
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#pragma once
+
+#include <boost/assert.hpp>
+#include <boost/noncopyable.hpp>
+#include <utxx/alloc_page_source.hpp>
+#include <utxx/alloc_stats.hpp>
+#include <utxx/atomic.hpp>
+#include <utxx/compiler_hints.hpp>
+#include <utxx/concurrent_mpsc_queue.hpp>
+#include <pthread.h>
+#include <algorithm>
+#include <new>
+#include <utility>
+
+namespace utxx   {
+namespace memory {
+
+/**
+ * Allocator of objects of type T owned by a single thread.
+ *
+ * Typical use is a pipeline where messages are allocated by a receiving
+ * thread and released by worker threads.  Only the owner (the thread that
+ * constructed the pool or called claim()) may allocate.  Any thread may
+ * free: the owner's frees go to the local free list, others' frees are
+ * pushed to the return queue and reclaimed by the owner in one batch on
+ * the first allocation that finds the local free list empty (or by
+ * calling drain()).  Otherwise a batch of chunks is carved from pages of
+ * PageSize obtained from the PageSource, which are released when the pool
+ * is destroyed.
+ * An attached alloc_stats counts objects in size class 0 and pages in
+ * size class 1 (a miss is an object allocation that required a new page).
+ */
+template <
+      typename T
+    , size_t   PageSize   = 64*1024
+    , class    PageSource = heap_page_source<PageSize>
+>
+class owner_pool : boost::noncopyable {
+    struct storage { alignas(T) char data[sizeof(T)]; };
+
+    typedef concurrent_mpsc_queue<storage>  queue;
+    typedef typename queue::node            chunk;
+
+    struct header { header* next; };
+
+    static const size_t s_data_offset  =
+        (sizeof(chunk*)  + alignof(storage) - 1) & ~(alignof(storage) - 1);
+    static const size_t s_begin_offset =
+        (sizeof(header)  + alignof(chunk)   - 1) & ~(alignof(chunk)   - 1);
+    static const size_t s_max_chunks   = (PageSize - s_begin_offset) / sizeof(chunk);
+    static const size_t s_refill_batch = 32;    ///< Chunks carved at once
+
+    static_assert((PageSize & (PageSize-1)) == 0, "PageSize must be a power of 2");
+    static_assert(s_max_chunks > 0,               "PageSize too small");
+
+    chunk*       m_free;        ///< Owner's free list
+    char*        m_next;        ///< Next uncarved chunk of the current page
+    char*        m_end;         ///< End of chunks of the current page
+    header*      m_pages;       ///< Allocated pages
+    size_t       m_page_count;
+    pthread_t    m_owner;
+    alloc_stats* m_stats;
+    // Keep the return queue off the owner's cache line
+    char         m_pad[UTXX_CL_SIZE];
+    queue        m_remote;      ///< Chunks freed by other threads
+
+    static chunk* to_chunk(T* p) {
+        return reinterpret_cast<chunk*>(reinterpret_cast<char*>(p) - s_data_offset);
+    }
+
+    static T* to_object(chunk* c) {
+        return reinterpret_cast<T*>(c->data().data);
+    }
+
+    void new_page() {
+        header* h    = static_cast<header*>(PageSource::allocate());
+        h->next      = m_pages;
+        m_pages      = h;
+        ++m_page_count;
+        m_next       = reinterpret_cast<char*>(h) + s_begin_offset;
+        m_end        = m_next + s_max_chunks * sizeof(chunk);
+        if (unlikely(m_stats != NULL))
+            m_stats->on_alloc(page_class);
+    }
+
+    chunk* refill(bool& a_miss) {
+        // Prefer chunks returned by other threads to carving new ones.  The
+        // relaxed check keeps the atomic exchange off the allocation path
+        // of an owner whose objects are rarely freed remotely
+        if (!m_remote.empty()) {
+            chunk* c = m_remote.pop_all_reverse();
+            if (c)
+                return c;
+        }
+        if (unlikely(m_next == m_end)) {
+            new_page();
+            a_miss = true;
+        }
+        // Carve a batch of chunks linked in the order of their addresses
+        size_t n    = std::min(size_t(s_refill_batch),
+                               size_t(m_end - m_next) / sizeof(chunk));
+        chunk* head = NULL;
+        for (char* p = m_next + n*sizeof(chunk); p != m_next;) {
+            p -= sizeof(chunk);
+            chunk* c = new (p) chunk();
+            c->next(head);
+            head = c;
+        }
+        BOOST_ASSERT(reinterpret_cast<char*>(to_object(head)) -
+                     reinterpret_cast<char*>(head) == ptrdiff_t(s_data_offset));
+        m_next += n*sizeof(chunk);
+        return head;
+    }
+
+public:
+    typedef T           value_type;
+    typedef T*          pointer;
+    typedef size_t      size_type;
+
+    enum { object_class, page_class };
+
+    /// The calling thread becomes the owner of the pool
+    owner_pool()
+        : m_free(NULL), m_next(NULL), m_end(NULL), m_pages(NULL)
+        , m_page_count(0), m_owner(pthread_self()), m_stats(NULL)
+    {}
+
+    /// Releases all pages.  All objects must be freed, and all remote frees
+    /// completed, before the pool is destroyed.
+    ~owner_pool() {
+        for (header* p = m_pages, *next; p; p = next) {
+            next = p->next;
+            PageSource::deallocate(p);
+        }
+    }
+
+    /// Allocate uninitialized memory for an object (owner thread only).
+    pointer allocate() {
+        BOOST_ASSERT(is_owner());
+        bool   miss = false;
+        chunk* c    = m_free;
+        if (unlikely(!c))
+            c = refill(miss);
+        m_free = c->next();
+        if (unlikely(m_stats != NULL))
+            m_stats->on_alloc(object_class, 0, miss);
+        return to_object(c);
+    }
+
+    /// Free an object allocated by this pool.  May be called by any thread.
+    void deallocate(pointer p) {
+        if (is_owner())
+            free(p);
+        else
+            remote_free(p);
+    }
+
+    /// Free an object by the owner thread
+    void free(pointer p) {
+        BOOST_ASSERT(is_owner());
+        chunk* c = to_chunk(p);
+        c->next(m_free);
+        m_free = c;
+        if (unlikely(m_stats != NULL))
+            m_stats->on_free(object_class);
+    }
+
+    /// Free an object by a thread other than the owner.  The chunk is pushed
+    /// to the owner's return queue.
+    void remote_free(pointer p) {
+        m_remote.push(to_chunk(p));
+        if (unlikely(m_stats != NULL))
+            m_stats->on_free(object_class);
+    }
+
+    /// Allocate and construct an object (owner thread only)
+    template <typename... Args>
+    pointer create(Args&&... a_args) {
+        pointer p = allocate();
+        try {
+            return new (p) T(std::forward<Args>(a_args)...);
+        } catch (...) {
+            free(p);
+            throw;
+        }
+    }
+
+    /// Destroy and free an object.  May be called by any thread.
+    void destroy(pointer p) {
+        p->~T();
+        deallocate(p);
+    }
+
+    /// Move chunks freed by other threads to the local free list (owner
+    /// thread only).
+    /// @return number of reclaimed chunks
+    size_t drain() {
+        BOOST_ASSERT(is_owner());
+        chunk* head = m_remote.pop_all_reverse();
+        if (!head)
+            return 0;
+        size_t n = 1;
+        chunk* tail = head;
+        for (; tail->next(); tail = tail->next())
+            ++n;
+        tail->next(m_free);
+        m_free = head;
+        return n;
+    }
+
+    /// Make the calling thread the owner of the pool.  The previous owner
+    /// must no longer allocate from the pool.
+    void claim()            { m_owner = pthread_self(); }
+    bool is_owner()   const { return pthread_equal(m_owner, pthread_self()); }
+
+    /// Number of pages allocated by the pool
+    size_t pages()    const { return m_page_count; }
+
+    /// True if no chunks are waiting in the return queue
+    bool remote_empty() const { return m_remote.empty(); }
+
+    static constexpr size_t chunk_size()     { return sizeof(chunk);  }
+    static constexpr size_t chunks_per_page(){ return s_max_chunks;   }
+    /// Number of chunks carved from a page at once
+    static constexpr size_t refill_batch()   { return s_refill_batch; }
+
+    /// Attach statistics collector (NULL detaches).  It must have at least
+    /// two size classes, whose chunk sizes are set to sizeof(T) and PageSize.
+    void stats(alloc_stats* a_stats) {
+        BOOST_ASSERT(!a_stats || a_stats->classes() > page_class);
+        if (a_stats) {
+            a_stats->class_size(object_class, sizeof(T));
+            a_stats->class_size(page_class,   PageSize);
+        }
+        m_stats = a_stats;
+    }
+    alloc_stats* stats() const { return m_stats; }
+};
+
+} // namespace memory
+} // namespace utxx
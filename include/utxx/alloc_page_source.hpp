@@ -0,0 +1,251 @@
+//----------------------------------------------------------------------------
+/// \file   alloc_page_source.hpp
+/// \author Serge Aleynikov
+//----------------------------------------------------------------------------
+/// \brief Sources of aligned memory pages for page allocators.
+///
+/// A page source is a class with static allocate() and deallocate(void*)
+/// functions returning memory pages aligned at their size.  The
+/// heap_page_source uses posix_memalign(3).  The numa_page_source hands out
+/// pages from per-NUMA-node arenas of chunks bound to the node of the CPU
+/// the caller is running on, optionally backed by huge pages.
+//----------------------------------------------------------------------------
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#pragma once
+
+#include <boost/assert.hpp>
+#include <utxx/cpu.hpp>
+#include <utxx/huge_pages.hpp>
+#include <utxx/synch.hpp>
+#include <utxx/compiler_hints.hpp>
+#include <utxx/error.hpp>
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <cstdint>
+#include <mutex>
+#include <new>
+
+namespace utxx   {
+namespace memory {
+
+//----------------------------------------------------------------------------
+/// Page source allocating pages of PageSize aligned at PageSize in the heap
+//----------------------------------------------------------------------------
+template <size_t PageSize>
+struct heap_page_source {
+    static void* allocate() {
+        void* p;
+        #if defined(_WIN32) || defined (_WIN64)
+        p = _aligned_malloc(PageSize, PageSize);
+        if (!p)
+            throw std::bad_alloc();
+        #else
+        if (posix_memalign(&p, PageSize, PageSize) != 0)
+            throw std::bad_alloc();
+        #endif
+        return p;
+    }
+
+    static void deallocate(void* a_page) {
+        #if defined(_WIN32) || defined (_WIN64)
+        _aligned_free(a_page);
+        #else
+        ::free(a_page);
+        #endif
+    }
+};
+
+/// Per-node statistics of the numa_page_source
+struct numa_page_stats {
+    long chunks;            ///< Chunks mapped on the node
+    long huge_chunks;       ///< Chunks backed by explicit huge pages
+    long huge_fallbacks;    ///< Explicit huge page mappings that failed
+    long pages_used;        ///< Pages handed out
+    long pages_free;        ///< Released pages cached for reuse
+};
+
+/// NUMA node holding the memory page at \a a_addr (-1 if unknown).
+/// The page is faulted in if it was not touched yet.
+inline int numa_node_of(const void* a_addr) {
+    int node = -1;
+    return ::syscall(SYS_get_mempolicy, &node, NULL, 0, a_addr,
+                     MPOL_F_NODE | MPOL_F_ADDR) == 0 ? node : -1;
+}
+
+//----------------------------------------------------------------------------
+/// Page source allocating node-local pages.
+///
+/// Pages are carved from chunks of ChunkSize aligned at ChunkSize, mmap'ed
+/// and bound to a NUMA node with MPOL_PREFERRED, so that pages are placed on
+/// the node even if they are first touched by a thread running elsewhere.
+/// The first page of every chunk holds the chunk's header (the owning node).
+/// Released pages are returned to the free list of their node and are never
+/// unmapped.
+///
+/// @tparam PageSize  size of pages (power of 2)
+/// @tparam Huge      huge page backing of chunks
+/// @tparam ChunkSize size of chunks requested from the OS (power of 2, at
+///                   least 4 pages, and a multiple of 2M for huge pages)
+//----------------------------------------------------------------------------
+template <
+      size_t     PageSize  = 64*1024
+    , huge_pages Huge      = huge_pages::NONE
+    , size_t     ChunkSize = 2*1024*1024
+>
+class numa_page_source {
+    static_assert((PageSize  & (PageSize -1)) == 0, "PageSize must be a power of 2");
+    static_assert((ChunkSize & (ChunkSize-1)) == 0, "ChunkSize must be a power of 2");
+    static_assert(ChunkSize >= 4*PageSize, "ChunkSize too small");
+    static_assert(Huge == huge_pages::NONE || ChunkSize % (2*1024*1024) == 0,
+                  "ChunkSize must be a multiple of the huge page size");
+
+    struct chunk_header {
+        int node;
+    };
+
+    struct alignas(64) node_arena {
+        synch::spin_lock lock;
+        void*            free_list = nullptr;   ///< Linked via the first word
+        char*            next      = nullptr;   ///< Next page of current chunk
+        char*            end       = nullptr;   ///< End of current chunk
+        numa_page_stats  stats     = {0, 0, 0, 0, 0};
+    };
+
+    static node_arena& arena(int a_node) {
+        static node_arena s_arenas[max_nodes];
+        return s_arenas[a_node];
+    }
+
+    static void bind(void* a_addr, size_t a_len, int a_node) {
+        // The kernel reads maxnode-1 bits of the mask. Failures are ignored
+        // (e.g. kernels without NUMA support)
+        BOOST_ASSERT(a_node >= 0 && a_node < max_nodes);
+        unsigned long mask = 1ul << a_node;
+        ::syscall(SYS_mbind, a_addr, a_len, MPOL_PREFERRED, &mask,
+                  8*sizeof(mask) + 1, 0);
+    }
+
+    static char* map_chunk(int a_node, numa_page_stats& a_stats) {
+        const int prot  = PROT_READ | PROT_WRITE;
+        const int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+        void* p = MAP_FAILED;
+
+        if (Huge == huge_pages::EXPLICIT) {
+            p = ::mmap(NULL, ChunkSize, prot, flags | MAP_HUGETLB, -1, 0);
+            if (p != MAP_FAILED && (uintptr_t(p) & (ChunkSize-1)) != 0) {
+                ::munmap(p, ChunkSize);
+                p = MAP_FAILED;
+            }
+            ++(p == MAP_FAILED ? a_stats.huge_fallbacks : a_stats.huge_chunks);
+        }
+        if (p == MAP_FAILED) {
+            // Over-map to align the chunk at ChunkSize
+            char* raw = static_cast<char*>
+                (::mmap(NULL, 2*ChunkSize, prot, flags, -1, 0));
+            if (raw == MAP_FAILED)
+                throw std::bad_alloc();
+            char* c = reinterpret_cast<char*>
+                ((uintptr_t(raw) + ChunkSize-1) & ~uintptr_t(ChunkSize-1));
+            if (c > raw)
+                ::munmap(raw, c - raw);
+            if (raw + 2*ChunkSize > c + ChunkSize)
+                ::munmap(c + ChunkSize, raw + 2*ChunkSize - (c + ChunkSize));
+            p = c;
+            if (Huge != huge_pages::NONE)
+                ::madvise(p, ChunkSize, MADV_HUGEPAGE);
+        }
+        bind(p, ChunkSize, a_node);
+        ++a_stats.chunks;
+        return static_cast<char*>(p);
+    }
+
+public:
+    static const int    max_nodes  = 64;
+    static const size_t page_size  = PageSize;
+    static const size_t chunk_size = ChunkSize;
+
+    /// Allocate a page on NUMA node \a a_node (-1 - the node of the CPU the
+    /// calling thread is running on).  Nodes past max_nodes are not
+    /// supported: an explicit one is rejected, and the current one is
+    /// folded onto the supported range.
+    static void* allocate(int a_node = -1) {
+        if (unlikely(a_node >= max_nodes))
+            throw badarg_error("numa_page_source: unsupported node ", a_node);
+        int node = a_node < 0 ? current_numa_node() : a_node;
+        if (unlikely(node >= max_nodes))
+            node %= max_nodes;
+        node_arena& a = arena(node);
+        std::lock_guard<synch::spin_lock> g(a.lock);
+        void* p = a.free_list;
+        if (p) {
+            a.free_list = *static_cast<void**>(p);
+            --a.stats.pages_free;
+        } else {
+            if (a.next == a.end) {
+                char* c = map_chunk(node, a.stats);
+                reinterpret_cast<chunk_header*>(c)->node = node;
+                a.next = c + PageSize;
+                a.end  = c + ChunkSize;
+            }
+            p = a.next;
+            a.next += PageSize;
+        }
+        ++a.stats.pages_used;
+        return p;
+    }
+
+    /// Return a page to the free list of the node it was allocated on
+    static void deallocate(void* a_page) {
+        int node = reinterpret_cast<const chunk_header*>
+                   (uintptr_t(a_page) & ~uintptr_t(ChunkSize-1))->node;
+        node_arena& a = arena(node);
+        std::lock_guard<synch::spin_lock> g(a.lock);
+        *static_cast<void**>(a_page) = a.free_list;
+        a.free_list = a_page;
+        --a.stats.pages_used;
+        ++a.stats.pages_free;
+    }
+
+    /// Node that owns a page allocated by this source
+    static int node(const void* a_page) {
+        return reinterpret_cast<const chunk_header*>
+               (uintptr_t(a_page) & ~uintptr_t(ChunkSize-1))->node;
+    }
+
+    /// Snapshot of statistics of the node \a a_node
+    static numa_page_stats stats(int a_node) {
+        node_arena& a = arena(a_node % max_nodes);
+        std::lock_guard<synch::spin_lock> g(a.lock);
+        return a.stats;
+    }
+};
+
+} // namespace memory
+} // namespace utxx
@@ -0,0 +1,349 @@
+//----------------------------------------------------------------------------
+/// \file   alloc_stats.hpp
+/// \author Serge Aleynikov
+//----------------------------------------------------------------------------
+/// \brief Opt-in allocation statistics of utxx allocators.
+///
+/// An alloc_stats instance is attached to an allocator (cached_allocator,
+/// pow2_allocator, aligned_page_allocator) or passed to the calls of a
+/// fixed_size_object_pool, and counts per size class allocations, frees,
+/// misses (requests not served from a free list) and failed CAS attempts on
+/// shared free lists.  Counters are thread_cached_int's, so the hot path only
+/// updates thread-local values.  Bytes in use and high-water marks are derived
+/// from the counters.  Optionally the latency of every N-th allocation is
+/// sampled into a perf_histogram.
+//----------------------------------------------------------------------------
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#pragma once
+
+#include <boost/noncopyable.hpp>
+#include <utxx/compiler_hints.hpp>
+#include <utxx/perf_histogram.hpp>
+#include <utxx/thread_cached_int.hpp>
+#include <atomic>
+#include <initializer_list>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+
+namespace utxx   {
+namespace memory {
+
+/// Snapshot of statistics of one size class of an allocator
+struct alloc_class_stats {
+    size_t  size;           ///< Chunk size of the class in bytes
+    long    allocs;         ///< Number of allocations
+    long    frees;          ///< Number of deallocations
+    long    misses;         ///< Requests not served from a free list
+    long    retries;        ///< Failed CAS attempts on shared free lists
+    long    high_water;     ///< Max number of chunks in use observed
+
+    long    in_use()       const { return allocs - frees; }
+    size_t  bytes_in_use() const { return in_use() > 0 ? in_use() * size : 0; }
+};
+
+/// Allocation statistics of an allocator with a number of size classes.
+/// A size class beyond classes()-1 is accounted in the last class.
+/// By default the chunk size of class i is 2^i (see cached_allocator and
+/// pow2_allocator), other sizes are given at construction or by class_size().
+///
+/// The high-water mark is updated on every allocation from the shared totals
+/// and the calling thread's cached counts, so it's exact for a single thread
+/// and may miss peaks by the counts cached by other threads (up to the
+/// counters' cache size per thread).
+class alloc_stats : boost::noncopyable {
+public:
+    struct tag {};
+    typedef thread_cached_int<long, tag> counter;
+
+    /// @param a_name       name of the allocator printed by dump()
+    /// @param a_classes    number of size classes (chunk size of class i is 2^i)
+    /// @param a_cache_size number of updates of a thread's counter cached
+    ///                     before it is added to the shared total
+    explicit alloc_stats(const std::string& a_name = std::string(),
+                         size_t a_classes = 32, uint32_t a_cache_size = 64)
+    {
+        init(a_classes, a_cache_size);
+        m_name = a_name;
+        for (size_t i = 0; i < m_count; ++i)
+            m_classes[i].size = i < 8*sizeof(size_t) ? size_t(1) << i : 0;
+    }
+
+    /// Stats with explicitly given chunk sizes of size classes
+    alloc_stats(const std::string& a_name, std::initializer_list<size_t> a_sizes,
+                uint32_t a_cache_size = 64)
+    {
+        init(a_sizes.size(), a_cache_size);
+        m_name = a_name;
+        size_t i = 0;
+        for (auto sz : a_sizes)
+            m_classes[i++].size = sz;
+    }
+
+    ~alloc_stats() {
+        for (auto& h : m_hist.access_all_threads())
+            h.parent = nullptr;
+    }
+
+    const std::string& name()    const { return m_name;  }
+    size_t             classes() const { return m_count; }
+
+    size_t class_size(size_t a_class) const { return m_classes[clamp(a_class)].size; }
+    void   class_size(size_t a_class, size_t a_size) { m_classes[clamp(a_class)].size = a_size; }
+
+    /// Record an allocation of a chunk of size class <a_class>.
+    /// @param a_retries number of failed CAS attempts on shared free lists
+    /// @param a_miss    true if the chunk was not served from a free list
+    void on_alloc(size_t a_class, unsigned a_retries = 0, bool a_miss = false) {
+        size_class& c = m_classes[clamp(a_class)];
+        ++c.allocs;
+        if (unlikely(a_retries)) c.retries += a_retries;
+        if (unlikely(a_miss))    ++c.misses;
+        update_high_water(c, c.allocs.read_fast() + c.allocs.read_local()
+                           - c.frees.read_fast()  - c.frees.read_local());
+    }
+
+    /// Record an allocation request of size class <a_class> that failed
+    /// (e.g. because the pool is exhausted).  It's counted as a miss.
+    void on_exhausted(size_t a_class, unsigned a_retries = 0) {
+        size_class& c = m_classes[clamp(a_class)];
+        ++c.misses;
+        if (a_retries) c.retries += a_retries;
+    }
+
+    /// Record a deallocation of a chunk of size class <a_class>.
+    void on_free(size_t a_class, unsigned a_retries = 0) {
+        size_class& c = m_classes[clamp(a_class)];
+        ++c.frees;
+        if (unlikely(a_retries)) c.retries += a_retries;
+    }
+
+    /// Time every <a_rate>-th allocation of each thread (0 disables timing).
+    void latency_sampling(unsigned a_rate) {
+        m_sample_rate.store(a_rate, std::memory_order_relaxed);
+    }
+
+    unsigned latency_sampling() const {
+        return m_sample_rate.load(std::memory_order_relaxed);
+    }
+
+    /// Called by an allocator before an allocation.
+    /// @return true if timing of this allocation has started, in which case
+    ///         sample_stop() must be called when it's done.
+    bool sample_start() {
+        unsigned rate = m_sample_rate.load(std::memory_order_relaxed);
+        if (likely(rate == 0))
+            return false;
+        thread_histogram* h = m_hist.get();
+        if (unlikely(!h))
+            h = make_histogram();
+        if (++h->tick < rate)
+            return false;
+        h->tick = 0;
+        h->hist.start();
+        return true;
+    }
+
+    void sample_stop() { m_hist->hist.stop(); }
+
+    /// @return merged allocation latency samples of all threads.
+    /// The samples of running threads are read without synchronization,
+    /// so the result is approximate while they keep allocating.
+    perf_histogram latency() const {
+        std::lock_guard<std::mutex> g(m_lock);
+        perf_histogram res(m_exited);
+        for (auto& h : m_hist.access_all_threads())
+            res += h.hist;
+        return res;
+    }
+
+    /// @return exact statistics of size class <a_class>.  Slow since it
+    ///         reads all threads' counters under a lock.
+    alloc_class_stats snapshot(size_t a_class) const {
+        const size_class& c = m_classes[clamp(a_class)];
+        alloc_class_stats s;
+        s.size    = c.size;
+        s.allocs  = c.allocs.read_full();
+        s.frees   = c.frees.read_full();
+        s.misses  = c.misses.read_full();
+        s.retries = c.retries.read_full();
+        s.high_water = update_high_water(c, s.in_use());
+        return s;
+    }
+
+    /// @return totals of all size classes (size is the bytes in use and
+    ///         high_water is the sum of high-water marks of all classes).
+    alloc_class_stats total() const {
+        alloc_class_stats t = alloc_class_stats();
+        size_t bytes = 0;
+        for (size_t i = 0; i < m_count; ++i) {
+            alloc_class_stats s = snapshot(i);
+            t.allocs     += s.allocs;
+            t.frees      += s.frees;
+            t.misses     += s.misses;
+            t.retries    += s.retries;
+            t.high_water += s.high_water;
+            bytes        += s.bytes_in_use();
+        }
+        t.size = bytes;
+        return t;
+    }
+
+    /// Reset all counters (best effort while allocations are in progress).
+    void reset() {
+        for (size_t i = 0; i < m_count; ++i) {
+            size_class& c = m_classes[i];
+            c.allocs.set(0);  c.frees.set(0);
+            c.misses.set(0);  c.retries.set(0);
+            c.high_water.store(0, std::memory_order_relaxed);
+        }
+        std::lock_guard<std::mutex> g(m_lock);
+        m_exited.reset();
+        for (auto& h : m_hist.access_all_threads())
+            h.hist.reset();
+    }
+
+    /// Print a table of size classes having allocations (or all classes
+    /// if <a_all> is true) followed by the latency histogram if sampled.
+    void dump(std::ostream& out, bool a_all = false) const {
+        alloc_class_stats t = alloc_class_stats();
+        size_t bytes = 0, high_bytes = 0;
+
+        out << (m_name.empty() ? "Allocator" : m_name.c_str()) << " statistics:\n"
+            << "  Class       Size     Allocs      Frees     InUse  HighWater"
+               "        Bytes     Misses    Retries\n";
+        for (size_t i = 0; i < m_count; ++i) {
+            alloc_class_stats s = snapshot(i);
+            t.allocs  += s.allocs;  t.frees   += s.frees;
+            t.misses  += s.misses;  t.retries += s.retries;
+            bytes      += s.bytes_in_use();
+            high_bytes += s.high_water * s.size;
+            if (!a_all && !s.allocs && !s.misses)
+                continue;
+            out << "  " << std::setw(5)  << i
+                << ' '  << std::setw(10) << s.size
+                << ' '  << std::setw(10) << s.allocs
+                << ' '  << std::setw(10) << s.frees
+                << ' '  << std::setw(9)  << s.in_use()
+                << ' '  << std::setw(10) << s.high_water
+                << ' '  << std::setw(12) << s.bytes_in_use()
+                << ' '  << std::setw(10) << s.misses
+                << ' '  << std::setw(10) << s.retries << '\n';
+        }
+        out << "  Total" << std::setw(22) << t.allocs
+            << ' '  << std::setw(10) << t.frees
+            << ' '  << std::setw(9)  << t.in_use()
+            << ' '  << std::setw(10) << ""
+            << ' '  << std::setw(12) << bytes
+            << ' '  << std::setw(10) << t.misses
+            << ' '  << std::setw(10) << t.retries << '\n'
+            << "  High-water bytes: " << high_bytes << std::endl;
+
+        if (latency_sampling()) {
+            perf_histogram h("  Allocation latency (sampled 1/" +
+                             std::to_string(latency_sampling()) + "):");
+            h += latency();
+            h.dump(out);
+        }
+    }
+
+    std::string to_string(bool a_all = false) const {
+        std::stringstream s;
+        dump(s, a_all);
+        return s.str();
+    }
+
+private:
+    struct size_class {
+        counter                     allocs, frees, misses, retries;
+        mutable std::atomic<long>   high_water;
+        size_t                      size;
+        size_class() : high_water(0), size(0) {}
+    };
+
+    // Latency samples of a thread added to the parent's totals on thread exit
+    struct thread_histogram {
+        alloc_stats*        parent;
+        perf_histogram      hist;
+        unsigned            tick;
+
+        explicit thread_histogram(alloc_stats* a_parent)
+            : parent(a_parent), tick(0)
+        {}
+
+        ~thread_histogram() {
+            if (!parent) return;
+            std::lock_guard<std::mutex> g(parent->m_lock);
+            parent->m_exited += hist;
+        }
+    };
+
+    std::string                             m_name;
+    size_t                                  m_count;
+    std::unique_ptr<size_class[]>           m_classes;
+    std::atomic<unsigned>                   m_sample_rate;
+    mutable std::mutex                      m_lock;
+    perf_histogram                          m_exited;
+    thr_local_ptr<thread_histogram, tag>    m_hist; // Must be last for dtor ordering
+
+    void init(size_t a_classes, uint32_t a_cache_size) {
+        m_count   = a_classes ? a_classes : 1;
+        m_classes.reset(new size_class[m_count]);
+        m_sample_rate.store(0, std::memory_order_relaxed);
+        for (size_t i = 0; i < m_count; ++i) {
+            size_class& c = m_classes[i];
+            c.allocs.cache_size(a_cache_size);
+            c.frees.cache_size(a_cache_size);
+            c.misses.cache_size(a_cache_size);
+            c.retries.cache_size(a_cache_size);
+        }
+    }
+
+    size_t clamp(size_t a_class) const {
+        return likely(a_class < m_count) ? a_class : m_count-1;
+    }
+
+    static long update_high_water(const size_class& c, long a_in_use) {
+        long hw = c.high_water.load(std::memory_order_relaxed);
+        while (a_in_use > hw &&
+               !c.high_water.compare_exchange_weak(hw, a_in_use,
+                                                   std::memory_order_relaxed));
+        return std::max(hw, a_in_use);
+    }
+
+    thread_histogram* make_histogram() {
+        thread_histogram* h = new thread_histogram(this);
+        m_hist.reset(h);
+        return h;
+    }
+};
+
+} // namespace memory
+} // namespace utxx
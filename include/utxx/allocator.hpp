@@ -66,21 +66,32 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <string>
 #include <sstream>
 #include <iostream>
+#include <boost/noncopyable.hpp>
 #include <utxx/meta.hpp>
 #include <utxx/math.hpp>
 #include <utxx/atomic.hpp>
+#include <utxx/alloc_stats.hpp>
+#include <utxx/error.hpp>
+#include <utxx/huge_pages.hpp>
+#include <utxx/robust_mutex.hpp>
+#include <atomic>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/stat.h>
 
 #ifdef ALLOC_TRACE
 #  include <iomanip>
 #  define TRACEIT(X) { std::stringstream _s; _s << X; std::cerr << _s.str() << std::endl; }
 #else
-#  define TRACEIT(X) (void*)0
+#  define TRACEIT(X) (void)0
 #endif
 
 namespace utxx {
 namespace memory {
 
-class shmem_manager {
+/// Owns the mapping of a shared memory file, which it unmaps on destruction,
+/// and therefore is not copyable.
+class shmem_manager : boost::noncopyable {
 public:
     enum init_mode {
           TRUNCATE_SHARED_MEMORY
@@ -96,9 +107,17 @@ public:
     ///            <total_mem_size>.
     /// @param <remove_on_destruct> if true then the memory mapped file
     ///            will be deleted on destruction of this instance.
+    /// @param <map_options> extra mmap(2) flags (e.g. MAP_POPULATE to
+    ///            pre-fault the mapping).
+    /// @param <huge> huge page backing. A file located on hugetlbfs is
+    ///            always backed by explicit huge pages (and its size is
+    ///            rounded up to the huge page size). Otherwise a value
+    ///            other than NONE advises transparent huge pages.
     shmem_manager(const char* filename, size_t sz = 0,
                   init_mode mode = ATTACH_SHARED_MEMORY,
-                  bool remove_on_destruct = false)
+                  bool remove_on_destruct = false,
+                  int  map_options = 0,
+                  huge_pages huge  = huge_pages::NONE)
         throw(std::runtime_error);
 
     ~shmem_manager();
@@ -117,6 +136,10 @@ public:
     /// True if the shared memory was truncated on construction.
     bool               truncated() const { return m_truncated; }
 
+    /// Huge page backing of the mapping (TRANSPARENT means the advice
+    /// was accepted by the kernel).
+    huge_pages         huge()      const { return m_huge; }
+
 private:
     size_t          m_size;
     int             m_fd;
@@ -126,8 +149,85 @@ private:
     bool            m_remove_file;
     size_t          m_offset;
     bool            m_truncated;
+    huge_pages      m_huge;
+
+    static std::runtime_error error(const char* what, const std::string& file) {
+        std::stringstream s;
+        s << what << ' ' << file << ": " << strerror(errno);
+        return std::runtime_error(s.str());
+    }
 };
 
+//-----------------------------------------------------------------------------
+// IMPLEMENTATION
+//-----------------------------------------------------------------------------
+
+inline shmem_manager::shmem_manager(
+    const char* filename, size_t sz, init_mode mode, bool remove_on_destruct,
+    int map_options, huge_pages huge) throw(std::runtime_error)
+    : m_size(sz), m_fd(-1), m_filename(filename), m_mode(mode)
+    , m_address(NULL), m_remove_file(remove_on_destruct), m_offset(0)
+    , m_truncated(false), m_huge(huge_pages::NONE)
+{
+    bool truncate = mode == TRUNCATE_SHARED_MEMORY;
+    m_fd = ::open(filename, O_RDWR | (truncate ? O_CREAT : 0), 0660);
+    if (m_fd < 0)
+        throw error("Cannot open file", m_filename);
+
+    size_t huge_size = hugetlbfs_page_size(m_fd);
+
+    if (truncate) {
+        if (huge_size)
+            m_size = page_round_up(m_size, huge_size);
+        if (::ftruncate(m_fd, m_size) < 0) {
+            ::close(m_fd);
+            throw error("Cannot truncate file", m_filename);
+        }
+        m_truncated = true;
+    } else {
+        struct stat st;
+        if (::fstat(m_fd, &st) < 0) {
+            ::close(m_fd);
+            throw error("Cannot stat file", m_filename);
+        }
+        m_size = st.st_size;
+    }
+
+    if (m_size == 0) {
+        ::close(m_fd);
+        throw std::runtime_error("Empty shared memory file " + m_filename);
+    }
+
+    void* p = ::mmap(NULL, m_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | map_options, m_fd, 0);
+    if (p == MAP_FAILED) {
+        ::close(m_fd);
+        throw error("Cannot map file", m_filename);
+    }
+    m_address = static_cast<char*>(p);
+    m_huge    = huge_size ? huge_pages::EXPLICIT
+                          : advise_huge_pages(p, m_size, huge);
+}
+
+inline shmem_manager::~shmem_manager() {
+    if (m_address)
+        ::munmap(m_address, m_size);
+    if (m_fd >= 0)
+        ::close(m_fd);
+    if (m_remove_file)
+        ::unlink(m_filename.c_str());
+}
+
+inline void* shmem_manager::reserve(size_t sz) {
+    // Keep reserved blocks aligned at the cache line size
+    sz = page_round_up(sz, 64);
+    if (sz > available())
+        return NULL;
+    char* p = m_address + m_offset;
+    m_offset += sz;
+    return p;
+}
+
 /**
  * Simple concurrent allocator that manages memory
  * by allocating blocks of power of 2 size-classes.
@@ -136,145 +236,153 @@ private:
  * available in the free list for the nearest power of 2
  * size block of the requested allocation.  Otherwise the block
  * of requested size is fetched from the free list.
- * The allocator is safe for concurrent use.
+ * The allocator is safe for concurrent use by threads and processes
+ * sharing the memory segment.
+ *
+ * Recovery: free lists and the segment offset are guarded by a robust
+ * process-shared mutex located in the segment header, and every chunk is
+ * tagged with its state and the PID of the owning process.  Chunks are laid
+ * out contiguously, so the allocator can always rebuild its free lists by
+ * walking the chunks.  When a process dies holding the mutex, the next
+ * process to lock it rebuilds the free lists before proceeding, so the
+ * lists are never left corrupted.  Chunks owned by dead processes are
+ * reclaimed by recover(), which a supervisor calls e.g. before restarting a
+ * crashed process.  A process handing a chunk to another process should let
+ * the receiver adopt() it, so that the chunk isn't reclaimed if the
+ * allocating process dies.
+ *
+ * Allocation statistics of a process are collected when an alloc_stats
+ * instance is attached by calling stats() (see alloc_stats.hpp).
  */
 template <int MinSize = 8, int MaxPow2Size = 32>
 class pow2_allocator {
 public:
     static const unsigned int max_bucket = MaxPow2Size-1;
 
-    typedef struct {
-        int   next_free;
-        pid_t pid       : 16;  // Pid of the process that allocated this node
-        char  size_class: 8;
-        bool  allocated : 8;
-    } node;
+    enum chunk_state { FREE, ALLOCATED };
+
+    /// Chunk header (16 bytes, so that user data is 16-byte aligned)
+    struct node {
+        int64_t  next_free;     // Offset of next free chunk from the header
+        pid_t    pid;           // Process that owns this chunk (0 if free)
+        uint8_t  size_class;
+        uint8_t  state;         // chunk_state
+        uint16_t reserved;
+    };
 
 protected:
     // Max object size that allocator can allocate
-    static const long max_size = 1 << max_bucket;
+    static const long max_size = 1l << max_bucket;
     // Min object size that allocator allocates
     static const long min_size = MinSize;
     // Magic version number written in the beginning of base address
-    enum { MAGIC = 0xFFDE1234 };
-
-    // Stack used by each size-class specific free list
-    class stack {
-        int   m_head;
-        char* m_base_addr;
-        #ifdef ALLOC_STATS
-        int   m_push_count;
-        #endif
-    public:
-        stack() : m_head(0) {}
-        stack(void* addr) : m_base_addr((char*)addr), m_head(0) {}
-
-        void push(node* nd) {
-            BOOST_ASSERT((char*)nd >= m_base_addr);
-                // "Wrong address range (base: " << m_base_addr << ", addr: " << nd << ')');
-            nd->allocated = false;
-            long curr;
-            do {
-                curr = m_head;
-                nd->next_free = curr;
-            } while (!atomic::cas(&m_head, curr, (char*)nd-m_base_addr));
-            #ifdef ALLOC_STATS
-            atomic_add(m_push_count, 1);
-            #endif
-        }
-
-        node* pop() {
-            volatile int curr;
-            node* nd;
-            do {
-                curr = m_head;
-                if (curr == 0)
-                    return NULL;
-                nd = reinterpret_cast<node*>(m_base_addr + curr);
-            } while (!atomic::cas(&m_head, curr, nd->next_free));
-
-            nd->allocated = true;
-            nd->next_free = 0;
-            return nd;
-        }
-
-        /// Returns number of items in the stack
-        int length() const {
-            int len = 0;
-            int tmp = m_head;
-            while (tmp != 0) {
-                len++;
-                tmp = reinterpret_cast<node*>(m_base_addr + tmp)->next_free;
-            }
-            return len;
-        }
-
-        #ifdef ALLOC_STATS
-        long push_count() const { return m_push_count; }
-        #endif
-    };
+    enum { MAGIC = 0xFFDE1235 };
 
-    struct header {
-        const unsigned int magic;
-        stack  freelist[MaxPow2Size];
-        size_t total_size;
-        size_t offset;
+    // Aligned so that chunks following the header are 16-byte aligned
+    struct alignas(16) header {
+        const unsigned int  magic;
+        pthread_mutex_t     mutex;
+        int64_t             freelist[MaxPow2Size]; // Offsets of first free chunks
+        size_t              total_size;  // Size of the segment including header
+        size_t              offset;      // Offset of the first unused byte
+        long                recoveries;  // Number of free list rebuilds
 
-        header() : magic(pow2_allocator::MAGIC), total_size(0), offset(0) {}
         header(size_t sz)
             : magic(pow2_allocator::MAGIC)
-            , total_size(sz-sizeof(header))
+            , total_size(sz)
             , offset(sizeof(header))
+            , recoveries(0)
         {
             for (int i=0; i < MaxPow2Size; ++i)
-                new (&freelist[i]) stack(this);
+                freelist[i] = 0;
         }
     };
 
-    pow2_allocator() {}
+    pow2_allocator() : m_header(NULL), m_stats(NULL) {}
 
 private:
+    typedef robust_mutex::scoped_lock guard;
+
     header*         m_header;
-    pid_t           m_pid_id;    // PID of the process that created this allocator
-    #ifdef ALLOC_STATS
-    int             m_mem_hits;
-    int             m_pool_hits;
-    #endif
+    alloc_stats*    m_stats;     // Optional statistics of this process
+    robust_mutex    m_mutex;     // Guards m_header->mutex
+
+    void init_mutex();
+
+    node* to_node(int64_t offset) const {
+        return reinterpret_cast<node*>(reinterpret_cast<char*>(m_header) + offset);
+    }
+
+    int64_t to_offset(const node* nd) const {
+        return reinterpret_cast<const char*>(nd) - reinterpret_cast<const char*>(m_header);
+    }
 
     /// Allocate a chunk from the main memory pool given to allocator.
     /// @param <sz> size of a chunk to allocate
     /// @param <size_class> size-class for this chunk
     void* allocate_main_memory(size_t sz, size_t size_class);
 
+    /// Mark chunks owned by processes for which <dead> returns true free
+    /// and rebuild the free lists.  Must be called with the mutex locked.
+    /// @return number of reclaimed chunks
+    template <class Pred>
+    size_t rebuild(Pred dead);
+
+    /// Invoked when a process died holding the mutex
+    int on_owner_dead(robust_mutex& a_mutex);
+
 public:
     /// Initialize shared memory allocator
     /// @param <total_mem_size> is the total memory managed by the allocator
+    /// @param <initialize> if true the segment is formatted, otherwise the
+    ///         allocator attaches to a segment formatted by another instance
     pow2_allocator(void* base_addr, size_t total_mem_size, bool initialize=false)
         throw(badarg_error);
 
     pow2_allocator( const pow2_allocator& a )
         : m_header(a.m_header)
-        , m_pid_id(a.m_pid_id)
-        #ifdef ALLOC_STATS
-        , m_mem_hits(a.m_mem_hits)
-        , m_pool_hits(a.m_pool_hits)
-        #endif
-    {}
+        , m_stats(a.m_stats)
+    {
+        if (m_header)
+            init_mutex();
+    }
+
+    /// The recovery callback of the mutex is bound to this instance,
+    /// so it is rebound rather than copied from \a a
+    pow2_allocator& operator=(const pow2_allocator& a) {
+        m_header = a.m_header;
+        m_stats  = a.m_stats;
+        m_mutex.on_make_consistent.clear();
+        if (m_header)
+            init_mutex();
+        return *this;
+    }
 
     void* allocate(size_t sz);
     void  release(void* p);
 
+    /// Make the calling process the owner of chunk <p> (e.g. when it was
+    /// handed over by another process).
+    void  adopt(void* p) { ptr_to_node(p)->pid = ::getpid(); }
+
+    /// @return number of chunks in the free list of a bucket.
     int freelist_size(int bucket) {
-        return (bucket < MaxPow2Size) ? m_header->freelist[bucket].length() : -1;
+        if (bucket < 0 || bucket >= MaxPow2Size)
+            return -1;
+        guard g(m_mutex);
+        int len = 0;
+        for (int64_t i = m_header->freelist[bucket]; i; i = to_node(i)->next_free)
+            ++len;
+        return len;
     }
 
     /// @return size of memory currently used or pooled
     size_t used_memory()        const { return m_header->offset - sizeof(header); }
     /// @return total memory managed by this allocator
-    size_t total_memory()       const { return m_header->total_size; }
+    size_t total_memory()       const { return m_header->total_size - sizeof(header); }
 
     /// Determine size of memory pointed to by <p>.
-    static size_t size_of(void* p)    { return 1 << ptr_to_node(p)->size_class; }
+    static size_t size_of(void* p)    { return 1ul << ptr_to_node(p)->size_class; }
 
     /// Get node metadata for a given pointer
     static node* ptr_to_node(void* p) { return reinterpret_cast<node*>(p) - 1; }
@@ -285,25 +393,44 @@ public:
     static const size_t header_size() { return sizeof(header); }
 
     /// Beginning of addressable range managed by this allocator
-    const char* begin() const { return static_cast<const char*>(m_header) + sizeof(header); }
-    char*       begin()       { return static_cast<char*>(m_header)       + sizeof(header); }
+    const char* begin() const { return reinterpret_cast<const char*>(m_header) + sizeof(header); }
+    char*       begin()       { return reinterpret_cast<char*>(m_header)       + sizeof(header); }
     /// End of addressable range managed by this allocator
-    const char* end()   const { return begin() + m_header->total_size; }
+    const char* end()   const { return reinterpret_cast<const char*>(m_header) + m_header->total_size; }
+
+    /// @return true if process <pid> exists.
+    static bool process_alive(pid_t pid) {
+        return ::kill(pid, 0) == 0 || errno != ESRCH;
+    }
 
     /// Reclaim all allocated memory blocks owned by process <pid> by
     /// marking them available and moving to the free list.  This method
     /// can be used when implemening an inter-process memory manager, which
     /// detects a death of a process which previously attached to the
     /// shared memory using this allocator.
-    void reclaim_resources(pid_t pid);
+    /// @return number of reclaimed chunks
+    size_t reclaim_resources(pid_t pid);
+
+    /// Reclaim chunks owned by processes that no longer exist and rebuild
+    /// the free lists.
+    /// @return number of reclaimed chunks
+    size_t recover();
+
+    /// Verify that the free lists match the states of the chunks.
+    /// @return true if the allocator's state is consistent.
+    bool consistent();
+
+    /// Number of times the free lists were rebuilt after a process died
+    /// while holding the allocator's mutex.
+    long recoveries()  const { return m_header->recoveries; }
 
     /// @return size of space overhead for each allocated chunk.
     static size_t chunk_header_size() { return sizeof(node); }
 
-    #ifdef ALLOC_STATS
-    int mem_hits()  const { return m_mem_hits; }
-    int pool_hits() const { return m_pool_hits; }
-    #endif
+    /// Attach statistics collector indexed by size class (NULL detaches).
+    /// A miss is counted when a chunk is carved from the main memory pool.
+    void         stats(alloc_stats* a_stats) { m_stats = a_stats; }
+    alloc_stats* stats() const               { return m_stats;    }
 };
 
 struct shmem_allocator_policy {
@@ -419,16 +546,30 @@ inline bool operator!= (const shmem_allocator<T,Policy>& a, const shmem_allocato
 //-----------------------------------------------------------------------------
 // IMPLEMENTATION
 //-----------------------------------------------------------------------------
+namespace detail {
+    /// PID of the calling process cached in user space (getpid(2) is a
+    /// system call) and refreshed in a child process after fork(2).
+    struct process_id {
+        static pid_t get() { return value(); }
+    private:
+        static pid_t& value() {
+            static pid_t s_pid = init();
+            return s_pid;
+        }
+        static pid_t init() {
+            ::pthread_atfork(NULL, NULL, &on_fork);
+            return ::getpid();
+        }
+        static void on_fork() { value() = ::getpid(); }
+    };
+} // namespace detail
+
 template <int MinSize, int MaxPow2Size>
 pow2_allocator<MinSize, MaxPow2Size>
 ::pow2_allocator(void* base_addr, size_t total_mem_size, bool initialize)
     throw(badarg_error)
     : m_header(static_cast<header*>(base_addr))
-    , m_pid_id(::getpid())
-    #ifdef ALLOC_STATS
-    , m_mem_hits(0);
-    , m_pool_hits(0)
-    #endif
+    , m_stats(NULL)
 {
     if (!base_addr)
         throw badarg_error("NULL base address provided!");
@@ -436,41 +577,93 @@ pow2_allocator<MinSize, MaxPow2Size>
     if (total_mem_size <= sizeof(header))
         throw badarg_error("Requested memory is too small");
 
-    if (initialize)
+    if (initialize) {
         new (m_header) header(total_mem_size);
+        m_mutex.init(m_header->mutex);
+    } else if (m_header->magic != MAGIC)
+        throw badarg_error("Incompatible allocator layout (magic: ",
+                           m_header->magic, ')');
+    else if (m_header->total_size != total_mem_size)
+        throw badarg_error("Wrong allocator size (requested: ", total_mem_size,
+                           ", found: ", m_header->total_size, ')');
+
+    init_mutex();
 
     TRACEIT("pow2_allocator(" << this <<
             ") - Allocator constructed (" << m_header <<
             ", initialize=" << initialize << ')');
 }
 
+template <int MinSize, int MaxPow2Size>
+void pow2_allocator<MinSize, MaxPow2Size>
+::init_mutex()
+{
+    m_mutex.set(m_header->mutex);
+    m_mutex.on_make_consistent = [this](robust_mutex& m) { return on_owner_dead(m); };
+}
+
+template <int MinSize, int MaxPow2Size>
+int pow2_allocator<MinSize, MaxPow2Size>
+::on_owner_dead(robust_mutex& a_mutex)
+{
+    // The dead process may have left a free list half-updated
+    rebuild([](pid_t) { return false; });
+    ++m_header->recoveries;
+    TRACEIT("pow2_allocator(" << this << ") - Free lists rebuilt after owner death");
+    return a_mutex.make_consistent();
+}
+
+template <int MinSize, int MaxPow2Size>
+template <class Pred>
+size_t pow2_allocator<MinSize, MaxPow2Size>
+::rebuild(Pred dead)
+{
+    for (int i=0; i < MaxPow2Size; ++i)
+        m_header->freelist[i] = 0;
+
+    // A chunk's header is written before the offset is advanced past it,
+    // so all chunks below the offset are valid
+    size_t n = 0;
+    for (int64_t off = sizeof(header), end = m_header->offset; off < end;) {
+        node* nd = to_node(off);
+        BOOST_ASSERT(nd->size_class < MaxPow2Size);
+        if (nd->state == ALLOCATED && dead(nd->pid)) {
+            nd->state = FREE;
+            ++n;
+        }
+        if (nd->state != ALLOCATED) {
+            nd->state     = FREE;
+            nd->pid       = 0;
+            nd->next_free = m_header->freelist[nd->size_class];
+            m_header->freelist[nd->size_class] = off;
+        }
+        off += 1l << nd->size_class;
+    }
+    return n;
+}
+
 template <int MinSize, int MaxPow2Size>
 void* pow2_allocator<MinSize, MaxPow2Size>
 ::allocate_main_memory(size_t sz, size_t size_class)
 {
-    size_t curr;
-    size_t new_offset;
-
-    do {
-        curr = m_header->offset;
-        new_offset = curr+sz;
-        if (new_offset >= m_header->total_size) {
-            TRACEIT("No room to allocate " << sz << '(' << size_class
-                    << ") bytes (curr=" << curr << ')');
-            return NULL;
-        }
-    } while(!atomic::cas(&m_header->offset, curr, new_offset));
+    size_t curr = m_header->offset;
+
+    if (sz > m_header->total_size - curr) {
+        TRACEIT("No room to allocate " << sz << '(' << size_class
+                << ") bytes (curr=" << curr << ')');
+        return NULL;
+    }
 
-    node* p       = reinterpret_cast<node*>((char*)m_header + curr);
-    p->pid        = m_pid_id;
+    node* p       = to_node(curr);
+    p->pid        = detail::process_id::get();
     p->size_class = size_class;
-    p->allocated  = true;
+    p->state      = ALLOCATED;
     p->next_free  = 0;
+    // Publish the chunk only after its header is complete (see rebuild())
+    std::atomic_signal_fence(std::memory_order_release);
+    m_header->offset = curr + sz;
     TRACEIT("Allocated " << std::setw(9) << sz << '[' << size_class
             << "] bytes (offset=" << curr << ", addr=" << (p+1) << ") - not pooled.");
-    #ifdef ALLOC_STATS
-    atomic_add(m_mem_hits, 1);
-    #endif
     return static_cast<void*>(++p);
 }
 
@@ -479,29 +672,42 @@ void* pow2_allocator<MinSize, MaxPow2Size>
 ::allocate(size_t sz)
 {
     size_t alloc_sz = sz + sizeof(node);
-    char size_class = (alloc_sz < min_size)
+    unsigned size_class = (alloc_sz < min_size)
               ? log<min_size, 2>::value
               : math::upper_log2(alloc_sz);
-    size_t size = 1 << size_class;
 
-    if (size_class > max_bucket)
+    if (size_class > max_bucket) {
+        if (unlikely(m_stats != NULL))
+            m_stats->on_exhausted(size_class);
         return NULL;
+    }
 
-    node* nd = m_header->freelist[size_class].pop();
-    if (nd == NULL)
-        return allocate_main_memory(size, size_class);
-
-    nd->pid = m_pid_id;
-
-    #ifdef ALLOC_STATS
-    atomic_add(m_pool_hits, 1);
-    #endif
+    void* p;
+    bool  miss;
+    {
+        guard g(m_mutex);
+        int64_t off = m_header->freelist[size_class];
+        if ((miss = off == 0))
+            p = allocate_main_memory(1ul << size_class, size_class);
+        else {
+            node* nd = to_node(off);
+            m_header->freelist[size_class] = nd->next_free;
+            nd->pid       = detail::process_id::get();
+            nd->next_free = 0;
+            nd->state     = ALLOCATED;
+            p = nd + 1;
+            TRACEIT("Allocated<" << nd->pid << '>' << std::setw(9)
+                    << (1ul << size_class) << '/' << sz << " bytes (offset="
+                    << off << ", addr=" << p << ") - from pool["
+                    << size_class << ']');
+        }
+    }
 
-    TRACEIT("Allocated<" << m_pid_id << '>' << std::setw(9) 
-            << size << '/' << sz << " bytes (offset="
-            << reinterpret_cast<int>(nd)-reinterpret_cast<int>(m_header)
-            << ", addr=" << (nd+1) << ") - from pool[" << (int)size_class << ']');
-    return ++nd;
+    if (unlikely(m_stats != NULL)) {
+        if (p) m_stats->on_alloc(size_class, 0, miss);
+        else   m_stats->on_exhausted(size_class);
+    }
+    return p;
 }
 
 template <int MinSize, int MaxPow2Size>
@@ -511,36 +717,91 @@ void pow2_allocator<MinSize, MaxPow2Size>
     if (!p) return;
 
     node* nd = ptr_to_node(p);
-    char size_class = nd->size_class;
+    unsigned size_class = nd->size_class;
 
     BOOST_ASSERT(size_class < MaxPow2Size);
         // "Memory size (1 << " << size_class << ") is greater then "
         // "(1 << " << MaxPow2Size << ')');
+    BOOST_ASSERT(nd->state == ALLOCATED);   // Double free
+
+    TRACEIT("Released<" << detail::process_id::get() << "> " << std::setw(9)
+            << (1ul << size_class) << " bytes to pool[" << size_class
+            << "] (offset=" << to_offset(nd) << ", addr=" << p
+            << ", old_pid=" << nd->pid << ')');
+    {
+        guard g(m_mutex);
+        nd->state     = FREE;
+        nd->pid       = 0;
+        nd->next_free = m_header->freelist[size_class];
+        m_header->freelist[size_class] = to_offset(nd);
+    }
 
-    TRACEIT("Released<" << m_pid_id << "> " << std::setw(9)
-            << (1 << size_class) << " bytes to pool[" << (int)size_class
-            << "] (offset=" << reinterpret_cast<int>(nd)-reinterpret_cast<int>(m_header)
-            << ", addr=" << (nd+1) << ", old_pid=" << nd->pid << ')');
-    m_header->freelist[size_class].push(nd);
+    if (unlikely(m_stats != NULL))
+        m_stats->on_free(size_class);
 }
 
 template <int MinSize, int MaxPow2Size>
-void pow2_allocator<MinSize, MaxPow2Size>
+size_t pow2_allocator<MinSize, MaxPow2Size>
 ::reclaim_resources(pid_t pid) {
     // cannot reclaim own resources - we are still alive and may
     // have active references to allocated blocks
-    if (pid == m_pid_id)
-        return;
+    if (pid == detail::process_id::get())
+        return 0;
 
-    char* p   = m_header->begin();
-    char* end = m_header->end();
+    guard g(m_mutex);
+    return rebuild([pid](pid_t p) { return p == pid; });
+}
 
-    while (p < end) {
-        node* nd = static_cast<node*>(p);
-        if (nd->pid == pid && nd->allocated)
-            release(p+sizeof(node));
-        p += (1 << nd->size_class);
+template <int MinSize, int MaxPow2Size>
+size_t pow2_allocator<MinSize, MaxPow2Size>
+::recover() {
+    pid_t self = detail::process_id::get();
+    pid_t last = 0;
+    bool  last_dead = false;
+
+    guard g(m_mutex);
+    // Chunks of a process are usually adjacent, so remember the last answer
+    return rebuild([&](pid_t p) {
+        if (p == self)
+            return false;
+        if (p != last) {
+            last      = p;
+            last_dead = !process_alive(p);
+        }
+        return last_dead;
+    });
+}
+
+template <int MinSize, int MaxPow2Size>
+bool pow2_allocator<MinSize, MaxPow2Size>
+::consistent() {
+    guard g(m_mutex);
+
+    long free_chunks[MaxPow2Size] = {0};
+    int64_t end = m_header->offset;
+    for (int64_t off = sizeof(header); off < end;) {
+        node* nd = to_node(off);
+        if (nd->size_class >= MaxPow2Size || (1l << nd->size_class) < long(sizeof(node)))
+            return false;
+        if (nd->state == FREE)
+            ++free_chunks[nd->size_class];
+        else if (nd->state != ALLOCATED)
+            return false;
+        off += 1l << nd->size_class;
+    }
+
+    for (int i=0; i < MaxPow2Size; ++i) {
+        long n = 0;
+        for (int64_t off = m_header->freelist[i]; off; off = to_node(off)->next_free) {
+            node* nd = to_node(off);
+            if (off < int64_t(sizeof(header)) || off >= end || ++n > free_chunks[i] ||
+                nd->state != FREE || nd->size_class != i)
+                return false;
+        }
+        if (n != free_chunks[i])
+            return false;
     }
+    return true;
 }
 
 } // namespace memory
@@ -117,6 +117,9 @@ namespace atomic {
         template<int N, typename T> bool dcas(
             volatile void* ptr, T* vold, T* vnew);
 
+        // Memory operand spanning both words compared by dcas()
+        template <typename T> struct dword { T lo, hi; };
+
         template<> __inline__ bool dcas<8, unsigned int>(
             volatile void* ptr, unsigned int* vold, unsigned int* vnew)
         {
@@ -124,10 +127,10 @@ namespace atomic {
             __asm__ __volatile__(
                   "lock cmpxchg8b %0 \n"
                   "setz %1"
-                : "+m" (*(unsigned int*)ptr), "=q" (r), "+a" (*vold),
-                  "+d" (*(vold+1))
+                : "+m" (*(volatile dword<unsigned int>*)ptr), "=q" (r),
+                  "+a" (*vold), "+d" (*(vold+1))
                 : "b" (*vnew), "c" (*(vnew+1))
-                : "cc");
+                : "cc", "memory");
             return r;
         }
 
@@ -139,10 +142,10 @@ namespace atomic {
             __asm__ __volatile__(
                   "lock cmpxchg16b %0 \n"
                   "setz %1"
-                : "+m" (*(unsigned long*)ptr), "=q" (r), "+a" (*vold),
-                  "+d" (*(vold+1))
+                : "+m" (*(volatile dword<unsigned long>*)ptr), "=q" (r),
+                  "+a" (*vold), "+d" (*(vold+1))
                 : "b" (*vnew), "c" (*(vnew+1))
-                : "cc");
+                : "cc", "memory");
             return r;
         }
 #endif
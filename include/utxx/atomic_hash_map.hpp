@@ -31,6 +31,8 @@
 ///      capacity.
 ///    - Max size limit of ~18x initial size (dependent on max load factor).
 ///    - Memory is not freed or reclaimed by erase.
+///      (see growable_atomic_hash_map.hpp for a map with incremental resizing
+///      that drops erased cells, at the cost of trivially copyable values)
 ///
 /// Usage and Operation Details:
 ///   Simple performance/memory tradeoff with max_load_factor.  Higher load factors
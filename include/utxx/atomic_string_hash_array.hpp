@@ -0,0 +1,548 @@
+//----------------------------------------------------------------------------
+/// \file   atomic_string_hash_array.hpp
+/// \author Serge Aleynikov
+//----------------------------------------------------------------------------
+/// \brief Lock-free fixed-capacity hash array with arbitrary byte-string keys.
+///
+/// This is a companion of atomic_hash_array for keys that cannot be
+/// compare-and-swapped directly (symbols, ISINs, composite POD keys).
+/// Each cell holds a 64-bit key hash in an atomic word, an offset/length
+/// reference into a parallel append-only key arena, and the value.  The full
+/// key is compared only when the hashes match, so a lookup touches the key
+/// arena at most once per successful find.
+///
+/// The cells and the arena are placed in a single block obtained from the
+/// given allocator and contain no absolute pointers, so the array can be
+/// hosted in shared memory in the same way as atomic_hash_array:
+/// @code
+///     using symbol_map = atomic_string_hash_array<uint32_t>;
+///     auto m = symbol_map::create(10000, alloc);      // alloc -> shm segment
+///     m->insert("AAPL", 1);
+///     const uint32_t* id = m->find("AAPL");
+/// @endcode
+///
+/// Like atomic_hash_array, it cannot grow, erased cells are never reused,
+/// and the key bytes of erased entries are not reclaimed.  The hash
+/// function must be stateless and produce the same value in every process
+/// sharing the array.
+//----------------------------------------------------------------------------
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+#include <assert.h>
+#include <boost/noncopyable.hpp>
+#include <utxx/compiler_hints.hpp>
+#include <utxx/backoff.hpp>
+#include <utxx/hashmap.hpp>
+
+namespace utxx {
+
+/// Default key hash for atomic_string_hash_array (64-bit MurmurHash2)
+struct string_key_hash {
+    uint64_t operator()(const char* a_key, size_t a_len) const {
+        return detail::murmur_hash64(a_key, int(a_len), 0x9E3779B9);
+    }
+};
+
+template <class ValueT, class HashFcn = string_key_hash>
+class atomic_string_hash_array : boost::noncopyable {
+    // Reserved values of the cell's hash word
+    static const uint64_t s_empty    = 0;
+    static const uint64_t s_locked   = 1;
+    static const uint64_t s_erased   = 2;
+    static const uint64_t s_reserved = 3;
+
+    // Key reference: 48-bit arena offset and 16-bit length
+    static const int      s_len_bits = 16;
+    static const uint64_t s_len_mask = (1ul << s_len_bits) - 1;
+
+    struct cell {
+        std::atomic<uint64_t> hash;
+        uint64_t              key_ref;
+        ValueT                value;
+    };
+
+    template <class Allocator>
+    class deleter {
+        Allocator* m_alloc;
+    public:
+        deleter(Allocator& a_alloc) : m_alloc(&a_alloc) {}
+        void operator()(atomic_string_hash_array* p) {
+            atomic_string_hash_array::destroy(p, *m_alloc);
+        }
+    };
+
+public:
+    using mapped_type = ValueT;
+    using size_type   = std::size_t;
+
+    /// Maximum length of a key in bytes
+    static constexpr size_t max_key_size() { return s_len_mask; }
+
+    template <typename Allocator>
+    using SmartPtr = std::unique_ptr<atomic_string_hash_array, deleter<Allocator>>;
+
+    struct config {
+        double  m_max_load_factor;
+        size_t  m_avg_key_size;   ///< Used to size the key arena
+        size_t  m_arena_size;     ///< If positive, overrides m_avg_key_size
+
+        static constexpr const double def_max_load_factor = 0.8;
+
+        config
+        (
+            double a_max_load_factor = def_max_load_factor,
+            size_t a_avg_key_size    = 16,
+            size_t a_arena_size      = 0
+        ) : m_max_load_factor(a_max_load_factor)
+          , m_avg_key_size   (a_avg_key_size)
+          , m_arena_size     (a_arena_size)
+        {}
+
+        /// Number of cells allocated for \a a_max_sz entries
+        size_t capacity(size_t a_max_sz) const {
+            size_t n = size_t(double(a_max_sz) / m_max_load_factor + 0.5);
+            size_t c = 2;
+            while (c < n) c <<= 1;
+            return c;
+        }
+
+        /// Number of bytes in the key arena for \a a_max_sz entries
+        size_t arena_size(size_t a_max_sz) const {
+            return m_arena_size ? m_arena_size : a_max_sz * m_avg_key_size;
+        }
+
+        /// Memory size needed to host \a a_max_sz entries
+        size_t memory_size(size_t a_max_sz) const {
+            return atomic_string_hash_array::memory_size
+                (capacity(a_max_sz), arena_size(a_max_sz));
+        }
+    };
+
+    static const config s_def_config;
+
+    /// Memory size needed for the given number of cells and key arena bytes
+    /// (including padding that aligns the cells after the header)
+    static size_t memory_size(size_t a_capacity, size_t a_arena_size) {
+        return sizeof(atomic_string_hash_array) + alignof(cell) - 1
+             + sizeof(cell) * a_capacity + a_arena_size;
+    }
+
+    /// Create an array able to hold \a a_max_sz entries.
+    /// The memory is obtained from \a a_alloc, which may be a shared memory
+    /// allocator returning offset pointers.
+    template <class Allocator>
+    static SmartPtr<Allocator> create(size_t a_max_sz, Allocator& a_alloc,
+                                      const config& a_cfg = s_def_config);
+
+    /// Attach to an array previously created in memory at \a a_addr
+    /// (e.g. by another process sharing the same segment).
+    static atomic_string_hash_array* attach(void* a_addr) {
+        return static_cast<atomic_string_hash_array*>(a_addr);
+    }
+
+    template <class Allocator>
+    static void destroy(atomic_string_hash_array* p, Allocator& a_alloc);
+
+    //------------------------------------------------------------------------
+    // Lookup
+    //------------------------------------------------------------------------
+
+    /// Find the value associated with the key.
+    /// @return pointer to the value or nullptr if the key is not found.
+    const ValueT* find(const char* a_key, size_t a_len) const {
+        size_t idx = internal_find(a_key, a_len);
+        return idx < m_capacity ? &m_cells()[idx].value : nullptr;
+    }
+    ValueT* find(const char* a_key, size_t a_len) {
+        size_t idx = internal_find(a_key, a_len);
+        return idx < m_capacity ? &m_cells()[idx].value : nullptr;
+    }
+
+    template <class K>
+    const ValueT* find(const K& a_key) const { return find(data(a_key), len(a_key)); }
+    template <class K>
+    ValueT*       find(const K& a_key)       { return find(data(a_key), len(a_key)); }
+
+    template <class K>
+    bool exists(const K& a_key) const { return find(a_key) != nullptr; }
+
+    //------------------------------------------------------------------------
+    // Modification
+    //------------------------------------------------------------------------
+
+    /// Insert a key/value pair.
+    /// Existing values are not overwritten.
+    /// @return pair of the value pointer and success flag. On key collision
+    ///         the pointer refers to the existing value and the flag is false.
+    ///         If the array or its key arena is full, or the key is longer than
+    ///         max_key_size(), returns {nullptr, false}.
+    template <class T>
+    std::pair<ValueT*, bool> insert(const char* a_key, size_t a_len, T&& a_val) {
+        auto res = internal_insert(a_key, a_len, std::forward<T>(a_val));
+        return std::make_pair
+            (res.first < m_capacity ? &m_cells()[res.first].value : nullptr,
+             res.second);
+    }
+
+    template <class K, class T>
+    std::pair<ValueT*, bool> insert(const K& a_key, T&& a_val) {
+        return insert(data(a_key), len(a_key), std::forward<T>(a_val));
+    }
+
+    /// Mark the key erased.
+    /// The cell and the key bytes are not reused, and the value is left
+    /// intact since other threads may still hold a pointer to it.
+    /// @return number of erased elements (0 or 1)
+    size_t erase(const char* a_key, size_t a_len);
+
+    template <class K>
+    size_t erase(const K& a_key) { return erase(data(a_key), len(a_key)); }
+
+    /// Remove all entries and reset the key arena. Not thread safe.
+    void clear();
+
+    //------------------------------------------------------------------------
+    // Properties
+    //------------------------------------------------------------------------
+
+    /// Number of live entries
+    size_t size() const {
+        return m_num_entries.load(std::memory_order_relaxed)
+             - m_num_erases .load(std::memory_order_relaxed);
+    }
+    bool   empty()       const { return size() == 0;    }
+    size_t capacity()    const { return m_capacity;     }
+    size_t max_entries() const { return m_max_entries;  }
+    size_t arena_size()  const { return m_arena_size;   }
+    size_t arena_used()  const { return m_arena_used.load(std::memory_order_relaxed); }
+
+    /// Visit every live entry as f(const char* key, size_t len, ValueT& val)
+    template <class F>
+    void for_each(F&& a_fun) {
+        for (size_t i=0; i < m_capacity; ++i) {
+            cell& c = m_cells()[i];
+            if (c.hash.load(std::memory_order_acquire) >= s_reserved)
+                a_fun(key_data(c), key_len(c), c.value);
+        }
+    }
+
+private:
+    const size_t            m_capacity;
+    const size_t            m_max_entries;
+    const size_t            m_anchor_mask;
+    const size_t            m_arena_size;
+    const HashFcn           m_hash_fun;
+    std::atomic<size_t>     m_arena_used;
+    std::atomic<size_t>     m_num_entries;   ///< Successful inserts
+    std::atomic<size_t>     m_num_erases;    ///< Successful erases
+
+    // The cells followed by the key arena are laid out after this object
+
+    atomic_string_hash_array(size_t a_capacity, size_t a_max_entries,
+                             size_t a_arena_size)
+        : m_capacity   (a_capacity)
+        , m_max_entries(a_max_entries)
+        , m_anchor_mask(a_capacity - 1)
+        , m_arena_size (a_arena_size)
+        , m_hash_fun   ()
+        , m_arena_used (0)
+        , m_num_entries(0)
+        , m_num_erases (0)
+    {}
+
+    ~atomic_string_hash_array() {}
+
+    // Cells start at the first address past the header aligned for a cell
+    // (the memory itself may be less aligned than a cell, e.g. for an
+    // over-aligned ValueT)
+    cell* m_cells() const {
+        uintptr_t p = reinterpret_cast<uintptr_t>(this + 1);
+        return reinterpret_cast<cell*>
+            ((p + alignof(cell) - 1) & ~uintptr_t(alignof(cell) - 1));
+    }
+    char* m_arena() const {
+        return reinterpret_cast<char*>(m_cells() + m_capacity);
+    }
+
+    static const char* data(const std::string& a) { return a.c_str(); }
+    static size_t      len (const std::string& a) { return a.size();  }
+    static const char* data(const char* a)        { return a;         }
+    static size_t      len (const char* a)        { return strlen(a); }
+
+    template <class K>
+    static typename std::enable_if<!std::is_pointer<K>::value, const char*>::type
+    data(const K& a) {
+        static_assert(std::is_trivially_copyable<K>::value,
+                      "Key type must be a string or trivially copyable");
+        return reinterpret_cast<const char*>(&a);
+    }
+    template <class K>
+    static typename std::enable_if<!std::is_pointer<K>::value, size_t>::type
+    len(const K&) { return sizeof(K); }
+
+    uint64_t hash(const char* a_key, size_t a_len) const {
+        uint64_t h = m_hash_fun(a_key, a_len);
+        return likely(h >= s_reserved) ? h : h + s_reserved;
+    }
+
+    size_t key_to_anchor_idx(uint64_t a_hash) const {
+        return a_hash & m_anchor_mask;
+    }
+
+    size_t probe_next(size_t a_idx) const {
+        return (a_idx + 1) & m_anchor_mask;   // linear probing
+    }
+
+    const char* key_data(const cell& c) const {
+        return m_arena() + (c.key_ref >> s_len_bits);
+    }
+    static size_t key_len(const cell& c) { return c.key_ref & s_len_mask; }
+
+    bool is_key_eq(const cell& c, const char* a_key, size_t a_len) const {
+        return key_len(c) == a_len && memcmp(key_data(c), a_key, a_len) == 0;
+    }
+
+    // Wait for a concurrent insert into the cell to complete
+    static uint64_t wait_unlocked(const cell& c) {
+        uint64_t h = c.hash.load(std::memory_order_acquire);
+        for (backoff<> bo; h == s_locked; h = c.hash.load(std::memory_order_acquire))
+            bo();
+        return h;
+    }
+
+    // Copy the key to the arena. Returns offset or -1 if there's no space left
+    ssize_t append_key(const char* a_key, size_t a_len) {
+        size_t off = m_arena_used.load(std::memory_order_relaxed);
+        do {
+            if (off + a_len > m_arena_size)
+                return -1;
+        } while (!m_arena_used.compare_exchange_weak
+                    (off, off + a_len, std::memory_order_relaxed));
+        memcpy(m_arena() + off, a_key, a_len);
+        return off;
+    }
+
+    size_t internal_find(const char* a_key, size_t a_len) const;
+
+    template <class T>
+    std::pair<size_t, bool> internal_insert(const char* a_key, size_t a_len, T&& a_val);
+};
+
+//----------------------------------------------------------------------------
+// Implementation
+//----------------------------------------------------------------------------
+
+template <class ValueT, class HashFcn>
+const typename atomic_string_hash_array<ValueT, HashFcn>::config
+atomic_string_hash_array<ValueT, HashFcn>::s_def_config;
+
+template <class ValueT, class HashFcn>
+template <class Allocator>
+typename atomic_string_hash_array<ValueT, HashFcn>::template SmartPtr<Allocator>
+atomic_string_hash_array<ValueT, HashFcn>::
+create(size_t a_max_sz, Allocator& a_alloc, const config& a_cfg) {
+    assert(a_cfg.m_max_load_factor <= 1.0);
+    assert(a_cfg.m_max_load_factor  > 0.0);
+    size_t capacity = a_cfg.capacity(a_max_sz);
+    size_t arena_sz = a_cfg.arena_size(a_max_sz);
+    size_t sz       = memory_size(capacity, arena_sz);
+
+    auto const mem = a_alloc.allocate(sz);
+    // mem could be an offset ptr if using shared memory, therefore we
+    // dereference/reference it to let the compiler know we want the real pointer
+    auto p = reinterpret_cast<atomic_string_hash_array*>(&*mem);
+
+    new (p) atomic_string_hash_array
+        (capacity, size_t(a_cfg.m_max_load_factor * capacity + 0.5), arena_sz);
+
+    // Values are constructed lazily on insert, only the hash words are set
+    cell* cells = p->m_cells();
+    for (size_t i=0; i < capacity; ++i)
+        new (&cells[i].hash) std::atomic<uint64_t>(s_empty);
+
+    return SmartPtr<Allocator>(p, deleter<Allocator>(a_alloc));
+}
+
+template <class ValueT, class HashFcn>
+template <class Allocator>
+void atomic_string_hash_array<ValueT, HashFcn>::
+destroy(atomic_string_hash_array* p, Allocator& a_alloc) {
+    assert(p);
+    // Erased cells still hold a constructed value
+    cell* cells = p->m_cells();
+    for (size_t i=0; i < p->m_capacity; ++i)
+        if (cells[i].hash.load(std::memory_order_relaxed) != s_empty)
+            cells[i].value.~ValueT();
+
+    size_t sz = memory_size(p->m_capacity, p->m_arena_size);
+    p->~atomic_string_hash_array();
+
+    typename Allocator::pointer q(reinterpret_cast<char*>(p));
+    a_alloc.deallocate(q, sz);
+}
+
+template <class ValueT, class HashFcn>
+void atomic_string_hash_array<ValueT, HashFcn>::
+clear() {
+    cell* cells = m_cells();
+    for (size_t i=0; i < m_capacity; ++i)
+        if (cells[i].hash.load(std::memory_order_relaxed) != s_empty) {
+            cells[i].value.~ValueT();
+            cells[i].hash.store(s_empty, std::memory_order_relaxed);
+        }
+    m_arena_used .store(0, std::memory_order_relaxed);
+    m_num_entries.store(0, std::memory_order_relaxed);
+    m_num_erases .store(0, std::memory_order_relaxed);
+}
+
+template <class ValueT, class HashFcn>
+size_t atomic_string_hash_array<ValueT, HashFcn>::
+internal_find(const char* a_key, size_t a_len) const {
+    const uint64_t h = hash(a_key, a_len);
+    for (size_t idx = key_to_anchor_idx(h), probes = 0;
+         probes < m_capacity; idx = probe_next(idx), ++probes)
+    {
+        const cell& c = m_cells()[idx];
+        uint64_t    v = c.hash.load(std::memory_order_acquire);
+
+        if (unlikely(v == s_empty))
+            // if we hit an empty element, this key does not exist
+            return m_capacity;
+
+        // A cell being inserted may hold our key
+        if (unlikely(v == s_locked) && (v = wait_unlocked(c)) == s_empty)
+            // The insert was rolled back
+            return m_capacity;
+
+        if (v == h && likely(is_key_eq(c, a_key, a_len)))
+            return idx;
+    }
+    // probed every cell...fail
+    return m_capacity;
+}
+
+template <class ValueT, class HashFcn>
+template <class T>
+std::pair<size_t, bool> atomic_string_hash_array<ValueT, HashFcn>::
+internal_insert(const char* a_key, size_t a_len, T&& a_val) {
+    if (unlikely(a_len > max_key_size()))
+        return std::make_pair(m_capacity, false);
+
+    const uint64_t h = hash(a_key, a_len);
+    size_t idx = key_to_anchor_idx(h);
+
+    for (size_t probes = 0; probes < m_capacity;) {
+        cell&    c = m_cells()[idx];
+        uint64_t v = c.hash.load(std::memory_order_acquire);
+
+        if (v == s_empty) {
+            // Reserve an entry so that the load factor is never exceeded
+            if (m_num_entries.fetch_add(1, std::memory_order_relaxed) >= m_max_entries) {
+                m_num_entries.fetch_sub(1, std::memory_order_relaxed);
+                return std::make_pair(m_capacity, false);
+            }
+
+            if (c.hash.compare_exchange_strong
+                    (v, s_locked, std::memory_order_acq_rel)) {
+                ssize_t off = append_key(a_key, a_len);
+                if (unlikely(off < 0)) {
+                    // Key arena is full
+                    c.hash.store(s_empty, std::memory_order_release);
+                    m_num_entries.fetch_sub(1, std::memory_order_relaxed);
+                    return std::make_pair(m_capacity, false);
+                }
+                try {
+                    new (&c.value) ValueT(std::forward<T>(a_val));
+                } catch (...) {
+                    c.hash.store(s_empty, std::memory_order_release);
+                    m_num_entries.fetch_sub(1, std::memory_order_relaxed);
+                    throw;
+                }
+                c.key_ref = (uint64_t(off) << s_len_bits) | a_len;
+                // Publish the key bytes, key reference and value
+                c.hash.store(h, std::memory_order_release);
+                return std::make_pair(idx, true);
+            }
+            m_num_entries.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        if (v == s_locked)
+            v = wait_unlocked(c);
+
+        if (v == h && is_key_eq(c, a_key, a_len))
+            // Found an existing entry for our key. Don't overwrite it
+            return std::make_pair(idx, false);
+
+        if (v == s_empty)
+            // Concurrent insert into this cell was rolled back - retry
+            continue;
+
+        ++probes;
+        idx = probe_next(idx);
+    }
+    // probed every cell...fail
+    return std::make_pair(m_capacity, false);
+}
+
+template <class ValueT, class HashFcn>
+size_t atomic_string_hash_array<ValueT, HashFcn>::
+erase(const char* a_key, size_t a_len) {
+    const uint64_t h = hash(a_key, a_len);
+    for (size_t idx = key_to_anchor_idx(h), probes = 0;
+         probes < m_capacity; idx = probe_next(idx), ++probes)
+    {
+        cell&    c = m_cells()[idx];
+        uint64_t v = c.hash.load(std::memory_order_acquire);
+
+        if (v == s_empty)
+            return 0;
+
+        // Same as find(): a cell being inserted may hold our key
+        if (unlikely(v == s_locked) && (v = wait_unlocked(c)) == s_empty)
+            // The insert was rolled back
+            return 0;
+
+        if (v == h && is_key_eq(c, a_key, a_len)) {
+            // Some other thread may have erased our key, but this is ok
+            if (!c.hash.compare_exchange_strong(v, s_erased, std::memory_order_acq_rel))
+                return 0;
+            m_num_erases.fetch_add(1, std::memory_order_relaxed);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+} // namespace utxx
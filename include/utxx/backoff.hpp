@@ -0,0 +1,84 @@
+//----------------------------------------------------------------------------
+/// \file   backoff.hpp
+/// \author Serge Aleynikov
+//----------------------------------------------------------------------------
+/// \brief Exponential backoff helper for contended lock-free loops.
+//----------------------------------------------------------------------------
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#ifndef _UTXX_BACKOFF_HPP_
+#define _UTXX_BACKOFF_HPP_
+
+#include <cstdint>
+
+namespace utxx {
+
+/// Hint the CPU that we are in a spin-wait loop.
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#else
+    __asm__ __volatile__ ("" ::: "memory");
+#endif
+}
+
+/// Exponential backoff used after a failed CAS on a contended word.
+/// Each call to operator() spins for the current number of iterations and
+/// doubles it, up to \a MaxSpins.
+/// @code
+///     backoff<> bo;
+///     while (!atomic::cas(&m_head, old, new))
+///         bo();
+/// @endcode
+template <uint32_t MinSpins = 4, uint32_t MaxSpins = 1024>
+class backoff {
+    static_assert(MinSpins > 0 && MinSpins <= MaxSpins, "Invalid spin limits");
+
+    uint32_t m_spins;
+public:
+    backoff() : m_spins(MinSpins) {}
+
+    /// Spin for the current number of iterations and increase it.
+    void operator()() {
+        for (uint32_t i=0; i < m_spins; ++i)
+            cpu_relax();
+        if (m_spins < MaxSpins)
+            m_spins <<= 1;
+    }
+
+    /// @return true if the backoff has reached its maximum spin count.
+    bool saturated() const { return m_spins >= MaxSpins; }
+
+    /// Current number of spins.
+    uint32_t spins()  const { return m_spins; }
+
+    void reset() { m_spins = MinSpins; }
+};
+
+} // namespace utxx
+
+#endif // _UTXX_BACKOFF_HPP_
@@ -3,7 +3,8 @@
 /// \author Serge Aleynikov
 //----------------------------------------------------------------------------
 /// \brief Bitmap index suitable for indexing up to 64 or 4096 values on a
-/// 64bit platform with fast iteration between adjacent items.
+/// 64bit platform with fast iteration between adjacent items, and a
+/// hierarchical bitmap for an arbitrary number of bits.
 //----------------------------------------------------------------------------
 // Copyright (c) 2010 Serge Aleynikov <saleyn@gmail.com>
 // Created: 2009-12-21
@@ -39,9 +40,17 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <utxx/meta.hpp>
 #include <utxx/atomic.hpp>
 #include <utxx/detail/bit_count.hpp>
+#include <utxx/compiler_hints.hpp>
+#include <atomic>
+#include <vector>
 #include <sstream>
+#include <stdint.h>
 #include <stdio.h>
 
+#if defined(__AVX2__)
+#  include <immintrin.h>
+#endif
+
 namespace utxx {
 
 template <int N, typename T = unsigned long>
@@ -215,6 +224,342 @@ public:
     }
 };
 
+namespace detail {
+    /// Word access policy of the hierarchical_bitmap
+    template <bool Atomic> struct hbitmap_word;
+
+    template <> struct hbitmap_word<false> {
+        typedef uint64_t type;
+        static uint64_t load (const type& a)             { return a; }
+        static void     store(type& a, uint64_t v)       { a = v;    }
+        static uint64_t fetch_or (type& a, uint64_t m)   { uint64_t o = a; a = o | m; return o; }
+        static uint64_t fetch_and(type& a, uint64_t m)   { uint64_t o = a; a = o & m; return o; }
+    };
+
+    template <> struct hbitmap_word<true> {
+        typedef std::atomic<uint64_t> type;
+        static uint64_t load (const type& a)       { return a.load(std::memory_order_acquire); }
+        static void     store(type& a, uint64_t v) { a.store(v, std::memory_order_release);    }
+        static uint64_t fetch_or (type& a, uint64_t m)
+        { return a.fetch_or (m, std::memory_order_acq_rel); }
+        static uint64_t fetch_and(type& a, uint64_t m)
+        { return a.fetch_and(m, std::memory_order_acq_rel); }
+    };
+
+    /// Number of set bits in the array of \a a_n words.
+    inline size_t popcount(const uint64_t* a_p, size_t a_n) {
+        size_t sum = 0, i = 0;
+    #if defined(__AVX2__)
+        // Nibble lookup table popcount (W. Mula), 256 bits per iteration
+        const __m256i lut  = _mm256_setr_epi8(0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4,
+                                              0,1,1,2,1,2,2,3,1,2,2,3,2,3,3,4);
+        const __m256i low  = _mm256_set1_epi8(0x0f);
+        const __m256i zero = _mm256_setzero_si256();
+        __m256i       acc  = zero;
+        for (; i + 4 <= a_n; i += 4) {
+            __m256i v  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a_p + i));
+            __m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(v, low));
+            __m256i hi = _mm256_shuffle_epi8(lut,
+                            _mm256_and_si256(_mm256_srli_epi16(v, 4), low));
+            acc = _mm256_add_epi64(acc, _mm256_sad_epu8(_mm256_add_epi8(lo, hi), zero));
+        }
+        sum = _mm256_extract_epi64(acc, 0) + _mm256_extract_epi64(acc, 1)
+            + _mm256_extract_epi64(acc, 2) + _mm256_extract_epi64(acc, 3);
+    #endif
+        for (; i < a_n; ++i)
+            sum += __builtin_popcountll(a_p[i]);
+        return sum;
+    }
+
+    /// Index of the first word in [a_from, a_n) that is not all ones,
+    /// or \a a_n if all of them are full.
+    inline size_t find_non_full(const uint64_t* a_p, size_t a_from, size_t a_n) {
+        size_t i = a_from;
+    #if defined(__AVX2__)
+        const __m256i ones = _mm256_set1_epi64x(-1);
+        for (; i + 4 <= a_n; i += 4)
+            if (!_mm256_testc_si256(
+                    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a_p + i)), ones))
+                break;
+    #endif
+        for (; i < a_n && a_p[i] == ~0ul; ++i);
+        return i;
+    }
+} // namespace detail
+
+//----------------------------------------------------------------------------
+/// Hierarchical bitmap of an arbitrary number of bits.
+///
+/// Level 0 holds the bits, and every bit of level k+1 summarizes whether
+/// the corresponding 64-bit word of level k is non-empty. Searching for the
+/// first/last/next/prev set bit walks up the summary levels until a set bit
+/// is found and down again, so it costs O(levels) (4 levels cover 16M bits)
+/// regardless of the distance to the next set bit. Range set/clear update
+/// whole words and touch summaries once per affected word.
+///
+/// With \a Atomic = true individual bits may be set and cleared concurrently.
+/// Summary bits are updated after the bits they cover, so a search that
+/// overlaps a concurrent update of the same 64-bit word may transiently miss
+/// a bit. Range operations are not atomic as a whole, and count() and the
+/// clear bit search of the atomic variant read words one at a time.
+//----------------------------------------------------------------------------
+template <bool Atomic = false>
+class hierarchical_bitmap {
+    typedef detail::hbitmap_word<Atomic>    ops;
+    typedef typename ops::type              word_t;
+
+    static const int s_max_levels = 11;     // ceil(64 / 6)
+
+    size_t              m_size;
+    int                 m_levels;
+    size_t              m_offset[s_max_levels]; // Offset of level's first word
+    size_t              m_nwords[s_max_levels]; // Number of words in a level
+    std::vector<word_t> m_words;
+
+    word_t&       word(int a_lvl, size_t a_w)       { return m_words[m_offset[a_lvl] + a_w]; }
+    const word_t& word(int a_lvl, size_t a_w) const { return m_words[m_offset[a_lvl] + a_w]; }
+
+    static uint64_t mask(size_t a_from, size_t a_to, size_t a_w) {
+        uint64_t m = ~0ul;
+        if (a_w == (a_from >> 6)) m &= ~0ul << (a_from & 63);
+        if (a_w == ((a_to-1) >> 6) && (a_to & 63)) m &= ~0ul >> (64 - (a_to & 63));
+        return m;
+    }
+
+    // Set bit a_i of level a_lvl and propagate to the summary levels
+    void set_from(int a_lvl, size_t a_i) {
+        for (; a_lvl < m_levels; ++a_lvl, a_i >>= 6)
+            if (ops::fetch_or(word(a_lvl, a_i >> 6), 1ul << (a_i & 63)))
+                break;
+    }
+
+    // Clear a_mask bits in word a_w of level a_lvl and propagate to the
+    // summary levels if the word became empty
+    void clear_mask(int a_lvl, size_t a_w, uint64_t a_mask) {
+        uint64_t old = ops::fetch_and(word(a_lvl, a_w), ~a_mask);
+        if (!(old & a_mask) || (old & ~a_mask) || a_lvl+1 == m_levels)
+            return;
+        clear_mask(a_lvl+1, a_w >> 6, 1ul << (a_w & 63));
+        // A concurrent set() may have filled the word before the summary
+        // bit was cleared
+        if (Atomic && ops::load(word(a_lvl, a_w)))
+            set_from(a_lvl+1, a_w);
+    }
+
+    // Clear summary bits of the emptied words a_mask of level a_lvl that
+    // belong to the summary word a_pw
+    void clear_summary(int a_lvl, size_t a_pw, uint64_t a_mask) {
+        clear_mask(a_lvl+1, a_pw, a_mask);
+        if (Atomic)
+            for (uint64_t m = a_mask; m; m &= m-1) {
+                size_t w = (a_pw << 6) | __builtin_ctzl(m);
+                if (ops::load(word(a_lvl, w)))
+                    set_from(a_lvl+1, w);
+            }
+    }
+
+    void set_range(int a_lvl, size_t a_from, size_t a_to) {
+        if (a_from >= a_to) return;
+        size_t wf = a_from >> 6, wl = (a_to-1) >> 6;
+        for (size_t w = wf; w <= wl; ++w)
+            ops::fetch_or(word(a_lvl, w), mask(a_from, a_to, w));
+        // Every word in the range is now non-empty
+        if (a_lvl+1 < m_levels)
+            set_range(a_lvl+1, wf, wl+1);
+    }
+
+    void clear_range(int a_lvl, size_t a_from, size_t a_to) {
+        if (a_from >= a_to) return;
+        size_t   wf = a_from >> 6, wl = (a_to-1) >> 6;
+        bool     top = a_lvl+1 == m_levels;
+        size_t   pw  = wf >> 6;
+        uint64_t pm  = 0;   // Words of summary word pw that became empty
+        for (size_t w = wf; w <= wl; ++w) {
+            uint64_t m   = mask(a_from, a_to, w);
+            uint64_t old = ops::fetch_and(word(a_lvl, w), ~m);
+            if (top || !(old & m) || (old & ~m))
+                continue;
+            if ((w >> 6) != pw) {
+                if (pm) clear_summary(a_lvl, pw, pm);
+                pw = w >> 6;
+                pm = 0;
+            }
+            pm |= 1ul << (w & 63);
+        }
+        if (pm) clear_summary(a_lvl, pw, pm);
+    }
+
+    // First set bit >= a_pos
+    size_t scan_fwd(size_t a_pos) const {
+        if (a_pos >= m_size) return end();
+        int lvl = 0; size_t i = a_pos;
+        for (;;) {
+            // Ascend until a word has a set bit at or after position i
+            for (;;) {
+                size_t   w = i >> 6;
+                if (w >= m_nwords[lvl]) return end();
+                uint64_t v = ops::load(word(lvl, w)) & (~0ul << (i & 63));
+                if (v) { i = (w << 6) | __builtin_ctzl(v); break; }
+                if (++lvl == m_levels) return end();
+                i = w + 1;
+            }
+            // Descend following the first set bit of each summary word
+            for (; lvl > 0; --lvl) {
+                uint64_t v = ops::load(word(lvl-1, i));
+                if (unlikely(!v)) break;    // Stale summary bit
+                i = (i << 6) | __builtin_ctzl(v);
+            }
+            if (likely(lvl == 0)) return i;
+            ++i;
+        }
+    }
+
+    // Last set bit <= a_pos
+    size_t scan_bwd(size_t a_pos) const {
+        if (m_size == 0) return end();
+        if (a_pos >= m_size) a_pos = m_size - 1;
+        int lvl = 0; size_t i = a_pos;
+        for (;;) {
+            for (;;) {
+                size_t   w = i >> 6;
+                uint64_t v = ops::load(word(lvl, w)) & (~0ul >> (63 - (i & 63)));
+                if (v) { i = (w << 6) | (63 - __builtin_clzl(v)); break; }
+                if (w == 0 || ++lvl == m_levels) return end();
+                i = w - 1;
+            }
+            for (; lvl > 0; --lvl) {
+                uint64_t v = ops::load(word(lvl-1, i));
+                if (unlikely(!v)) break;
+                i = (i << 6) | (63 - __builtin_clzl(v));
+            }
+            if (likely(lvl == 0)) return i;
+            if (i == 0) return end();
+            --i;
+        }
+    }
+
+    size_t count_words(size_t a_from, size_t a_to) const {
+        const word_t* p = m_words.data() + a_from;
+        if (!Atomic)
+            return detail::popcount(reinterpret_cast<const uint64_t*>(p), a_to - a_from);
+        size_t sum = 0;
+        for (size_t i = 0, n = a_to - a_from; i < n; ++i)
+            sum += __builtin_popcountll(ops::load(p[i]));
+        return sum;
+    }
+
+    hierarchical_bitmap(const hierarchical_bitmap&);
+    void operator=(const hierarchical_bitmap&);
+public:
+    /// @param a_size number of bits in the bitmap
+    explicit hierarchical_bitmap(size_t a_size = 0) : m_size(0), m_levels(0) {
+        resize(a_size);
+    }
+
+    /// Change the number of bits in the bitmap clearing all bits.
+    /// Not thread-safe.
+    void resize(size_t a_size) {
+        m_size   = a_size;
+        m_levels = 0;
+        size_t total = 0;
+        for (size_t n = a_size; n; n = (n + 63) >> 6) {
+            size_t words = (n + 63) >> 6;
+            m_offset[m_levels] = total;
+            m_nwords[m_levels] = words;
+            total += words;
+            ++m_levels;
+            if (words == 1) break;
+        }
+        std::vector<word_t>(total).swap(m_words);
+    }
+
+    size_t size()   const { return m_size;   }
+    size_t end()    const { return m_size;   }
+    int    levels() const { return m_levels; }
+    bool   empty()  const { return !m_levels || !ops::load(word(m_levels-1, 0)); }
+
+    bool is_set(size_t i) const {
+        BOOST_ASSERT(i < m_size);
+        return ops::load(word(0, i >> 6)) & (1ul << (i & 63));
+    }
+    bool operator[] (size_t i) const { return is_set(i); }
+
+    void set(size_t i) {
+        BOOST_ASSERT(i < m_size);
+        set_from(0, i);
+    }
+
+    void clear(size_t i) {
+        BOOST_ASSERT(i < m_size);
+        clear_mask(0, i >> 6, 1ul << (i & 63));
+    }
+
+    /// Set bits in the range [a_from, a_to)
+    void set(size_t a_from, size_t a_to) {
+        BOOST_ASSERT(a_from <= a_to && a_to <= m_size);
+        set_range(0, a_from, a_to);
+    }
+
+    /// Clear bits in the range [a_from, a_to)
+    void clear(size_t a_from, size_t a_to) {
+        BOOST_ASSERT(a_from <= a_to && a_to <= m_size);
+        clear_range(0, a_from, a_to);
+    }
+
+    void fill()  { set(0, m_size); }
+    void clear() { for (auto& w : m_words) ops::store(w, 0); }
+
+    /// @return position of the first set bit or end() if not found.
+    size_t first() const { return scan_fwd(0); }
+    /// @return position of the last set bit or end() if not found.
+    size_t last()  const { return scan_bwd(m_size); }
+    /// @return position of the next set bit after \a i or end() if not found.
+    size_t next(size_t i) const { return scan_fwd(i+1); }
+    /// @return position of the previous set bit before \a i or end() if not found.
+    size_t prev(size_t i) const { return i ? scan_bwd(i-1) : end(); }
+
+    /// @return position of the first clear bit at or after \a i or end()
+    /// if not found. Full words are skipped 256 bits at a time with AVX2.
+    size_t next_clear(size_t i = 0) const {
+        if (i >= m_size) return end();
+        size_t   w = i >> 6;
+        uint64_t v = ~ops::load(word(0, w)) & (~0ul << (i & 63));
+        if (!v) {
+            if (Atomic)
+                for (++w; w < m_nwords[0] && !~ops::load(word(0, w)); ++w);
+            else
+                w = detail::find_non_full(
+                        reinterpret_cast<const uint64_t*>(&word(0, 0)), w+1, m_nwords[0]);
+            if (w == m_nwords[0]) return end();
+            v = ~ops::load(word(0, w));
+        }
+        size_t n = (w << 6) | __builtin_ctzl(v);
+        return n < m_size ? n : end();
+    }
+
+    /// Total number of set bits
+    size_t count() const { return m_levels ? count_words(0, m_nwords[0]) : 0; }
+
+    /// Number of set bits in the range [a_from, a_to)
+    size_t count(size_t a_from, size_t a_to) const {
+        BOOST_ASSERT(a_from <= a_to && a_to <= m_size);
+        if (a_from >= a_to) return 0;
+        size_t wf = a_from >> 6, wl = (a_to-1) >> 6;
+        size_t n  = __builtin_popcountll(ops::load(word(0, wf)) & mask(a_from, a_to, wf));
+        if (wl == wf) return n;
+        n += __builtin_popcountll(ops::load(word(0, wl)) & mask(a_from, a_to, wl));
+        return n + count_words(wf+1, wl);
+    }
+
+    /// @return true if any bit in the range [a_from, a_to) is set
+    bool any(size_t a_from, size_t a_to) const {
+        size_t n = scan_fwd(a_from);
+        return n < a_to && n != end();
+    }
+};
+
+typedef hierarchical_bitmap<true> atomic_hierarchical_bitmap;
+
 typedef bitmap_low<16>    bitmap16;
 typedef bitmap_low<32>    bitmap32;
 typedef
@@ -0,0 +1,452 @@
+// vim:ts=4:sw=4:et
+//------------------------------------------------------------------------------
+/// @file  broadcast_ring.hpp
+/// @brief Single-producer broadcast ring with per-consumer cursors
+//------------------------------------------------------------------------------
+/// This is a disruptor-style extension of the generation_buffer idea: one
+/// publisher writes into a power-of-2 ring, and up to MaxReaders independent
+/// subscribers consume the same stream, each through its own cursor.
+///
+/// Unlike generation_buffer, every slot carries a sequence stamp, so that a
+/// reader can tell whether the slot it is reading was overwritten by the
+/// publisher (i.e. the reader was lapped).  In that case the reader's cursor
+/// is moved forward to the oldest slot still available and the number of lost
+/// items is added to the reader's overrun counter.
+///
+/// Subscribers registered as "gating" limit the publisher: it will not
+/// overwrite a slot that the slowest gating subscriber has not consumed yet.
+///
+/// The ring, its cursors and its statistics are all contained in a single
+/// flat memory block, so it can be placed in shared memory and used by
+/// several processes (see create()).  The item type must be trivially
+/// copyable because readers copy the item out and validate the copy against
+/// the slot's sequence stamp (seqlock-style).
+//------------------------------------------------------------------------------
+// Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#pragma once
+
+#include <utxx/config.h>
+#include <utxx/math.hpp>
+#include <utxx/error.hpp>
+#include <utxx/compiler_hints.hpp>
+#include <boost/noncopyable.hpp>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
+#include <algorithm>
+#include <type_traits>
+
+namespace utxx
+{
+    //--------------------------------------------------------------------------
+    /// Wait-free single-producer multiple-consumer broadcast ring.
+    /// @tparam T          item type (must be trivially copyable).
+    /// @tparam MaxReaders maximum number of concurrent subscribers.
+    //--------------------------------------------------------------------------
+    template<typename T, uint32_t MaxReaders = 16>
+    class broadcast_ring : private boost::noncopyable {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "broadcast_ring: T must be trivially copyable");
+        static_assert(MaxReaders > 0, "broadcast_ring: MaxReaders must be > 0");
+
+        using Self = broadcast_ring<T, MaxReaders>;
+
+    public:
+        /// Result of a read() call
+        enum class read_result {
+            OK,         ///< An item was copied out and the cursor advanced
+            EMPTY,      ///< No new items are available
+            OVERRUN     ///< The reader was lapped, cursor skipped forward
+        };
+
+        /// State of a subscriber slot
+        enum class reader_state : uint32_t {
+            FREE     = 0,
+            CLAIMED  = 1,   ///< Being initialized by subscribe()
+            ACTIVE   = 2,   ///< Non-gating subscriber (may be lapped)
+            GATING   = 3    ///< Publisher never overwrites unread items
+        };
+
+    private:
+        static const uint32_t s_version = 0xB0CA5700;
+
+        /// Per-subscriber state, one cache line each to avoid false sharing
+        struct reader_slot {
+            std::atomic<uint64_t> cursor;   ///< Next sequence number to read
+            std::atomic<uint64_t> overruns; ///< Total number of items lost
+            std::atomic<uint32_t> state;
+        } __attribute__((aligned(UTXX_CL_SIZE)));
+
+        /// Ring slot. The stamp is (seq+1) of the item stored in the slot,
+        /// or 0 while the publisher is writing the slot.
+        struct slot {
+            std::atomic<uint64_t> stamp;
+            T                     data;
+        };
+
+        struct publisher_state {
+            std::atomic<uint64_t> tail;     ///< Next sequence to be published
+            uint64_t              gate;     ///< Cached min of gating cursors
+        } __attribute__((aligned(UTXX_CL_SIZE)));
+
+        uint32_t        m_version;
+        uint32_t        m_capacity;
+        uint32_t        m_mask;
+        bool            m_external;
+        publisher_state m_pub;
+        reader_slot     m_readers[MaxReaders];
+        slot            m_slots[0];
+
+        // NB: the ctor is private, because the object is variable-size and
+        // is supposed to be created by create() only:
+        broadcast_ring(uint32_t a_capacity, bool a_external)
+            : m_version (s_version)
+            , m_capacity(math::upper_power(a_capacity, 2))
+            , m_mask    (m_capacity - 1)
+            , m_external(a_external)
+        {
+            if (m_capacity < 2)
+                UTXX_THROW_BADARG_ERROR
+                    ("broadcast_ring: invalid capacity: ", a_capacity);
+            assert((m_capacity & m_mask) == 0); // Power of 2
+
+            m_pub.tail.store(0, std::memory_order_relaxed);
+            m_pub.gate = 0;
+
+            for (auto& r : m_readers) {
+                r.cursor  .store(0, std::memory_order_relaxed);
+                r.overruns.store(0, std::memory_order_relaxed);
+                r.state   .store(uint32_t(reader_state::FREE),
+                                 std::memory_order_relaxed);
+            }
+            for (uint32_t i=0; i < m_capacity; ++i)
+                m_slots[i].stamp.store(0, std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+
+        ~broadcast_ring() = default;
+
+        reader_slot& rd(int a_id) {
+            assert(a_id >= 0 && uint32_t(a_id) < MaxReaders);
+            return m_readers[a_id];
+        }
+        reader_slot const& rd(int a_id) const {
+            assert(a_id >= 0 && uint32_t(a_id) < MaxReaders);
+            return m_readers[a_id];
+        }
+
+        /// Minimum cursor of all gating subscribers (or \a a_tail if none)
+        uint64_t min_gating_cursor(uint64_t a_tail) const {
+            // Pairs with the fence in subscribe(): either this scan sees the
+            // new gating subscriber, or the subscriber sees a tail >= a_tail
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            uint64_t res = a_tail;
+            for (auto& r : m_readers)
+                if (r.state.load(std::memory_order_acquire) ==
+                    uint32_t(reader_state::GATING)) {
+                    auto c = r.cursor.load(std::memory_order_acquire);
+                    if (c < res) res = c;
+                }
+            return res;
+        }
+
+        /// Check if the slot for sequence \a a_seq may be overwritten
+        bool can_publish(uint64_t a_seq) {
+            if (likely(a_seq - m_pub.gate < m_capacity))
+                return true;
+            m_pub.gate = min_gating_cursor(a_seq);
+            return a_seq - m_pub.gate < m_capacity;
+        }
+
+        template <typename Lambda>
+        bool do_publish(const Lambda& a_fill) {
+            uint64_t seq = m_pub.tail.load(std::memory_order_relaxed);
+            if (unlikely(!can_publish(seq)))
+                return false;
+
+            slot& s = m_slots[seq & m_mask];
+            // Invalidate the slot so that lagging readers detect overwrite:
+            s.stamp.store(0, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            a_fill(s.data);
+            s.stamp.store(seq+1, std::memory_order_release);
+            m_pub.tail.store(seq+1, std::memory_order_release);
+            return true;
+        }
+
+    public:
+        //----------------------------------------------------------------------
+        /// Capacity of the ring (number of slots, a power of 2)
+        //----------------------------------------------------------------------
+        uint32_t capacity()   const { return m_capacity; }
+
+        /// Total number of items published since creation
+        uint64_t total_count() const {
+            return m_pub.tail.load(std::memory_order_acquire);
+        }
+
+        /// Maximum number of concurrent subscribers
+        static constexpr uint32_t max_readers() { return MaxReaders; }
+
+        /// Returns true if the instance was constructed in external memory
+        bool is_externally_allocated() const { return m_external; }
+
+        //----------------------------------------------------------------------
+        /// Publish a copy of \a a_item.
+        /// This method is EXCLUSIVELY to be used by the publisher.
+        /// @return false if the publisher is held back by a gating subscriber.
+        //----------------------------------------------------------------------
+        bool try_publish(const T& a_item) {
+            return do_publish([&a_item](T& a) { a = a_item; });
+        }
+
+        //----------------------------------------------------------------------
+        /// Evaluate \a a_fun by passing it a reference to the next slot to be
+        /// published, and publish it.
+        /// This method is EXCLUSIVELY to be used by the publisher.
+        /// @return false if the publisher is held back by a gating subscriber.
+        //----------------------------------------------------------------------
+        template <typename Lambda>
+        bool try_publish_with(const Lambda& a_fun) { return do_publish(a_fun); }
+
+        //----------------------------------------------------------------------
+        /// Publish a copy of \a a_item, spinning while the ring is gated.
+        //----------------------------------------------------------------------
+        void publish(const T& a_item) {
+            while (unlikely(!try_publish(a_item)))
+                __builtin_ia32_pause();
+        }
+
+        //----------------------------------------------------------------------
+        /// Register a new subscriber.
+        /// The subscriber will receive items published after this call.
+        /// @param a_gating when true, the publisher will not overwrite items
+        ///                 that this subscriber has not consumed yet.
+        /// @return subscriber id, or -1 if all subscriber slots are taken.
+        //----------------------------------------------------------------------
+        int subscribe(bool a_gating = false) {
+            for (uint32_t i=0; i < MaxReaders; ++i) {
+                auto& r = m_readers[i];
+                auto  v = uint32_t(reader_state::FREE);
+                if (!r.state.compare_exchange_strong
+                        (v, uint32_t(reader_state::CLAIMED),
+                         std::memory_order_acq_rel))
+                    continue;
+                r.overruns.store(0, std::memory_order_relaxed);
+                r.cursor  .store(m_pub.tail.load(std::memory_order_acquire),
+                                 std::memory_order_relaxed);
+                r.state   .store(uint32_t(a_gating ? reader_state::GATING
+                                                   : reader_state::ACTIVE),
+                                 std::memory_order_release);
+                if (a_gating) {
+                    // The publisher's cached gate may come from a scan that
+                    // didn't see this slot as gating yet. Such a gate is never
+                    // ahead of the tail read after the fence, so moving the
+                    // cursor there keeps the publisher from lapping us.
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    r.cursor.store(m_pub.tail.load(std::memory_order_relaxed),
+                                   std::memory_order_release);
+                }
+                return int(i);
+            }
+            return -1;
+        }
+
+        //----------------------------------------------------------------------
+        /// Release the subscriber slot \a a_id.
+        /// May be called by a supervising process to evict a dead gating
+        /// subscriber that would otherwise block the publisher forever.
+        //----------------------------------------------------------------------
+        void unsubscribe(int a_id) {
+            rd(a_id).state.store(uint32_t(reader_state::FREE),
+                                 std::memory_order_release);
+        }
+
+        /// State of subscriber slot \a a_id
+        reader_state state(int a_id) const {
+            return reader_state(rd(a_id).state.load(std::memory_order_acquire));
+        }
+
+        /// Next sequence number to be consumed by subscriber \a a_id
+        uint64_t cursor(int a_id) const {
+            return rd(a_id).cursor.load(std::memory_order_acquire);
+        }
+
+        /// Total number of items lost by subscriber \a a_id due to overruns
+        uint64_t overruns(int a_id) const {
+            return rd(a_id).overruns.load(std::memory_order_relaxed);
+        }
+
+        /// Number of items available for reading by subscriber \a a_id
+        /// (may exceed capacity() if the subscriber was lapped).
+        uint64_t available(int a_id) const {
+            return total_count() - cursor(a_id);
+        }
+
+        //----------------------------------------------------------------------
+        /// Copy the next item for subscriber \a a_id into \a a_item.
+        /// This method must only be called by the owner of subscriber \a a_id.
+        /// @return OK      if an item was read;
+        ///         EMPTY   if there's nothing to read;
+        ///         OVERRUN if the subscriber was lapped. In this case no item
+        ///                 is read, the cursor is moved to the oldest item
+        ///                 still available in the ring, and the number of
+        ///                 skipped items is added to overruns(a_id).
+        //----------------------------------------------------------------------
+        read_result read(int a_id, T& a_item) {
+            auto&    r   = rd(a_id);
+            uint64_t cur = r.cursor.load(std::memory_order_relaxed);
+
+            if (cur >= m_pub.tail.load(std::memory_order_acquire))
+                return read_result::EMPTY;
+
+            slot const& s = m_slots[cur & m_mask];
+            uint64_t    stamp = s.stamp.load(std::memory_order_acquire);
+
+            if (likely(stamp == cur+1)) {
+                std::memcpy(static_cast<void*>(&a_item), &s.data, sizeof(T));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (likely(s.stamp.load(std::memory_order_relaxed) == cur+1)) {
+                    r.cursor.store(cur+1, std::memory_order_release);
+                    return read_result::OK;
+                }
+            }
+
+            // The slot was (or is being) overwritten: we've been lapped.
+            // If the publisher is currently overwriting the oldest slot, the
+            // next read() will detect it and skip forward again.
+            uint64_t tail   = m_pub.tail.load(std::memory_order_acquire);
+            uint64_t oldest = tail > m_capacity ? tail - m_capacity : 0;
+            uint64_t next   = std::max(cur+1, oldest);
+            r.overruns.fetch_add(next - cur, std::memory_order_relaxed);
+            r.cursor.store(next, std::memory_order_release);
+            return read_result::OVERRUN;
+        }
+
+        //----------------------------------------------------------------------
+        /// Get the memory size needed to allocate a ring of given capacity
+        //----------------------------------------------------------------------
+        static size_t memory_size(uint32_t a_capacity) {
+            return sizeof(Self) +
+                   sizeof(slot) * math::upper_power(a_capacity, 2);
+        }
+
+        //----------------------------------------------------------------------
+        /// Factory function which allocates a new ring of given capacity in
+        /// given memory (e.g. shared memory), and optionally constructs it.
+        /// @param a_capacity  number of slots (rounded up to a power of 2).
+        /// @param a_memory    externally allocated memory, or NULL to use the
+        ///                    heap.
+        /// @param a_mem_sz    size of \a a_memory obtained by memory_size().
+        /// @param a_construct if false, \a a_memory must contain a ring
+        ///                    previously constructed by another process.
+        //----------------------------------------------------------------------
+        static broadcast_ring* create
+        (
+            uint32_t a_capacity,
+            void*    a_memory    = nullptr,
+            size_t   a_mem_sz    = 0,
+            bool     a_construct = false
+        ) {
+            assert((a_memory && a_mem_sz >  0) || (!a_memory && a_mem_sz == 0));
+
+            if (a_capacity < 2)
+                UTXX_THROW_BADARG_ERROR
+                    ("broadcast_ring::create: invalid capacity: ", a_capacity);
+
+            size_t expect_sz = memory_size(a_capacity);
+
+            if (a_mem_sz && a_mem_sz != expect_sz)
+                UTXX_THROW_BADARG_ERROR
+                    ("broadcast_ring::create: invalid memory size (expected=",
+                     expect_sz, ", got=", a_mem_sz, ')');
+
+            bool external = a_memory != nullptr;
+
+            if (!external) {
+                a_memory    = ::aligned_alloc(UTXX_CL_SIZE,
+                                (expect_sz + UTXX_CL_SIZE-1) & ~(UTXX_CL_SIZE-1));
+                if (!a_memory)
+                    throw std::bad_alloc();
+                a_construct = true;
+            }
+
+            if (a_construct)
+                return new (a_memory) Self(a_capacity, external);
+
+            auto p = static_cast<Self*>(a_memory);
+            if (p->m_version != s_version || p->m_capacity !=
+                math::upper_power(a_capacity, 2))
+                UTXX_THROW_RUNTIME_ERROR
+                    ("broadcast_ring::create: invalid version or capacity of "
+                     "existing ring at address ", a_memory);
+            return p;
+        }
+
+        //----------------------------------------------------------------------
+        /// Destroy a ring previously returned by create()
+        //----------------------------------------------------------------------
+        static void destroy(broadcast_ring*& a_ptr) {
+            if (!a_ptr)
+                return;
+            if (!a_ptr->is_externally_allocated()) {
+                a_ptr->~broadcast_ring();
+                ::free(a_ptr);
+            }
+            a_ptr = nullptr;
+        }
+
+        //----------------------------------------------------------------------
+        /// RAII handle of a subscriber
+        //----------------------------------------------------------------------
+        class subscriber : private boost::noncopyable {
+            broadcast_ring* m_ring;
+            int             m_id;
+        public:
+            subscriber(broadcast_ring& a_ring, bool a_gating = false)
+                : m_ring(&a_ring), m_id(a_ring.subscribe(a_gating))
+            {
+                if (m_id < 0)
+                    UTXX_THROW_RUNTIME_ERROR
+                        ("broadcast_ring: no free subscriber slots (max=",
+                         MaxReaders, ')');
+            }
+
+            ~subscriber() { m_ring->unsubscribe(m_id); }
+
+            int         id()        const { return m_id; }
+            uint64_t    cursor()    const { return m_ring->cursor(m_id);    }
+            uint64_t    overruns()  const { return m_ring->overruns(m_id);  }
+            uint64_t    available() const { return m_ring->available(m_id); }
+            read_result read(T& a_item)   { return m_ring->read(m_id, a_item); }
+        };
+    };
+
+} // namespace utxx
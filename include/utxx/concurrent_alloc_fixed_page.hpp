@@ -1,5 +1,5 @@
 //----------------------------------------------------------------------------
-/// \file   alloc_fixed_page.cpp
+/// \file   concurrent_alloc_fixed_page.hpp
 /// \author Serge Aleynikov
 //----------------------------------------------------------------------------
 /// \brief An allocator with aligned paged allocation of size(T) objects.
@@ -31,13 +31,16 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 ***** END LICENSE BLOCK *****
 */
 
-#ifndef _ALLOC_FIXED_PAGE_HPP_
-#define _ALLOC_FIXED_PAGE_HPP_
+#ifndef _UTXX_CONCURRENT_ALLOC_FIXED_PAGE_HPP_
+#define _UTXX_CONCURRENT_ALLOC_FIXED_PAGE_HPP_
 
 #include <new>
+#include <type_traits>
 #include <boost/noncopyable.hpp>
 #include <boost/cstdint.hpp>
 #include <utxx/atomic.hpp>
+#include <utxx/alloc_page_source.hpp>
+#include <utxx/error.hpp>
 #include <stdlib.h>
 #ifdef _ALLOCATOR_MEM_DEBUG
 #include <stdio.h>
@@ -46,30 +49,48 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 namespace utxx {
 namespace memory {
 
+namespace detail {
+    /// True if the page source assigns pages to NUMA nodes
+    template <class S, class = void>
+    struct has_page_node : std::false_type {};
+
+    template <class S>
+    struct has_page_node<S, decltype((void)S::node((const void*)0))>
+        : std::true_type {};
+}
+
 /**
  * Implementation of paged allocator that allocates memory in
  * aligned pages of PageSize. A new page is allocated when
  * there is no more room to store an object of size T in a page.
+ * Each thread allocates from its own page, and objects may be
+ * deallocated by any thread.  A page is released when all of
+ * its objects are freed and its owning thread moved on to
+ * another page.  Up to MaxFreePages released pages are cached
+ * by the releasing thread, unless the PageSource places pages on
+ * NUMA nodes (it has a node() function): such a source keeps a free
+ * list per node, and a thread cache would hand a page freed on one
+ * node to allocations on another.
+ * Pages are obtained from the PageSource (see alloc_page_source.hpp).
  */
 template <
       typename T
     , size_t   PageSize     = 64*1024
     , size_t   MaxFreePages = 10
+    , class    PageSource   = heap_page_source<PageSize>
 >
 class concurrent_aligned_page_allocator : public boost::noncopyable {
     struct header {
         static const uint32_t s_magic = 1234567890;
         const uint32_t magic;   ///< Magic version that must match s_magic.
         T*      avail_chunk;    ///< Next available chunk on this page
-        long    alloc_count;    ///< Number of allocated chunks on this page
-        header* next;
+        long    alloc_count;    ///< Allocated chunks plus the owner's reference
+        header* next;           ///< Link in the list of free pages
         header() : magic(s_magic), next(NULL) {}
     };
 
-    typedef std::allocator<T> base;
     static const size_t s_page_mask    = PageSize-1;
     static const size_t s_begin_offset = sizeof(header);
-    static const size_t s_end_chunks   = PageSize / sizeof(T);
     static const int    s_max_chunks   = ((PageSize-s_begin_offset) / sizeof(T));
 
     // Page size must be a power of 2
@@ -77,100 +98,112 @@ class concurrent_aligned_page_allocator : public boost::noncopyable {
     BOOST_STATIC_ASSERT(s_begin_offset < PageSize);
     BOOST_STATIC_ASSERT(s_max_chunks > 0);
 
-    static __thread header* m_page;
-    static __thread header* m_free;
-    static __thread long    m_free_count;
+    // Pages of the calling thread. Released when the thread exits.
+    struct thread_pages {
+        header* page       = NULL;
+        header* free       = NULL;
+        long    free_count = 0;
+
+        ~thread_pages() {
+            if (page)
+                release(page);
+            for (header* p = free, *next; p; p = next) {
+                next = p->next;
+                PageSource::deallocate(p);
+            }
+        }
+    };
+
+    static thread_pages& local() {
+        static thread_local thread_pages s_pages;
+        return s_pages;
+    }
+
+    static T* begin(header* p) {
+        return reinterpret_cast<T*>(reinterpret_cast<char*>(p) + s_begin_offset);
+    }
 
     static header* page_alloc() {
-        union {
-            unsigned long n;
-            void*   pp;
-            char*   pc;
-            header* p;
-        } u;
-        #if defined(_WIN32) || defined (_WIN64)
-        u.pp = _aligned_malloc(PageSize, PageSize);
-        if (!u.pp)
-            throw std::bad_alloc();
-        #else
-        if (posix_memalign(&u.pp, PageSize, PageSize) < 0)
-            throw std::bad_alloc();
-        #endif
-        BOOST_ASSERT(u.n & s_page_mask == 0);
-        new (u.p) header();
-        u.p->avail_chunk = reinterpret_cast<T*>(u.pc + s_begin_offset);
-        u.p->alloc_count = 0;
+        thread_pages& tp = local();
+        header* p = tp.free;
+        if (p) {
+            tp.free = p->next;
+            --tp.free_count;
+        } else {
+            p = new (PageSource::allocate()) header();
+            BOOST_ASSERT((reinterpret_cast<unsigned long>(p) & s_page_mask) == 0);
+        }
+        p->avail_chunk = begin(p);
+        p->alloc_count = 1;     // The owner's reference
         #ifdef _ALLOCATOR_MEM_DEBUG
-        printf("Allocated page %p\n", u.p);
+        printf("Allocated page %p\n", p);
         #endif
-        return u.p;
+        return p;
     }
 
-    static void page_free(header* p) {
+    // Drop a reference to the page and free the page if it was the last one
+    static void release(header* p) {
+        // atomic::add() returns the value prior to the update
+        if (atomic::add(&p->alloc_count, -1) != 1)
+            return;
         #ifdef _ALLOCATOR_MEM_DEBUG
         printf("Freeing page %p\n", p);
         #endif
-
-        #if defined(_WIN32) || defined (_WIN64)
-        _aligned_free(p);
-        #else
-        free(p);
-        #endif
+        thread_pages& tp = local();
+        if (!detail::has_page_node<PageSource>::value &&
+            tp.free_count < long(MaxFreePages)) {
+            p->next = tp.free;
+            tp.free = p;
+            ++tp.free_count;
+        } else
+            PageSource::deallocate(p);
     }
 
 public:
-    typedef T*      pointer;
-    typedef size_t  size_type;
-
-    concurrent_aligned_page_allocator() : m_page(page_alloc()) {
-        #ifdef _ALLOCATOR_MEM_DEBUG
-        printf("Page size: %d\n", PageSize);
-        #endif
-        m_free       = NULL;
-        m_free_count = 0;
-
-        if (!m_page)
-            throw std::bad_alloc();
-    }
+    typedef T*          pointer;
+    typedef T&          reference;
+    typedef ptrdiff_t   difference_type;
+    typedef const T&    const_reference;
+    typedef size_t      size_type;
+    typedef T           value_type;
+
+    template <typename U>
+    struct rebind {
+        typedef concurrent_aligned_page_allocator<U, PageSize, MaxFreePages,
+                                                  PageSource> other;
+    };
 
-    ~concurrent_aligned_page_allocator() {
-        if (m_page && (m_page->alloc_count == 0)) {
-            page_free(m_page);
-            m_page = NULL;
+    concurrent_aligned_page_allocator() {}
+
+    /// Allocate a chunk from the calling thread's page. This operation is
+    /// thread-safe.
+    pointer allocate(size_type n = 1, const void* hint = 0) {
+        if (unlikely(n != 1))
+            throw badarg_error("concurrent_aligned_page_allocator: "
+                               "cannot allocate ", n, " objects");
+        thread_pages& tp = local();
+        if (unlikely(!tp.page || tp.page->avail_chunk >= begin(tp.page) + s_max_chunks)) {
+            if (tp.page)
+                release(tp.page);
+            tp.page = page_alloc();
         }
-    }
-
-    pointer allocate(size_type n, const void *hint = 0) {
-        pointer end = reinterpret_cast<pointer>(
-                        reinterpret_cast<char*>(m_page) + PageSize);
-
-        m_page = page_alloc();
-
-        atomic::add(&m_page->alloc_count);
-
-        pointer p;
-        do {
-            p = m_page->avail_chunk;
-            if (p >= end)
-                reinterpret_cast<pointer>(
-            atomic::add(&m_page->avail_chunk, sizeof(T)));
+        atomic::inc(&tp.page->alloc_count);
+        pointer p = tp.page->avail_chunk++;
         #ifdef _ALLOCATOR_MEM_DEBUG
         printf("  Allocated: %p\n", p);
         #endif
         return p;
     }
 
-    void deallocate(pointer p, size_type n){
+    /// Free a chunk allocated by any thread. This operation is thread-safe.
+    void deallocate(pointer p, size_type n = 1) {
         unsigned long addr = reinterpret_cast<unsigned long>(p) & ~s_page_mask;
         header* h = reinterpret_cast<header*>(addr);
         #ifdef _ALLOCATOR_MEM_DEBUG
         printf("  Deallocating %p, page=%p\n", p, h);
         #endif
         BOOST_ASSERT(h->magic == header::s_magic);
-        long n = h->alloc_count;
-        atomic::dec(h->alloc_count);
-        if (h->alloc_count == 0 && h != m_page)
-            page_free(h);
+        release(h);
     }
 
      void construct(pointer p, const T &val){
@@ -181,10 +214,14 @@ public:
          p->~T();
      }
 
-     const header* address() const { return m_page; }
+     /// Current page of the calling thread
+     const header* address() const { return local().page; }
+
+     /// Number of free pages cached by the calling thread
+     static long free_pages() { return local().free_count; }
 };
 
 } // namespace memory
 } // namespace utxx
 
-#endif // _ALLOC_FIXED_PAGE_HPP_
+#endif // _UTXX_CONCURRENT_ALLOC_FIXED_PAGE_HPP_
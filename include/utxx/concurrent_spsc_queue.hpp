@@ -42,6 +42,7 @@
 #include <utxx/math.hpp>
 #include <utxx/error.hpp>
 #include <utxx/compiler_hints.hpp>
+#include <utxx/warmup.hpp>
 #include <boost/noncopyable.hpp>
 #include <atomic>
 #include <cassert>
@@ -406,6 +407,17 @@ public:
     /// Queue Capacity (static or dynamic):
     uint32_t capacity() const { return m_header.m_capacity; }
 
+    /// Pre-fault (and optionally lock / NUMA-bind) the storage of the queue.
+    /// Shared storage is warmed up along with its header.
+    memory::warmup_report
+    prefault(const memory::warmup_options& a_opts = memory::warmup_options()) {
+        const char* beg = m_shared_data
+                        ? reinterpret_cast<const char*>(m_header_ptr)
+                        : reinterpret_cast<const char*>(m_rec_ptr);
+        const char* end = reinterpret_cast<const char*>(m_rec_ptr + capacity());
+        return memory::warm_up(beg, end - beg, a_opts);
+    }
+
     //=======================================================================//
     // UNSAFE iterators over the queue:                                      //
     //=======================================================================//
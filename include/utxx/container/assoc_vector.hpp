@@ -18,8 +18,17 @@
 #include <functional>
 #include <vector>
 #include <utility>
+#include <stdint.h>
+#include <boost/assert.hpp>
 
 namespace utxx {
+    /// Key layout used for lookups in a frozen assoc_vector
+    enum class frozen_layout {
+        NONE,       ///< Binary search in the sorted vector
+        EYTZINGER,  ///< Keys in BFS order of an implicit binary tree
+        BTREE       ///< Keys in cache-line blocks of an implicit B-tree
+    };
+
     //--------------------------------------------------------------------------
     /// class template assoc_vector_compare
     /// Used by assoc_vector
@@ -50,6 +59,129 @@ namespace utxx {
             bool operator()(const first_argument_type& lhs, const data& rhs) const
             { return operator()(lhs, rhs.first); }
         };
+
+        //----------------------------------------------------------------------
+        /// Read-optimized copy of the keys of a sorted vector.
+        /// The keys are laid out either in Eytzinger (BFS) order, or in
+        /// blocks of B keys forming an implicit static (B+1)-ary search tree.
+        /// Both layouts make the next comparisons of a search fall into a
+        /// few predictable cache lines, and both searches are branchless
+        /// except for the loop condition.  lower_bound() returns the rank
+        /// of the found key in the sorted vector.
+        //----------------------------------------------------------------------
+        template <class K, class Compare>
+        class frozen_index {
+        public:
+            using layout_t = frozen_layout;
+
+            /// Number of keys in a B-tree block (about one cache line)
+            static const size_t s_block =
+                64 / sizeof(K) >= 2 ? 64 / sizeof(K) : 2;
+
+            frozen_index() : m_layout(layout_t::NONE), m_size(0), m_blocks(0) {}
+
+            layout_t layout() const { return m_layout; }
+
+            void clear() {
+                m_layout = layout_t::NONE;
+                m_size   = m_blocks = 0;
+                std::vector<K>().swap(m_keys);
+                std::vector<uint32_t>().swap(m_rank);
+            }
+
+            /// Build the index from the keys of a sorted range
+            template <class Iter>
+            void build(layout_t a_layout, Iter a_begin, Iter a_end) {
+                m_layout = a_layout;
+                m_size   = std::distance(a_begin, a_end);
+                m_keys.clear();
+                m_rank.clear();
+                if (m_layout == layout_t::NONE || !m_size)
+                    return;
+
+                size_t i = 0;
+                if (m_layout == layout_t::EYTZINGER) {
+                    // 1-based, slot 0 is unused
+                    m_keys.resize(m_size + 1, a_begin->first);
+                    m_rank.resize(m_size + 1);
+                    build_eytzinger(a_begin, i, 1);
+                } else {
+                    m_blocks = (m_size + s_block - 1) / s_block;
+                    // Padding keys copy the greatest key. They never compare
+                    // less than a key that has a lower bound in the range
+                    m_keys.resize(m_blocks * s_block, (a_begin + (m_size-1))->first);
+                    m_rank.resize(m_blocks * s_block, m_size);
+                    build_btree(a_begin, i, 0);
+                }
+            }
+
+            /// Rank of the first key not less than \a a_key (size() if none)
+            size_t lower_bound(const K& a_key, const Compare& a_cmp) const {
+                return m_layout == layout_t::EYTZINGER ? eytzinger_search(a_key, a_cmp)
+                                             : btree_search(a_key, a_cmp);
+            }
+
+        private:
+            layout_t              m_layout;
+            size_t                m_size;
+            size_t                m_blocks;
+            std::vector<K>        m_keys;
+            std::vector<uint32_t> m_rank;
+
+            template <class Iter>
+            void build_eytzinger(Iter a_sorted, size_t& i, size_t k) {
+                if (k > m_size) return;
+                build_eytzinger(a_sorted, i, 2*k);
+                m_keys[k] = (a_sorted + i)->first;
+                m_rank[k] = i++;
+                build_eytzinger(a_sorted, i, 2*k+1);
+            }
+
+            size_t child(size_t k, size_t i) const { return k*(s_block+1) + i + 1; }
+
+            template <class Iter>
+            void build_btree(Iter a_sorted, size_t& i, size_t k) {
+                if (k >= m_blocks) return;
+                for (size_t j = 0; j < s_block; ++j) {
+                    build_btree(a_sorted, i, child(k, j));
+                    if (i < m_size) {
+                        m_keys[k*s_block + j] = (a_sorted + i)->first;
+                        m_rank[k*s_block + j] = i++;
+                    }
+                }
+                build_btree(a_sorted, i, child(k, s_block));
+            }
+
+            size_t eytzinger_search(const K& a_key, const Compare& a_cmp) const {
+                const K* keys = m_keys.data();
+                size_t   k    = 1;
+                while (k <= m_size) {
+                    // The 16 descendants four levels down are adjacent
+                    const K* p = keys + std::min(16*k, m_size);
+                    __builtin_prefetch(p);
+                    if (sizeof(K) > 4)
+                        __builtin_prefetch(p + 8);
+                    k = 2*k + a_cmp(keys[k], a_key);
+                }
+                // Undo the right turns taken after the last left turn
+                k >>= __builtin_ffsll(~k);
+                return k ? m_rank[k] : m_size;
+            }
+
+            size_t btree_search(const K& a_key, const Compare& a_cmp) const {
+                const K* keys = m_keys.data();
+                size_t   res  = m_size;
+                for (size_t k = 0; k < m_blocks; ) {
+                    const K* b = keys + k*s_block;
+                    size_t   i = 0;
+                    for (size_t j = 0; j < s_block; ++j)
+                        i += a_cmp(b[j], a_key);
+                    res = i < s_block ? m_rank[k*s_block + i] : res;
+                    k   = child(k, i);
+                }
+                return res;
+            }
+        };
     }
 
     //--------------------------------------------------------------------------
@@ -60,6 +192,19 @@ namespace utxx {
     /// * the complexity of insert/erase is O(N) not O(log N)
     /// * value_type is std::pair<K, V> not std::pair<const K, V>
     /// * iterators are random
+    ///
+    /// For read-mostly tables the vector can be frozen after a bulk build.
+    /// A frozen vector keeps a copy of the keys in a search-friendly layout
+    /// (see frozen_layout) that is used by find() and lower_bound().
+    /// Inserts into a frozen vector are appended to a sorted tail of the
+    /// vector and merged lazily: when the tail grows past
+    /// max(32, N/32) elements (N being the number of merged elements),
+    /// or when ordered access (begin(), lower_bound(), etc.) is requested
+    /// through a non-const reference. Const members never merge: find() and
+    /// count() search the tail as well, while const ordered access
+    /// (begin() const, lower_bound() const, etc.) requires the caller to
+    /// call merge() first. A merge reorders the elements, so it invalidates
+    /// iterators obtained before it.
     //--------------------------------------------------------------------------
     template
     <
@@ -74,6 +219,11 @@ namespace utxx {
     {
         using base                  = std::vector<std::pair<K, V>, A>;
         using my_compare            = detail::assoc_vector_compare<V, C>;
+        using frozen_index          = detail::frozen_index<K, my_compare>;
+
+        // Lookup index of the first m_frozen elements when frozen
+        frozen_index                m_index;
+        size_t                      m_frozen = 0;
 
     public:
         using key_type              = K;
@@ -117,7 +267,11 @@ namespace utxx {
         explicit assoc_vector(assoc_vector&& rhs)
             : base(std::move(static_cast<base&&>(rhs)))
             , my_compare(std::move(static_cast<my_compare&&>(rhs)))
-        {}
+            , m_index (std::move(rhs.m_index))
+            , m_frozen(rhs.m_frozen)
+        {
+            rhs.m_index.clear();
+        }
 
         explicit assoc_vector(std::initializer_list<std::pair<K,V>> items,
             const key_compare& comp = key_compare(), const A& alloc = A())
@@ -145,14 +299,18 @@ namespace utxx {
 
         // iterators:
         // The following are here because MWCW gets 'using' wrong
-        iterator                begin()         { return base::begin();    }
-        const_iterator          cbegin()  const { return base::begin();    }
-        iterator                end()           { return base::end();      }
-        const_iterator          cend()    const { return base::end();      }
-        reverse_iterator        rbegin()        { return base::rbegin();   }
-        const_reverse_iterator  crbegin() const { return base::rbegin();   }
-        reverse_iterator        rend()          { return base::rend();     }
-        const_reverse_iterator  crend()   const { return base::rend();     }
+        // Ordered traversal merges pending inserts of a frozen vector;
+        // const traversal requires them to be merged already
+        iterator                begin()         { merge(); return base::begin();  }
+        const_iterator          begin()   const { ordered(); return base::begin();}
+        const_iterator          cbegin()  const { ordered(); return base::begin();}
+        iterator                end()           { return base::end();             }
+        const_iterator          end()     const { return base::end();             }
+        const_iterator          cend()    const { return base::end();             }
+        reverse_iterator        rbegin()        { merge(); return base::rbegin(); }
+        const_reverse_iterator  crbegin() const { ordered(); return base::rbegin();}
+        reverse_iterator        rend()          { merge(); return base::rend();   }
+        const_reverse_iterator  crend()   const { ordered(); return base::rend(); }
 
         // capacity:
         bool                    empty()   const { return base::empty();    }
@@ -163,8 +321,45 @@ namespace utxx {
         mapped_type& operator[](const key_type& key)
         { return insert(value_type(key, mapped_type())).first->second; }
 
+        // frozen mode:
+
+        /// Build the lookup index in the given layout.
+        /// Passing frozen_layout::NONE is the same as thaw().
+        void freeze(frozen_layout layout = frozen_layout::EYTZINGER) {
+            merge();
+            m_index.build(layout, base::begin(), base::end());
+            m_frozen = frozen() ? size() : 0;
+        }
+
+        /// Merge pending inserts and drop the lookup index
+        void thaw() {
+            merge();
+            m_index.clear();
+            m_frozen = 0;
+        }
+
+        bool          frozen() const { return layout() != frozen_layout::NONE; }
+        frozen_layout layout() const { return m_index.layout(); }
+
+        /// Number of inserts into a frozen vector not merged yet
+        size_type     pending() const { return frozen() ? size() - m_frozen : 0; }
+
+        /// Merge pending inserts of a frozen vector and rebuild its index.
+        /// Must be called before ordered access through a const reference.
+        void merge() {
+            if (!pending())
+                return;
+            std::inplace_merge(base::begin(), base::begin() + m_frozen,
+                               base::end(), static_cast<my_compare&>(*this));
+            m_frozen = size();
+            m_index.build(layout(), base::begin(), base::end());
+        }
+
         // modifiers:
         std::pair<iterator, bool> insert(const value_type& val) {
+            if (frozen())
+                return frozen_insert(val);
+
             bool found(true);
             iterator i(lower_bound(val.first));
 
@@ -176,6 +371,8 @@ namespace utxx {
         }
 
         iterator insert(iterator pos, const value_type& val) {
+            if (frozen())
+                return insert(val).first;
             if (pos != end() && this->operator()(*pos, val) &&
                (pos == end()-1  ||
                    (!this->operator()(val, pos[1]) &&
@@ -188,8 +385,14 @@ namespace utxx {
         void insert(InputIterator first, InputIterator last)
         { for (; first != last; ++first) insert(*first); }
 
-        void erase(iterator pos)
-        { base::erase(pos); }
+        void erase(iterator pos) {
+            bool reindex = frozen() && size_t(pos - base::begin()) < m_frozen;
+            base::erase(pos);
+            if (reindex) {
+                --m_frozen;
+                build_index();
+            }
+        }
 
         size_type erase(const key_type& k) {
             iterator i(find(k));
@@ -198,8 +401,14 @@ namespace utxx {
             return 1;
         }
 
-        void erase(iterator first, iterator last)
-        { base::erase(first, last); }
+        void erase(iterator first, iterator last) {
+            bool reindex = frozen() && size_t(first - base::begin()) < m_frozen;
+            if (reindex)
+                m_frozen -= std::min(last, base::begin() + m_frozen) - first;
+            base::erase(first, last);
+            if (reindex)
+                build_index();
+        }
 
         void swap(assoc_vector& other) {
             using std::swap;
@@ -207,6 +416,8 @@ namespace utxx {
             my_compare& me  = *this;
             my_compare& rhs = other;
             swap(me, rhs);
+            swap(m_index,  other.m_index);
+            swap(m_frozen, other.m_frozen);
         }
 
         void swap(assoc_vector&& other) {
@@ -214,9 +425,15 @@ namespace utxx {
             base::swap(std::move(static_cast<base&&>(other)));
             static_cast<my_compare&>(*this) =
                 std::move(static_cast<my_compare&&>(other));
+            m_index  = std::move(other.m_index);
+            m_frozen = other.m_frozen;
         }
 
-        void clear() { base::clear(); }
+        void clear() {
+            base::clear();
+            m_frozen = 0;
+            if (frozen()) build_index();
+        }
 
         // observers:
         key_compare key_comp() const { return *this; }
@@ -228,6 +445,8 @@ namespace utxx {
 
         // 23.3.1.3 map operations:
         iterator find(const key_type& k) {
+            if (frozen())
+                return base::begin() + frozen_find(k);
             iterator i(lower_bound(k));
             if (i != end() && this->operator()(k, i->first))
                 i =  end();
@@ -235,6 +454,8 @@ namespace utxx {
         }
 
         const_iterator find(const key_type& k) const {
+            if (frozen())
+                return base::begin() + frozen_find(k);
             const_iterator i(lower_bound(k));
             if (i != end() && this->operator()(k, i->first))
                 i =  end();
@@ -246,13 +467,22 @@ namespace utxx {
 
         /// Return first element that doesn't compare less than \a k.
         iterator lower_bound(const key_type& k) {
+            if (frozen()) {
+                merge();
+                return base::begin() + index_lower_bound(k);
+            }
             return std::lower_bound(begin(), end(), k,
                                     static_cast<my_compare&>(*this));
         }
 
         /// Return first element that doesn't compare less than \a k.
+        /// A frozen vector must have no pending inserts (see merge()).
         const_iterator  lower_bound(const key_type& k) const {
-            return std::lower_bound(begin(), end(), k,
+            if (frozen()) {
+                ordered();
+                return base::begin() + index_lower_bound(k);
+            }
+            return std::lower_bound(cbegin(), cend(), k,
                                     static_cast<const my_compare&>(*this));
         }
 
@@ -262,7 +492,7 @@ namespace utxx {
         }
 
         const_iterator upper_bound(const key_type& k) const {
-            return std::upper_bound(begin(), end(), k,
+            return std::upper_bound(cbegin(), cend(), k,
                                     static_cast<const my_compare&>(*this));
         }
 
@@ -274,16 +504,22 @@ namespace utxx {
 
         std::pair<const_iterator, const_iterator>
         equal_range(const key_type& k) const {
-            return std::equal_range(begin(), end(), k,
+            return std::equal_range(cbegin(), cend(), k,
                                     static_cast<const my_compare&>(*this));
         }
 
+        // Comparison of frozen vectors with pending inserts is done on
+        // merged copies, as const members don't reorder the elements
         friend bool operator==(const assoc_vector& lhs, const assoc_vector& rhs) {
-            return static_cast<base&>(lhs) == rhs;
+            if (!lhs.pending() && !rhs.pending())
+                return static_cast<const base&>(lhs) == static_cast<const base&>(rhs);
+            return lhs.merged() == rhs.merged();
         }
 
         bool operator<(const assoc_vector& rhs) const {
-            return static_cast<const base&>(*this) < static_cast<const base&>(rhs);
+            if (!pending() && !rhs.pending())
+                return static_cast<const base&>(*this) < static_cast<const base&>(rhs);
+            return merged() < rhs.merged();
         }
 
         friend bool operator!=(const assoc_vector& lhs, const assoc_vector& rhs)
@@ -297,6 +533,57 @@ namespace utxx {
 
         friend bool operator<=(const assoc_vector& lhs, const assoc_vector& rhs)
         { return !(rhs < lhs); }
+
+    private:
+        // Const ordered access is only valid without pending inserts
+        void ordered() const {
+            BOOST_ASSERT_MSG(!pending(), "call merge() before const ordered access");
+        }
+
+        // Copy of the elements in key order
+        base merged() const {
+            base v(static_cast<const base&>(*this));
+            std::inplace_merge(v.begin(), v.begin() + m_frozen, v.end(),
+                               static_cast<const my_compare&>(*this));
+            return v;
+        }
+
+        void build_index() {
+            m_index.build(layout(), base::begin(), base::begin() + m_frozen);
+        }
+
+        size_t index_lower_bound(const key_type& k) const {
+            return m_index.lower_bound(k, static_cast<const my_compare&>(*this));
+        }
+
+        // Position of the key in the frozen range or the pending tail, or
+        // size() if not found
+        size_t frozen_find(const key_type& k) const {
+            size_t i = index_lower_bound(k);
+            if (i < m_frozen && !this->operator()(k, base::operator[](i).first))
+                return i;
+            if (m_frozen == size())
+                return m_frozen;
+            auto p = std::lower_bound(base::begin() + m_frozen, base::end(), k,
+                                      static_cast<const my_compare&>(*this));
+            return p != base::end() && !this->operator()(k, p->first)
+                 ? p - base::begin() : size();
+        }
+
+        std::pair<iterator, bool> frozen_insert(const value_type& val) {
+            size_t i = frozen_find(val.first);
+            if (i < size())
+                return std::make_pair(base::begin() + i, false);
+
+            auto p = std::upper_bound(base::begin() + m_frozen, base::end(),
+                                      val.first, static_cast<my_compare&>(*this));
+            p = base::insert(p, val);
+            if (pending() <= std::max<size_t>(32, m_frozen / 32))
+                return std::make_pair(p, true);
+
+            merge();
+            return std::make_pair(find(val.first), true);
+        }
     };
 
     // specialized algorithms:
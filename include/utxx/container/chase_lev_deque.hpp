@@ -0,0 +1,208 @@
+//----------------------------------------------------------------------------
+/// \file   chase_lev_deque.hpp
+/// \author Serge Aleynikov
+//----------------------------------------------------------------------------
+/// \brief Chase-Lev work-stealing deque.
+///
+/// The owner thread pushes and pops at the bottom end without atomic
+/// read-modify-write operations (except when racing for the last element),
+/// while any number of thief threads steal from the top end with a CAS.
+/// \see D. Chase, Y. Lev "Dynamic Circular Work-Stealing Deque" (SPAA 2005)
+/// \see N.M. Le et al. "Correct and Efficient Work-Stealing for Weak Memory
+///      Models" (PPoPP 2013) - the memory ordering used here
+//----------------------------------------------------------------------------
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#pragma once
+
+#include <utxx/config.h>
+#include <utxx/compiler_hints.hpp>
+#include <utxx/backoff.hpp>
+#include <atomic>
+#include <vector>
+#include <type_traits>
+#include <stdint.h>
+
+namespace utxx {
+namespace container {
+
+//-----------------------------------------------------------------------------
+/// Growable single-owner/multi-thief deque of trivially copyable items.
+//-----------------------------------------------------------------------------
+/// push() and pop() may only be called by the owner thread, steal() by any
+/// thread. When the circular array fills up, the owner replaces it with one
+/// twice the size. Old arrays may still be read by concurrent thieves, so
+/// they are retired and released only when the deque is destroyed (their
+/// total size is bounded by the size of the current array).
+template <typename T>
+class chase_lev_deque {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "T must be trivially copyable (e.g. a pointer)");
+
+    struct array {
+        int64_t          mask;
+        std::atomic<T>   items[0];
+
+        int64_t capacity() const   { return mask+1; }
+        T    get(int64_t i) const  { return items[i & mask].load(std::memory_order_relaxed); }
+        void put(int64_t i, T v)   { items[i & mask].store(v, std::memory_order_relaxed); }
+
+        static array* create(int64_t a_capacity) {
+            auto p = static_cast<array*>(
+                ::operator new(sizeof(array) + a_capacity * sizeof(std::atomic<T>)));
+            p->mask = a_capacity-1;
+            return p;
+        }
+        static void destroy(array* a) { ::operator delete(a); }
+    };
+
+    // Thieves write m_top, the owner writes m_bottom: keep them on separate
+    // cache lines (padding rather than alignment so that the deque can be
+    // heap-allocated without C++17 aligned new)
+    char                 m_pad0[UTXX_CL_SIZE];
+    std::atomic<int64_t> m_top;
+    char                 m_pad1[UTXX_CL_SIZE - sizeof(std::atomic<int64_t>)];
+    std::atomic<int64_t> m_bottom;
+    std::atomic<array*>  m_array;
+    std::vector<array*>  m_retired;
+
+    array* grow(array* a_old, int64_t a_bottom, int64_t a_top) {
+        array* a = array::create(a_old->capacity() * 2);
+        for (int64_t i = a_top; i < a_bottom; ++i)
+            a->put(i, a_old->get(i));
+        m_retired.push_back(a_old);
+        m_array.store(a, std::memory_order_release);
+        return a;
+    }
+
+public:
+    enum steal_result { STOLEN, EMPTY, ABORT };
+
+    /// @param a_capacity initial capacity (rounded up to a power of 2)
+    explicit chase_lev_deque(size_t a_capacity = 256)
+        : m_top(0), m_bottom(0)
+    {
+        int64_t n = 2;
+        while (n < int64_t(a_capacity)) n <<= 1;
+        m_array.store(array::create(n), std::memory_order_relaxed);
+    }
+
+    chase_lev_deque(const chase_lev_deque&)            = delete;
+    chase_lev_deque& operator=(const chase_lev_deque&) = delete;
+
+    ~chase_lev_deque() {
+        array::destroy(m_array.load(std::memory_order_relaxed));
+        for (auto a : m_retired)
+            array::destroy(a);
+    }
+
+    /// Current capacity of the circular array.
+    size_t capacity() const {
+        return m_array.load(std::memory_order_relaxed)->capacity();
+    }
+
+    /// Approximate number of items (exact when called by the owner with no
+    /// concurrent thieves).
+    size_t size() const {
+        int64_t b = m_bottom.load(std::memory_order_relaxed);
+        int64_t t = m_top.load(std::memory_order_relaxed);
+        return b > t ? size_t(b - t) : 0;
+    }
+
+    bool empty() const { return size() == 0; }
+
+    /// Owner side: add an item to the bottom end.
+    void push(T a_item) {
+        int64_t b = m_bottom.load(std::memory_order_relaxed);
+        int64_t t = m_top.load(std::memory_order_acquire);
+        array*  a = m_array.load(std::memory_order_relaxed);
+        if (unlikely(b - t > a->mask))
+            a = grow(a, b, t);
+        a->put(b, a_item);
+        std::atomic_thread_fence(std::memory_order_release);
+        m_bottom.store(b+1, std::memory_order_relaxed);
+    }
+
+    /// Owner side: remove an item from the bottom end (LIFO).
+    /// @return false if the deque is empty
+    bool pop(T& a_item) {
+        int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+        array*  a = m_array.load(std::memory_order_relaxed);
+        m_bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = m_top.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            // Empty
+            m_bottom.store(b+1, std::memory_order_relaxed);
+            return false;
+        }
+
+        a_item = a->get(b);
+        if (t == b) {
+            // Last item - race against thieves
+            bool won = m_top.compare_exchange_strong
+                (t, t+1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            m_bottom.store(b+1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    /// Thief side: remove an item from the top end (FIFO).
+    /// @return STOLEN on success, EMPTY if there was nothing to steal, or
+    ///         ABORT if another thread won the race for the item.
+    steal_result try_steal(T& a_item) {
+        int64_t t = m_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = m_bottom.load(std::memory_order_acquire);
+
+        if (t >= b)
+            return EMPTY;
+
+        array* a = m_array.load(std::memory_order_acquire);
+        T      x = a->get(t);
+        if (!m_top.compare_exchange_strong
+                (t, t+1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return ABORT;
+        a_item = x;
+        return STOLEN;
+    }
+
+    /// Thief side: steal an item, retrying while losing races to other
+    /// threads.
+    /// @return false if the deque is empty
+    bool steal(T& a_item) {
+        steal_result r;
+        while ((r = try_steal(a_item)) == ABORT)
+            cpu_relax();
+        return r == STOLEN;
+    }
+};
+
+} // namespace container
+} // namespace utxx
@@ -36,12 +36,18 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #ifndef _UTXX_CLUSTERED_MAP_HPP_
 #define _UTXX_CLUSTERED_MAP_HPP_
 
+#include <boost/static_assert.hpp>
 #include <boost/type_traits/is_same.hpp>
 #include <boost/mpl/if.hpp>
 #include <boost/mpl/int.hpp>
 #include <utxx/bitmap.hpp>
+#include <utxx/alloc_fixed_page.hpp>
+#include <utxx/compiler_hints.hpp>
+#include <utxx/error.hpp>
+#include <algorithm>
 #include <map>
 #include <functional>
+#include <stdlib.h>
 
 namespace utxx {
 
@@ -109,7 +115,7 @@ class clustered_map {
             return false;
         else if (m_mru[1]->first == a_hi) {
             std::swap(m_mru[0], m_mru[1]);
-            a_it = m_mru[1];
+            a_it = m_mru[0];
         } else
             return false;
         return true;
@@ -389,6 +395,276 @@ erase(iterator a_it) {
     return true;
 }
 
+//----------------------------------------------------------------------------
+/// Flat two-level radix variant of clustered_map for bounded key spaces.
+///
+/// Keys must lie in the range [base, base + 2^KeyBits). The high
+/// (KeyBits - LowBits) bits of a key offset index a directly addressed top
+/// level array of pointers to leaf groups, and the low LowBits bits index
+/// the item in a group, so a lookup costs two dependent loads regardless of
+/// how lookups jump between groups.  Leaf groups are allocated lazily from
+/// an aligned_page_allocator and released when their last item is erased.
+/// The top level is zero-initialized by calloc(3), so its untouched pages are
+/// not backed by physical memory until used. Iteration skips unallocated
+/// groups using a hierarchical_bitmap of allocated groups, which covers the
+/// groups up to the highest one allocated so far and doubles when needed.
+///
+/// The interface follows clustered_map.
+//----------------------------------------------------------------------------
+template <
+    class  Key,
+    class  Data,
+    int    KeyBits,
+    int    LowBits   = 6,
+    class  SortOrder = ascending,
+    size_t PageSize  = 64*1024
+>
+class flat_clustered_map {
+    BOOST_STATIC_ASSERT(LowBits <= 6);
+    BOOST_STATIC_ASSERT(KeyBits >  LowBits && KeyBits - LowBits <= 32);
+
+    typedef bitmap_low<1 << LowBits> bitmap_t;
+    static const bool   s_asc      = boost::is_same<SortOrder, ascending>::value;
+    static const size_t s_lo_mask  = (1 << LowBits) - 1;
+    static const size_t s_groups   = 1ul << (KeyBits - LowBits);
+    static const size_t s_npos     = size_t(-1);
+    static const size_t s_min_used = 4096;  ///< Initial size of m_used
+
+    struct key_data {
+        bitmap_t    index;
+        Data        data[1 << LowBits];
+    };
+
+    typedef memory::aligned_page_allocator<key_data, PageSize> alloc_t;
+
+    alloc_t                 m_alloc;
+    Key                     m_base;
+    key_data**              m_top;
+    hierarchical_bitmap<>   m_used;     ///< Bitmap of allocated groups
+    size_t                  m_groups;   ///< Number of allocated groups
+
+    bool valid(Key a_key) const {
+        return a_key >= m_base && size_t(a_key - m_base) < (s_groups << LowBits);
+    }
+
+    key_data* group(Key a_key) const {
+        return m_top[size_t(a_key - m_base) >> LowBits];
+    }
+
+    // Mark the group allocated, growing the bitmap to cover it
+    void mark_used(size_t a_grp) {
+        if (unlikely(a_grp >= m_used.size())) {
+            size_t old = m_used.size();
+            size_t n   = std::max<size_t>(old, s_min_used);
+            while (n <= a_grp) n <<= 1;
+            m_used.resize(std::min(n, s_groups));
+            for (size_t g = 0; g < old; ++g)
+                if (m_top[g]) m_used.set(g);
+        }
+        m_used.set(a_grp);
+    }
+
+    // Next allocated group after a_grp (s_npos means from the beginning)
+    size_t next_group(size_t a_grp) const {
+        size_t g = a_grp == s_npos ? m_used.first() : m_used.next(a_grp);
+        return g == m_used.end() ? s_npos : g;
+    }
+
+    // Previous allocated group before a_grp (s_npos means from the end)
+    size_t prev_group(size_t a_grp) const {
+        size_t g = a_grp == s_npos ? m_used.last() : m_used.prev(a_grp);
+        return g == m_used.end() ? s_npos : g;
+    }
+
+    size_t first_group() const {
+        return s_asc ? next_group(s_npos) : prev_group(s_npos);
+    }
+
+    static int first_item(const bitmap_t& a_idx) {
+        return s_asc ? a_idx.first() : a_idx.last();
+    }
+
+    static int next_item(const bitmap_t& a_idx, int a_item) {
+        if (s_asc)
+            return a_item < int(bitmap_t::max) ? a_idx.next(a_item) : bitmap_t::cend;
+        return a_item > 0 ? a_idx.prev(a_item) : bitmap_t::cend;
+    }
+
+    std::pair<bool, Data*> ensure(Key a_key) {
+        if (unlikely(!valid(a_key)))
+            UTXX_THROW_BADARG_ERROR("Key ", a_key, " is outside of the key range");
+        size_t     off = a_key - m_base;
+        key_data*& grp = m_top[off >> LowBits];
+        if (!grp) {
+            grp = new (m_alloc.allocate(1)) key_data();
+            mark_used(off >> LowBits);
+            ++m_groups;
+        }
+        size_t lo    = off & s_lo_mask;
+        bool   found = grp->index[lo];
+        grp->index.set(lo);
+        return std::make_pair(found, &grp->data[lo]);
+    }
+
+    void free_group(size_t a_grp) {
+        key_data*& grp = m_top[a_grp];
+        grp->~key_data();
+        m_alloc.deallocate(grp, 1);
+        grp = NULL;
+        m_used.clear(a_grp);
+        --m_groups;
+    }
+
+public:
+    typedef Key  key_type;
+    typedef Data mapped_type;
+
+    class iterator;
+    typedef iterator const_iterator;
+
+    /// @param a_base lowest key that can be stored in the container
+    explicit flat_clustered_map(Key a_base = Key())
+        : m_base(a_base)
+        , m_top(static_cast<key_data**>(::calloc(s_groups, sizeof(key_data*))))
+        , m_used(std::min(s_groups, s_min_used))
+        , m_groups(0)
+    {
+        if (!m_top)
+            throw std::bad_alloc();
+    }
+
+    ~flat_clustered_map() {
+        clear();
+        ::free(m_top);
+    }
+
+    iterator begin() const {
+        size_t g = first_group();
+        return g == s_npos ? end() : iterator(this, g, first_item(m_top[g]->index));
+    }
+    iterator end()   const { return iterator(this, s_npos, bitmap_t::cend); }
+
+    /// Lowest key that can be stored in the container
+    Key    base()        const { return m_base; }
+    /// Number of keys that can be stored in the container
+    static size_t capacity()   { return s_groups << LowBits; }
+    /// Total number of clustered key groups
+    size_t group_count() const { return m_groups; }
+    /// Number of items in the cluster group associated with the \a a_key.
+    size_t item_count(Key a_key) const {
+        key_data* p = valid(a_key) ? group(a_key) : NULL;
+        return p ? p->index.count() : 0;
+    }
+
+    /// Return the data pointer associated with the \a a_key entry
+    /// in the container. If the \a a_key is not found, return NULL.
+    Data* at(Key a_key) const {
+        if (unlikely(!valid(a_key)))
+            return NULL;
+        key_data* p  = group(a_key);
+        size_t    lo = (a_key - m_base) & s_lo_mask;
+        return likely(p) && p->index[lo] ? &p->data[lo] : NULL;
+    }
+
+    iterator find(Key a_key) const {
+        return at(a_key)
+             ? iterator(this, size_t(a_key - m_base) >> LowBits,
+                        (a_key - m_base) & s_lo_mask)
+             : end();
+    }
+
+    /// Insert an entry in the container associated with the \a a_key.
+    /// Throws badarg_error if the key is outside of the key range.
+    Data& insert(Key a_key) { return *ensure(a_key).second; }
+
+    /// Insert \a a_key and \a a_data pair in the container
+    void insert(Key a_key, const Data& a_data) { *ensure(a_key).second = a_data; }
+
+    /// Return data associated with the \a a_key. If the \a a_key
+    /// is not present in the container, it will be inserted.
+    Data& operator[] (Key a_key) { return insert(a_key); }
+
+    /// Erase entry pointed by the iterator \a a_it from the container
+    bool erase(iterator a_it) {
+        return a_it != end() && erase(a_it.key());
+    }
+
+    /// Erase given key from the container
+    bool erase(Key a_key) {
+        if (!at(a_key))
+            return false;
+        size_t off = a_key - m_base;
+        key_data* p = m_top[off >> LowBits];
+        p->index.clear(off & s_lo_mask);
+        if (p->index.empty())
+            free_group(off >> LowBits);
+        return true;
+    }
+
+    /// Clears the container
+    void clear() {
+        for (size_t g = next_group(s_npos); g != s_npos; g = next_group(g))
+            free_group(g);
+    }
+
+    /// Returns true when the container is empty
+    bool empty() const { return m_groups == 0; }
+
+    template <class Visitor, class State>
+    void for_each(Visitor& a_visit, State& a_state) {
+        for (iterator it = begin(), e = end(); it != e; ++it)
+            a_visit(it.key(), it.data(), a_state);
+    }
+};
+
+// Definitions of the constants bound to references by std::min/std::max
+template <class Key, class Data, int KeyBits, int LowBits, class SortOrder, size_t PageSize>
+const size_t flat_clustered_map<Key, Data, KeyBits, LowBits, SortOrder, PageSize>::s_groups;
+
+template <class Key, class Data, int KeyBits, int LowBits, class SortOrder, size_t PageSize>
+const size_t flat_clustered_map<Key, Data, KeyBits, LowBits, SortOrder, PageSize>::s_min_used;
+
+template <class Key, class Data, int KeyBits, int LowBits, class SortOrder, size_t PageSize>
+class flat_clustered_map<Key, Data, KeyBits, LowBits, SortOrder, PageSize>::iterator
+{
+    const flat_clustered_map* m_owner;
+    size_t                    m_group;
+    int                       m_item;
+
+    friend class flat_clustered_map;
+
+    iterator(const flat_clustered_map* a_owner, size_t a_group, int a_item)
+        : m_owner(a_owner), m_group(a_group), m_item(a_item)
+    {}
+
+    key_data* leaf() const { return m_owner->m_top[m_group]; }
+public:
+    iterator() : m_owner(NULL), m_group(s_npos), m_item(bitmap_t::cend) {}
+
+    Key   key()  const { return m_owner->m_base + Key((m_group << LowBits) | m_item); }
+    Data& data() const { return leaf()->data[m_item]; }
+    int   item() const { return m_item; }
+
+    Data* operator->() const { return &data(); }
+    Data& operator*()  const { return  data(); }
+
+    bool operator== (const iterator& a_rhs) const {
+        return m_group == a_rhs.m_group && m_item == a_rhs.m_item;
+    }
+    bool operator!= (const iterator& a_rhs) const { return !operator==(a_rhs); }
+
+    iterator& operator++() {
+        m_item = next_item(leaf()->index, m_item);
+        if (m_item != int(bitmap_t::cend))
+            return *this;
+        m_group = s_asc ? m_owner->next_group(m_group)
+                        : m_owner->prev_group(m_group);
+        m_item  = m_group == s_npos ? int(bitmap_t::cend)
+                                    : first_item(leaf()->index);
+        return *this;
+    }
+};
+
 } // namespace utxx
 
 #endif // _UTXX_CLUSTERED_MAP_HPP_
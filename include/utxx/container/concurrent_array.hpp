@@ -5,13 +5,18 @@
 /// \brief Concurrent array with templetized locking primitive.
 /// 
 /// The concurrent_array class implemented in this module permits
-/// concurrent access to its elements.  The access is guarded by a number of 
+/// concurrent access to its elements.  Updates are guarded by a number of
 /// locks (defaults to synch::spin_lock) that are balanced by the item's index.
-/// All access happens by either by copying data in and out of array's item 
-/// (which is a good choice for small items) or by returning a reference to 
-/// an item with the associated scoped lock.
+/// Each lock stripe also carries a sequence number that writers make odd
+/// for the duration of an update, so readers copy an item without taking
+/// the lock and retry if the sequence number changed (seqlock).  Concurrent
+/// reads therefore never write to shared memory.
 ///
-/// The array doesn't own any memory - storage is provided in the constructor.
+/// Items are accessed by copying data in and out of the array (which is a
+/// good choice for small trivially copyable items) or by updating an item
+/// in place with a functor called under the stripe's lock.
+///
+/// The array doesn't own any memory - storage is provided to create().
 /// Consequently it can be used for stack, heap and shared memory placement.
 //----------------------------------------------------------------------------
 // Created: 2009-11-25
@@ -42,9 +47,18 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #ifndef _UTXX_CONCURRENT_ARRAY_HPP_
 #define _UTXX_CONCURRENT_ARRAY_HPP_
 
-#include <boost/tuple/tuple.hpp>
+#include <boost/assert.hpp>
 #include <boost/static_assert.hpp>
 #include <utxx/meta.hpp>
+#include <utxx/atomic.hpp>
+#include <utxx/backoff.hpp>
+#include <utxx/compiler_hints.hpp>
+#include <utxx/error.hpp>
+#include <utxx/synch.hpp>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <type_traits>
 
 #ifndef CACHELINE_SIZE
 #  define CACHELINE_SIZE 64
@@ -57,8 +71,8 @@ namespace container {
  * Implements a concurrent array with an ability to have fine-grain
  * locking over a managed set of <LocksCount> entries.
  * Template arguments:
- *      T           - type of array's element
- *      Lock        - lock primitive to use for safe concurrent access
+ *      T           - type of array's element (must be trivially copyable)
+ *      Lock        - lock primitive serializing writers of a stripe
  *      LocksCount  - number of locks balanced accross access to array's items
  *      CacheAlign  - Perform cacheline alignment of managed locks
  */
@@ -69,75 +83,110 @@ template <
     , bool  CacheAlign  = false
 >
 class concurrent_array {
-    typedef concurrent_array<T, SyncSlots, CacheAlign> self_t;
+    typedef concurrent_array<T, Lock, LocksCount, CacheAlign> self_t;
     static const unsigned int max_lock_num = LocksCount-1;
 
-    struct header {
-        Lock lock[LocksCount];
-        char __pad[CacheAlign ? CACHELINE_SIZE - sizeof(Lock) : 0];
+    BOOST_STATIC_ASSERT((LocksCount & (LocksCount-1)) == 0);
+    // Readers copy items that may be concurrently modified
+    BOOST_STATIC_ASSERT(std::is_trivially_copyable<T>::value);
 
-        const size_t size;
+    struct stripe_base {
+        Lock                    lock;
+        std::atomic<uint32_t>   version;    ///< Odd while an item is updated
+        stripe_base() : version(0) {}
+    };
 
-        header(size_t sz) : size(sz) {}
+    struct stripe : stripe_base {
+        char __pad[CacheAlign
+            ? (CACHELINE_SIZE - sizeof(stripe_base) % CACHELINE_SIZE) % CACHELINE_SIZE : 0];
     };
-    
-    header      m_header;
-    T*          m_data;
 
-    concurrent_array(void* data, size_t n_items)
-        : m_header(n_items), m_data(data)
-    {}
+    stripe          m_stripes[LocksCount];
+    const size_t    m_size;
+
+    static size_t data_offset() {
+        return (sizeof(self_t) + alignof(T) - 1) & ~(alignof(T) - 1);
+    }
+
+    T*       data()       { return reinterpret_cast<T*>(reinterpret_cast<char*>(this) + data_offset()); }
+    const T* data() const { return const_cast<self_t*>(this)->data(); }
+
+    stripe&  stripe_of(size_t i) const {
+        BOOST_ASSERT(i < m_size);
+        return const_cast<stripe&>(m_stripes[i & max_lock_num]);
+    }
+
+    explicit concurrent_array(size_t n_items) : m_size(n_items) {}
+
+    // Run a_fun under the stripe lock with the stripe's version made odd
+    template <class Fun>
+    void write(size_t i, Fun&& a_fun) {
+        stripe& s = stripe_of(i);
+        std::lock_guard<Lock> guard(s.lock);
+        uint32_t v = s.version.load(std::memory_order_relaxed);
+        s.version.store(v+1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        a_fun(data()[i]);
+        s.version.store(v+2, std::memory_order_release);
+    }
 
 public:
     typedef Lock lock_type;
     typedef T    value_type;
 
-    static self_t& create(void* storage, size_t sz, size_t n_items) {
-        const size_t expected_size = sizeof(self_t) + n_items*sizeof(T);
-        if (expected_size < sz)
-            THROW_RUNTIME_ERROR(
-                "Storage pool too small (expected " << expected_size << ')');
-        STATIC_CAST((LocksCount & (LocksCount-1)) == 0, Must_be_power_of_2);
-
-        char* data = static_cast<char*>(storage) + sizeof(header);
-        new (storage) concurrent_array(data, n_items);
+    /// @return storage size needed to hold an array of \a n_items.
+    static size_t storage_size(size_t n_items) {
+        return data_offset() + n_items*sizeof(T);
     }
 
-    T operator[] (int i) {
-        ASSERT(i < m_header.size, "Index " << i << " beyond array boundaries");
-        int lock_num = i & max_lock_num;
-        scoped_lock guard(m_header.lock[lock_num]);
-        return m_data[i];
+    /// Create an array of \a n_items in the \a storage of \a sz bytes.
+    static self_t& create(void* storage, size_t sz, size_t n_items) {
+        if (sz < storage_size(n_items))
+            UTXX_THROW_RUNTIME_ERROR(
+                "Storage pool too small (expected ", storage_size(n_items), ')');
+        self_t* p = new (storage) concurrent_array(n_items);
+        std::uninitialized_fill_n(p->data(), n_items, T());
+        return *p;
     }
 
-    void operator[] (int i, const T& value) {
-        ASSERT(i < m_header.size, "Index " << i << " beyond array boundaries");
-        int lock_num = i & max_lock_num;
-        scoped_lock guard(m_header.lock[lock_num]);
-        m_data[i] = value;
+    /// Copy the item at index \a i. The call doesn't take the lock, and
+    /// spins while a writer is updating an item in the same stripe.
+    T get(size_t i) const {
+        const stripe& s = stripe_of(i);
+        for (T v;; cpu_relax()) {
+            uint32_t v0 = s.version.load(std::memory_order_acquire);
+            if (unlikely(v0 & 1))
+                continue;
+            v = data()[i];
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (likely(s.version.load(std::memory_order_relaxed) == v0))
+                return v;
+        }
     }
 
-    /// This is a raw reference to internally stored item.
-    /// Use only in the context protected by scoped lock!
-    /// <code>
-    ///     {
-    ///         typedef synch::scoped_lock(concurrent_array<T>::lock_type lock_t;
-    ///         boost::tuple<lock_t, data_t&> tuple = array.locked_get(10);
-    ///         ... Do something with item without making blocking or system calls!
-    ///         ... The lock will be released automatically at the scope exit.
-    ///     }
-    /// </code>
-    boost::tuple<synch::lock_guard<Lock>, T&> 
-    locked_get(int i) {
-        int lock_num = i & max_lock_num;
-        synch::lock_guard<Lock> guard(m_header.lock[lock_num]);
-        return boost::tuple<synch::lock_guard<Lock>, T&>(guard, m_data[i]);
+    /// Try to copy the item at index \a i without waiting for a writer.
+    /// @return false if the item's stripe was being updated
+    bool try_get(size_t i, T& a_value) const {
+        const stripe& s = stripe_of(i);
+        uint32_t v0 = s.version.load(std::memory_order_acquire);
+        if (v0 & 1)
+            return false;
+        a_value = data()[i];
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return s.version.load(std::memory_order_relaxed) == v0;
     }
 
-    T       get(int i)              { return operator[] (i); }
-    void    set(int i, const T& v)  { operator[] (i, v); }
-    
-    size_t  size() const            { return m_header.size; }
+    void set(size_t i, const T& v) { write(i, [&](T& a) { a = v; }); }
+
+    /// Update the item at index \a i in place by calling \a a_fun(T&)
+    /// under the stripe's lock.  The functor must not make blocking or
+    /// system calls, as readers of the stripe spin until it returns.
+    template <class Fun>
+    void update(size_t i, Fun&& a_fun) { write(i, std::forward<Fun>(a_fun)); }
+
+    T       operator[] (size_t i) const { return get(i); }
+
+    size_t  size() const            { return m_size; }
 };
 
 /** 
@@ -164,23 +213,23 @@ class concurrent_atomic_array {
     atomic_data        m_data[N];  // must be last data member
 
     concurrent_atomic_array() : m_index(UNASSIGNED) {
-        STATIC_ASSERT((N & (N-1)) == 0, N_must_be_power_of_2);
+        BOOST_STATIC_ASSERT((N & (N-1)) == 0);
     }
 public:
     typedef T value_type;
 
     static self_t& create(void* storage, size_t sz) {
-        if (sizeof(self_t) <= sz)
-            THROW_RUNTIME_ERROR(
-                "Storage pool too small (expected " << sizeof(self_t) << ')');
-        new (storage) concurrent_atomic_array();
+        if (sz < sizeof(self_t))
+            UTXX_THROW_RUNTIME_ERROR(
+                "Storage pool too small (expected ", sizeof(self_t), ')');
+        return *new (storage) concurrent_atomic_array();
     }
 
     void put(T& item) {
         size_t old_idx = m_index;
         size_t new_idx = (old_idx+1) & (N-1);
         while(1) {
-            versioned_data& v = m_data[new_idx];
+            atomic_data& v = m_data[new_idx];
             if (!atomic::cas(&v.status, IDLE, WRITING))
                 new_idx = (new_idx+1) & (N-1);
             else {
@@ -200,7 +249,7 @@ public:
             return false;
         while(1) {
             size_t old_idx = m_index;
-            versioned_data& v = m_data[old_idx];
+            atomic_data& v = m_data[old_idx];
             if (atomic::cas(&v.status, IDLE, READING)) {
                 item = v.data;
                 v.status = IDLE;
@@ -3,8 +3,9 @@
 /// \author Serge Aleynikov
 //----------------------------------------------------------------------------
 /// \brief Concurrent lock-free stack.
-/// 
-/// Note: this implementation has ABA problem.
+///
+/// The head of the stack is a {pointer, version} pair updated with a
+/// double-width CAS, so the ABA problem is avoided without hazard pointers.
 //----------------------------------------------------------------------------
 // Created: 2010-01-06
 //----------------------------------------------------------------------------
@@ -38,7 +39,10 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <boost/type_traits.hpp>
 #include <utxx/meta.hpp>
 #include <utxx/atomic.hpp>
+#include <utxx/backoff.hpp>
+#include <utxx/compiler_hints.hpp>
 #include <utxx/synch.hpp>
+#include <atomic>
 #include <time.h>
 
 namespace utxx {
@@ -69,21 +73,20 @@ namespace container {
 /// refer to the next item in the list.
 /// For example usage of this stack see <alloc_cached.cpp>, which holds
 /// size-class-specific free lists represented by versioned_stack.
-/// Data pushed to the stack must be aligned on the 4-byte boudary since
-/// the stack uses version masking of lower three bits of the head pointer
-/// for ABA problem prevention.
+/// The head pointer is paired with a full-width version counter that is
+/// incremented on every update and swapped with a double-width CAS
+/// (cmpxchg16b), which prevents the ABA problem. A CAS failure is followed
+/// by an exponential backoff in order to reduce contention on the head.
 class versioned_stack {
 public:
     class node_t {
         const unsigned int m_size_class;
 
         // Magic value s_magic is used to check validity of managed pointers.
-        // Version value s_version_mask is used to prevent the ABA problem.
         static const unsigned int  s_magic_mask   = 0xFFFFFF00;
         static const unsigned int  s_magic_unmask = 0x000000FF;
     public:
         static const unsigned int  s_magic        = 0xFEDCBA00;
-        static const unsigned long s_version_mask = 0x7;
 
         node_t*      next;
 
@@ -97,17 +100,6 @@ public:
         }
 
         static node_t* to_node(void* p) { return reinterpret_cast<node_t*>(p)-1; }
-        static node_t* no_version(node_t* p) {
-            return reinterpret_cast<node_t*>(
-                reinterpret_cast<unsigned long>(p) & ~node_t::s_version_mask);
-        }
-        static node_t* inc_version(node_t* p, node_t* versioned) { 
-            unsigned long version = 
-                reinterpret_cast<unsigned long>(versioned) & s_version_mask;
-            return reinterpret_cast<node_t*>(
-                ((version + 1) & node_t::s_version_mask) |
-                (reinterpret_cast<unsigned long>(p) & ~node_t::s_version_mask));
-        }
 
         node_t() : m_size_class(s_magic), next(NULL) 
         {}
@@ -116,22 +108,26 @@ public:
         {}
     };
 
-    versioned_stack() : m_head(NULL) {}
+    versioned_stack() { m_head.ptr = NULL; m_head.version = 0; }
 
     static size_t header_size() { return sizeof(node_t); }
 
     /// Push a node <nd> to stack.
-    void push(node_t* nd) {
-        node_t *curr, *new_head;
-        do {
-            curr     = m_head;
-            nd->next = node_t::no_version(curr);
-            new_head = node_t::inc_version(nd, curr);
-        } while (!atomic::cas(&m_head, curr, new_head));
+    /// @return number of failed CAS attempts (a measure of contention).
+    unsigned push(node_t* nd) {
+        backoff<> bo;
+        unsigned retries = 0;
+        for (; !try_push(nd); ++retries)
+            bo();
+        return retries;
     }
 
     /// Pop a node from stack in the LIFO order.
-    node_t* pop() { return pop(false); }
+    node_t* pop() { unsigned n = 0; return pop(false, n); }
+
+    /// Pop a node from stack adding the number of failed CAS attempts
+    /// to <a_retries>.
+    node_t* pop(unsigned& a_retries) { return pop(false, a_retries); }
 
     /// Reset replaces the head pointer with NULL and returns 
     /// the old content of the head optionally reversing
@@ -140,7 +136,8 @@ public:
     ///        is reversed prior to returning.
     /// @return old content of the stack (optionally reversed)
     node_t* reset(bool reverse = false) {
-        node_t *old_head, *new_head, *curr = pop(true);
+        unsigned n = 0;
+        node_t *old_head, *new_head, *curr = pop(true, n);
 
         if (reverse) {
             for (old_head = NULL; curr; curr = new_head) {
@@ -154,31 +151,170 @@ public:
     }
 
     /// @return true if stack is empty
-    bool empty() const { return node_t::no_version(m_head) == NULL; }
+    bool empty() const { return load_head().ptr == NULL; }
 
     /// Returns number of items in the stack. O(n) complexity.
     /// Use only for debugging.
     int unsafe_size() const {
         int len = 0;
-        for (node_t* tmp = node_t::no_version(m_head); tmp; ++len, tmp = tmp->next);
+        for (node_t* tmp = load_head().ptr; tmp; ++len, tmp = tmp->next);
         return len;
     }
 
+    /// Number of modifications of the stack's head since construction.
+    unsigned long version() const { return load_head().version; }
+
 protected:
-    node_t* m_head;
+    struct head_t {
+        node_t*       ptr;
+        unsigned long version;
+    } __attribute__((aligned(16)));
+
+    head_t m_head;
+
+    /// Read the head. The two words may be torn by a concurrent update,
+    /// in which case the subsequent dcas() will fail.
+    head_t load_head() const {
+        head_t h;
+        h.version = const_cast<volatile head_t&>(m_head).version;
+        h.ptr     = const_cast<volatile head_t&>(m_head).ptr;
+        return h;
+    }
 
-    node_t* pop(bool empty_head) {
-        node_t *old_head, *curr, *new_head;
-        do {
-            old_head = m_head;
-            curr     = node_t::no_version(old_head);
-            if (curr == NULL) return NULL;
-            new_head = node_t::inc_version(empty_head ? NULL : curr->next, old_head);
-        } while (!atomic::cas(&m_head, old_head, new_head));
+    /// Make a single attempt to push <nd> to stack.
+    /// @return false if the head was concurrently modified.
+    bool try_push(node_t* nd) {
+        head_t curr = load_head();
+        nd->next    = curr.ptr;
+        head_t new_head = { nd, curr.version + 1 };
+        return atomic::dcas(&m_head, curr, new_head);
+    }
 
+    /// Make a single attempt to pop a node (or the whole chain of nodes
+    /// if <empty_head> is true) from stack.
+    /// @return false if the head was concurrently modified, or true with
+    ///         <res> set to the popped node (NULL if the stack is empty).
+    bool try_pop(node_t*& res, bool empty_head) {
+        head_t curr = load_head();
+        res = curr.ptr;
+        if (res == NULL)
+            return true;
+        head_t new_head = { empty_head ? NULL : res->next, curr.version + 1 };
+        if (!atomic::dcas(&m_head, curr, new_head))
+            return false;
         if (!empty_head)
-            curr->next = NULL;
-        return curr;
+            res->next = NULL;
+        return true;
+    }
+
+    node_t* pop(bool empty_head, unsigned& a_retries) {
+        node_t* res;
+        backoff<> bo;
+        for (; !try_pop(res, empty_head); ++a_retries)
+            bo();
+        return res;
+    }
+};
+
+//-----------------------------------------------------------------------------
+// ELIMINATION STACK
+//-----------------------------------------------------------------------------
+
+/// @class container::elimination_stack
+/// Versioned stack with an elimination array front end. When a push or pop
+/// fails to update the head due to contention, the thread tries to meet a
+/// thread performing the opposite operation in a randomly chosen slot of the
+/// elimination array. A matched push/pop pair completes without touching the
+/// head at all, so under heavy alloc/free churn (e.g. in cached_allocator)
+/// throughput keeps scaling with the number of threads instead of
+/// serializing on a single CAS word.
+/// @tparam Slots number of elimination slots.
+/// @tparam Spins number of iterations a pusher waits in a slot for a match.
+template <int Slots = 8, int Spins = 64>
+class elimination_stack : public versioned_stack {
+    struct slot_t {
+        std::atomic<node_t*> node;
+    } __attribute__((aligned(UTXX_CL_SIZE)));
+
+    slot_t m_slots[Slots];
+
+    static slot_t& random_slot(slot_t* a_slots) {
+        static thread_local unsigned int s_seed = 0;
+        if (unlikely(!s_seed))
+            s_seed = (unsigned int)(reinterpret_cast<unsigned long>(&s_seed) >> 4) | 1;
+        // xorshift32
+        s_seed ^= s_seed << 13;
+        s_seed ^= s_seed >> 17;
+        s_seed ^= s_seed << 5;
+        return a_slots[s_seed % Slots];
+    }
+
+    /// Offer <nd> to a popping thread. @return true if it was taken.
+    bool try_eliminate_push(node_t* nd) {
+        slot_t& slot = random_slot(m_slots);
+        node_t* empty = NULL;
+        if (!slot.node.compare_exchange_strong(empty, nd, std::memory_order_release,
+                                                         std::memory_order_relaxed))
+            return false;
+        for (int i=0; i < Spins; ++i) {
+            if (slot.node.load(std::memory_order_relaxed) != nd)
+                return true;
+            cpu_relax();
+        }
+        // Nobody came - withdraw the offer unless it's been taken meanwhile:
+        node_t* mine = nd;
+        return !slot.node.compare_exchange_strong(mine, NULL,
+                                                  std::memory_order_acquire,
+                                                  std::memory_order_relaxed);
+    }
+
+    /// Take a node offered by a pushing thread. @return NULL if none.
+    node_t* try_eliminate_pop() {
+        slot_t& slot = random_slot(m_slots);
+        node_t* nd   = slot.node.load(std::memory_order_relaxed);
+        if (nd == NULL || !slot.node.compare_exchange_strong
+                (nd, NULL, std::memory_order_acquire, std::memory_order_relaxed))
+            return NULL;
+        nd->next = NULL;
+        return nd;
+    }
+
+public:
+    elimination_stack() {
+        for (auto& s : m_slots)
+            s.node.store(NULL, std::memory_order_relaxed);
+    }
+
+    /// Push a node <nd> to stack.
+    /// @return number of failed CAS attempts on the head.
+    unsigned push(node_t* nd) {
+        backoff<> bo;
+        unsigned retries = 0;
+        for (; !try_push(nd); ++retries) {
+            if (try_eliminate_push(nd))
+                return retries + 1;
+            bo();
+        }
+        return retries;
+    }
+
+    /// Pop a node from stack in the LIFO order.
+    /// @return NULL if stack is empty.
+    node_t* pop() { unsigned n = 0; return pop(n); }
+
+    /// Pop a node from stack adding the number of failed CAS attempts
+    /// on the head to <a_retries>.
+    node_t* pop(unsigned& a_retries) {
+        node_t* res;
+        backoff<> bo;
+        for (; !try_pop(res, false); ++a_retries) {
+            if ((res = try_eliminate_pop()) != NULL) {
+                ++a_retries;
+                return res;
+            }
+            bo();
+        }
+        return res;
     }
 };
 
@@ -0,0 +1,684 @@
+//----------------------------------------------------------------------------
+/// \file   flat_hash_map.hpp
+/// \author Serge Aleynikov
+//----------------------------------------------------------------------------
+/// \brief Open-addressing hash map with SIMD control-byte group probing.
+///
+/// The layout follows the SwissTable design: values are stored inline in a
+/// flat slot array, and a parallel array of one-byte control words records
+/// for each slot whether it is empty, deleted, or full together with 7 bits
+/// of the key's hash.  A lookup loads a group of 16 (SSE2) or 32 (AVX2)
+/// control bytes at once, compares them against the hash fragment with a
+/// single vector instruction, and compares full keys only for the matching
+/// slots.  Without SSE2 a portable 8-byte SWAR group is used.
+///
+/// The interface mirrors detail::basic_hash_map (i.e. std::unordered_map)
+/// so that it can replace it where lookup latency matters.  The differences
+/// are:
+///   - references and iterators are invalidated by rehashing (any insert
+///     that grows the table), not only by erasing the element;
+///   - the maximum load factor is fixed at 7/8;
+///   - there is no bucket interface besides bucket_count().
+///
+/// The memory is obtained from an allocator of bytes (value_type char), such
+/// as std::allocator<char> or memory::cached_allocator<char>.  Since some
+/// allocators are stateful and non-copyable, the map keeps a reference to
+/// the allocator passed to the constructor (a static instance is used by
+/// default).
+//----------------------------------------------------------------------------
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <stdint.h>
+#include <boost/iterator/iterator_facade.hpp>
+#include <utxx/compiler_hints.hpp>
+
+#if defined(__AVX2__)
+#  include <immintrin.h>
+#elif defined(__SSE2__)
+#  include <emmintrin.h>
+#endif
+
+namespace utxx {
+
+namespace detail {
+
+    /// Control byte values. Full slots hold the 7-bit hash fragment (0..127)
+    enum ctrl_t : int8_t {
+        CTRL_EMPTY   = -128,
+        CTRL_DELETED = -2
+    };
+
+    /// Set of slot positions within a group, iterated from the lowest one.
+    /// @tparam T     - mask word type
+    /// @tparam Width - number of positions in the group
+    /// @tparam Shift - log2 of the number of mask bits per position
+    template <class T, int Width, int Shift>
+    class group_mask {
+        T m_mask;
+
+        static int clz(uint32_t x) { return __builtin_clz(x);   }
+        static int clz(uint64_t x) { return __builtin_clzll(x); }
+        static int ctz(uint32_t x) { return __builtin_ctz(x);   }
+        static int ctz(uint64_t x) { return __builtin_ctzll(x); }
+    public:
+        explicit group_mask(T a_mask) : m_mask(a_mask) {}
+
+        explicit operator bool() const { return m_mask != 0; }
+
+        /// Position of the lowest set element (mask must not be empty)
+        int  lowest()         const { return ctz(m_mask) >> Shift; }
+        void clear_lowest()         { m_mask &= m_mask - 1; }
+
+        /// Number of unset positions at the low end of the group
+        int trailing_zeros()  const { return ctz(m_mask) >> Shift; }
+        /// Number of unset positions at the high end of the group
+        int leading_zeros()   const {
+            return (clz(m_mask) - int(sizeof(T)*8 - (Width << Shift))) >> Shift;
+        }
+    };
+
+#if defined(__AVX2__)
+    struct ctrl_group {
+        static const size_t width = 32;
+        using mask = group_mask<uint32_t, 32, 0>;
+
+        explicit ctrl_group(const int8_t* a_pos)
+            : m_ctrl(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a_pos)))
+        {}
+
+        mask match(int8_t a_h2) const {
+            return mask(uint32_t(_mm256_movemask_epi8(
+                _mm256_cmpeq_epi8(_mm256_set1_epi8(a_h2), m_ctrl))));
+        }
+        mask match_empty() const { return match(CTRL_EMPTY); }
+        /// Empty and deleted control bytes are the ones with the sign bit set
+        mask match_free()  const {
+            return mask(uint32_t(_mm256_movemask_epi8(m_ctrl)));
+        }
+    private:
+        __m256i m_ctrl;
+    };
+#elif defined(__SSE2__)
+    struct ctrl_group {
+        static const size_t width = 16;
+        using mask = group_mask<uint32_t, 16, 0>;
+
+        explicit ctrl_group(const int8_t* a_pos)
+            : m_ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a_pos)))
+        {}
+
+        mask match(int8_t a_h2) const {
+            return mask(uint32_t(_mm_movemask_epi8(
+                _mm_cmpeq_epi8(_mm_set1_epi8(a_h2), m_ctrl))));
+        }
+        mask match_empty() const { return match(CTRL_EMPTY); }
+        /// Empty and deleted control bytes are the ones with the sign bit set
+        mask match_free()  const {
+            return mask(uint32_t(_mm_movemask_epi8(m_ctrl)));
+        }
+    private:
+        __m128i m_ctrl;
+    };
+#else
+    struct ctrl_group {
+        static const size_t width = 8;
+        using mask = group_mask<uint64_t, 8, 3>;
+
+        explicit ctrl_group(const int8_t* a_pos) { memcpy(&m_ctrl, a_pos, 8); }
+
+        /// May report false positives, which are weeded out by key comparison
+        mask match(int8_t a_h2) const {
+            uint64_t x = m_ctrl ^ (s_lsbs * uint8_t(a_h2));
+            return mask((x - s_lsbs) & ~x & s_msbs);
+        }
+        mask match_empty() const { return mask(m_ctrl & (~m_ctrl << 6) & s_msbs); }
+        mask match_free()  const { return mask(m_ctrl & s_msbs); }
+    private:
+        static const uint64_t s_lsbs = 0x0101010101010101ull;
+        static const uint64_t s_msbs = 0x8080808080808080ull;
+        uint64_t m_ctrl;
+    };
+#endif
+
+} // namespace detail
+
+/// Flat open-addressing hash map.
+/// @tparam Key   - key type
+/// @tparam T     - mapped type
+/// @tparam Hash  - hash function (the result is additionally mixed, so
+///                 identity hashes of integers are fine)
+/// @tparam Equal - key equality predicate
+/// @tparam Alloc - allocator of bytes
+template <
+    class Key,
+    class T,
+    class Hash  = std::hash<Key>,
+    class Equal = std::equal_to<Key>,
+    class Alloc = std::allocator<char>
+>
+class flat_hash_map {
+    using group = detail::ctrl_group;
+    static const size_t s_width = group::width;
+
+    template <class MapT, class Value>
+    class iter;
+public:
+    using key_type        = Key;
+    using mapped_type     = T;
+    using value_type      = std::pair<const Key, T>;
+    using size_type       = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using hasher          = Hash;
+    using key_equal       = Equal;
+    using allocator_type  = Alloc;
+    using reference       = value_type&;
+    using const_reference = const value_type&;
+    using iterator        = iter<flat_hash_map,       value_type>;
+    using const_iterator  = iter<const flat_hash_map, const value_type>;
+
+    static_assert(sizeof(typename Alloc::value_type) == 1,
+                  "Alloc must be an allocator of bytes");
+
+    explicit flat_hash_map(size_t a_n = 0, const Hash& a_hash = Hash(),
+                           const Equal& a_eq = Equal(),
+                           Alloc& a_alloc = default_allocator())
+        : m_hash(a_hash), m_eq(a_eq), m_alloc(&a_alloc)
+    {
+        if (a_n) reserve(a_n);
+    }
+
+    flat_hash_map(size_t a_n, Alloc& a_alloc)
+        : flat_hash_map(a_n, Hash(), Equal(), a_alloc)
+    {}
+
+    template <class InputIt>
+    flat_hash_map(InputIt a_first, InputIt a_last, size_t a_n = 0)
+        : flat_hash_map(a_n)
+    {
+        insert(a_first, a_last);
+    }
+
+    flat_hash_map(std::initializer_list<value_type> a_list, size_t a_n = 0)
+        : flat_hash_map(a_n ? a_n : a_list.size())
+    {
+        insert(a_list.begin(), a_list.end());
+    }
+
+    flat_hash_map(const flat_hash_map& a_rhs)
+        : flat_hash_map(a_rhs.size(), a_rhs.m_hash, a_rhs.m_eq, *a_rhs.m_alloc)
+    {
+        for (auto& v : a_rhs) insert_unique(v);
+    }
+
+    flat_hash_map(flat_hash_map&& a_rhs) noexcept
+        : m_hash(a_rhs.m_hash), m_eq(a_rhs.m_eq), m_alloc(a_rhs.m_alloc)
+    {
+        swap_state(a_rhs);
+    }
+
+    ~flat_hash_map() { destroy(); }
+
+    flat_hash_map& operator=(const flat_hash_map& a_rhs) {
+        if (this != &a_rhs) {
+            flat_hash_map tmp(a_rhs);
+            swap(tmp);
+        }
+        return *this;
+    }
+
+    flat_hash_map& operator=(flat_hash_map&& a_rhs) noexcept {
+        swap(a_rhs);
+        return *this;
+    }
+
+    void swap(flat_hash_map& a_rhs) noexcept {
+        std::swap(m_hash,  a_rhs.m_hash);
+        std::swap(m_eq,    a_rhs.m_eq);
+        std::swap(m_alloc, a_rhs.m_alloc);
+        swap_state(a_rhs);
+    }
+
+    //------------------------------------------------------------------------
+    // Iterators
+    //------------------------------------------------------------------------
+    iterator       begin()        { return iterator(this, next_full(0));       }
+    iterator       end()          { return iterator(this, m_capacity);         }
+    const_iterator begin()  const { return const_iterator(this, next_full(0)); }
+    const_iterator end()    const { return const_iterator(this, m_capacity);   }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend()   const { return end();   }
+
+    //------------------------------------------------------------------------
+    // Capacity
+    //------------------------------------------------------------------------
+    bool   empty()          const { return m_size == 0;   }
+    size_t size()           const { return m_size;        }
+    size_t max_size()       const { return size_t(1) << (sizeof(size_t)*8 - 2); }
+    size_t bucket_count()   const { return m_capacity;    }
+    float  load_factor()    const { return m_capacity ? float(m_size)/m_capacity : 0; }
+    float  max_load_factor()const { return 7.0f / 8;      }
+    /// The maximum load factor is fixed, the argument is ignored
+    void   max_load_factor(float) {}
+
+    Hash   hash_function()  const { return m_hash;        }
+    Equal  key_eq()         const { return m_eq;          }
+    Alloc& get_allocator()  const { return *m_alloc;      }
+
+    /// Number of deleted slots not yet reclaimed by a rehash
+    size_t tombstones()     const {
+        return capacity_to_growth(m_capacity) - m_size - m_growth_left;
+    }
+
+    //------------------------------------------------------------------------
+    // Lookup
+    //------------------------------------------------------------------------
+    iterator find(const Key& a_key) {
+        return iterator(this, find_index(a_key));
+    }
+    const_iterator find(const Key& a_key) const {
+        return const_iterator(this, find_index(a_key));
+    }
+
+    size_t count(const Key& a_key) const {
+        return find_index(a_key) != m_capacity;
+    }
+
+    T& at(const Key& a_key) {
+        size_t i = find_index(a_key);
+        if (unlikely(i == m_capacity))
+            throw std::out_of_range("flat_hash_map::at: key not found");
+        return m_slots[i].second;
+    }
+    const T& at(const Key& a_key) const {
+        return const_cast<flat_hash_map*>(this)->at(a_key);
+    }
+
+    T& operator[](const Key& a_key) { return try_emplace(a_key).first->second; }
+    T& operator[](Key&& a_key) {
+        return try_emplace(std::move(a_key)).first->second;
+    }
+
+    std::pair<iterator, iterator> equal_range(const Key& a_key) {
+        auto it = find(a_key);
+        return std::make_pair(it, it == end() ? it : std::next(it));
+    }
+
+    //------------------------------------------------------------------------
+    // Modifiers
+    //------------------------------------------------------------------------
+    std::pair<iterator, bool> insert(const value_type& a_val) {
+        return try_emplace(a_val.first, a_val.second);
+    }
+
+    template <class P>
+    std::pair<iterator, bool> insert(P&& a_val) {
+        return emplace(std::forward<P>(a_val));
+    }
+
+    iterator insert(const_iterator, const value_type& a_val) {
+        return insert(a_val).first;
+    }
+
+    template <class InputIt>
+    void insert(InputIt a_first, InputIt a_last) {
+        for (; a_first != a_last; ++a_first)
+            insert(*a_first);
+    }
+
+    void insert(std::initializer_list<value_type> a_list) {
+        insert(a_list.begin(), a_list.end());
+    }
+
+    /// Construct the value in place if the key doesn't exist.
+    /// Mapped value arguments are not consumed if the key exists.
+    template <class K, class... Args>
+    std::pair<iterator, bool> try_emplace(K&& a_key, Args&&... a_args) {
+        auto res = find_or_prepare(a_key);
+        if (res.second)
+            construct(res.first, std::piecewise_construct,
+                      std::forward_as_tuple(std::forward<K>(a_key)),
+                      std::forward_as_tuple(std::forward<Args>(a_args)...));
+        return std::make_pair(iterator(this, res.first), res.second);
+    }
+
+    template <class... Args>
+    std::pair<iterator, bool> emplace(Args&&... a_args) {
+        value_type v(std::forward<Args>(a_args)...);
+        auto res = find_or_prepare(v.first);
+        if (res.second)
+            construct(res.first, std::move(v));
+        return std::make_pair(iterator(this, res.first), res.second);
+    }
+
+    template <class M>
+    std::pair<iterator, bool> insert_or_assign(const Key& a_key, M&& a_val) {
+        auto res = try_emplace(a_key, std::forward<M>(a_val));
+        if (!res.second)
+            res.first->second = std::forward<M>(a_val);
+        return res;
+    }
+
+    size_t erase(const Key& a_key) {
+        size_t i = find_index(a_key);
+        if (i == m_capacity)
+            return 0;
+        erase_at(i);
+        return 1;
+    }
+
+    /// Erase the element. Returns the iterator following it.
+    iterator erase(const_iterator a_it) {
+        erase_at(a_it.m_idx);
+        return iterator(this, next_full(a_it.m_idx + 1));
+    }
+
+    iterator erase(const_iterator a_first, const_iterator a_last) {
+        size_t i = a_first.m_idx;
+        for (; i < a_last.m_idx; i = next_full(i + 1))
+            erase_at(i);
+        return iterator(this, i);
+    }
+
+    /// Destroy all elements, but keep the allocated table
+    void clear() {
+        for (size_t i = 0; i < m_capacity; ++i)
+            if (is_full(m_ctrl[i]))
+                m_slots[i].~value_type();
+        if (m_capacity)
+            memset(m_ctrl, detail::CTRL_EMPTY, m_capacity + s_width);
+        m_size        = 0;
+        m_growth_left = capacity_to_growth(m_capacity);
+    }
+
+    /// Resize the table to hold at least \a a_n slots
+    void rehash(size_t a_n) {
+        size_t cap = normalize_capacity(std::max(a_n, growth_to_capacity(m_size)));
+        if (cap != m_capacity || tombstones())
+            resize(cap);
+    }
+
+    /// Resize the table so that \a a_n elements fit without rehashing
+    void reserve(size_t a_n) {
+        if (a_n > m_size + m_growth_left)
+            resize(normalize_capacity(growth_to_capacity(a_n)));
+    }
+
+private:
+    Hash     m_hash;
+    Equal    m_eq;
+    Alloc*   m_alloc;
+    char*    m_mem          = nullptr;
+    size_t   m_mem_size     = 0;
+    int8_t*  m_ctrl         = nullptr;  ///< m_capacity + s_width bytes
+    value_type* m_slots     = nullptr;
+    size_t   m_capacity     = 0;        ///< Power of 2 or zero
+    size_t   m_size         = 0;
+    size_t   m_growth_left  = 0;
+
+    static Alloc& default_allocator() {
+        static Alloc s_alloc;
+        return s_alloc;
+    }
+
+    static bool   is_full(int8_t c)    { return c >= 0; }
+    static size_t capacity_to_growth(size_t a_cap) { return a_cap - a_cap / 8; }
+    static size_t growth_to_capacity(size_t a_n)   { return a_n + (a_n + 6) / 7; }
+
+    static size_t normalize_capacity(size_t a_n) {
+        size_t c = s_width;
+        while (c < a_n) c <<= 1;
+        return c;
+    }
+
+    // The user hash is mixed by a 128-bit multiply so that the low bits used
+    // for the control byte and the probe start depend on all input bits
+    size_t hash(const Key& a_key) const {
+        unsigned __int128 m = (unsigned __int128)uint64_t(m_hash(a_key))
+                            * 0x9E3779B97F4A7C15ull;
+        return size_t(uint64_t(m) ^ uint64_t(m >> 64));
+    }
+    static size_t h1(size_t h) { return h >> 7;   }
+    static int8_t h2(size_t h) { return h & 0x7F; }
+
+    // Control bytes for slots [0, s_width) are mirrored after the last slot
+    // so that a group can be loaded at any slot position
+    void set_ctrl(size_t i, int8_t c) {
+        m_ctrl[i] = c;
+        if (i < s_width)
+            m_ctrl[m_capacity + i] = c;
+    }
+
+    size_t next_full(size_t i) const {
+        while (i < m_capacity && !is_full(m_ctrl[i])) ++i;
+        return i;
+    }
+
+    template <class K>
+    size_t find_index(const K& a_key) const {
+        if (unlikely(!m_capacity))
+            return 0;
+        size_t h    = hash(a_key);
+        size_t mask = m_capacity - 1;
+        // Triangular probing over groups visits every group once
+        for (size_t pos = h1(h) & mask, step = 0;; ) {
+            group g(m_ctrl + pos);
+            for (auto m = g.match(h2(h)); m; m.clear_lowest()) {
+                size_t i = (pos + m.lowest()) & mask;
+                if (likely(m_eq(m_slots[i].first, a_key)))
+                    return i;
+            }
+            if (likely(bool(g.match_empty())))
+                return m_capacity;
+            step += s_width;
+            pos   = (pos + step) & mask;
+        }
+    }
+
+    size_t find_free(size_t h) const {
+        size_t mask = m_capacity - 1;
+        for (size_t pos = h1(h) & mask, step = 0;; ) {
+            auto m = group(m_ctrl + pos).match_free();
+            if (m)
+                return (pos + m.lowest()) & mask;
+            step += s_width;
+            pos   = (pos + step) & mask;
+        }
+    }
+
+    // Returns the slot index of the key and true if the slot is free and
+    // must be constructed by the caller
+    template <class K>
+    std::pair<size_t, bool> find_or_prepare(const K& a_key) {
+        size_t i = find_index(a_key);
+        if (i < m_capacity)
+            return std::make_pair(i, false);
+
+        size_t h = hash(a_key);
+        if (likely(m_capacity)) {
+            i = find_free(h);
+            if (likely(m_growth_left || m_ctrl[i] == detail::CTRL_DELETED)) {
+                m_growth_left -= m_ctrl[i] == detail::CTRL_EMPTY;
+                set_ctrl(i, h2(h));
+                return std::make_pair(i, true);
+            }
+        }
+        grow();
+        i = find_free(h);
+        --m_growth_left;
+        set_ctrl(i, h2(h));
+        return std::make_pair(i, true);
+    }
+
+    template <class... Args>
+    void construct(size_t i, Args&&... a_args) {
+        try {
+            new (&m_slots[i]) value_type(std::forward<Args>(a_args)...);
+        } catch (...) {
+            set_ctrl(i, detail::CTRL_DELETED);
+            throw;
+        }
+        ++m_size;
+    }
+
+    void insert_unique(const value_type& a_val) {
+        size_t h = hash(a_val.first);
+        size_t i = find_free(h);
+        --m_growth_left;
+        set_ctrl(i, h2(h));
+        construct(i, a_val);
+    }
+
+    void erase_at(size_t i) {
+        m_slots[i].~value_type();
+        --m_size;
+        // If no probe sequence could have passed over this slot while all
+        // slots of a group were full, it can be marked empty again
+        size_t mask  = m_capacity - 1;
+        auto before  = group(m_ctrl + ((i - s_width) & mask)).match_empty();
+        auto after   = group(m_ctrl + i).match_empty();
+        bool never_full = before && after &&
+            size_t(before.leading_zeros() + after.trailing_zeros()) < s_width;
+        set_ctrl(i, never_full ? int8_t(detail::CTRL_EMPTY) : int8_t(detail::CTRL_DELETED));
+        m_growth_left += never_full;
+    }
+
+    // Double the table, or rehash in place if it's mostly filled with
+    // tombstones
+    void grow() {
+        if (m_capacity && m_size * 32 <= m_capacity * 25)
+            resize(m_capacity);
+        else
+            resize(m_capacity ? m_capacity * 2 : s_width);
+    }
+
+    void resize(size_t a_cap) {
+        size_t slots_sz = sizeof(value_type) * a_cap;
+        size_t mem_sz   = alignof(value_type) - 1 + slots_sz + a_cap + s_width;
+        char*  mem      = m_alloc->allocate(mem_sz);
+        auto   addr     = (reinterpret_cast<uintptr_t>(mem) + alignof(value_type) - 1)
+                        & ~uintptr_t(alignof(value_type) - 1);
+
+        auto   old_mem   = m_mem;
+        auto   old_sz    = m_mem_size;
+        auto   old_ctrl  = m_ctrl;
+        auto   old_slots = m_slots;
+        auto   old_cap   = m_capacity;
+
+        m_mem         = mem;
+        m_mem_size    = mem_sz;
+        m_slots       = reinterpret_cast<value_type*>(addr);
+        m_ctrl        = reinterpret_cast<int8_t*>(addr + slots_sz);
+        m_capacity    = a_cap;
+        m_growth_left = capacity_to_growth(a_cap) - m_size;
+        memset(m_ctrl, detail::CTRL_EMPTY, a_cap + s_width);
+
+        for (size_t i = 0; i < old_cap; ++i) {
+            if (!is_full(old_ctrl[i]))
+                continue;
+            size_t h = hash(old_slots[i].first);
+            size_t j = find_free(h);
+            set_ctrl(j, h2(h));
+            new (&m_slots[j]) value_type(std::move(old_slots[i]));
+            old_slots[i].~value_type();
+        }
+
+        if (old_mem)
+            m_alloc->deallocate(old_mem, old_sz);
+    }
+
+    void destroy() {
+        if (!m_mem)
+            return;
+        clear();
+        m_alloc->deallocate(m_mem, m_mem_size);
+        m_mem = nullptr;
+    }
+
+    void swap_state(flat_hash_map& a_rhs) noexcept {
+        std::swap(m_mem,         a_rhs.m_mem);
+        std::swap(m_mem_size,    a_rhs.m_mem_size);
+        std::swap(m_ctrl,        a_rhs.m_ctrl);
+        std::swap(m_slots,       a_rhs.m_slots);
+        std::swap(m_capacity,    a_rhs.m_capacity);
+        std::swap(m_size,        a_rhs.m_size);
+        std::swap(m_growth_left, a_rhs.m_growth_left);
+    }
+};
+
+//----------------------------------------------------------------------------
+// Iterator
+//----------------------------------------------------------------------------
+template <class Key, class T, class Hash, class Equal, class Alloc>
+template <class MapT, class Value>
+class flat_hash_map<Key, T, Hash, Equal, Alloc>::iter
+    : public boost::iterator_facade<iter<MapT, Value>, Value,
+                                    boost::forward_traversal_tag>
+{
+public:
+    iter() : m_map(nullptr), m_idx(0) {}
+
+    template <class OtherMapT, class OtherValue>
+    iter(const iter<OtherMapT, OtherValue>& a_rhs)
+        : m_map(a_rhs.m_map), m_idx(a_rhs.m_idx)
+    {}
+
+private:
+    friend class flat_hash_map;
+    friend class boost::iterator_core_access;
+    template <class, class> friend class iter;
+
+    iter(MapT* a_map, size_t a_idx) : m_map(a_map), m_idx(a_idx) {}
+
+    void   increment()     { m_idx = m_map->next_full(m_idx + 1); }
+    Value& dereference() const { return m_map->m_slots[m_idx]; }
+
+    template <class OtherMapT, class OtherValue>
+    bool equal(const iter<OtherMapT, OtherValue>& a_rhs) const {
+        return m_idx == a_rhs.m_idx;
+    }
+
+    MapT*  m_map;
+    size_t m_idx;
+};
+
+template <class Key, class T, class Hash, class Equal, class Alloc>
+inline void swap(flat_hash_map<Key, T, Hash, Equal, Alloc>& a,
+                 flat_hash_map<Key, T, Hash, Equal, Alloc>& b) noexcept
+{
+    a.swap(b);
+}
+
+} // namespace utxx
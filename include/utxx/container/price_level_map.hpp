@@ -0,0 +1,332 @@
+//----------------------------------------------------------------------------
+/// \file   price_level_map.hpp
+/// \author Serge Aleynikov
+//----------------------------------------------------------------------------
+/// \brief Ordered map of order book price levels indexed by price tick.
+///
+/// One side of a book (bids or asks) is kept in a tick-indexed array that
+/// covers a window of prices around the best price, so that adding,
+/// updating and removing a level near the top of the book is an array
+/// access.  The best level is cached and found in O(1); when it is removed
+/// the next best level is located with a hierarchical_bitmap of occupied
+/// ticks.  Levels that are too far from the best price to fit in the window
+/// are kept in an ordered tree whose nodes come from a preallocated
+/// heap_fixed_size_object_pool, so the container does not allocate memory
+/// after construction.
+///
+/// When a price better than the window arrives, the window is recentered
+/// around it and the levels that fall out of the window migrate into the
+/// tree.  When the window runs empty, it is recentered around the best
+/// outlier.
+//----------------------------------------------------------------------------
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#pragma once
+
+#include <boost/intrusive/set.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/static_assert.hpp>
+#include <utxx/alloc_fixed_pool.hpp>
+#include <utxx/bitmap.hpp>
+#include <utxx/compiler_hints.hpp>
+#include <utxx/error.hpp>
+#include <memory>
+#include <vector>
+
+namespace utxx {
+
+enum class price_side { BID, ASK };
+
+//----------------------------------------------------------------------------
+/// One side of an order book mapping integer price ticks to \a Level.
+///
+/// @tparam Level       per-level data (e.g. quantity and order count). It
+///                     must be default constructible and move assignable.
+///                     A default constructed value denotes an empty level.
+/// @tparam Side        BID orders levels by descending price, ASK by
+///                     ascending price.
+/// @tparam MaxOutliers maximum number of levels outside of the window
+///                     (less than 2^32-1).
+///
+/// The window follows the best level: it is recentered when a price better
+/// than the window arrives, and when erasing the best level moves the best
+/// one past the middle of the window (or out of it).  Pointers to levels
+/// returned by emplace(), find() and best() are invalidated by recentering.
+//----------------------------------------------------------------------------
+template <class Level, price_side Side, size_t MaxOutliers = 4096>
+class price_level_map : boost::noncopyable {
+    // Outliers come from a fixed_size_object_pool, whose free list holds
+    // a 32-bit object index
+    BOOST_STATIC_ASSERT(MaxOutliers >= 2 && MaxOutliers < 0xFFFFFFFFul);
+
+    // Prices are stored as keys ordered from the best to the worst level
+    struct node : public boost::intrusive::set_base_hook<> {
+        long  key;
+        Level level;
+
+        node(long a_key, Level&& a_level) : key(a_key), level(std::move(a_level)) {}
+        bool operator<(const node& a) const { return key < a.key; }
+    };
+
+    struct key_less {
+        bool operator()(long a, const node& b) const { return a < b.key; }
+        bool operator()(const node& a, long b) const { return a.key < b; }
+    };
+
+    typedef boost::intrusive::set<node>         tree_t;
+    typedef memory::heap_fixed_size_object_pool pool_t;
+
+    static const size_t s_npos       = size_t(-1);
+    static const size_t s_pool_bytes =
+        pool_t::storage_size<sizeof(node), MaxOutliers>::value;
+
+    size_t                  m_window;
+    size_t                  m_margin;       ///< Window slots in front of the best level
+    long                    m_lo;           ///< Key of the first window slot
+    size_t                  m_best;         ///< Window slot of the best level
+    size_t                  m_size;
+    size_t                  m_recenters;
+    int                     m_cur;          ///< Current of the two window buffers
+    std::vector<Level>      m_levels[2];
+    hierarchical_bitmap<>   m_used[2];
+    tree_t                  m_tree;
+    std::unique_ptr<char[]> m_storage;
+    pool_t*                 m_pool;
+
+    static long to_key(long a_px)  { return Side == price_side::BID ? -a_px : a_px; }
+    static long to_px (long a_key) { return Side == price_side::BID ? -a_key : a_key; }
+
+    bool in_window(long a_key) const {
+        return a_key >= m_lo && size_t(a_key - m_lo) < m_window;
+    }
+
+    node& new_node(long a_key, Level&& a_level) {
+        void* p = m_pool->allocate();
+        if (unlikely(!p))
+            UTXX_THROW_RUNTIME_ERROR("Out of outlier price levels (max ", MaxOutliers, ')');
+        node* n = new (p) node(a_key, std::move(a_level));
+        m_tree.insert(*n);
+        return *n;
+    }
+
+    void free_node(node& a_node) {
+        m_tree.erase(m_tree.iterator_to(a_node));
+        a_node.~node();
+        m_pool->free(&a_node);
+    }
+
+    // Move the window to start at key a_lo. Levels leaving the window are
+    // moved to the tree and outliers entering the window are moved from it.
+    void recenter(long a_lo) {
+        auto& from = m_levels[m_cur];
+        auto& to   = m_levels[m_cur ^ 1];
+        auto& fu   = m_used[m_cur];
+        auto& tu   = m_used[m_cur ^ 1];
+        long  hi   = a_lo + long(m_window);
+
+        size_t out = 0;
+        for (size_t i = fu.first(); i != fu.end(); i = fu.next(i))
+            out += !(m_lo + long(i) >= a_lo && m_lo + long(i) < hi);
+        if (unlikely(m_tree.size() + out > MaxOutliers))
+            UTXX_THROW_RUNTIME_ERROR("Out of outlier price levels (max ", MaxOutliers, ')');
+
+        for (size_t i = fu.first(); i != fu.end(); i = fu.next(i)) {
+            long k = m_lo + long(i);
+            if (k >= a_lo && k < hi) {
+                to[k - a_lo] = std::move(from[i]);
+                tu.set(k - a_lo);
+            } else
+                new_node(k, std::move(from[i]));
+            from[i] = Level();
+        }
+        fu.clear();
+
+        for (auto it = m_tree.lower_bound(a_lo, key_less());
+             it != m_tree.end() && it->key < hi;)
+        {
+            node& n = *it++;
+            to[n.key - a_lo] = std::move(n.level);
+            tu.set(n.key - a_lo);
+            free_node(n);
+        }
+
+        m_cur  ^= 1;
+        m_lo    = a_lo;
+        m_best  = tu.first() == tu.end() ? s_npos : tu.first();
+        ++m_recenters;
+    }
+
+public:
+    typedef Level value_type;
+
+    /// @param a_window number of price ticks covered by the array window.
+    ///                 A quarter of the window is reserved for prices
+    ///                 better than the best level.
+    explicit price_level_map(size_t a_window = 1024)
+        : m_window(a_window), m_margin(a_window / 4), m_lo(0), m_best(s_npos)
+        , m_size(0), m_recenters(0), m_cur(0)
+        , m_storage(new char[s_pool_bytes])
+        , m_pool(&pool_t::create(m_storage.get(), s_pool_bytes, sizeof(node)))
+    {
+        if (a_window < 64)
+            UTXX_THROW_BADARG_ERROR("Price level window too small: ", a_window);
+        for (int i = 0; i < 2; ++i) {
+            m_levels[i].resize(a_window);
+            m_used[i].resize(a_window);
+        }
+    }
+
+    ~price_level_map() { clear(); }
+
+    /// Number of price levels
+    size_t size()      const { return m_size;        }
+    bool   empty()     const { return m_size == 0;   }
+    /// Number of ticks covered by the array window
+    size_t window()    const { return m_window;      }
+    /// Number of levels stored outside of the window
+    size_t outliers()  const { return m_tree.size(); }
+    /// Number of times the window was moved
+    size_t recenters() const { return m_recenters;   }
+
+    /// Best level or NULL if the map is empty
+    Level*       best()       { return m_best == s_npos ? NULL : &m_levels[m_cur][m_best]; }
+    const Level* best() const { return m_best == s_npos ? NULL : &m_levels[m_cur][m_best]; }
+
+    /// Price of the best level. The map must not be empty.
+    long best_price() const {
+        BOOST_ASSERT(m_best != s_npos);
+        return to_px(m_lo + long(m_best));
+    }
+
+    /// Find the level at price \a a_px or insert an empty one.
+    /// @return the level and true if it was inserted
+    std::pair<Level*, bool> emplace(long a_px) {
+        long k = to_key(a_px);
+        if (unlikely(m_size == 0))
+            m_lo = k - long(m_margin);
+        else if (unlikely(k < m_lo))
+            recenter(k - long(m_margin));
+        else if (unlikely(size_t(k - m_lo) >= m_window)) {
+            auto it = m_tree.find(k, key_less());
+            if (it != m_tree.end())
+                return std::make_pair(&it->level, false);
+            node& n = new_node(k, Level());
+            ++m_size;
+            return std::make_pair(&n.level, true);
+        }
+
+        size_t i    = k - m_lo;
+        auto&  used = m_used[m_cur];
+        if (used[i])
+            return std::make_pair(&m_levels[m_cur][i], false);
+        used.set(i);
+        ++m_size;
+        if (i < m_best || m_best == s_npos)
+            m_best = i;
+        return std::make_pair(&m_levels[m_cur][i], true);
+    }
+
+    /// Find the level at price \a a_px or insert an empty one
+    Level& operator[](long a_px) { return *emplace(a_px).first; }
+
+    /// @return the level at price \a a_px or NULL if not found
+    Level* find(long a_px) {
+        long k = to_key(a_px);
+        if (likely(in_window(k))) {
+            size_t i = k - m_lo;
+            return m_used[m_cur][i] ? &m_levels[m_cur][i] : NULL;
+        }
+        auto it = m_tree.find(k, key_less());
+        return it == m_tree.end() ? NULL : &it->level;
+    }
+
+    const Level* find(long a_px) const {
+        return const_cast<price_level_map*>(this)->find(a_px);
+    }
+
+    /// Remove the level at price \a a_px.
+    /// @return false if there is no such level
+    bool erase(long a_px) {
+        long k = to_key(a_px);
+        if (unlikely(!in_window(k))) {
+            auto it = m_tree.find(k, key_less());
+            if (it == m_tree.end())
+                return false;
+            free_node(*it);
+            --m_size;
+            return true;
+        }
+
+        size_t i    = k - m_lo;
+        auto&  used = m_used[m_cur];
+        if (!used[i])
+            return false;
+        used.clear(i);
+        m_levels[m_cur][i] = Level();
+        --m_size;
+
+        if (i == m_best) {
+            m_best = used.next(i);
+            if (m_best == used.end()) {
+                m_best = s_npos;
+                if (!m_tree.empty())
+                    recenter(m_tree.begin()->key - long(m_margin));
+            } else if (unlikely(m_best > 2*m_margin))
+                // Prices moved toward the end of the window: follow them
+                recenter(m_lo + long(m_best) - long(m_margin));
+        }
+        return true;
+    }
+
+    /// Visit up to \a a_max levels from the best to the worst price by
+    /// calling \a a_visit(long price, const Level&).
+    /// @return number of visited levels
+    template <class Visitor>
+    size_t for_each(Visitor&& a_visit, size_t a_max = s_npos) const {
+        size_t n    = 0;
+        auto&  used = m_used[m_cur];
+        if (m_best != s_npos)
+            for (size_t i = m_best; i != used.end() && n < a_max; i = used.next(i), ++n)
+                a_visit(to_px(m_lo + long(i)), m_levels[m_cur][i]);
+        for (auto it = m_tree.begin(); it != m_tree.end() && n < a_max; ++it, ++n)
+            a_visit(to_px(it->key), it->level);
+        return n;
+    }
+
+    /// Remove all levels
+    void clear() {
+        auto& used = m_used[m_cur];
+        for (size_t i = used.first(); i != used.end(); i = used.next(i))
+            m_levels[m_cur][i] = Level();
+        used.clear();
+        while (!m_tree.empty())
+            free_node(*m_tree.begin());
+        m_size = 0;
+        m_best = s_npos;
+    }
+};
+
+} // namespace utxx
@@ -3,6 +3,7 @@
 // found in the LICENSE file.
 #pragma once
 
+#include <utxx/alloc_arena.hpp>
 #include <string>
 #include <vector>
 #include <cstdint>
@@ -27,6 +28,18 @@ namespace utxx {
 // be sure to reserve() in the container up to the stack buffer size. Otherwise
 // the container will allocate a small array which will "use up" the stack
 // buffer.
+//
+// When the storage is given a memory::arena, allocations that don't fit in
+// the stack buffer are made from the arena instead of the heap, and are
+// reclaimed all at once by arena::reset().  Allocators rebound to other types
+// (e.g. for nodes of std::unordered_map) share the arena but not the stack
+// buffer.  An allocator constructed from an arena alone doesn't use a stack
+// buffer:
+//
+//   memory::arena& a = memory::arena::local();
+//   std::vector<int, stack_allocator<int, 1>> v(stack_allocator<int, 1>(&a));
+//   ...
+//   a.reset();      // At the end of processing of a message
 template<typename T, size_t stack_capacity>
 class stack_allocator : public std::allocator<T>
 {
@@ -39,7 +52,9 @@ public:
     // live.
     struct storage
     {
-        storage() : m_used_stack_buffer(false) {}
+        explicit storage(memory::arena* a_arena = NULL)
+            : m_used_stack_buffer(false), m_arena(a_arena)
+        {}
 
         // Casts the buffer in its right type.
         T* stack_buffer()
@@ -66,6 +81,9 @@ public:
         // Set when the stack buffer is used for an allocation. We do not track
         // how much of the buffer is used, only that somebody is using it.
         bool m_used_stack_buffer;
+
+        // Optional arena for allocations that overflow the stack buffer.
+        memory::arena* m_arena;
     };
 
     // Used by containers when they want to refer to an allocator of type U.
@@ -77,7 +95,7 @@ public:
 
     // For the straight up copy c-tor, we can share storage.
     stack_allocator(const stack_allocator<T, stack_capacity>& rhs)
-        : std::allocator<T>(), m_src(rhs.m_src)
+        : std::allocator<T>(), m_src(rhs.m_src), m_arena(rhs.m_arena)
     {}
 
     // ISO C++ requires the following constructor to be defined,
@@ -91,20 +109,25 @@ public:
     // iff sizeof(T) == sizeof(U).
     template<typename U, size_t other_capacity>
     stack_allocator(const stack_allocator<U, other_capacity>& other)
-        : m_src(NULL)
+        : m_src(NULL), m_arena(other.arena())
     {}
 
     // Don't use this allocator directly - it's for compatibility with GCC < 5.1
     // when using with std::string that has __a == __Alloc() comparison
-    stack_allocator() : m_src(NULL)
+    stack_allocator() : m_src(NULL), m_arena(NULL)
     {}
 
-    explicit stack_allocator(storage* source) : m_src(source)
+    explicit stack_allocator(storage* source)
+        : m_src(source), m_arena(source ? source->m_arena : NULL)
+    {}
+
+    // Allocate everything from the arena without using a stack buffer.
+    explicit stack_allocator(memory::arena* a_arena) : m_src(NULL), m_arena(a_arena)
     {}
 
     // Actually do the allocation. Use the stack buffer if nobody has used it yet
-    // and the size requested fits. Otherwise, fall through to the standard
-    // allocator.
+    // and the size requested fits. Otherwise, fall through to the arena if
+    // there is one, or to the standard allocator.
     pointer allocate(size_type n, void* hint = 0)
     {
         if (m_src != NULL && !m_src->m_used_stack_buffer && n <= stack_capacity)
@@ -112,6 +135,10 @@ public:
             m_src->m_used_stack_buffer = true;
             return m_src->stack_buffer();
         }
+        else if (m_arena != NULL)
+        {
+            return static_cast<pointer>(m_arena->allocate(n*sizeof(T), alignof(T)));
+        }
         else
         {
             return std::allocator<T>::allocate(n, hint);
@@ -119,22 +146,28 @@ public:
     }
 
     // Free: when trying to free the stack buffer, just mark it as free. For
-    // non-stack-buffer pointers, just fall though to the standard allocator.
+    // non-stack-buffer pointers, just fall though to the arena or to the
+    // standard allocator.
     void deallocate(pointer p, size_type n)
     {
         if (m_src != NULL && p == m_src->stack_buffer())
             m_src->m_used_stack_buffer = false;
+        else if (m_arena != NULL)
+            m_arena->deallocate(p, n*sizeof(T));
         else
             std::allocator<T>::deallocate(p, n);
     }
 
     bool operator==(const stack_allocator& rhs) const {
-        return m_src == rhs.m_src;
+        return m_src == rhs.m_src && m_arena == rhs.m_arena;
     }
+    bool operator!=(const stack_allocator& rhs) const { return !operator==(rhs); }
 
-    bool used_stack() const { return m_src && m_src->m_used_stack_buffer; }
+    bool           used_stack() const { return m_src && m_src->m_used_stack_buffer; }
+    memory::arena* arena()      const { return m_arena; }
 private:
-    storage* m_src;
+    storage*       m_src;
+    memory::arena* m_arena;
 };
 
 // A wrapper around STL containers that maintains a stack-sized buffer that the
@@ -162,6 +195,13 @@ public:
         m_container.reserve(capacity);
     }
 
+    // Overflow the stack buffer onto the arena rather than the heap.
+    explicit stack_container(memory::arena* a_arena, size_t capacity = stack_capacity)
+        : m_stack_data(a_arena), m_allocator(&m_stack_data), m_container(m_allocator)
+    {
+        m_container.reserve(capacity);
+    }
+
     // Getters for the actual container.
     //
     // Danger: any copies of this made using the copy constructor must have
@@ -210,6 +250,8 @@ public:
     // Note: reserving capacity-1 because string implementation does +1 to
     // provision for terminating '\0'.
     basic_stack_string() : base(stack_capacity-1) {}
+    explicit basic_stack_string(memory::arena* a_arena)
+        : base(a_arena, stack_capacity-1) {}
 
 private:
     basic_stack_string(basic_stack_string const&)            = delete;
@@ -230,6 +272,8 @@ class basic_stack_wstring
         stack_capacity>;
 public:
     basic_stack_wstring() : base(stack_capacity - sizeof(wchar_t)) {}
+    explicit basic_stack_wstring(memory::arena* a_arena)
+        : base(a_arena, stack_capacity - sizeof(wchar_t)) {}
 
 private:
     basic_stack_wstring(basic_stack_wstring const&)            = delete;
@@ -253,6 +297,11 @@ public:
         stack_capacity>()
     {}
 
+    explicit basic_stack_vector(memory::arena* a_arena) : stack_container<
+        std::vector<T, stack_allocator<T, stack_capacity> >,
+        stack_capacity>(a_arena)
+    {}
+
     // We need to put this in STL containers sometimes, which requires a copy
     // constructor. We can't call the regular copy constructor because that will
     // take the stack buffer from the original. Here, we create an empty object
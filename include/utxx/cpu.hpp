@@ -47,4 +47,110 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #  error Platform not supported!
 #endif
 
+#include <sched.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace utxx {
+
+/// Placement of a logical CPU as reported by /sys/devices/system/cpu
+struct cpu_info {
+    int cpu;        ///< Logical CPU number
+    int core;       ///< Physical core id within the package (-1 if unknown)
+    int package;    ///< Physical package (socket) id (-1 if unknown)
+    int node;       ///< NUMA node (-1 if unknown)
+};
+
+/// List of logical CPUs that the calling thread is allowed to run on.
+inline std::vector<int> cpu_affinity_list() {
+    std::vector<int> res;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (::sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int i=0; i < CPU_SETSIZE; ++i)
+            if (CPU_ISSET(i, &set))
+                res.push_back(i);
+    }
+    if (res.empty())
+        for (int i=0, n = detail::cpu_count(); i < n; ++i)
+            res.push_back(i);
+    return res;
+}
+
+/// Topology of CPUs in cpu_affinity_list().
+inline std::vector<cpu_info> cpu_topology() {
+    auto read_id = [](const std::string& a_file) {
+        std::ifstream in(a_file);
+        int  n = -1;
+        return (in >> n) ? n : -1;
+    };
+    std::vector<cpu_info> res;
+    for (int cpu : cpu_affinity_list()) {
+        auto dir  = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+        cpu_info info{cpu, read_id(dir + "/topology/core_id"),
+                      read_id(dir + "/topology/physical_package_id"), -1};
+        if (DIR* d = ::opendir(dir.c_str())) {
+            while (dirent* e = ::readdir(d))
+                if (strncmp(e->d_name, "node", 4) == 0 && e->d_name[4] >= '0' &&
+                    e->d_name[4] <= '9') {
+                    info.node = atoi(e->d_name + 4);
+                    break;
+                }
+            ::closedir(d);
+        }
+        res.push_back(info);
+    }
+    return res;
+}
+
+/// Bind \a a_thread to logical CPU \a a_cpu.
+/// @return 0 on success or an errno value
+inline int pin_thread(pthread_t a_thread, int a_cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(a_cpu, &set);
+    return ::pthread_setaffinity_np(a_thread, sizeof(set), &set);
+}
+
+/// Bind the calling thread to logical CPU \a a_cpu.
+/// @return 0 on success or an errno value
+inline int pin_this_thread(int a_cpu) { return pin_thread(::pthread_self(), a_cpu); }
+
+/// Logical CPU the calling thread is currently running on.
+inline int current_cpu() { return ::sched_getcpu(); }
+
+/// NUMA node of the CPU the calling thread is currently running on
+/// (0 if unknown).
+inline int current_numa_node() {
+    unsigned int cpu, node;
+    #if defined(__GLIBC__) && __GLIBC_PREREQ(2, 29)
+    return ::getcpu(&cpu, &node) == 0 ? int(node) : 0;
+    #else
+    return ::syscall(SYS_getcpu, &cpu, &node, NULL) == 0 ? int(node) : 0;
+    #endif
+}
+
+/// Number of NUMA nodes in the system (1 if the system is not NUMA).
+inline int numa_node_count() {
+    int n = 0;
+    if (DIR* d = ::opendir("/sys/devices/system/node")) {
+        while (dirent* e = ::readdir(d))
+            if (strncmp(e->d_name, "node", 4) == 0 && e->d_name[4] >= '0' &&
+                e->d_name[4] <= '9')
+                n = std::max(n, atoi(e->d_name + 4) + 1);
+        ::closedir(d);
+    }
+    return std::max(n, 1);
+}
+
+} // namespace utxx
+
 #endif // _UTXX_CPU_HPP_
@@ -36,6 +36,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <utxx/math.hpp>
 #include <utxx/error.hpp>
 #include <utxx/compiler_hints.hpp>
+#include <utxx/warmup.hpp>
 #include <memory>
 #include <cstring>
 #include <stdexcept>
@@ -169,6 +170,16 @@ namespace utxx
         //----------------------------------------------------------------------
         void clear() { m_size = 0; }
 
+        //----------------------------------------------------------------------
+        /// Pre-fault (and optionally lock / NUMA-bind) the memory of the
+        /// buffer including all of its entries
+        //----------------------------------------------------------------------
+        memory::warmup_report
+        prefault(const memory::warmup_options& a_opts = memory::warmup_options()) {
+            return memory::warm_up(this, reinterpret_cast<char*>(m_entries + m_capacity)
+                                       - reinterpret_cast<char*>(this), a_opts);
+        }
+
         //----------------------------------------------------------------------
         /// Emplace a new entry into the buffer
         /// @return a direct access ref to the entry stored
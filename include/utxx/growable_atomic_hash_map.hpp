@@ -0,0 +1,695 @@
+//----------------------------------------------------------------------------
+/// \file   growable_atomic_hash_map.hpp
+/// \author Serge Aleynikov
+//----------------------------------------------------------------------------
+/// \brief Concurrent open-addressing hash map with incremental resizing.
+///
+/// Unlike atomic_hash_map, which chains up to 16 fixed submaps and never
+/// reuses erased cells, this map keeps a single power-of-two table. When
+/// the number of claimed cells (live keys plus tombstones) reaches the max
+/// load factor, a new table sized for the number of live keys is allocated
+/// and the old one is migrated into it in chunks. Every insert/erase that
+/// runs during a migration moves one chunk, and an optional background
+/// thread moves the rest. Tombstones are dropped while migrating, so a map
+/// with a steady churn of keys keeps its probe lengths and memory bounded.
+/// If concurrent inserts fill the new table before the migration completes,
+/// it is given a larger table of its own, and the remaining keys are
+/// forwarded there.
+///
+/// Lookups never take locks and never wait for a migration to finish. Old
+/// tables are freed via rcu_snapshot once all threads that could see them
+/// have left their read sections.
+//----------------------------------------------------------------------------
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#pragma once
+
+#include <utxx/rcu_snapshot.hpp>
+#include <utxx/thread_cached_int.hpp>
+#include <utxx/backoff.hpp>
+#include <utxx/compiler_hints.hpp>
+#include <utxx/error.hpp>
+#include <boost/noncopyable.hpp>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <type_traits>
+
+namespace utxx {
+
+//-----------------------------------------------------------------------------
+/// Concurrent hash map with int32/int64 keys and incremental resizing.
+//-----------------------------------------------------------------------------
+/// ValueT must be trivially copyable: values are written once on insert and
+/// copied out by find(), and during migration they are copied into the new
+/// table. All methods are thread-safe.
+///
+/// Cell states: a cell holds either a live key or one of the reserved keys
+/// (see config): EMPTY, LOCKED (value being written by an insert), ERASED
+/// (tombstone), MOVING (being copied into the next table) or MOVED (frozen,
+/// the key, if any, lives in the next table). Cells never return to EMPTY,
+/// which keeps probe sequences intact while tables are being migrated.
+template <class KeyT, class ValueT,
+          class HashFcn   = std::hash<KeyT>,
+          class EqualFcn  = std::equal_to<KeyT>,
+          class Allocator = std::allocator<char>>
+class growable_atomic_hash_map : boost::noncopyable {
+    static_assert(std::is_convertible<KeyT, int64_t>::value &&
+                  sizeof(KeyT) <= sizeof(int64_t),
+                  "Key must be an atomically compare-and-swappable integer");
+    static_assert(std::is_trivially_copyable<ValueT>::value,
+                  "Value must be trivially copyable");
+public:
+    using key_type    = KeyT;
+    using mapped_type = ValueT;
+    using hasher      = HashFcn;
+    using key_equal   = EqualFcn;
+
+    struct config {
+        KeyT    m_empty_key;
+        KeyT    m_locked_key;
+        KeyT    m_erased_key;
+        KeyT    m_moving_key;
+        KeyT    m_moved_key;
+        double  m_max_load_factor;  ///< Claimed cells (incl. tombstones) ratio
+                                    ///< that triggers a resize
+        size_t  m_chunk_size;       ///< Cells migrated per helping step
+        bool    m_background;       ///< Run a background migration thread
+
+        config
+        (
+            KeyT   a_empty_key       = (KeyT)-1,
+            KeyT   a_locked_key      = (KeyT)-2,
+            KeyT   a_erased_key      = (KeyT)-3,
+            KeyT   a_moving_key      = (KeyT)-4,
+            KeyT   a_moved_key       = (KeyT)-5,
+            double a_max_load_factor = 0.8,
+            size_t a_chunk_size      = 256,
+            bool   a_background      = false
+        ) : m_empty_key      (a_empty_key)
+          , m_locked_key     (a_locked_key)
+          , m_erased_key     (a_erased_key)
+          , m_moving_key     (a_moving_key)
+          , m_moved_key      (a_moved_key)
+          , m_max_load_factor(a_max_load_factor)
+          , m_chunk_size     (a_chunk_size)
+          , m_background     (a_background)
+        {}
+    };
+
+    /// Probe length statistics of live keys in the current table.
+    struct probe_stats {
+        size_t size;        ///< Live keys
+        size_t capacity;    ///< Table capacity
+        size_t tombstones;  ///< Erased cells
+        double avg;         ///< Average distance from the home cell
+        size_t max;         ///< Maximum distance from the home cell
+    };
+
+    /// @param a_capacity expected number of live keys
+    explicit growable_atomic_hash_map(size_t a_capacity, const config& a_cfg = config(),
+                                      const Allocator& a_alloc = Allocator());
+    ~growable_atomic_hash_map();
+
+    /// Insert a key/value pair. Doesn't overwrite an existing key.
+    /// @return true if inserted, false if the key already exists
+    bool insert(const KeyT& a_key, const ValueT& a_value);
+
+    /// Copy the value of \a a_key to \a a_value.
+    /// @return false if the key is not found
+    bool find(const KeyT& a_key, ValueT& a_value) const;
+
+    bool exists(const KeyT& a_key) const { ValueT v; return find(a_key, v); }
+
+    /// @return 1 if the key was found and erased, 0 otherwise
+    size_t erase(const KeyT& a_key);
+
+    /// Number of live keys (exact, but takes a lock - see thread_cached_int)
+    size_t size()     const { return size_t(std::max<int64_t>(0, m_size.read_full())); }
+    bool   empty()    const { return size() == 0; }
+
+    /// Capacity of the current table.
+    size_t capacity() const { return m_tables.read([](const table* t) { return t->capacity; }); }
+
+    /// True if the current table is being migrated into a new one.
+    bool   migrating() const {
+        return m_tables.read([](const table* t) { return t->next.load() != nullptr; });
+    }
+
+    /// Number of completed migrations.
+    unsigned long resizes() const { return m_resizes.load(std::memory_order_relaxed); }
+
+    /// Move up to \a a_max_chunks chunks of the current table into the next
+    /// one (e.g. from a maintenance thread).
+    /// @return number of chunks moved (0 if no migration is in progress)
+    size_t migrate(size_t a_max_chunks = size_t(-1));
+
+    /// Free old tables that are no longer referenced by readers.
+    size_t reclaim() { return m_tables.reclaim(); }
+
+    /// Call \a a_fun(key, value) for every live key. Completes the pending
+    /// migration first. Concurrent modifications may or may not be seen.
+    template <class F>
+    void for_each(F&& a_fun) const;
+
+    /// Probe statistics of the current table (an O(capacity) scan).
+    probe_stats stats() const;
+
+private:
+    using rebind_cell = typename Allocator::template rebind<char>::other;
+
+    struct cell {
+        std::atomic<KeyT> key;
+        KeyT              copy;     // Key written on insert, lets lookups
+                                    // match a MOVING cell without waiting
+        ValueT            value;
+    };
+
+    // All mutable state is atomic or written by the cell owner only, so the
+    // table is shared as a const object through rcu_snapshot
+    struct table {
+        const size_t                        capacity;
+        const size_t                        mask;
+        const size_t                        max_used;
+        const size_t                        chunks;
+        mutable thread_cached_int<int64_t>  used;     // Claimed cells
+        mutable std::atomic<table*>         next;     // Migration target
+        mutable std::atomic<size_t>         claimed;  // Chunks claimed
+        mutable std::atomic<size_t>         done;     // Chunks migrated
+        mutable rebind_cell                 alloc;
+        cell* const                         cells;
+
+        table(size_t a_capacity, const config& a_cfg, const rebind_cell& a_alloc)
+            : capacity(a_capacity)
+            , mask    (a_capacity - 1)
+            , max_used(size_t(a_capacity * a_cfg.m_max_load_factor))
+            , chunks  ((a_capacity + a_cfg.m_chunk_size - 1) / a_cfg.m_chunk_size)
+            // Keep the lag of read_fast() to a fraction of the capacity
+            , used    (0, uint32_t(std::min<size_t>(256, std::max<size_t>(1, a_capacity >> 9))))
+            , next    (nullptr)
+            , claimed (0)
+            , done    (0)
+            , alloc   (a_alloc)
+            , cells   (reinterpret_cast<cell*>(&*alloc.allocate(a_capacity * sizeof(cell))))
+        {
+            for (size_t i=0; i < capacity; ++i)
+                cells[i].key.store(a_cfg.m_empty_key, std::memory_order_relaxed);
+        }
+
+        ~table() {
+            typename rebind_cell::pointer p(reinterpret_cast<char*>(cells));
+            alloc.deallocate(p, capacity * sizeof(cell));
+        }
+    };
+
+    enum class result { FOUND, ABSENT, FORWARD, INSERTED, FULL };
+
+    const config                m_cfg;
+    const HashFcn               m_hash;
+    const EqualFcn              m_eq;
+    const size_t                m_min_capacity;
+    rebind_cell                 m_alloc;
+    mutable rcu_snapshot<table> m_tables;
+    thread_cached_int<int64_t>  m_size;
+    std::atomic<unsigned long>  m_resizes;
+
+    // Background migration
+    std::mutex                  m_bg_mutex;
+    std::condition_variable     m_bg_cond;
+    bool                        m_bg_stop;
+    std::thread                 m_bg_thread;
+
+    bool is_eq    (KeyT a, KeyT b) const { return m_eq(a, b); }
+    bool is_empty (KeyT k) const { return m_eq(k, m_cfg.m_empty_key);  }
+    bool is_locked(KeyT k) const { return m_eq(k, m_cfg.m_locked_key); }
+    bool is_erased(KeyT k) const { return m_eq(k, m_cfg.m_erased_key); }
+    bool is_moving(KeyT k) const { return m_eq(k, m_cfg.m_moving_key); }
+    bool is_moved (KeyT k) const { return m_eq(k, m_cfg.m_moved_key);  }
+    bool is_live  (KeyT k) const {
+        return !is_empty(k) && !is_locked(k) && !is_erased(k) && !is_moving(k) && !is_moved(k);
+    }
+    bool is_reserved(KeyT k) const { return !is_live(k); }
+
+    // Fibonacci hashing spreads poor hash functions (e.g. identity of
+    // sequential ids) over a power-of-two table
+    size_t home(const table* t, KeyT k) const {
+        return size_t((uint64_t(m_hash(k)) * 0x9E3779B97F4A7C15ull) >> 20) & t->mask;
+    }
+
+    static size_t calc_capacity(size_t a_live, double a_load_factor, size_t a_min) {
+        // After a resize the table is at most half of the max load factor
+        size_t need = size_t(double(a_live) * 2 / a_load_factor);
+        size_t n    = 64;
+        while (n < need || n < a_min) n <<= 1;
+        return n;
+    }
+
+    // Wait for a transient cell state (LOCKED or MOVING) to resolve
+    KeyT wait_cell(const cell& c, bool (growable_atomic_hash_map::*a_pred)(KeyT) const) const {
+        backoff<> bo;
+        KeyT k;
+        while ((this->*a_pred)(k = c.key.load(std::memory_order_acquire))) {
+            if (bo.saturated()) std::this_thread::yield();
+            else                bo();
+        }
+        return k;
+    }
+
+    // Current table. Must be called inside of a read section, which keeps
+    // the returned table alive (the nested section keeps the outer epoch).
+    const table* current() const { return m_tables.read().get(); }
+
+    result lookup    (const table* t, KeyT a_key, size_t& a_idx) const;
+    result try_insert(const table* t, KeyT a_key, const ValueT& a_value, bool a_migrating);
+    result try_erase(const table* t, KeyT a_key);
+    void   start_resize(const table* t, bool a_grow = false);
+    bool   help_migrate(const table* t, size_t a_max_chunks, size_t& a_moved);
+    void   migrate_chunk(const table* t, size_t a_chunk);
+    void   background_run();
+};
+
+//-----------------------------------------------------------------------------
+// IMPLEMENTATION
+//-----------------------------------------------------------------------------
+
+template <class K, class V, class H, class E, class A>
+growable_atomic_hash_map<K,V,H,E,A>::
+growable_atomic_hash_map(size_t a_capacity, const config& a_cfg, const A& a_alloc)
+    : m_cfg         (a_cfg)
+    , m_hash        (H())
+    , m_eq          (E())
+    , m_min_capacity(calc_capacity(a_capacity, a_cfg.m_max_load_factor, 64) / 2)
+    , m_alloc       (a_alloc)
+    , m_size        (0, 32)
+    , m_resizes     (0)
+    , m_bg_stop     (false)
+{
+    if (a_cfg.m_max_load_factor <= 0.0 || a_cfg.m_max_load_factor >= 1.0 || !a_cfg.m_chunk_size)
+        UTXX_THROW_BADARG_ERROR("Invalid max load factor or chunk size");
+    m_tables.publish(new table(
+        calc_capacity(a_capacity, a_cfg.m_max_load_factor, 64), m_cfg, m_alloc));
+    if (m_cfg.m_background)
+        m_bg_thread = std::thread([this]() { background_run(); });
+}
+
+template <class K, class V, class H, class E, class A>
+growable_atomic_hash_map<K,V,H,E,A>::
+~growable_atomic_hash_map() {
+    if (m_bg_thread.joinable()) {
+        { std::lock_guard<std::mutex> g(m_bg_mutex); m_bg_stop = true; }
+        m_bg_cond.notify_one();
+        m_bg_thread.join();
+    }
+    // Pending migration targets are not owned by m_tables yet
+    m_tables.read([](const table* t) {
+        for (table* p = t->next.load(), *n; p; p = n) {
+            n = p->next.load();
+            delete p;
+        }
+    });
+}
+
+template <class K, class V, class H, class E, class A>
+void growable_atomic_hash_map<K,V,H,E,A>::background_run() {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> g(m_bg_mutex);
+            m_bg_cond.wait(g, [this]() { return m_bg_stop || migrating(); });
+            if (m_bg_stop)
+                return;
+        }
+        if (!migrate())
+            std::this_thread::yield();
+        reclaim();
+    }
+}
+
+template <class K, class V, class H, class E, class A>
+typename growable_atomic_hash_map<K,V,H,E,A>::result
+growable_atomic_hash_map<K,V,H,E,A>::
+lookup(const table* t, K a_key, size_t& a_idx) const {
+    bool fwd = false;
+    for (size_t i = home(t, a_key), n = 0; n < t->capacity; ++n, i = (i+1) & t->mask) {
+        const cell& c = t->cells[i];
+        K k = c.key.load(std::memory_order_acquire);
+        if (is_eq(k, a_key)) {
+            a_idx = i;
+            return result::FOUND;
+        }
+        if (is_empty(k))
+            return fwd ? result::FORWARD : result::ABSENT;
+        if (is_moving(k)) {
+            // This may be our key on its way to the next table. Its value
+            // stays valid here until the table is reclaimed
+            if (is_eq(c.copy, a_key)) {
+                a_idx = i;
+                return result::FOUND;
+            }
+            fwd = true;
+        } else if (is_moved(k))
+            fwd = true;
+    }
+    return fwd || t->next.load(std::memory_order_acquire) ? result::FORWARD : result::ABSENT;
+}
+
+template <class K, class V, class H, class E, class A>
+bool growable_atomic_hash_map<K,V,H,E,A>::
+find(const K& a_key, V& a_value) const {
+    assert(is_live(a_key));
+    auto   g = m_tables.read();
+    size_t idx;
+    for (const table* t = g.get(); t; t = t->next.load(std::memory_order_acquire))
+        switch (lookup(t, a_key, idx)) {
+            case result::FOUND:
+                // Values are immutable once the key is published, and the
+                // table can't be freed while we are in the read section
+                a_value = t->cells[idx].value;
+                return true;
+            case result::FORWARD:
+                continue;
+            default:
+                return false;
+        }
+    return false;
+}
+
+template <class K, class V, class H, class E, class A>
+typename growable_atomic_hash_map<K,V,H,E,A>::result
+growable_atomic_hash_map<K,V,H,E,A>::
+try_insert(const table* t, K a_key, const V& a_value, bool a_migrating) {
+    bool fwd = false;
+    for (size_t i = home(t, a_key), n = 0; n < t->capacity; ++n, i = (i+1) & t->mask) {
+        cell& c = t->cells[i];
+        K k = c.key.load(std::memory_order_acquire);
+
+        while (is_empty(k)) {
+            if (fwd || (!a_migrating && t->next.load(std::memory_order_acquire))) {
+                // Freeze the end of the probe sequence so that nobody can
+                // insert our key here after we've moved on to the next table
+                if (c.key.compare_exchange_strong(k, m_cfg.m_moved_key))
+                    return result::FORWARD;
+                continue;
+            }
+            if (!a_migrating && t->used.read_fast() >= int64_t(t->max_used))
+                return result::FULL;
+            if (c.key.compare_exchange_strong(k, m_cfg.m_locked_key,
+                                              std::memory_order_acq_rel)) {
+                c.copy  = a_key;
+                c.value = a_value;
+                c.key.store(a_key, std::memory_order_release);
+                ++t->used;
+                return result::INSERTED;
+            }
+        }
+
+        if (is_locked(k))
+            k = wait_cell(c, &growable_atomic_hash_map::is_locked);
+        if (is_eq(k, a_key))
+            return result::FOUND;
+        if (is_moving(k)) {
+            k = wait_cell(c, &growable_atomic_hash_map::is_moving);
+            fwd = true;
+        } else if (is_moved(k))
+            fwd = true;
+    }
+    return t->next.load(std::memory_order_acquire) ? result::FORWARD : result::FULL;
+}
+
+template <class K, class V, class H, class E, class A>
+bool growable_atomic_hash_map<K,V,H,E,A>::
+insert(const K& a_key, const V& a_value) {
+    assert(is_live(a_key));
+    bool   finished = false;
+    bool   res;
+    size_t n;
+    {
+        auto g = m_tables.read();
+        while (true) {
+            const table* cur = current();
+            if (cur->next.load(std::memory_order_acquire))
+                finished |= help_migrate(cur, 1, n);
+
+            const table* t = cur;
+            result       r;
+            while ((r = try_insert(t, a_key, a_value, false)) == result::FORWARD)
+                t = t->next.load(std::memory_order_acquire);
+
+            if (r != result::FULL) {
+                res = r == result::INSERTED;
+                break;
+            }
+            if (t == cur)
+                start_resize(t);
+            else
+                // The migration target got full before the migration has
+                // completed (only the current table may be resized)
+                while (current() == cur) {
+                    finished |= help_migrate(cur, size_t(-1), n);
+                    if (!n)
+                        std::this_thread::yield();
+                }
+        }
+    }
+    if (res)
+        ++m_size;
+    if (finished)
+        m_tables.reclaim();
+    return res;
+}
+
+template <class K, class V, class H, class E, class A>
+typename growable_atomic_hash_map<K,V,H,E,A>::result
+growable_atomic_hash_map<K,V,H,E,A>::
+try_erase(const table* t, K a_key) {
+    bool fwd = false;
+    for (size_t i = home(t, a_key), n = 0; n < t->capacity; ++n, i = (i+1) & t->mask) {
+        cell& c = t->cells[i];
+        K k = c.key.load(std::memory_order_acquire);
+        if (is_eq(k, a_key)) {
+            if (c.key.compare_exchange_strong(k, m_cfg.m_erased_key))
+                return result::FOUND;
+            // Lost to another erase, or the migration of this cell
+            if (!is_moving(k) && !is_moved(k))
+                return result::ABSENT;
+        }
+        if (is_empty(k))
+            return fwd ? result::FORWARD : result::ABSENT;
+        if (is_moving(k)) {
+            wait_cell(c, &growable_atomic_hash_map::is_moving);
+            fwd = true;
+        } else if (is_moved(k))
+            fwd = true;
+    }
+    return fwd || t->next.load(std::memory_order_acquire) ? result::FORWARD : result::ABSENT;
+}
+
+template <class K, class V, class H, class E, class A>
+size_t growable_atomic_hash_map<K,V,H,E,A>::
+erase(const K& a_key) {
+    assert(is_live(a_key));
+    bool   finished = false;
+    size_t res      = 0;
+    {
+        auto g = m_tables.read();
+        for (const table* t = g.get(); t; t = t->next.load(std::memory_order_acquire)) {
+            if (t->next.load(std::memory_order_acquire)) {
+                size_t n;
+                finished |= help_migrate(t, 1, n);
+            }
+            auto r = try_erase(t, a_key);
+            if (r == result::FORWARD)
+                continue;
+            res = r == result::FOUND;
+            break;
+        }
+    }
+    if (res)
+        --m_size;
+    if (finished)
+        m_tables.reclaim();
+    return res;
+}
+
+template <class K, class V, class H, class E, class A>
+void growable_atomic_hash_map<K,V,H,E,A>::
+start_resize(const table* t, bool a_grow) {
+    if (t->next.load(std::memory_order_acquire))
+        return;
+    // Double the table if at least half of the claimed cells are live (or
+    // if a migration target overflowed), otherwise just drop the tombstones
+    // (shrinking if the live keys fit into a smaller table at half of the
+    // max load factor)
+    size_t live = size();
+    size_t cap  = t->capacity;
+    if (a_grow || live >= t->max_used / 2)
+        cap *= 2;
+    else
+        while (cap / 2 >= m_min_capacity &&
+               double(live) <= double(cap / 2) * m_cfg.m_max_load_factor / 2)
+            cap /= 2;
+    auto nt  = new table(cap, m_cfg, m_alloc);
+    table* expected = nullptr;
+    if (!t->next.compare_exchange_strong(expected, nt, std::memory_order_acq_rel)) {
+        delete nt;
+        return;
+    }
+    if (m_cfg.m_background) {
+        { std::lock_guard<std::mutex> g(m_bg_mutex); }
+        m_bg_cond.notify_one();
+    }
+}
+
+template <class K, class V, class H, class E, class A>
+void growable_atomic_hash_map<K,V,H,E,A>::
+migrate_chunk(const table* t, size_t a_chunk) {
+    table* nt  = t->next.load(std::memory_order_acquire);
+    size_t end = std::min(t->capacity, (a_chunk+1) * m_cfg.m_chunk_size);
+
+    for (size_t i = a_chunk * m_cfg.m_chunk_size; i < end; ++i) {
+        cell& c = t->cells[i];
+        K k = c.key.load(std::memory_order_acquire);
+        while (true) {
+            if (is_moved(k))
+                break;
+            if (is_locked(k)) {
+                k = wait_cell(c, &growable_atomic_hash_map::is_locked);
+                continue;
+            }
+            if (is_empty(k) || is_erased(k)) {
+                // Tombstones are not copied
+                if (c.key.compare_exchange_weak(k, m_cfg.m_moved_key))
+                    break;
+                continue;
+            }
+            assert(!is_moving(k));  // Chunks are migrated by one thread
+            if (!c.key.compare_exchange_weak(k, m_cfg.m_moving_key,
+                                             std::memory_order_acq_rel))
+                continue;
+            // The key can't be in the next table yet: inserts that see it
+            // live here don't forward, and those that see MOVING wait for us.
+            // If the target is full (concurrent inserts filled it), it gets
+            // its own larger target, which the key is forwarded to
+            result r;
+            for (table* dst = nt; (r = try_insert(dst, k, c.value, true)) != result::INSERTED;) {
+                if (r == result::FULL)
+                    start_resize(dst, true);
+                else if (r == result::FORWARD)
+                    dst = dst->next.load(std::memory_order_acquire);
+                else {
+                    assert(r != result::FOUND);
+                    break;
+                }
+            }
+            c.key.store(m_cfg.m_moved_key, std::memory_order_release);
+            break;
+        }
+    }
+}
+
+template <class K, class V, class H, class E, class A>
+bool growable_atomic_hash_map<K,V,H,E,A>::
+help_migrate(const table* t, size_t a_max_chunks, size_t& a_moved) {
+    a_moved = 0;
+    while (a_moved < a_max_chunks) {
+        size_t chunk = t->claimed.fetch_add(1, std::memory_order_relaxed);
+        if (chunk >= t->chunks)
+            return false;
+        migrate_chunk(t, chunk);
+        ++a_moved;
+        if (t->done.fetch_add(1, std::memory_order_acq_rel) + 1 == t->chunks) {
+            // Last chunk: make the next table current, and retire this one
+            m_tables.publish(t->next.load(std::memory_order_acquire));
+            m_resizes.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+template <class K, class V, class H, class E, class A>
+size_t growable_atomic_hash_map<K,V,H,E,A>::
+migrate(size_t a_max_chunks) {
+    size_t n = 0;
+    bool   finished;
+    {
+        auto g = m_tables.read();
+        if (!g->next.load(std::memory_order_acquire))
+            return 0;
+        finished = help_migrate(g.get(), a_max_chunks, n);
+    }
+    if (finished)
+        m_tables.reclaim();
+    return n;
+}
+
+template <class K, class V, class H, class E, class A>
+template <class F>
+void growable_atomic_hash_map<K,V,H,E,A>::
+for_each(F&& a_fun) const {
+    auto self = const_cast<growable_atomic_hash_map*>(this);
+    // Chunks claimed by other threads may still be in flight
+    while (migrating()) {
+        if (!self->migrate())
+            std::this_thread::yield();
+    }
+    auto g = m_tables.read();
+    const table* t = g.get();
+    for (size_t i=0; i < t->capacity; ++i) {
+        K k = t->cells[i].key.load(std::memory_order_acquire);
+        if (is_live(k))
+            a_fun(k, t->cells[i].value);
+    }
+}
+
+template <class K, class V, class H, class E, class A>
+typename growable_atomic_hash_map<K,V,H,E,A>::probe_stats
+growable_atomic_hash_map<K,V,H,E,A>::
+stats() const {
+    probe_stats res{0, 0, 0, 0.0, 0};
+    auto g = m_tables.read();
+    const table* t = g.get();
+    size_t total = 0;
+    res.capacity = t->capacity;
+    for (size_t i=0; i < t->capacity; ++i) {
+        K k = t->cells[i].key.load(std::memory_order_acquire);
+        if (is_erased(k))
+            ++res.tombstones;
+        if (!is_live(k))
+            continue;
+        size_t d = (i - home(t, k)) & t->mask;
+        total   += d;
+        res.max  = std::max(res.max, d);
+        ++res.size;
+    }
+    res.avg = res.size ? double(total) / res.size : 0.0;
+    return res;
+}
+
+} // namespace utxx
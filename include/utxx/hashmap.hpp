@@ -54,13 +54,23 @@ namespace detail {
     #endif
 
     /// Hash map class
-    template <typename K, typename V, typename Hash = src::hash<K> >
-    struct basic_hash_map : public src::unordered_map<K, V, Hash>
+    /// For latency-sensitive lookups consider utxx::flat_hash_map
+    /// (utxx/container/flat_hash_map.hpp) that has the same interface.
+    template <typename K, typename V, typename Hash = src::hash<K>,
+              typename Eq    = std::equal_to<K>,
+              typename Alloc = std::allocator<std::pair<const K, V> > >
+    struct basic_hash_map : public src::unordered_map<K, V, Hash, Eq, Alloc>
     {
+        typedef src::unordered_map<K, V, Hash, Eq, Alloc> base;
+
         basic_hash_map() {}
-        basic_hash_map(size_t n): src::unordered_map<K,V,Hash>(n)
+        basic_hash_map(size_t n): base(n)
+        {}
+        basic_hash_map(size_t n, const Hash& h): base(n, h)
+        {}
+        explicit basic_hash_map(const Alloc& a): base(a)
         {}
-        basic_hash_map(size_t n, const Hash& h): src::unordered_map<K,V,Hash>(n, h)
+        basic_hash_map(size_t n, const Alloc& a): base(n, Hash(), Eq(), a)
         {}
     };
 
@@ -115,7 +125,7 @@ namespace detail {
     //-----------------------------------------------------------------------------
     // MurmurHash2, 64-bit and 32-bit versions, by Austin Appleby (MIT license)
     //-----------------------------------------------------------------------------
-    uint64_t murmur_hash64(const void* key, int len, unsigned int seed)
+    inline uint64_t murmur_hash64(const void* key, int len, unsigned int seed)
     {
         const uint64_t m = 0xc6a4a7935bd1e995;
         const int r = 47;
@@ -159,7 +169,7 @@ namespace detail {
     } 
 
     // 64-bit hash for 32-bit platforms
-    uint32_t murmur_hash32(const void* key, int len, unsigned int seed)
+    inline uint32_t murmur_hash32(const void* key, int len, unsigned int seed)
     {
         // 'm' and 'r' are mixing constants generated offline.
         // They're not really 'magic', they just happen to work well.
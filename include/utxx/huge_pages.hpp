@@ -0,0 +1,108 @@
+//----------------------------------------------------------------------------
+/// \file   huge_pages.hpp
+/// \author Serge Aleynikov
+//----------------------------------------------------------------------------
+/// \brief Helpers for huge page backing and pre-faulting of memory mappings.
+//----------------------------------------------------------------------------
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#pragma once
+
+#include <sys/mman.h>
+#include <sys/statfs.h>
+#include <sys/vfs.h>
+#include <linux/magic.h>
+#include <unistd.h>
+#include <cstddef>
+#include <cstdint>
+
+namespace utxx   {
+namespace memory {
+
+/// Huge page backing of a memory mapping
+enum class huge_pages {
+    NONE,           ///< Regular pages
+    TRANSPARENT,    ///< Regular pages advised with MADV_HUGEPAGE
+    EXPLICIT        ///< Explicit huge pages (MAP_HUGETLB or a hugetlbfs file),
+                    ///< falling back to TRANSPARENT when unavailable
+};
+
+/// Huge page size of the hugetlbfs file system holding the open file
+/// \a a_fd or 0 if the file is not on hugetlbfs.
+inline size_t hugetlbfs_page_size(int a_fd) {
+    struct statfs st;
+    return ::fstatfs(a_fd, &st) == 0 && st.f_type == HUGETLBFS_MAGIC
+         ? size_t(st.f_bsize) : 0;
+}
+
+/// Huge page size of the hugetlbfs file system holding \a a_path (a file
+/// or a directory) or 0 if the path is not on hugetlbfs.
+inline size_t hugetlbfs_page_size(const char* a_path) {
+    struct statfs st;
+    return ::statfs(a_path, &st) == 0 && st.f_type == HUGETLBFS_MAGIC
+         ? size_t(st.f_bsize) : 0;
+}
+
+/// Round \a a_size up to a multiple of \a a_page (a power of 2)
+inline size_t page_round_up(size_t a_size, size_t a_page) {
+    return (a_size + a_page - 1) & ~(a_page - 1);
+}
+
+/// Advise the kernel to back the mapping with transparent huge pages.
+/// @return TRANSPARENT if the advice was accepted, NONE otherwise
+inline huge_pages advise_huge_pages(void* a_addr, size_t a_len, huge_pages a_mode) {
+    if (a_mode == huge_pages::NONE)
+        return huge_pages::NONE;
+    // The address must be aligned at a (regular) page boundary
+    uintptr_t pg  = ::sysconf(_SC_PAGESIZE);
+    uintptr_t beg = (uintptr_t(a_addr) + pg-1) & ~(pg-1);
+    uintptr_t end = uintptr_t(a_addr) + a_len;
+    return beg < end && ::madvise((void*)beg, end - beg, MADV_HUGEPAGE) == 0
+         ? huge_pages::TRANSPARENT : huge_pages::NONE;
+}
+
+/// Fault in all pages of a mapping, so that later accesses don't take page
+/// faults. Use this when MAP_POPULATE was not given to mmap(2).
+/// @param a_write if true, the pages are faulted in for writing, which also
+///                breaks copy-on-write sharing of private mappings
+inline void prefault(void* a_addr, size_t a_len, bool a_write = true) {
+    #ifdef MADV_POPULATE_WRITE
+    if (::madvise(a_addr, a_len, a_write ? MADV_POPULATE_WRITE
+                                         : MADV_POPULATE_READ) == 0)
+        return;
+    #endif
+    // Older kernels: touch every page. The write is an atomic no-op, so
+    // that concurrent updates of a shared mapping are not lost
+    size_t pg = ::sysconf(_SC_PAGESIZE);
+    char*  p  = static_cast<char*>(a_addr);
+    for (size_t i = 0; i < a_len; i += pg) {
+        if (a_write) __atomic_fetch_add(p+i, 0, __ATOMIC_RELAXED);
+        else         (void)*static_cast<volatile char*>(p+i);
+    }
+}
+
+} // namespace memory
+} // namespace utxx
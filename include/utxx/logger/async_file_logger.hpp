@@ -32,13 +32,17 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 */
 #pragma once
 
+#include <utxx/scope_exit.hpp>
 #include <utxx/synch.hpp>
+#include <utxx/warmup.hpp>
+#include <algorithm>
 #include <iostream>
 #include <functional>
 #include <atomic>
 #include <thread>
 #include <memory>
 #include <string>
+#include <vector>
 #include <stdio.h>
 #include <stdarg.h>
 #include <unistd.h>
@@ -234,6 +238,17 @@ public:
     /// Deallocate an object previously allocated by call to allocate().
     void  deallocate(log_msg_type* a_msg);
 
+    /// Warm up the message allocator before logging starts.
+    /// \a a_count messages of \a a_msg_size bytes are allocated, their memory
+    /// is pre-faulted (and optionally locked / NUMA-bound), and the messages
+    /// are returned to the allocator to be reused by the first writes.
+    /// Note that a general purpose heap may give freed memory back to the
+    /// OS (see mallopt(M_TRIM_THRESHOLD)), so this is most effective with a
+    /// caching allocator in the traits.
+    memory::warmup_report
+    prefault(const memory::warmup_options& a_opts = memory::warmup_options(),
+             size_t a_count = 4096, size_t a_msg_size = traits::write_buf_sz);
+
     /// Write a message to the logger by making of copy of
     int   write_copy(const void* a_data, size_t a_sz);
     // Enqueues msg to internal queue
@@ -486,6 +501,46 @@ deallocate(log_msg_type* a_msg)
     m_allocator.deallocate(reinterpret_cast<char*>(a_msg), size);
 }
 
+//-----------------------------------------------------------------------------
+template<typename traits>
+memory::warmup_report basic_async_logger<traits>::
+prefault(const memory::warmup_options& a_opts, size_t a_count, size_t a_msg_size)
+{
+    memory::warmup_report      r;
+    std::vector<log_msg_type*> msgs(a_count, nullptr);
+    // Messages allocated before an allocation failure are freed, too
+    UTXX_SCOPE_EXIT([&]() {
+        for (auto m : msgs)
+            if (m) deallocate(m);
+    });
+    for (auto& m : msgs)
+        m = allocate(a_msg_size);
+
+    // Warm up the messages coalesced into ranges. Messages less than a page
+    // apart are merged, since the memory in between is mapped
+    std::vector<const char*> sorted(a_count);
+    for (size_t i = 0; i < a_count; ++i)
+        sorted[i] = reinterpret_cast<const char*>(msgs[i]);
+    std::sort(sorted.begin(), sorted.end());
+    const size_t pg  = ::sysconf(_SC_PAGESIZE);
+    const size_t sz  = sizeof(log_msg_type) + a_msg_size;
+    const char*  beg = nullptr;
+    const char*  end = nullptr;
+    for (auto p : sorted) {
+        if (beg && p < end + pg) {
+            end = std::max(end, p + sz);
+            continue;
+        }
+        if (beg)
+            r += memory::warm_up(beg, end - beg, a_opts);
+        beg = p;
+        end = p + sz;
+    }
+    if (beg)
+        r += memory::warm_up(beg, end - beg, a_opts);
+    return r;
+}
+
 //-----------------------------------------------------------------------------
 template<typename traits>
 inline int basic_async_logger<traits>::
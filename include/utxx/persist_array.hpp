@@ -1,7 +1,8 @@
 //----------------------------------------------------------------------------
 /// \file  basic_persist_array.hpp
 //----------------------------------------------------------------------------
-/// \brief Implementation of persistent array storage class.
+/// \brief Implementation of persistent array storage class and of its
+/// variant with a persistent hash index of records by key.
 //----------------------------------------------------------------------------
 // Copyright (c) 2010 Omnibius, LLC
 // Author:  Serge Aleynikov <saleyn@gmail.com>
@@ -49,6 +50,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <utxx/meta.hpp>
 #include <utxx/scope_exit.hpp>
 #include <utxx/error.hpp>
+#include <utxx/huge_pages.hpp>
+#include <utxx/warmup.hpp>
 #include <stdexcept>
 #include <fstream>
 #include <thread>
@@ -59,6 +62,8 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <cstddef>
 #include <cstdlib>
 #include <atomic>
+#include <tuple>
+#include <fcntl.h>
 #include <unistd.h>
 
 namespace utxx {
@@ -105,6 +110,8 @@ namespace utxx {
         bip::mapped_region  m_region;
         // Name of the memory-mapped file or shm segment
         std::string         m_storage_name;
+        // Huge page backing of the mapping
+        memory::huge_pages  m_huge_pages;
 
         // Locks that guard access to internal record structures.
         header* m_header;
@@ -123,7 +130,8 @@ namespace utxx {
         using scoped_lock = std::lock_guard<Lock>;
 
         persist_array()
-            : m_header(NULL), m_begin(NULL), m_end(NULL)
+            : m_huge_pages(memory::huge_pages::NONE)
+            , m_header(NULL), m_begin(NULL), m_end(NULL)
         {}
 
 #if __cplusplus >= 201103L
@@ -133,6 +141,7 @@ namespace utxx {
 
         void operator=(persist_array&& a_rhs) {
             m_storage_name = std::move(a_rhs.m_storage_name);
+            m_huge_pages   = a_rhs.m_huge_pages;
             m_header       = a_rhs.m_header;
             m_begin        = a_rhs.m_begin;
             m_end          = a_rhs.m_end;
@@ -156,10 +165,18 @@ namespace utxx {
         }
 
         /// Initialize the storage
+        /// @param a_map_options extra mmap(2) flags (e.g. MAP_POPULATE to
+        ///                      pre-fault the mapping)
+        /// @param a_huge_pages  huge page backing of the mapping. A file
+        ///                      located on hugetlbfs is always backed by
+        ///                      explicit huge pages. Otherwise a value other
+        ///                      than NONE advises transparent huge pages.
         /// @return true if the storage file didn't exist and was created
         bool init(const char* a_filename, size_t a_max_recs, bool a_read_only = false,
             int a_mode = default_file_mode(), void const* a_map_address = nullptr,
-            int a_map_options = 0) throw (io_error, utxx::runtime_error);
+            int a_map_options = 0,
+            memory::huge_pages a_huge_pages = memory::huge_pages::NONE)
+            throw (io_error, utxx::runtime_error);
 
         /// Initialize the storage in shared memory.
         /// @param a_segment  the shared memory segment
@@ -172,6 +189,21 @@ namespace utxx {
                   const char* a_name, persist_attach_type a_flag, size_t a_max_recs)
                   throw (utxx::runtime_error);
 
+        /// Huge page backing of the mapping (TRANSPARENT means the advice
+        /// was accepted by the kernel)
+        memory::huge_pages huge_pages() const { return m_huge_pages; }
+
+        /// Pre-fault (and optionally lock / NUMA-bind) the header and all
+        /// records.  A file mapped read-only is faulted in for reading.
+        memory::warmup_report
+        prefault(const memory::warmup_options& a_opts = memory::warmup_options()) {
+            memory::warmup_options opts(a_opts);
+            if (m_region.get_address() && m_region.get_mode() == bip::read_only)
+                opts.write = false;
+            return memory::warm_up(m_header, reinterpret_cast<char*>(m_end)
+                                           - reinterpret_cast<char*>(m_header), opts);
+        }
+
         size_t count()    const { return m_header->rec_count.load(std::memory_order_relaxed); }
         size_t capacity() const { return m_header->max_recs; }
 
@@ -315,7 +347,8 @@ namespace utxx {
 
     template <typename T, size_t NLocks, typename Lock, typename Ext>
     bool persist_array<T,NLocks,Lock,Ext>::
-    init(const char* a_filename, size_t a_max_recs, bool a_read_only, int a_mode, void const* a_map_address, int a_map_options)
+    init(const char* a_filename, size_t a_max_recs, bool a_read_only, int a_mode,
+         void const* a_map_address, int a_map_options, memory::huge_pages a_huge_pages)
         throw (io_error, utxx::runtime_error)
     {
         auto sz = total_size(a_max_recs);
@@ -330,6 +363,23 @@ namespace utxx {
                     l_name.parent_path(), ": ", e.what());
             }
 
+            // Files on hugetlbfs must be sized in whole huge pages and can't
+            // be written with write(2), so their header is written through
+            // a mapping
+            auto   l_dir  = l_name.parent_path().empty()
+                          ? boost::filesystem::path(".") : l_name.parent_path();
+            size_t l_huge = memory::hugetlbfs_page_size(l_dir.c_str());
+            if (l_huge)
+                sz = memory::page_round_up(sz, l_huge);
+
+            auto write_huge_header = [&](int a_fd, const header& a_hdr) {
+                void* p = ::mmap(NULL, l_huge, PROT_READ | PROT_WRITE, MAP_SHARED, a_fd, 0);
+                if (p == MAP_FAILED)
+                    throw io_error(errno, "Error mapping file ", a_filename);
+                memcpy(p, static_cast<const void*>(&a_hdr), sizeof(header));
+                ::munmap(p, l_huge);
+            };
+
             {
                 std::filebuf f;
                 f.open(a_filename, std::ios_base::in | std::ios_base::out
@@ -359,10 +409,21 @@ namespace utxx {
                     // Increase the file size if instructed to do so.
                     if (h.max_recs < a_max_recs) {
                         h.max_recs = a_max_recs;
-                        f.pubseekoff(0, std::ios_base::beg);
-                        f.sputn(reinterpret_cast<char*>(&h), sizeof(header));
-                        f.pubseekoff(sz-1, std::ios_base::beg);
-                        f.sputc(0);
+                        if (l_huge) {
+                            int l_fd = ::open(a_filename, O_RDWR);
+                            if (l_fd < 0)
+                                throw io_error(errno, "Error opening file ", a_filename);
+                            UTXX_SCOPE_EXIT([=]{ ::close(l_fd); });
+                            if (::ftruncate(l_fd, sz) < 0)
+                                throw io_error(errno, "Error setting file ",
+                                    a_filename, " to size ", sz);
+                            write_huge_header(l_fd, h);
+                        } else {
+                            f.pubseekoff(0, std::ios_base::beg);
+                            f.sputn(reinterpret_cast<char*>(&h), sizeof(header));
+                            f.pubseekoff(sz-1, std::ios_base::beg);
+                            f.sputc(0);
+                        }
                     }
                 }
             }
@@ -384,13 +445,16 @@ namespace utxx {
                 h.rec_size    = sizeof(T);
                 h.recs_offset = offsetof(header, records);
 
-                if (::write(l_fd, &h, sizeof(h)) < 0)
+                if (!l_huge && ::write(l_fd, &h, sizeof(h)) < 0)
                     throw io_error(errno, "Error writing to file ", a_filename);
 
                 if (::ftruncate(l_fd, sz) < 0)
                     throw io_error(errno, "Error setting file ",
                         a_filename, " to size ", sz);
 
+                if (l_huge)
+                    write_huge_header(l_fd, h);
+
                 ::fsync(l_fd);
             }
 
@@ -409,6 +473,8 @@ namespace utxx {
             m_file  .swap(shmf);
             m_region.swap(region);
             m_storage_name = a_filename;
+            m_huge_pages   = l_huge ? memory::huge_pages::EXPLICIT
+                           : memory::advise_huge_pages(addr, sz, a_huge_pages);
 
             //if (!exists && !a_read_only)
             //    memset(static_cast<char*>(addr) + sizeof(header), 0, size - sizeof(header));
@@ -538,6 +604,313 @@ namespace utxx {
         }
         return created;
     }
+
+    //-------------------------------------------------------------------------
+    /// Persistent array with a persistent open-addressing hash index.
+    ///
+    /// The index lives in a sidecar file "<filename>.idx" next to the records
+    /// and maps a key extracted from a record by \a KeyOf to the record's id,
+    /// so that after a restart records can be looked up by key without
+    /// scanning the array.  A slot of the index is a single 64-bit word
+    /// holding 16 bits of the key's hash and the record id, and keys are
+    /// compared against the records themselves.
+    ///
+    /// Records are added with insert() under the index lock: the record is
+    /// allocated and written, then its index slot is published, and finally
+    /// the index's commit mark is advanced.  The commit mark is the point at
+    /// which an insert survives a process crash: on restart a record
+    /// allocated past it is either committed (if its slot was published
+    /// before the crash) or rolled back, which costs one lookup rather than
+    /// a scan.  The index is rebuilt from the records (a full scan) only when
+    /// the sidecar file is missing or invalid, when the array's capacity
+    /// grows beyond the index size, or when the array holds fewer records
+    /// than the commit mark.
+    ///
+    /// Neither insert() nor the recovery orders writes to disk, so the above
+    /// only holds for process crashes, where the mapped pages stay in the
+    /// page cache.  After an OS crash recovery is best effort: records found
+    /// on either side of the commit mark are reindexed, but a commit mark
+    /// that reached the disk without its index slot is not detected.  Call
+    /// flush(), flush_header() and flush_index() (in this order) at the
+    /// points where inserts must be durable.
+    ///
+    /// Lookups are lock-free and may run concurrently with insert().  The
+    /// base class' add(), get_next() and allocate_rec() bypass the index and
+    /// are therefore not accessible.
+    ///
+    /// @tparam KeyOf functor returning the key of a record: Key (const T&)
+    //-------------------------------------------------------------------------
+    template <
+        typename    T,
+        typename    Key,
+        typename    KeyOf,
+        typename    Hash            = std::hash<Key>,
+        std::size_t NLocks          = 32,
+        typename    Lock            = std::mutex,
+        typename    ExtraHeaderData = detail::empty_data>
+    class persist_indexed_array
+        : public persist_array<T, NLocks, Lock, ExtraHeaderData>
+    {
+        typedef persist_array<T, NLocks, Lock, ExtraHeaderData> base;
+
+        struct index_header {
+            static const uint32_t s_version = 0xa1b2c3d5;
+            uint32_t              version;
+            uint32_t              rec_size;
+            size_t                capacity;     ///< Number of slots (power of 2)
+            std::atomic<size_t>   committed;    ///< Records [0, committed) are indexed
+            Lock                  lock;
+            std::atomic<uint64_t> slots[0];
+        };
+
+        static const uint64_t s_id_mask = (1ul << 48) - 1;
+
+        bip::file_mapping   m_idx_file;
+        bip::mapped_region  m_idx_region;
+        index_header*       m_index;
+
+        static uint64_t hash(const Key& a_key) {
+            // Murmur3 finalizer, since std::hash of integers is the identity
+            uint64_t h = Hash()(a_key);
+            h ^= h >> 33; h *= 0xff51afd7ed558ccdul;
+            h ^= h >> 33; h *= 0xc4ceb9fe1a85ec53ul;
+            return h ^ (h >> 33);
+        }
+
+        static uint64_t tag(uint64_t a_hash) { return a_hash & ~s_id_mask; }
+
+        static size_t index_capacity(size_t a_max_recs) {
+            size_t n = 64;
+            while (n < 2*a_max_recs) n <<= 1;
+            return n;
+        }
+
+        static size_t index_size(size_t a_capacity) {
+            return sizeof(index_header) + a_capacity * sizeof(uint64_t);
+        }
+
+        // Find the id of the record with a_key or the slot where it would
+        // be inserted
+        std::pair<size_t, std::atomic<uint64_t>*> lookup(const Key& a_key) const {
+            uint64_t h    = hash(a_key);
+            size_t   mask = m_index->capacity - 1;
+            for (size_t i = h & mask;; i = (i+1) & mask) {
+                auto&    slot = m_index->slots[i];
+                uint64_t v    = slot.load(std::memory_order_acquire);
+                if (!v)
+                    return std::make_pair(s_npos, &slot);
+                size_t id = (v & s_id_mask) - 1;
+                if (tag(v) == tag(h) && KeyOf()(*base::get(id)) == a_key)
+                    return std::make_pair(id, &slot);
+            }
+        }
+
+        void publish(std::atomic<uint64_t>* a_slot, const Key& a_key, size_t a_id) {
+            a_slot->store(tag(hash(a_key)) | (a_id + 1), std::memory_order_release);
+        }
+
+        void open_index(const std::string& a_name, bool a_read_only, int a_mode);
+        void recover();
+
+        using base::add;
+        using base::get_next;
+        using base::allocate_rec;
+    public:
+        static const size_t s_npos = size_t(-1);
+
+        persist_indexed_array() : m_index(NULL) {}
+
+        /// Initialize the storage and its index.
+        /// @return true if the storage file didn't exist and was created
+        bool init(const char* a_filename, size_t a_max_recs, bool a_read_only = false,
+            int a_mode = base::default_file_mode(), void const* a_map_address = nullptr,
+            int a_map_options = 0,
+            memory::huge_pages a_huge_pages = memory::huge_pages::NONE)
+        {
+            if (a_max_recs > s_id_mask)
+                throw badarg_error("persist_indexed_array: too many records ", a_max_recs);
+            bool created = base::init(a_filename, a_max_recs, a_read_only, a_mode,
+                                      a_map_address, a_map_options, a_huge_pages);
+            open_index(std::string(a_filename) + ".idx", a_read_only, a_mode);
+            return created;
+        }
+
+        /// Number of slots in the index
+        size_t index_capacity() const { return m_index->capacity; }
+
+        /// Pre-fault (and optionally lock / NUMA-bind) the records and the index
+        memory::warmup_report
+        prefault(const memory::warmup_options& a_opts = memory::warmup_options()) {
+            memory::warmup_options opts(a_opts);
+            memory::warmup_report  r = base::prefault(opts);
+            if (m_idx_region.get_mode() == bip::read_only)
+                opts.write = false;
+            r += memory::warm_up(m_idx_region.get_address(), m_idx_region.get_size(), opts);
+            return r;
+        }
+
+        /// Id of the record with the \a a_key or s_npos if not found
+        size_t find_id(const Key& a_key) const { return lookup(a_key).first; }
+
+        const T* find(const Key& a_key) const {
+            size_t id = find_id(a_key);
+            return id == s_npos ? NULL : base::get(id);
+        }
+
+        T* find(const Key& a_key) {
+            size_t id = find_id(a_key);
+            return id == s_npos ? NULL : base::get(id);
+        }
+
+        /// Add a record with the \a a_key initialized by calling
+        /// \a a_rec_init(size_t id, T* rec), which must set the record's
+        /// key to \a a_key.  If the key is already present, the existing
+        /// record is returned.
+        /// @return the record, its id, and true if it was inserted
+        template <typename InitFun>
+        std::tuple<T*, size_t, bool> insert(const Key& a_key, const InitFun& a_rec_init) {
+            typename base::scoped_lock guard(m_index->lock);
+            auto res = lookup(a_key);
+            if (res.first != s_npos)
+                return std::make_tuple(base::get(res.first), res.first, false);
+
+            size_t n   = base::allocate_rec();
+            T*     rec = base::get(n);
+            a_rec_init(n, rec);
+            BOOST_ASSERT(KeyOf()(*rec) == a_key);
+            publish(res.second, a_key, n);
+            m_index->committed.store(n+1, std::memory_order_release);
+            return std::make_tuple(rec, n, true);
+        }
+
+        /// Add a copy of \a a_rec unless a record with its key exists.
+        /// @return the id of the record with this key, and true if inserted
+        std::pair<size_t, bool> insert(const T& a_rec) {
+            auto res = insert(KeyOf()(a_rec), [&](size_t, T* p) { *p = a_rec; });
+            return std::make_pair(std::get<1>(res), std::get<2>(res));
+        }
+
+        /// Rebuild the index by scanning all records
+        void rebuild_index() {
+            typename base::scoped_lock guard(m_index->lock);
+            for (size_t i = 0; i < m_index->capacity; ++i)
+                m_index->slots[i].store(0, std::memory_order_relaxed);
+            size_t n = base::count();
+            for (size_t i = 0; i < n; ++i) {
+                Key  k   = KeyOf()(*base::get(i));
+                auto res = lookup(k);
+                if (res.first == s_npos)
+                    publish(res.second, k, i);
+            }
+            m_index->committed.store(n, std::memory_order_release);
+        }
+
+        /// Flush the index to disk
+        bool flush_index() { return m_idx_region.flush(); }
+
+        /// Remove memory mapped files of records and of the index from disk
+        void remove() {
+            base::remove();
+            m_idx_file.remove(m_idx_file.get_name());
+        }
+    };
+
+    template <typename T, typename Key, typename KeyOf, typename Hash,
+              size_t NLocks, typename Lock, typename Ext>
+    const size_t persist_indexed_array<T,Key,KeyOf,Hash,NLocks,Lock,Ext>::s_npos;
+
+    template <typename T, typename Key, typename KeyOf, typename Hash,
+              size_t NLocks, typename Lock, typename Ext>
+    void persist_indexed_array<T,Key,KeyOf,Hash,NLocks,Lock,Ext>::
+    open_index(const std::string& a_name, bool a_read_only, int a_mode)
+    {
+        size_t cap  = index_capacity(base::capacity());
+        size_t sz   = index_size(cap);
+        bool   init = false;
+
+        if (!a_read_only) {
+            int fd = ::open(a_name.c_str(), O_RDWR | O_CREAT, a_mode);
+            if (fd < 0)
+                throw io_error(errno, "Error opening file ", a_name);
+            UTXX_SCOPE_EXIT([=]{ ::close(fd); });
+
+            index_header h;
+            ssize_t n = ::pread(fd, &h, sizeof(h), 0);
+            init = n != sizeof(h)
+                || h.version  != index_header::s_version
+                || h.rec_size != sizeof(T)
+                || h.capacity != cap;
+            if (init && ::ftruncate(fd, 0) < 0)
+                throw io_error(errno, "Error truncating file ", a_name);
+            if (::ftruncate(fd, sz) < 0)
+                throw io_error(errno, "Error setting file ", a_name, " to size ", sz);
+        }
+
+        try {
+            auto mode = a_read_only ? bip::read_only : bip::read_write;
+            bip::file_mapping  file  (a_name.c_str(), mode);
+            bip::mapped_region region(file, mode, 0, sz);
+            m_idx_file  .swap(file);
+            m_idx_region.swap(region);
+        } catch (std::exception& e) {
+            throw runtime_error("Cannot map index file ", a_name, ": ", e.what());
+        }
+        m_index = static_cast<index_header*>(m_idx_region.get_address());
+
+        if (a_read_only) {
+            if (m_index->version != index_header::s_version || m_index->capacity != cap)
+                throw runtime_error("Invalid index file ", a_name);
+            return;
+        }
+
+        // A crash might have left the lock in inconsistent state
+        new (&m_index->lock) Lock();
+
+        if (init) {
+            m_index->version  = index_header::s_version;
+            m_index->rec_size = sizeof(T);
+            m_index->capacity = cap;
+            rebuild_index();
+        } else
+            recover();
+    }
+
+    template <typename T, typename Key, typename KeyOf, typename Hash,
+              size_t NLocks, typename Lock, typename Ext>
+    void persist_indexed_array<T,Key,KeyOf,Hash,NLocks,Lock,Ext>::
+    recover()
+    {
+        size_t n   = m_index->committed.load(std::memory_order_acquire);
+        size_t cnt = base::count();
+        if (cnt < n) {
+            // The index refers to records the array doesn't have: the
+            // records are authoritative
+            rebuild_index();
+            return;
+        }
+        if (cnt == n)
+            return;
+        if (cnt == n+1) {
+            // Inserts are serialized, so only record n could have been in
+            // progress. It is committed if its index slot was published.
+            if (find_id(KeyOf()(*base::get(n))) == n)
+                m_index->committed.store(n+1, std::memory_order_release);
+            else
+                this->m_header->rec_count.store(n, std::memory_order_release);
+            return;
+        }
+        // More than one record past the commit mark: the array's header
+        // reached the disk, but the index page holding the commit mark
+        // didn't. These are completed inserts, so index them
+        for (size_t i = n; i < cnt; ++i) {
+            Key  k   = KeyOf()(*base::get(i));
+            auto res = lookup(k);
+            if (res.first == s_npos)
+                publish(res.second, k, i);
+        }
+        m_index->committed.store(cnt, std::memory_order_release);
+    }
+
 } // namespace utxx
 
 #endif // _UTXX_PERSISTENT_ARRAY_HPP_
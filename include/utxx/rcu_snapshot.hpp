@@ -0,0 +1,291 @@
+//----------------------------------------------------------------------------
+/// \file   rcu_snapshot.hpp
+/// \author Serge Aleynikov
+//----------------------------------------------------------------------------
+/// \brief Read-mostly snapshot holder with epoch-based reclamation.
+///
+/// Readers never write to shared cache lines: entering a read section
+/// stores the current global epoch into the reader's own per-thread slot
+/// and loads the published pointer. A writer swaps in a new version, bumps
+/// the global epoch, and frees retired versions once every reader that was
+/// active at the time of the swap has left its read section.
+///
+/// Typical use is reloading reference data (e.g. a variant_tree) that is
+/// read on every message:
+/// @code
+///     rcu_snapshot<variant_tree> cfg(new variant_tree(load()));
+///     // Reader threads
+///     {
+///         auto snap = cfg.read();
+///         int  n    = snap->get<int>("limits.max_orders");
+///     }
+///     // Writer thread
+///     cfg.publish(new variant_tree(load()));
+/// @endcode
+//----------------------------------------------------------------------------
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#pragma once
+
+#include <utxx/config.h>
+#include <utxx/thread_local.hpp>
+#include <utxx/compiler_hints.hpp>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cassert>
+#include <stdint.h>
+
+namespace utxx {
+
+/// Default tag of per-thread reader slots. All rcu_snapshot instances with
+/// the same tag share a lock that writers hold while scanning reader slots.
+struct rcu_snapshot_tag {};
+
+//-----------------------------------------------------------------------------
+/// RCU-style holder of an immutable snapshot of T.
+//-----------------------------------------------------------------------------
+/// Reader side (read(), get()) is wait-free once the calling thread has
+/// registered its slot on the first call. Nested read sections are allowed.
+/// Writer side (publish(), update(), reclaim(), synchronize()) is serialized
+/// with a mutex.
+template <class T, class Tag = rcu_snapshot_tag>
+class rcu_snapshot {
+    // Per-thread reader slot. Padded to a cache line so that the writes
+    // of different readers don't share a line.
+    struct reader {
+        std::atomic<uint64_t> epoch;    // 0 - not in a read section
+        uint32_t              nesting;
+        char                  pad[UTXX_CL_SIZE - sizeof(uint64_t) - sizeof(uint32_t)];
+
+        reader() : epoch(0), nesting(0) {}
+    };
+
+    struct retired {
+        const T* ptr;
+        uint64_t epoch;
+    };
+
+    std::atomic<const T*>       m_current;
+    char                        m_pad0[UTXX_CL_SIZE - sizeof(void*)];
+    std::atomic<uint64_t>       m_epoch;
+    char                        m_pad1[UTXX_CL_SIZE - sizeof(uint64_t)];
+    thr_local_ptr<reader, Tag>  m_readers;
+    std::mutex                  m_write_lock;
+    std::vector<retired>        m_retired;
+
+    reader* local() {
+        reader* r = m_readers.get();
+        if (unlikely(!r)) {
+            r = new reader;
+            m_readers.reset(r);
+        }
+        return r;
+    }
+
+    // Smallest epoch of readers being in a read section
+    uint64_t min_reader_epoch() const {
+        uint64_t res = std::numeric_limits<uint64_t>::max();
+        for (auto& r : m_readers.access_all_threads()) {
+            uint64_t e = r.epoch.load(std::memory_order_acquire);
+            if (e && e < res)
+                res = e;
+        }
+        return res;
+    }
+
+    // Readers that observe an epoch greater than the one returned by
+    // fetch_add() are guaranteed to see a_new, so the old version can be
+    // freed once all reader epochs are past it
+    void swap_in(const T* a_new) {
+        const T* old = m_current.exchange(a_new, std::memory_order_seq_cst);
+        uint64_t e   = m_epoch.fetch_add(1, std::memory_order_seq_cst);
+        if (old)
+            m_retired.push_back(retired{old, e});
+        do_reclaim();
+    }
+
+    size_t do_reclaim() {
+        if (m_retired.empty())
+            return 0;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint64_t min = min_reader_epoch();
+        size_t   n   = 0;
+        for (auto it = m_retired.begin(); it != m_retired.end(); )
+            if (it->epoch < min) {
+                delete it->ptr;
+                it = m_retired.erase(it);
+                ++n;
+            } else
+                ++it;
+        return n;
+    }
+
+public:
+    //-------------------------------------------------------------------------
+    /// RAII read section. The snapshot stays valid while the guard is alive.
+    //-------------------------------------------------------------------------
+    class guard {
+        rcu_snapshot* m_owner;
+        const T*      m_ptr;
+
+        friend class rcu_snapshot;
+        guard(rcu_snapshot* a_owner) : m_owner(a_owner), m_ptr(a_owner->lock()) {}
+    public:
+        guard(guard&& a) : m_owner(a.m_owner), m_ptr(a.m_ptr) { a.m_owner = nullptr; }
+        ~guard() { if (m_owner) m_owner->unlock(); }
+
+        guard(const guard&)            = delete;
+        guard& operator=(const guard&) = delete;
+
+        const T* get()        const { return m_ptr;  }
+        const T* operator->() const { return m_ptr;  }
+        const T& operator*()  const { return *m_ptr; }
+        explicit operator bool() const { return m_ptr != nullptr; }
+    };
+
+    explicit rcu_snapshot(const T* a_init = nullptr)
+        : m_current(a_init), m_epoch(1)
+    {}
+
+    /// The caller must ensure that no thread is in a read section.
+    ~rcu_snapshot() {
+        delete m_current.load(std::memory_order_relaxed);
+        for (auto& r : m_retired)
+            delete r.ptr;
+    }
+
+    rcu_snapshot(const rcu_snapshot&)            = delete;
+    rcu_snapshot& operator=(const rcu_snapshot&) = delete;
+
+    //-------------------------------------------------------------------------
+    // Reader side
+    //-------------------------------------------------------------------------
+
+    /// Enter a read section and return the current snapshot (may be NULL).
+    /// Every call must be paired with unlock() in the same thread.
+    const T* lock() {
+        reader* r = local();
+        if (r->nesting++ == 0) {
+            r->epoch.store(m_epoch.load(std::memory_order_acquire),
+                           std::memory_order_relaxed);
+            // Pairs with the fence in do_reclaim(): either the writer sees
+            // our epoch, or we see the pointer it has swapped in.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+        return m_current.load(std::memory_order_acquire);
+    }
+
+    /// Leave the read section entered by lock().
+    void unlock() {
+        reader* r = m_readers.get();
+        assert(r && r->nesting > 0);
+        if (--r->nesting == 0)
+            r->epoch.store(0, std::memory_order_release);
+    }
+
+    /// Enter a read section for the lifetime of the returned guard.
+    guard read() { return guard(this); }
+
+    /// Call \a a_fun(const T*) inside of a read section.
+    template <class F>
+    auto read(F&& a_fun) -> decltype(a_fun(std::declval<const T*>())) {
+        guard g(this);
+        return a_fun(g.get());
+    }
+
+    /// True if the calling thread is inside of a read section.
+    bool in_read_section() const {
+        reader* r = m_readers.get();
+        return r && r->nesting > 0;
+    }
+
+    //-------------------------------------------------------------------------
+    // Writer side
+    //-------------------------------------------------------------------------
+
+    /// Replace the current snapshot with \a a_new (ownership is transferred),
+    /// and free retired snapshots that are no longer referenced by readers.
+    void publish(const T* a_new) {
+        std::lock_guard<std::mutex> g(m_write_lock);
+        swap_in(a_new);
+    }
+
+    void publish(std::unique_ptr<const T>&& a_new) { publish(a_new.release()); }
+
+    /// Construct a new snapshot in place and publish it.
+    template <class... Args>
+    void emplace(Args&&... args) { publish(new T(std::forward<Args>(args)...)); }
+
+    /// Read-copy-update: copy the current snapshot, apply \a a_fun(T&) to the
+    /// copy, and publish it. Concurrent updates are serialized, so none of
+    /// them is lost.
+    template <class F>
+    void update(F&& a_fun) {
+        std::lock_guard<std::mutex> g(m_write_lock);
+        const T* cur = m_current.load(std::memory_order_relaxed);
+        std::unique_ptr<T> p(cur ? new T(*cur) : new T());
+        a_fun(*p);
+        swap_in(p.release());
+    }
+
+    /// Free retired snapshots that are no longer referenced by readers.
+    /// @return number of freed snapshots
+    size_t reclaim() {
+        std::lock_guard<std::mutex> g(m_write_lock);
+        return do_reclaim();
+    }
+
+    /// Wait until all readers that are currently in a read section leave
+    /// it, and free all retired snapshots. Must not be called from a read
+    /// section.
+    void synchronize() {
+        assert(!in_read_section());
+        uint64_t e = m_epoch.fetch_add(1, std::memory_order_seq_cst);
+        while (true) {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (min_reader_epoch() > e)
+                break;
+            std::this_thread::yield();
+        }
+        reclaim();
+    }
+
+    /// Number of retired snapshots waiting to be freed.
+    size_t retired_count() {
+        std::lock_guard<std::mutex> g(m_write_lock);
+        return m_retired.size();
+    }
+
+    /// Current global epoch (incremented on every publish).
+    uint64_t epoch() const { return m_epoch.load(std::memory_order_relaxed); }
+};
+
+} // namespace utxx
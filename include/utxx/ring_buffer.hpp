@@ -39,6 +39,7 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #include <utxx/math.hpp>
 #include <utxx/error.hpp>
 #include <utxx/compiler_hints.hpp>
+#include <utxx/warmup.hpp>
 #include <cstddef>
 #include <type_traits>
 #include <atomic>
@@ -197,6 +198,14 @@ public:
     /// "Clear":
     void clear() { store_size<Atomic>(0); }
 
+    /// Pre-fault (and optionally lock / NUMA-bind) the memory of the buffer
+    /// including all of its entries
+    memory::warmup_report
+    prefault(const memory::warmup_options& a_opts = memory::warmup_options()) {
+        return memory::warm_up(this, reinterpret_cast<char*>(m_entries + m_capacity)
+                                   - reinterpret_cast<char*>(this), a_opts);
+    }
+
     /// \brief Insert a new entry into the buffer
     /// \return a direct access ptr to the entry stored
     template<class ...Args>
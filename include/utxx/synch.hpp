@@ -342,7 +342,7 @@ public:
             while (m_lock == to_underlying(lock_state::LOCKED));
             long old = to_underlying(lock_state::UNLOCKED);
             if (m_lock.compare_exchange_weak(old, to_underlying(lock_state::LOCKED),
-                    std::memory_order_release, std::memory_order_relaxed))
+                    std::memory_order_acquire, std::memory_order_relaxed))
                 return;
         }
     }
@@ -352,14 +352,14 @@ public:
             return -1;
         long old = to_underlying(lock_state::UNLOCKED);
         if (m_lock.compare_exchange_weak(old, to_underlying(lock_state::LOCKED),
-                    std::memory_order_release, std::memory_order_relaxed))
+                    std::memory_order_acquire, std::memory_order_relaxed))
             return 0;
         else
             return -1;
     }
 
     void unlock() {
-        m_lock.store(to_underlying(lock_state::UNLOCKED), std::memory_order_relaxed);
+        m_lock.store(to_underlying(lock_state::UNLOCKED), std::memory_order_release);
     }
 };
 
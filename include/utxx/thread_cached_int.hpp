@@ -62,6 +62,14 @@ public:
     // increments.
     IntT read_fast() const { return m_target.load(std::memory_order_relaxed); }
 
+    // Reads the increments cached by the calling thread, which are not yet
+    // included in read_fast().
+    IntT read_local() const {
+        auto cache = m_cache.get();
+        return cache && !cache->m_reset.load(std::memory_order_acquire)
+             ? cache->m_val.load(std::memory_order_relaxed) : 0;
+    }
+
     // Reads the current value plus all the cached increments.  Requires grabbing
     // a lock, so this is significantly slower than read_fast().
     IntT read_full() const {
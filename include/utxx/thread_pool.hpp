@@ -0,0 +1,468 @@
+//----------------------------------------------------------------------------
+/// \file   thread_pool.hpp
+/// \author Serge Aleynikov
+//----------------------------------------------------------------------------
+/// \brief Work-stealing thread pool.
+///
+/// Each worker owns a Chase-Lev deque. Tasks spawned by a worker go to the
+/// bottom of its own deque and are executed in LIFO order, idle workers
+/// steal from the top of other workers' deques. Tasks submitted by threads
+/// outside of the pool go to a shared MPSC injection queue, which is drained
+/// by whichever worker swaps it out first. Idle workers park on a futex and are
+/// woken up only when there's new work and somebody is actually sleeping.
+///
+/// Workers are pinned to the CPUs of the process affinity mask, spreading
+/// them over physical cores before using hyper-threaded siblings.
+//----------------------------------------------------------------------------
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#pragma once
+
+#include <utxx/config.h>
+#include <utxx/cpu.hpp>
+#include <utxx/backoff.hpp>
+#include <utxx/waitable_queue.hpp>
+#include <utxx/concurrent_mpsc_queue.hpp>
+#include <utxx/container/chase_lev_deque.hpp>
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace utxx {
+
+//-----------------------------------------------------------------------------
+/// Work-stealing thread pool.
+//-----------------------------------------------------------------------------
+/// Tasks must not throw (an exception escaping a task submitted with
+/// submit() terminates the process); exceptions thrown by the body of
+/// parallel_for() / parallel_reduce() are rethrown in the calling thread.
+/// The destructor executes all tasks that were queued before it was called.
+class work_stealing_pool {
+public:
+    struct task {
+        virtual ~task() {}
+        virtual void run() = 0;
+    };
+
+    /// @param a_threads number of workers (0 - one per available CPU)
+    /// @param a_pin     pin each worker to a CPU
+    explicit work_stealing_pool(unsigned a_threads = 0, bool a_pin = true);
+    ~work_stealing_pool();
+
+    work_stealing_pool(const work_stealing_pool&)            = delete;
+    work_stealing_pool& operator=(const work_stealing_pool&) = delete;
+
+    /// Number of workers.
+    size_t size() const { return m_workers.size(); }
+
+    /// CPU that the worker \a a_idx is pinned to (-1 - not pinned).
+    int worker_cpu(size_t a_idx) const { return m_workers[a_idx]->cpu; }
+
+    /// Total number of tasks executed / stolen by all workers.
+    unsigned long executed() const;
+    unsigned long stolen()   const;
+    /// Total number of times the workers went to sleep.
+    unsigned long parked()   const;
+
+    /// Index of the current worker in this pool or -1 if the calling thread
+    /// is not a worker of this pool.
+    int current_worker() const {
+        worker* w = current();
+        return w && w->pool == this ? w->index : -1;
+    }
+
+    /// Schedule \a a_fun() for execution. When called from a worker of this
+    /// pool, the task goes to the worker's own deque, otherwise to the
+    /// injection queue.
+    template <class F>
+    void submit(F&& a_fun);
+
+    /// Call \a a_fun(i) for each i in [a_begin, a_end) and wait for
+    /// completion. The range is split into chunks of \a a_grain iterations
+    /// (0 - about four chunks per worker). The calling thread executes one
+    /// chunk itself and then helps running other tasks.
+    template <class Int, class F>
+    void parallel_for(Int a_begin, Int a_end, F&& a_fun, Int a_grain = 0);
+
+    /// Compute \a a_map(b, e) for each chunk [b, e) of [a_begin, a_end) in
+    /// parallel, and fold the results left to right with \a a_reduce
+    /// starting with \a a_init. The result is deterministic for a given
+    /// grain even if \a a_reduce is not commutative.
+    template <class Int, class T, class Map, class Reduce>
+    T parallel_reduce(Int a_begin, Int a_end, T a_init, Map&& a_map,
+                      Reduce&& a_reduce, Int a_grain = 0);
+
+    /// Execute pending tasks in the calling thread until \a a_done() returns
+    /// true. Can be called by workers (e.g. inside of a task waiting for
+    /// nested tasks) or by external threads.
+    template <class Pred>
+    void help_until(const Pred& a_done);
+
+private:
+    template <class F>
+    struct task_impl : task {
+        F fun;
+        template <class U>
+        explicit task_impl(U&& a_fun) : fun(std::forward<U>(a_fun)) {}
+        void run() override { fun(); }
+    };
+
+    struct worker {
+        container::chase_lev_deque<task*> deque;
+        detail::queue_waiter              waiter;
+        work_stealing_pool*               pool;
+        int                               index;
+        int                               cpu;
+        uint32_t                          seed;
+        unsigned long                     executed;
+        unsigned long                     stolen;
+        std::thread                       thread;
+
+        worker(work_stealing_pool* a_pool, int a_idx, int a_cpu)
+            : waiter(0), pool(a_pool), index(a_idx), cpu(a_cpu)
+            , seed(a_idx*2654435761u + 1), executed(0), stolen(0)
+        {}
+
+        uint32_t random() {
+            seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+            return seed;
+        }
+    };
+
+    using inject_queue = concurrent_mpsc_queue<task*>;
+
+    std::vector<std::unique_ptr<worker>> m_workers;
+    inject_queue                         m_inject;
+    std::atomic<int>                     m_idle;
+    std::atomic<bool>                    m_stop;
+
+    static worker*& current() {
+        static thread_local worker* s_worker = nullptr;
+        return s_worker;
+    }
+
+    void run(worker* a_worker);
+    bool find_task(worker* a_worker, task*& a_task);
+    bool steal(worker* a_self, uint32_t a_start, task*& a_task);
+    bool drain_inject(worker* a_worker);
+    bool has_work() const;
+    void wake_one();
+    void park(worker* a_worker);
+
+    static void execute(worker* a_worker, task* a_task) {
+        a_task->run();
+        delete a_task;
+        if (a_worker) ++a_worker->executed;
+    }
+
+    template <class Int>
+    Int grain(Int a_begin, Int a_end, Int a_grain) const {
+        if (a_grain > 0) return a_grain;
+        Int n = Int((a_end - a_begin) / Int(4 * size()));
+        return n > 0 ? n : Int(1);
+    }
+
+    // Run a_fun(b, e) on consecutive chunks of [a_begin, a_end)
+    template <class Int, class F>
+    void for_each_chunk(Int a_begin, Int a_end, Int a_grain, const F& a_fun);
+};
+
+//-----------------------------------------------------------------------------
+// IMPLEMENTATION
+//-----------------------------------------------------------------------------
+
+inline work_stealing_pool::work_stealing_pool(unsigned a_threads, bool a_pin)
+    : m_idle(0), m_stop(false)
+{
+    auto cpus = cpu_topology();
+
+    // Order CPUs so that the first pass puts one worker per physical core
+    std::vector<std::pair<int, cpu_info>> order;
+    for (auto& c : cpus) {
+        int smt = std::count_if(cpus.begin(), cpus.begin() + (&c - &cpus[0]),
+            [&](const cpu_info& o) {
+                return o.core >= 0 && o.core == c.core && o.package == c.package;
+            });
+        order.emplace_back(smt, c);
+    }
+    std::stable_sort(order.begin(), order.end(),
+        [](const std::pair<int, cpu_info>& a, const std::pair<int, cpu_info>& b) {
+            return a.first < b.first;
+        });
+
+    if (!a_threads)
+        a_threads = std::max<size_t>(1, order.size());
+
+    for (unsigned i=0; i < a_threads; ++i) {
+        int cpu = a_pin && !order.empty() ? order[i % order.size()].second.cpu : -1;
+        m_workers.emplace_back(new worker(this, i, cpu));
+    }
+
+    // All workers must exist before any of them starts stealing
+    for (auto& w : m_workers) {
+        worker* p = w.get();
+        p->thread = std::thread([this, p]() { run(p); });
+    }
+}
+
+inline work_stealing_pool::~work_stealing_pool() {
+    m_stop.store(true, std::memory_order_release);
+    for (auto& w : m_workers)
+        w->waiter.interrupt();
+    for (auto& w : m_workers)
+        w->thread.join();
+}
+
+inline unsigned long work_stealing_pool::executed() const {
+    unsigned long n = 0;
+    for (auto& w : m_workers) n += w->executed;
+    return n;
+}
+
+inline unsigned long work_stealing_pool::stolen() const {
+    unsigned long n = 0;
+    for (auto& w : m_workers) n += w->stolen;
+    return n;
+}
+
+inline unsigned long work_stealing_pool::parked() const {
+    unsigned long n = 0;
+    for (auto& w : m_workers) n += w->waiter.park_count();
+    return n;
+}
+
+template <class F>
+inline void work_stealing_pool::submit(F&& a_fun) {
+    task* t = new task_impl<typename std::decay<F>::type>(std::forward<F>(a_fun));
+    worker* w = current();
+    if (w && w->pool == this)
+        w->deque.push(t);
+    else if (!m_inject.push(t)) {
+        delete t;
+        throw std::bad_alloc();
+    }
+    wake_one();
+}
+
+inline void work_stealing_pool::wake_one() {
+    // Pairs with the fence in queue_waiter::wait(): either we see the
+    // sleeper's m_idle increment, or it sees the task we've just queued.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (likely(m_idle.load(std::memory_order_relaxed) == 0))
+        return;
+    worker*  w = current();
+    size_t   n = m_workers.size();
+    size_t   s = w ? w->index + 1 : 0;
+    for (size_t i=0; i < n; ++i)
+        if (m_workers[(s + i) % n]->waiter.notify())
+            return;
+}
+
+inline bool work_stealing_pool::has_work() const {
+    if (!m_inject.empty())
+        return true;
+    for (auto& w : m_workers)
+        if (!w->deque.empty())
+            return true;
+    return false;
+}
+
+inline bool work_stealing_pool::drain_inject(worker* a_worker) {
+    // pop_all_reverse() is a single atomic exchange, so several workers
+    // may safely race here - each one gets a disjoint list
+    auto head = m_inject.empty() ? nullptr : m_inject.pop_all_reverse();
+    if (!head)
+        return false;
+
+    // Newest first, so that the owner pops the oldest task first and the
+    // thieves take the newest ones
+    int n = 0;
+    for (inject_queue::node* next; head; head = next, ++n) {
+        next = head->next();
+        a_worker->deque.push(head->data());
+        m_inject.free(head);
+    }
+    if (n > 1)
+        wake_one();
+    return true;
+}
+
+inline bool work_stealing_pool::steal(worker* a_self, uint32_t a_start, task*& a_task) {
+    size_t n = m_workers.size();
+    for (size_t i=0; i < n; ++i) {
+        worker* v = m_workers[(a_start + i) % n].get();
+        if (v != a_self && v->deque.steal(a_task)) {
+            if (a_self) ++a_self->stolen;
+            return true;
+        }
+    }
+    return false;
+}
+
+inline bool work_stealing_pool::find_task(worker* a_worker, task*& a_task) {
+    if (a_worker->deque.pop(a_task))
+        return true;
+    if (drain_inject(a_worker) && a_worker->deque.pop(a_task))
+        return true;
+    return steal(a_worker, a_worker->random(), a_task);
+}
+
+inline void work_stealing_pool::park(worker* a_worker) {
+    m_idle.fetch_add(1, std::memory_order_seq_cst);
+    a_worker->waiter.wait([this]() {
+        return has_work() || m_stop.load(std::memory_order_relaxed);
+    }, nullptr);
+    m_idle.fetch_sub(1, std::memory_order_relaxed);
+}
+
+inline void work_stealing_pool::run(worker* a_worker) {
+    current() = a_worker;
+    if (a_worker->cpu >= 0 && pin_this_thread(a_worker->cpu) != 0)
+        a_worker->cpu = -1;
+
+    backoff<> bo;
+    task*     t;
+
+    while (true) {
+        if (find_task(a_worker, t)) {
+            execute(a_worker, t);
+            bo.reset();
+        } else if (m_stop.load(std::memory_order_acquire))
+            break;
+        else if (!bo.saturated())
+            bo();
+        else {
+            park(a_worker);
+            bo.reset();
+        }
+    }
+    current() = nullptr;
+}
+
+template <class Pred>
+inline void work_stealing_pool::help_until(const Pred& a_done) {
+    worker* w = current();
+    if (w && w->pool != this)
+        w = nullptr;
+
+    backoff<> bo;
+    task*     t;
+    uint32_t  seed = 0;
+
+    while (!a_done()) {
+        if (w ? find_task(w, t) : steal(nullptr, seed++, t)) {
+            execute(w, t);
+            bo.reset();
+        } else if (!bo.saturated())
+            bo();
+        else
+            std::this_thread::yield();
+    }
+}
+
+template <class Int, class F>
+inline void work_stealing_pool::
+for_each_chunk(Int a_begin, Int a_end, Int a_grain, const F& a_fun) {
+    if (a_begin >= a_end)
+        return;
+
+    std::atomic<long>  pending(0);
+    std::exception_ptr error;
+    std::atomic<bool>  failed(false);
+
+    auto chunk = [&](Int b, Int e) {
+        try {
+            a_fun(b, e);
+        } catch (...) {
+            if (!failed.exchange(true))
+                error = std::current_exception();
+        }
+        pending.fetch_sub(1, std::memory_order_release);
+    };
+
+    Int step = grain(a_begin, a_end, a_grain);
+    Int b    = a_begin;
+
+    // Keep the first chunk for the calling thread
+    Int first_end = (a_end - b) > step ? Int(b + step) : a_end;
+    for (Int i = first_end; i < a_end; ) {
+        Int e = (a_end - i) > step ? Int(i + step) : a_end;
+        pending.fetch_add(1, std::memory_order_relaxed);
+        submit([&chunk, i, e]() { chunk(i, e); });
+        i = e;
+    }
+
+    pending.fetch_add(1, std::memory_order_relaxed);
+    chunk(b, first_end);
+
+    help_until([&]() { return pending.load(std::memory_order_acquire) == 0; });
+
+    if (error)
+        std::rethrow_exception(error);
+}
+
+template <class Int, class F>
+inline void work_stealing_pool::
+parallel_for(Int a_begin, Int a_end, F&& a_fun, Int a_grain) {
+    for_each_chunk(a_begin, a_end, a_grain, [&a_fun](Int b, Int e) {
+        for (Int i = b; i < e; ++i)
+            a_fun(i);
+    });
+}
+
+template <class Int, class T, class Map, class Reduce>
+inline T work_stealing_pool::
+parallel_reduce(Int a_begin, Int a_end, T a_init, Map&& a_map,
+                Reduce&& a_reduce, Int a_grain) {
+    if (a_begin >= a_end)
+        return a_init;
+
+    // Chunks write their results concurrently, so results are a cache line
+    // apart (this also avoids the packed bits of std::vector<bool>). The
+    // padding doesn't rely on over-aligned allocation, absent before C++17
+    struct slot {
+        T    v;
+        char pad[UTXX_CL_SIZE];
+        explicit slot(const T& a_v) : v(a_v) {}
+    };
+
+    Int               step = grain(a_begin, a_end, a_grain);
+    size_t            n    = size_t((a_end - a_begin + step - 1) / step);
+    std::vector<slot> res(n, slot(a_init));
+
+    for_each_chunk(a_begin, a_end, step, [&](Int b, Int e) {
+        res[size_t((b - a_begin) / step)].v = a_map(b, e);
+    });
+
+    for (auto& r : res)
+        a_init = a_reduce(a_init, r.v);
+    return a_init;
+}
+
+} // namespace utxx
@@ -0,0 +1,324 @@
+//----------------------------------------------------------------------------
+/// \file   waitable_queue.hpp
+/// \author Serge Aleynikov
+//----------------------------------------------------------------------------
+/// \brief Blocking-wait wrappers for concurrent_mpsc_queue and
+///        concurrent_spsc_queue.
+///
+/// The consumer spins for a configurable number of iterations and then parks
+/// on a futex. Before parking it raises a "sleeping" flag, and producers only
+/// make a wake-up system call when they find that flag set, so under load
+/// the producer side costs one fence and one relaxed load.
+//----------------------------------------------------------------------------
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#pragma once
+
+#include <utxx/futex.hpp>
+#include <utxx/backoff.hpp>
+#include <utxx/compiler_hints.hpp>
+#include <utxx/concurrent_mpsc_queue.hpp>
+#include <utxx/concurrent_spsc_queue.hpp>
+#include <atomic>
+#include <string>
+
+namespace utxx {
+
+namespace detail {
+
+    //-------------------------------------------------------------------------
+    /// Sleeping-flag handshake between producers and a single consumer.
+    //-------------------------------------------------------------------------
+    /// The consumer sets the flag and issues a full fence before re-checking
+    /// the queue and parking; a producer issues a full fence after enqueuing
+    /// and checks the flag. Either the consumer sees the new item, or the
+    /// producer sees the flag, so a wake-up can't be lost.
+    class queue_waiter {
+        std::atomic<int>            m_sleeping;
+        std::atomic<bool>           m_interrupt;
+        std::atomic<unsigned long>  m_wake_count;
+        unsigned long               m_park_count;
+        int                         m_spin;
+        futex                       m_futex;
+
+        bool wake_consumer() {
+            if (!m_sleeping.exchange(0, std::memory_order_acq_rel))
+                return false;
+            m_wake_count.fetch_add(1, std::memory_order_relaxed);
+            m_futex.signal();
+            return true;
+        }
+    public:
+        explicit queue_waiter(int a_spin = 128)
+            : m_sleeping  (0)
+            , m_interrupt (false)
+            , m_wake_count(0)
+            , m_park_count(0)
+            , m_spin      (a_spin)
+        {
+            m_futex.reset(0);
+        }
+
+        /// Number of spin iterations before the consumer parks.
+        int  spin() const    { return m_spin; }
+        void spin(int a_cnt) { m_spin = a_cnt; }
+
+        /// Number of times the consumer went to sleep.
+        unsigned long park_count() const { return m_park_count; }
+        /// Number of wake-up calls made by producers.
+        unsigned long wake_count() const {
+            return m_wake_count.load(std::memory_order_relaxed);
+        }
+
+        /// Producer side: call after an item was enqueued.
+        /// @return true if the consumer was parked and got woken up
+        bool notify() {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            return unlikely(m_sleeping.load(std::memory_order_relaxed))
+                && wake_consumer();
+        }
+
+        /// True if the consumer is parked or about to park.
+        bool sleeping() const {
+            return m_sleeping.load(std::memory_order_relaxed);
+        }
+
+        /// Make the consumer's pending or next wait() return false.
+        void interrupt() {
+            m_interrupt.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            wake_consumer();
+        }
+
+        /// Consumer side: wait until \a a_ready() returns true.
+        /// @param a_timeout relative timeout (NULL - infinite). Note that the
+        ///        timeout is restarted after a spurious wakeup.
+        /// @return true if \a a_ready() is satisfied, false on timeout or
+        ///         interrupt().
+        template <typename Ready>
+        bool wait(const Ready& a_ready, const struct timespec* a_timeout) {
+            for (int i=0; i < m_spin; ++i) {
+                if (a_ready())
+                    return true;
+                cpu_relax();
+            }
+
+            while (true) {
+                int val = m_futex.value();
+                m_sleeping.store(1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+
+                if (a_ready()) {
+                    m_sleeping.store(0, std::memory_order_relaxed);
+                    return true;
+                }
+                if (m_interrupt.exchange(false, std::memory_order_relaxed)) {
+                    m_sleeping.store(0, std::memory_order_relaxed);
+                    return false;
+                }
+
+                ++m_park_count;
+                auto res = m_futex.wait(a_timeout, &val);
+                m_sleeping.store(0, std::memory_order_relaxed);
+
+                if (res == wakeup_result::TIMEDOUT)
+                    return a_ready();
+            }
+        }
+    };
+
+} // namespace detail
+
+//-----------------------------------------------------------------------------
+/// Multi-producer single-consumer queue with a blocking consumer wait.
+//-----------------------------------------------------------------------------
+/// All producer-side insertion methods of concurrent_mpsc_queue are wrapped
+/// so that they wake up the consumer if it's parked.
+template <class T, class Allocator = std::allocator<char>>
+class waitable_mpsc_queue : public concurrent_mpsc_queue<T, Allocator> {
+    using base = concurrent_mpsc_queue<T, Allocator>;
+    detail::queue_waiter m_waiter;
+public:
+    using node  = typename base::node;
+    using Alloc = typename base::Alloc;
+
+    explicit waitable_mpsc_queue(const Alloc& a_alloc = Alloc(), int a_spin = 128)
+        : base(a_alloc), m_waiter(a_spin)
+    {}
+
+    bool push(const T& a_data) {
+        bool res = base::push(a_data);
+        m_waiter.notify();
+        return res;
+    }
+
+    void push(node* a_node) {
+        base::push(a_node);
+        m_waiter.notify();
+    }
+
+    template <typename... Args>
+    bool emplace(Args&&... args) {
+        bool res = base::emplace(std::forward<Args>(args)...);
+        m_waiter.notify();
+        return res;
+    }
+
+    /// Wait until the queue is not empty, and pop all elements in the order
+    /// of insertion.
+    /// @return NULL on timeout or interrupt().
+    node* wait_pop_all(const struct timespec* a_timeout = nullptr) {
+        return m_waiter.wait([this]() { return !this->empty(); }, a_timeout)
+             ? base::pop_all() : nullptr;
+    }
+
+    /// Wait until the queue is not empty.
+    /// @return false on timeout or interrupt().
+    bool wait(const struct timespec* a_timeout = nullptr) {
+        return m_waiter.wait([this]() { return !this->empty(); }, a_timeout);
+    }
+
+    /// Wake up the consumer without pushing data (e.g. on shutdown).
+    void interrupt() { m_waiter.interrupt(); }
+
+    detail::queue_waiter const& waiter() const { return m_waiter; }
+    detail::queue_waiter&       waiter()       { return m_waiter; }
+};
+
+//-----------------------------------------------------------------------------
+/// Multi-producer single-consumer queue of variable-size char nodes with a
+/// blocking consumer wait.
+//-----------------------------------------------------------------------------
+template <class Allocator>
+class waitable_mpsc_queue<char, Allocator>
+    : public concurrent_mpsc_queue<char, Allocator>
+{
+    using base = concurrent_mpsc_queue<char, Allocator>;
+    detail::queue_waiter m_waiter;
+public:
+    using node = typename base::node;
+
+    explicit waitable_mpsc_queue(const Allocator& a_alloc = Allocator(),
+                                 int a_spin = 128)
+        : base(a_alloc), m_waiter(a_spin)
+    {}
+
+    template <typename T, typename... Args>
+    bool emplace(Args&&... args) {
+        bool res = base::template emplace<T>(std::forward<Args>(args)...);
+        m_waiter.notify();
+        return res;
+    }
+
+    template <typename InitLambda>
+    bool push(size_t a_size, InitLambda a_fun) {
+        bool res = base::push(a_size, a_fun);
+        m_waiter.notify();
+        return res;
+    }
+
+    template <int N>
+    bool push(const char (&a_value)[N]) {
+        bool res = base::push(a_value);
+        m_waiter.notify();
+        return res;
+    }
+
+    template <typename Ch>
+    bool push(const std::basic_string<Ch>& a_value) {
+        bool res = base::push(a_value);
+        m_waiter.notify();
+        return res;
+    }
+
+    void push(node* a_node) {
+        base::push(a_node);
+        m_waiter.notify();
+    }
+
+    /// \copydoc waitable_mpsc_queue::wait_pop_all()
+    node* wait_pop_all(const struct timespec* a_timeout = nullptr) {
+        return m_waiter.wait([this]() { return !this->empty(); }, a_timeout)
+             ? base::pop_all() : nullptr;
+    }
+
+    /// \copydoc waitable_mpsc_queue::wait()
+    bool wait(const struct timespec* a_timeout = nullptr) {
+        return m_waiter.wait([this]() { return !this->empty(); }, a_timeout);
+    }
+
+    /// \copydoc waitable_mpsc_queue::interrupt()
+    void interrupt() { m_waiter.interrupt(); }
+
+    detail::queue_waiter const& waiter() const { return m_waiter; }
+    detail::queue_waiter&       waiter()       { return m_waiter; }
+};
+
+//-----------------------------------------------------------------------------
+/// Single-producer single-consumer queue with a blocking consumer wait.
+//-----------------------------------------------------------------------------
+/// NB: the futex lives in this (process-local) object, so when the queue data
+/// is placed in shared memory only threads of the same process can be woken.
+template <class T, uint32_t StaticCapacity = 0>
+class waitable_spsc_queue : public concurrent_spsc_queue<T, StaticCapacity> {
+    using base = concurrent_spsc_queue<T, StaticCapacity>;
+    detail::queue_waiter m_waiter;
+public:
+    using base::base;
+
+    /// Write a T object constructed with \a a_item_args to the queue, and
+    /// wake up the consumer if it's parked.
+    /// @return NULL if the queue is full.
+    template <class... Args>
+    T* push(Args&&... a_item_args) {
+        T* res = base::push(std::forward<Args>(a_item_args)...);
+        if (likely(res != nullptr))
+            m_waiter.notify();
+        return res;
+    }
+
+    /// Wait until an item is available and move it to \a a_item.
+    /// @return false on timeout or interrupt().
+    bool wait_pop(T& a_item, const struct timespec* a_timeout = nullptr) {
+        return m_waiter.wait([this]() { return !this->empty(); }, a_timeout)
+            && base::pop(a_item);
+    }
+
+    /// Wait until an item is available and return a pointer to it.
+    /// @return NULL on timeout or interrupt().
+    T* wait_peek(const struct timespec* a_timeout = nullptr) {
+        return m_waiter.wait([this]() { return !this->empty(); }, a_timeout)
+             ? base::peek() : nullptr;
+    }
+
+    /// \copydoc waitable_mpsc_queue::interrupt()
+    void interrupt() { m_waiter.interrupt(); }
+
+    detail::queue_waiter const& waiter() const { return m_waiter; }
+    detail::queue_waiter&       waiter()       { return m_waiter; }
+};
+
+} // namespace utxx
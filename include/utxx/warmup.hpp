@@ -0,0 +1,178 @@
+//----------------------------------------------------------------------------
+/// \file   warmup.hpp
+/// \author Serge Aleynikov
+//----------------------------------------------------------------------------
+/// \brief Start-up warm-up of container memory.
+///
+/// warm_up() pre-faults the pages backing a memory range, optionally binds
+/// them to a NUMA node and locks them in memory, and reports the time spent
+/// and the number of pages that were actually faulted in.  Containers that
+/// allocate large buffers (ring_buffer, generation_buffer,
+/// concurrent_spsc_queue, persist_array, basic_async_logger) expose it via a
+/// prefault(const warmup_options&) member, and prefault_all() warms up a
+/// number of such containers at once.
+//----------------------------------------------------------------------------
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+#pragma once
+
+#include <utxx/huge_pages.hpp>
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace utxx   {
+namespace memory {
+
+/// Options of warm_up()
+struct warmup_options {
+    bool write;     ///< Fault pages in for writing (must be false for
+                    ///< read-only memory)
+    bool lock;      ///< Lock the pages in memory with mlock(2)
+    int  numa_node; ///< Bind the pages to this NUMA node (-1 - don't bind)
+
+    warmup_options(bool a_write = true, bool a_lock = false, int a_numa_node = -1)
+        : write(a_write), lock(a_lock), numa_node(a_numa_node)
+    {}
+};
+
+/// Outcome of warming up one or more memory ranges
+struct warmup_report {
+    size_t bytes   = 0; ///< Size of the page-aligned ranges
+    size_t pages   = 0; ///< Number of pages in the ranges
+    size_t faulted = 0; ///< Pages that were not resident before the warm-up
+    size_t locked  = 0; ///< Bytes locked in memory
+    size_t bound   = 0; ///< Bytes bound to the NUMA node
+    int    error   = 0; ///< errno of the last failed mlock/mbind (0 - none)
+    long   nsec    = 0; ///< Time spent
+
+    warmup_report& operator+=(const warmup_report& a) {
+        bytes   += a.bytes;
+        pages   += a.pages;
+        faulted += a.faulted;
+        locked  += a.locked;
+        bound   += a.bound;
+        nsec    += a.nsec;
+        if (a.error) error = a.error;
+        return *this;
+    }
+
+    void dump(std::ostream& out) const {
+        out << "pages=" << pages << " (" << (bytes >> 10) << "K)"
+            << " faulted=" << faulted << " locked=" << (locked >> 10) << 'K'
+            << " bound="   << (bound >> 10) << 'K'
+            << " time="    << (nsec / 1000) << "us";
+        if (error)
+            out << " error=" << error;
+    }
+
+    std::string to_string() const {
+        std::stringstream s;
+        dump(s);
+        return s.str();
+    }
+};
+
+/// Pre-fault the pages backing [a_addr, a_addr+a_len).
+/// The range is extended to whole pages.  If requested, the pages are
+/// first bound to a NUMA node (existing pages are migrated), and after
+/// being faulted in locked with mlock(2), which needs CAP_IPC_LOCK or a
+/// sufficient RLIMIT_MEMLOCK.  Failures of binding and locking are reported
+/// in warmup_report::error and don't prevent pre-faulting.
+/// Note that binding and locking apply to whole pages, which may be shared
+/// with other heap objects.
+inline warmup_report warm_up(const void* a_addr, size_t a_len,
+                             const warmup_options& a_opts = warmup_options())
+{
+    warmup_report r;
+    if (!a_addr || !a_len)
+        return r;
+
+    auto      start = std::chrono::steady_clock::now();
+    size_t    pg    = ::sysconf(_SC_PAGESIZE);
+    uintptr_t beg   = uintptr_t(a_addr) & ~(pg-1);
+    uintptr_t end   = page_round_up(uintptr_t(a_addr) + a_len, pg);
+    void*     addr  = reinterpret_cast<void*>(beg);
+
+    r.bytes = end - beg;
+    r.pages = r.bytes / pg;
+
+    // Count the pages that are not resident yet
+    std::vector<unsigned char> resident(r.pages);
+    if (::mincore(addr, r.bytes, &resident[0]) == 0) {
+        for (auto c : resident)
+            r.faulted += !(c & 1);
+    } else
+        r.faulted = r.pages;
+
+    if (a_opts.numa_node >= 0) {
+        // The nodemask is sized to hold the node's bit
+        const size_t bits = 8*sizeof(unsigned long);
+        std::vector<unsigned long> mask(a_opts.numa_node / bits + 1);
+        mask[a_opts.numa_node / bits] = 1ul << (a_opts.numa_node % bits);
+        if (::syscall(SYS_mbind, addr, r.bytes, MPOL_BIND, &mask[0],
+                      mask.size()*bits + 1, MPOL_MF_MOVE) == 0)
+            r.bound = r.bytes;
+        else
+            r.error = errno;
+    }
+
+    prefault(addr, r.bytes, a_opts.write);
+
+    if (a_opts.lock) {
+        if (::mlock(addr, r.bytes) == 0)
+            r.locked = r.bytes;
+        else
+            r.error  = errno;
+    }
+
+    r.nsec = std::chrono::duration_cast<std::chrono::nanoseconds>
+                (std::chrono::steady_clock::now() - start).count();
+    return r;
+}
+
+/// Warm up a number of containers by calling their
+/// prefault(const warmup_options&) member.
+/// @return the combined report
+template <class... Containers>
+warmup_report prefault_all(const warmup_options& a_opts, Containers&... a_containers)
+{
+    warmup_report r;
+    int dummy[] = { 0, ((r += a_containers.prefault(a_opts)), 0)... };
+    (void)dummy;
+    return r;
+}
+
+} // namespace memory
+} // namespace utxx
@@ -0,0 +1,222 @@
+//----------------------------------------------------------------------------
+/// \file  test_alloc_arena.cpp
+//----------------------------------------------------------------------------
+/// \brief Test cases and benchmarks for alloc_arena.hpp
+//----------------------------------------------------------------------------
+// Copyright (c) 2026 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <utxx/alloc_arena.hpp>
+#include <utxx/verbosity.hpp>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace utxx;
+
+BOOST_AUTO_TEST_CASE( test_alloc_arena_rewind )
+{
+    memory::arena a(1024);
+    char* p1 = static_cast<char*>(a.allocate(100));
+    auto  m  = a.mark();
+    char* p2 = static_cast<char*>(a.allocate(100));
+    BOOST_CHECK_EQUAL(112, p2 - p1);
+
+    // Spill into more chunks
+    for (int i = 0; i < 100; ++i)
+        a.allocate(100);
+    size_t chunks = a.chunks();
+    BOOST_CHECK(chunks > 1);
+
+    // Rewinding keeps the chunks and hands out the same memory again
+    a.rewind(m);
+    BOOST_CHECK(p2 == a.allocate(100));
+    for (int i = 0; i < 100; ++i)
+        a.allocate(100);
+    BOOST_CHECK_EQUAL(chunks, a.chunks());
+
+    // A marker taken on an empty arena rewinds it to the beginning
+    memory::arena b(1024);
+    auto m0 = b.mark();
+    void* q = b.allocate(10);
+    b.rewind(m0);
+    BOOST_CHECK(q == b.allocate(10));
+
+    a.reset();
+    for (int n = 0; n < 3; ++n) {
+        memory::arena_scope<> scope(a);
+        for (int i = 0; i < 100; ++i)
+            a.allocate(100);
+    }
+    BOOST_CHECK_EQUAL(chunks, a.chunks());
+}
+
+BOOST_AUTO_TEST_CASE( test_alloc_arena_allocator )
+{
+    typedef memory::arena_allocator<char> alloc_t;
+    typedef std::basic_string<char, std::char_traits<char>, alloc_t> string_t;
+
+    memory::arena a;
+    {
+        memory::arena_scope<> scope(a);
+        std::vector<int, memory::arena_allocator<int>> v{memory::arena_allocator<int>(a)};
+        for (int i = 0; i < 1000; ++i) v.push_back(i);
+        BOOST_CHECK_EQUAL(999, v.back());
+
+        std::map<int, string_t, std::less<int>,
+                 memory::arena_allocator<std::pair<const int, string_t>>>
+            m{memory::arena_allocator<std::pair<const int, string_t>>(a)};
+        for (int i = 0; i < 100; ++i)
+            m.emplace(i, string_t(std::string(40, 'a' + i % 26).c_str(), alloc_t(a)));
+        BOOST_CHECK_EQUAL(100u, m.size());
+        BOOST_CHECK_EQUAL(std::string(40, 'e').c_str(), m.find(4)->second.c_str());
+
+        BOOST_CHECK(v.get_allocator() == alloc_t(a));
+        memory::arena b;
+        BOOST_CHECK(v.get_allocator() != alloc_t(b));
+    }
+    BOOST_CHECK(a.chunks() > 0);
+}
+
+BOOST_AUTO_TEST_CASE( test_alloc_arena_fixed )
+{
+    std::vector<char> storage(4096);
+    auto& a = memory::heap_fixed_arena::create(&storage[0], storage.size());
+    BOOST_CHECK_EQUAL(0u, a.used());
+    BOOST_CHECK_EQUAL(4096 - sizeof(a), a.capacity());
+
+    void* p = a.allocate(1000);
+    BOOST_REQUIRE(p);
+    auto m = a.mark();
+    BOOST_CHECK_EQUAL(1000u, m);
+    void* q = a.allocate(1000, 64);
+    BOOST_CHECK_EQUAL(0u, uintptr_t(q) & 63);
+    BOOST_CHECK(!a.allocate(4096));
+    a.rewind(m);
+    BOOST_CHECK_EQUAL(1000u, a.used());
+
+    // STL containers throw when the arena is exhausted
+    std::vector<long, memory::arena_allocator<long, memory::heap_fixed_arena>>
+        v{memory::arena_allocator<long, memory::heap_fixed_arena>(a)};
+    BOOST_CHECK_THROW(v.reserve(1000), std::bad_alloc);
+
+    a.reset();
+    BOOST_CHECK_EQUAL(a.capacity(), a.available());
+
+    BOOST_CHECK_EQUAL(&a, &memory::heap_fixed_arena::attach(&storage[0], storage.size()));
+    BOOST_CHECK_THROW(memory::heap_fixed_arena::attach(&storage[0], 100), badarg_error);
+    BOOST_CHECK_THROW(memory::heap_fixed_arena::create(&storage[0], 8),   badarg_error);
+}
+
+BOOST_AUTO_TEST_CASE( test_alloc_arena_shmem )
+{
+    const size_t bytes = 64*1024;
+    char name[64];
+    snprintf(name, sizeof(name), "/test_alloc_arena.%d", getpid());
+    int fd = ::shm_open(name, O_CREAT | O_RDWR | O_EXCL, 0600);
+    BOOST_REQUIRE(fd >= 0);
+    ::shm_unlink(name);
+    BOOST_REQUIRE_EQUAL(0, ::ftruncate(fd, bytes));
+
+    // Two views of the same memory at different addresses
+    char* v1 = static_cast<char*>(::mmap(NULL, bytes, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0));
+    char* v2 = static_cast<char*>(::mmap(NULL, bytes, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0));
+    BOOST_REQUIRE(v1 != MAP_FAILED && v2 != MAP_FAILED && v1 != v2);
+
+    auto& a1 = memory::shmem_fixed_arena::create(v1, bytes);
+    auto& a2 = memory::shmem_fixed_arena::attach(v2, bytes);
+
+    char* p1 = static_cast<char*>(a1.allocate(100));
+    strcpy(p1, "hello");
+    BOOST_CHECK_EQUAL(a1.used(), a2.used());
+
+    // The allocation made through the second view follows the first one
+    char* p2 = static_cast<char*>(a2.allocate(100));
+    BOOST_CHECK_EQUAL(p1 - v1 + 112, p2 - v2);
+    BOOST_CHECK_EQUAL("hello", v2 + (p1 - v1));
+    BOOST_CHECK_EQUAL(a1.mark(), a2.mark());
+
+    a2.reset();
+    BOOST_CHECK_EQUAL(0u, a1.used());
+
+    ::munmap(v1, bytes);
+    ::munmap(v2, bytes);
+    ::close(fd);
+}
+
+namespace {
+    // Decode a message into temporary containers
+    template <class VecAlloc, class MapAlloc>
+    long decode(const VecAlloc& a_va, const MapAlloc& a_ma, int a_seed) {
+        std::vector<std::pair<int, double>, VecAlloc> fields(a_va);
+        std::map<int, long, std::less<int>, MapAlloc> book(std::less<int>(), a_ma);
+        for (int i = 0; i < 32; ++i)
+            fields.emplace_back(i, a_seed * 0.5 + i);
+        for (int i = 0; i < 16; ++i)
+            book.emplace((a_seed + i*7) % 64, i);
+        return fields.size() + book.begin()->second;
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_alloc_arena_perf )
+{
+    using namespace std::chrono;
+    const long iterations = ::getenv("ITERATIONS") ? atoi(::getenv("ITERATIONS")) : 100000;
+    typedef std::pair<int, double>    field;
+    typedef std::pair<const int, long> level;
+
+    auto ns = [=](high_resolution_clock::time_point a_start) {
+        return double(duration_cast<nanoseconds>
+            (high_resolution_clock::now() - a_start).count()) / iterations;
+    };
+
+    long sum1 = 0, sum2 = 0;
+    auto t = high_resolution_clock::now();
+    for (long i = 0; i < iterations; ++i)
+        sum1 += decode(std::allocator<field>(), std::allocator<level>(), i);
+    double heap = ns(t);
+
+    memory::arena& a = memory::arena::local();
+    t = high_resolution_clock::now();
+    for (long i = 0; i < iterations; ++i) {
+        memory::arena_scope<> scope(a);
+        sum2 += decode(memory::arena_allocator<field>(a),
+                       memory::arena_allocator<level>(a), i);
+    }
+    double arena = ns(t);
+
+    BOOST_REQUIRE_EQUAL(sum1, sum2);
+
+    if (verbosity::level() != utxx::VERBOSE_NONE)
+        fprintf(stderr, "  Per message: std::allocator %.0f ns, arena %.0f ns\n",
+                heap, arena);
+}
@@ -34,7 +34,12 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <boost/test/unit_test.hpp>
 #include <utxx/alloc_fixed_page.hpp>
+#include <utxx/concurrent_alloc_fixed_page.hpp>
 #include <utxx/verbosity.hpp>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <thread>
 #include <vector>
 #include <iostream>
 
@@ -64,3 +69,152 @@ BOOST_AUTO_TEST_CASE( test_alloc_fixed_page )
 
 }
 
+
+BOOST_AUTO_TEST_CASE( test_alloc_fixed_page_numa )
+{
+    typedef memory::numa_page_source<64*1024>    source;
+    int node  = current_numa_node();
+    auto base = source::stats(node);
+
+    {
+        memory::aligned_page_allocator<test, 64*1024, source> alloc;
+        std::vector<test*> v;
+        // Several pages: the page in use is never returned by the allocator
+        for (int i = 0; i < 5000; i++)
+            v.push_back(alloc.allocate(1));
+        auto st = source::stats(node);
+        BOOST_CHECK_EQUAL(1, st.chunks - base.chunks);
+        BOOST_CHECK(st.pages_used - base.pages_used >= 5000*long(sizeof(test)) / (64*1024));
+        for (auto p : v) {
+            BOOST_REQUIRE_EQUAL(node, source::node(p));
+            alloc.deallocate(p, 1);
+        }
+        BOOST_CHECK_EQUAL(1, source::stats(node).pages_used - base.pages_used);
+    }
+    auto st = source::stats(node);
+    BOOST_CHECK_EQUAL(base.pages_used, st.pages_used);
+    BOOST_CHECK(st.pages_free > 0);
+
+    // Pages are placed on the requested node
+    void* p = source::allocate(node);
+    *static_cast<char*>(p) = 1;
+    int n = memory::numa_node_of(p);
+    BOOST_CHECK(n == node || n == -1);
+    source::deallocate(p);
+    BOOST_CHECK_THROW(source::allocate(source::max_nodes), badarg_error);
+
+    // Explicit huge pages fall back to regular pages if none are reserved
+    typedef memory::numa_page_source<64*1024, memory::huge_pages::EXPLICIT> huge;
+    p = huge::allocate();
+    memset(p, 0, 64*1024);
+    auto hs = huge::stats(current_numa_node());
+    BOOST_CHECK_EQUAL(1, hs.chunks);
+    BOOST_CHECK_EQUAL(1, hs.huge_chunks + hs.huge_fallbacks);
+    huge::deallocate(p);
+
+    if (verbosity::level() != utxx::VERBOSE_NONE)
+        fprintf(stderr, "  NUMA nodes: %d, huge chunks: %ld, fallbacks: %ld\n",
+                numa_node_count(), hs.huge_chunks, hs.huge_fallbacks);
+}
+
+BOOST_AUTO_TEST_CASE( test_alloc_fixed_page_concurrent )
+{
+    typedef memory::concurrent_aligned_page_allocator<test, 4096> alloc_t;
+    alloc_t alloc;
+    const int threads = 4, count = 20000;
+    std::vector<std::vector<test*>> v(threads);
+
+    // Objects are allocated by one thread and freed by another
+    std::vector<std::thread> th;
+    for (int i = 0; i < threads; i++)
+        th.emplace_back([&, i]() {
+            for (int j = 0; j < count; j++) {
+                v[i].push_back(alloc.allocate(1));
+                memset(v[i].back(), i, sizeof(test));
+            }
+        });
+    for (auto& t : th) t.join();
+    th.clear();
+
+    for (int i = 0; i < threads; i++)
+        th.emplace_back([&, i]() {
+            auto& w = v[(i+1) % threads];
+            for (auto p : w) {
+                BOOST_REQUIRE_EQUAL(char((i+1) % threads), p->buf[0]);
+                alloc.deallocate(p, 1);
+            }
+            // Released pages are cached by the freeing thread
+            BOOST_REQUIRE_EQUAL(10, alloc_t::free_pages());
+        });
+    for (auto& t : th) t.join();
+
+    test* p = alloc.allocate(1);
+    BOOST_CHECK(p);
+    alloc.deallocate(p, 1);
+    BOOST_CHECK_THROW(alloc.allocate(2), badarg_error);
+
+    // Pages of a NUMA source go back to the free list of their node rather
+    // than to the cache of the releasing thread
+    typedef memory::numa_page_source<4096*4>                        source;
+    typedef memory::concurrent_aligned_page_allocator
+                <test, 4096*4, 10, source>                          numa_t;
+    numa_t     numa;
+    int        node = current_numa_node();
+    auto       base = source::stats(node);
+    std::vector<test*> w;
+    std::thread([&]() {
+        for (int j = 0; j < count; j++)
+            w.push_back(numa.allocate(1));
+    }).join();
+    for (auto q : w)
+        numa.deallocate(q, 1);
+    BOOST_CHECK_EQUAL(0, numa_t::free_pages());
+    BOOST_CHECK_EQUAL(base.pages_used, source::stats(node).pages_used);
+}
+
+namespace {
+    // Average latency of a dependent random walk over pages of a node
+    double walk_latency(int a_node, int a_pages, long a_hops) {
+        typedef memory::numa_page_source<64*1024> source;
+        const size_t slots_per_page = source::page_size / 64;
+        std::vector<char*> pages;
+        for (int i = 0; i < a_pages; i++)
+            pages.push_back(static_cast<char*>(source::allocate(a_node)));
+
+        // Link cache-line slots of all pages in a random cycle
+        std::vector<char**> slots;
+        for (auto p : pages)
+            for (size_t j = 0; j < slots_per_page; j++)
+                slots.push_back(reinterpret_cast<char**>(p + j*64));
+        std::shuffle(slots.begin(), slots.end(), std::mt19937(1));
+        for (size_t i = 0; i < slots.size(); i++)
+            *slots[i] = reinterpret_cast<char*>(slots[(i+1) % slots.size()]);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        char** q = slots[0];
+        for (long i = 0; i < a_hops; i++)
+            q = reinterpret_cast<char**>(*q);
+        double ns = double(std::chrono::duration_cast<std::chrono::nanoseconds>
+                    (std::chrono::high_resolution_clock::now() - start).count());
+        BOOST_REQUIRE(q);
+        for (auto p : pages)
+            source::deallocate(p);
+        return ns / a_hops;
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_alloc_fixed_page_numa_latency )
+{
+    const long hops  = ::getenv("ITERATIONS") ? atol(::getenv("ITERATIONS")) : 1000000;
+    const int  nodes = numa_node_count();
+    const int  local = current_numa_node();
+    const int  pages = 512;     // 32M
+
+    double l = walk_latency(local, pages, hops);
+    double r = walk_latency((local + 1) % nodes, pages, hops);
+
+    if (verbosity::level() != utxx::VERBOSE_NONE)
+        fprintf(stderr, "  Random access latency: local node %d %.1f ns, "
+                "remote node %d %.1f ns%s\n", local, l, (local+1) % nodes, r,
+                nodes == 1 ? " (single node system)" : "");
+}
@@ -0,0 +1,146 @@
+//----------------------------------------------------------------------------
+/// \file  test_alloc_fixed_pool.cpp
+//----------------------------------------------------------------------------
+/// \brief Test cases for alloc_fixed_pool.hpp
+//----------------------------------------------------------------------------
+// Copyright (c) 2026 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <utxx/alloc_fixed_pool.hpp>
+#include <utxx/verbosity.hpp>
+#include <algorithm>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace utxx;
+
+BOOST_AUTO_TEST_CASE( test_alloc_fixed_pool_large )
+{
+    // More objects than fit in the 16-bit index of the old free list head
+    const size_t count = 200000;
+    typedef memory::heap_fixed_size_object_pool pool_t;
+    std::vector<char> storage((count + 16) * (16 + sizeof(void*)));
+    pool_t& pool = pool_t::create(&storage[0], storage.size(), 16);
+    BOOST_REQUIRE(pool.capacity() >= count);
+
+    std::vector<void*> v;
+    for (void* p; (p = pool.allocate()); )
+        v.push_back(p);
+    BOOST_CHECK_EQUAL(pool.capacity(), v.size());
+    std::sort(v.begin(), v.end());
+    BOOST_CHECK(std::adjacent_find(v.begin(), v.end()) == v.end());
+    BOOST_CHECK(!pool.allocate());
+
+    for (auto p : v) pool.free(p);
+    BOOST_CHECK(pool.version() >= 2*pool.capacity());
+
+    // The version no longer wraps after 64K operations
+    uint32_t ver = pool.version();
+    for (int i=0; i < 100000; ++i)
+        pool.free(pool.allocate());
+    BOOST_CHECK_EQUAL(ver + 200000, pool.version());
+
+    BOOST_CHECK_THROW(pool_t::attach(&storage[0], storage.size(), 8), badarg_error);
+    BOOST_CHECK_EQUAL(&pool, &pool_t::attach(&storage[0], storage.size(), 16));
+}
+
+BOOST_AUTO_TEST_CASE( test_alloc_fixed_pool_multiprocess )
+{
+    const int    iterations = ::getenv("ITERATIONS") ? atoi(::getenv("ITERATIONS")) : 100000;
+    const int    procs      = 4;
+    const size_t count      = 100000;
+    const size_t obj_size   = 16;
+    const size_t bytes      = (count + 16) * (obj_size + sizeof(boost::interprocess::offset_ptr<char>));
+    typedef memory::shmem_fixed_size_object_pool pool_t;
+
+    char name[64];
+    snprintf(name, sizeof(name), "/test_alloc_fixed_pool.%d", getpid());
+    int fd = ::shm_open(name, O_CREAT | O_RDWR | O_EXCL, 0600);
+    BOOST_REQUIRE(fd >= 0);
+    ::shm_unlink(name);
+    BOOST_REQUIRE_EQUAL(0, ::ftruncate(fd, bytes));
+
+    void* addr = ::mmap(NULL, bytes, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    BOOST_REQUIRE(addr != MAP_FAILED);
+    pool_t& pool = pool_t::create(addr, bytes, obj_size);
+
+    std::vector<pid_t> pids;
+    for (int n=0; n < procs; ++n) {
+        pid_t pid = fork();
+        BOOST_REQUIRE(pid >= 0);
+        if (pid > 0) {
+            pids.push_back(pid);
+            continue;
+        }
+        // Map the pool at a different address to exercise offset pointers
+        void* a = ::mmap(NULL, bytes, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+        if (a == MAP_FAILED)
+            _exit(2);
+        pool_t& p = pool_t::attach(a, bytes, obj_size);
+        long    me = getpid(), errors = 0;
+        long*   objs[16];
+        for (int i=0; i < iterations; ++i) {
+            int k = 1 + i % 16;
+            for (int j=0; j < k; ++j) {
+                objs[j] = static_cast<long*>(p.allocate());
+                if (!objs[j]) { k = j; ++errors; break; }
+                objs[j][0] = me; objs[j][1] = j;
+            }
+            for (int j=0; j < k; ++j) {
+                errors += objs[j][0] != me || objs[j][1] != j;
+                p.free(objs[j]);
+            }
+        }
+        _exit(errors ? 1 : 0);
+    }
+
+    for (auto pid : pids) {
+        int status;
+        BOOST_REQUIRE_EQUAL(pid, waitpid(pid, &status, 0));
+        BOOST_REQUIRE(WIFEXITED(status));
+        BOOST_CHECK_EQUAL(0, WEXITSTATUS(status));
+    }
+
+    // No object was lost or handed out twice
+    std::vector<void*> v;
+    for (void* p; (p = pool.allocate()); )
+        v.push_back(p);
+    BOOST_CHECK_EQUAL(pool.capacity(), v.size());
+    std::sort(v.begin(), v.end());
+    BOOST_CHECK(std::adjacent_find(v.begin(), v.end()) == v.end());
+
+    if (verbosity::level() != utxx::VERBOSE_NONE)
+        fprintf(stderr, "  %d processes: %lu objects, head version %u\n",
+                procs, pool.capacity(), pool.version());
+
+    ::munmap(addr, bytes);
+    ::close(fd);
+}
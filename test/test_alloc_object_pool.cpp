@@ -0,0 +1,221 @@
+//----------------------------------------------------------------------------
+/// \file  test_alloc_object_pool.cpp
+//----------------------------------------------------------------------------
+/// \brief Test cases and benchmarks for alloc_object_pool.hpp
+//----------------------------------------------------------------------------
+// Copyright (c) 2026 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <utxx/alloc_object_pool.hpp>
+#include <utxx/alloc_fixed_pool.hpp>
+#include <utxx/verbosity.hpp>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+using namespace utxx;
+
+namespace {
+    struct order {
+        static int s_live;
+        long   id;
+        double px;
+        int    qty;
+        order(long a_id, double a_px, int a_qty) : id(a_id), px(a_px), qty(a_qty) { ++s_live; }
+        ~order() { --s_live; }
+    };
+    int order::s_live = 0;
+}
+
+BOOST_AUTO_TEST_CASE( test_object_pool_basic )
+{
+    typedef memory::object_pool<order, 4, memory::single_thread_pool_policy> pool_t;
+    static_assert(pool_t::capacity() == 4, "constexpr capacity");
+    static_assert(sizeof(pool_t::handle) == 4, "32-bit handles");
+    BOOST_CHECK_EQUAL(3u, pool_t::index_bits());
+
+    {
+        pool_t pool;
+        BOOST_CHECK_EQUAL(4u, pool.unsafe_available());
+
+        auto h1 = pool.create(1, 10.5, 100);
+        auto h2 = pool.create(2, 11.0, 200);
+        BOOST_REQUIRE(h1 && h2);
+        BOOST_CHECK(h1 != h2);
+        BOOST_CHECK_EQUAL(2, order::s_live);
+        BOOST_CHECK_EQUAL(1,    pool.get(h1)->id);
+        BOOST_CHECK_EQUAL(200,  pool.at(h2).qty);
+        BOOST_CHECK_EQUAL(0u, reinterpret_cast<uintptr_t>(pool.get(h1)) % UTXX_CL_SIZE);
+        BOOST_CHECK(pool.to_handle(pool.get(h2)) == h2);
+        BOOST_CHECK(!pool.to_handle(&pool.at(h2) + 1));
+
+        // Stale handles are rejected after the slot is reused
+        BOOST_CHECK(pool.destroy(h1));
+        BOOST_CHECK(!pool.destroy(h1));
+        BOOST_CHECK(!pool.get(h1));
+        BOOST_CHECK(!pool.valid(h1));
+        BOOST_CHECK_THROW(pool.at(h1), badarg_error);
+        auto h3 = pool.create(3, 12.0, 300);
+        BOOST_CHECK(h3 != h1);
+        BOOST_CHECK(!pool.get(h1));
+        BOOST_CHECK_EQUAL(3, pool.get(h3)->id);
+        BOOST_CHECK(!pool.get(pool_t::handle()));
+        BOOST_CHECK(!pool.get(pool_t::handle::from_value(0xFFFFFFFF)));
+        BOOST_CHECK(pool.get(pool_t::handle::from_value(h3.value())));
+
+        // Exhaustion
+        BOOST_CHECK(pool.create(4, 1.0, 1));
+        BOOST_CHECK(pool.create(5, 1.0, 1));
+        BOOST_CHECK(!pool.create(6, 1.0, 1));
+        BOOST_CHECK_EQUAL(0u, pool.unsafe_available());
+        BOOST_CHECK_EQUAL(4, order::s_live);
+    }
+    // Live objects are destroyed with the pool
+    BOOST_CHECK_EQUAL(0, order::s_live);
+}
+
+BOOST_AUTO_TEST_CASE( test_object_pool_generations )
+{
+    // Every reuse of a slot yields a distinct handle until generations wrap
+    memory::object_pool<long, 1, memory::single_thread_pool_policy> pool;
+    std::set<uint32_t> seen;
+    for (int i = 0; i < 1000; ++i) {
+        auto h = pool.create(i);
+        BOOST_REQUIRE(seen.insert(h.value()).second);
+        BOOST_REQUIRE_EQUAL(i, *pool.get(h));
+        BOOST_REQUIRE(pool.destroy(h));
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_object_pool_lock_free )
+{
+    const int threads = 4, iterations = 100000;
+    typedef memory::object_pool<long, 64> pool_t;
+    pool_t pool;
+    std::atomic<long> errors(0);
+
+    std::vector<std::thread> thr;
+    for (int t = 0; t < threads; ++t)
+        thr.emplace_back([&, t]() {
+            std::vector<std::pair<pool_t::handle, long>> mine;
+            for (long i = 0; i < iterations; ++i) {
+                if (mine.size() < 16 && (i & 3) != 3) {
+                    long v = long(t) << 32 | i;
+                    auto h = pool.create(v);
+                    if (h) mine.emplace_back(h, v);
+                } else if (!mine.empty()) {
+                    auto& m = mine.back();
+                    long* p = pool.get(m.first);
+                    if (!p || *p != m.second || !pool.destroy(m.first) ||
+                        pool.destroy(m.first))
+                        ++errors;
+                    mine.pop_back();
+                }
+            }
+            for (auto& m : mine)
+                pool.destroy(m.first);
+        });
+    for (auto& t : thr) t.join();
+
+    BOOST_CHECK_EQUAL(0, errors.load());
+    BOOST_CHECK_EQUAL(64u, pool.unsafe_available());
+}
+
+//----------------------------------------------------------------------------
+// Benchmark
+//----------------------------------------------------------------------------
+namespace {
+    using namespace std::chrono;
+
+    // Allocate <a_live> objects, free them in random order, repeat.
+    // @return nanoseconds per allocate/free pair
+    template <class Alloc, class Free>
+    double bench(const std::vector<uint32_t>& a_order, long a_rounds,
+                 Alloc&& a_alloc, Free&& a_free)
+    {
+        typedef decltype(a_alloc(0)) ptr;
+        std::vector<ptr> live(a_order.size());
+        auto t = high_resolution_clock::now();
+        for (long r = 0; r < a_rounds; ++r) {
+            for (size_t i = 0; i < live.size(); ++i)
+                live[i] = a_alloc(i);
+            for (auto i : a_order)
+                a_free(live[i]);
+        }
+        return double(duration_cast<nanoseconds>(high_resolution_clock::now() - t).count())
+             / (a_rounds * live.size());
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_object_pool_perf )
+{
+    const long n = ::getenv("ITERATIONS") ? atol(::getenv("ITERATIONS")) : 2000000;
+    const uint32_t live = 1024;
+    const long rounds = std::max(1l, n / live);
+
+    std::vector<uint32_t> order_idx(live);
+    for (uint32_t i = 0; i < live; ++i) order_idx[i] = i;
+    std::shuffle(order_idx.begin(), order_idx.end(), std::mt19937(1));
+
+    typedef memory::object_pool<order, live, memory::single_thread_pool_policy> st_pool;
+    typedef memory::object_pool<order, live, memory::lock_free_pool_policy>     lf_pool;
+    st_pool sp;
+    lf_pool lp;
+
+    typedef memory::heap_fixed_size_object_pool fixed_pool;
+    std::vector<char> buf(fixed_pool::storage_size<sizeof(order), live+16>::value);
+    fixed_pool& fp = fixed_pool::create(&buf[0], buf.size(), sizeof(order));
+
+    double t_new = bench(order_idx, rounds,
+        [](long i) { return new order(i, 1.0, 1); },
+        [](order* p) { delete p; });
+    double t_fixed = bench(order_idx, rounds,
+        [&](long i) { return new (fp.allocate()) order(i, 1.0, 1); },
+        [&](order* p) { p->~order(); fp.free(p); });
+    double t_st = bench(order_idx, rounds,
+        [&](long i) { return sp.create(i, 1.0, 1); },
+        [&](st_pool::handle h) { sp.destroy(h); });
+    double t_lf = bench(order_idx, rounds,
+        [&](long i) { return lp.create(i, 1.0, 1); },
+        [&](lf_pool::handle h) { lp.destroy(h); });
+
+    BOOST_CHECK_EQUAL(0, order::s_live);
+    BOOST_CHECK_EQUAL(live, sp.unsafe_available());
+    BOOST_CHECK_EQUAL(live, lp.unsafe_available());
+
+    if (verbosity::level() != utxx::VERBOSE_NONE)
+        fprintf(stderr, "  ns per create+destroy of %u live objects:\n"
+                        "    new/delete ...............: %6.1f\n"
+                        "    fixed_size_object_pool ...: %6.1f\n"
+                        "    object_pool (single) .....: %6.1f\n"
+                        "    object_pool (lock-free) ..: %6.1f\n",
+                live, t_new, t_fixed, t_st, t_lf);
+}
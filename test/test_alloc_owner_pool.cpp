@@ -0,0 +1,234 @@
+//----------------------------------------------------------------------------
+/// \file  test_alloc_owner_pool.cpp
+//----------------------------------------------------------------------------
+/// \brief Test cases and benchmarks for alloc_owner_pool.hpp
+//----------------------------------------------------------------------------
+// Copyright (c) 2026 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <utxx/alloc_owner_pool.hpp>
+#include <utxx/alloc_cached.hpp>
+#include <utxx/verbosity.hpp>
+#include <atomic>
+#include <chrono>
+#include <set>
+#include <thread>
+#include <vector>
+
+using namespace utxx;
+
+namespace {
+    struct message {
+        static std::atomic<int> s_live;
+        long seqno;
+        char payload[56];
+        explicit message(long a_seqno) : seqno(a_seqno) { ++s_live; }
+        ~message() { --s_live; }
+    };
+    std::atomic<int> message::s_live(0);
+
+    typedef memory::owner_pool<message, 4096> pool_t;
+}
+
+BOOST_AUTO_TEST_CASE( test_owner_pool_basic )
+{
+    pool_t pool;
+    BOOST_CHECK(pool.is_owner());
+    BOOST_CHECK_EQUAL(0u, pool.pages());
+
+    message* m1 = pool.create(1);
+    message* m2 = pool.create(2);
+    BOOST_CHECK_EQUAL(1u, pool.pages());
+    BOOST_CHECK_EQUAL(1, m1->seqno);
+    BOOST_CHECK_EQUAL(2, m2->seqno);
+    BOOST_CHECK_EQUAL(0u, reinterpret_cast<uintptr_t>(m1) % alignof(message));
+    BOOST_CHECK_EQUAL(2, message::s_live);
+
+    // Owner frees are reused LIFO
+    pool.destroy(m1);
+    BOOST_CHECK_EQUAL(m1, pool.create(3));
+    pool.destroy(m1);
+    pool.destroy(m2);
+    BOOST_CHECK_EQUAL(0, message::s_live);
+
+    // Filling a page moves on to the next one
+    std::vector<message*> v;
+    for (size_t i = 0; i <= pool_t::chunks_per_page(); ++i)
+        v.push_back(pool.allocate());
+    BOOST_CHECK_EQUAL(2u, pool.pages());
+    BOOST_CHECK_EQUAL(v.size(), std::set<message*>(v.begin(), v.end()).size());
+    for (auto p : v)
+        pool.free(p);
+    BOOST_CHECK_EQUAL(0u, pool.drain());
+}
+
+BOOST_AUTO_TEST_CASE( test_owner_pool_remote_free )
+{
+    const int n = 1000;
+    pool_t pool;
+    memory::alloc_stats stats("owner_pool", 2);
+    pool.stats(&stats);
+
+    std::vector<message*> v;
+    for (int i = 0; i < n; ++i)
+        v.push_back(pool.create(i));
+    size_t pages = pool.pages();
+
+    // Two workers release the messages
+    std::thread t1([&]() { for (int i = 0;   i < n/2; ++i) pool.destroy(v[i]); });
+    std::thread t2([&]() { for (int i = n/2; i < n;   ++i) pool.destroy(v[i]); });
+    t1.join();
+    t2.join();
+    BOOST_CHECK_EQUAL(0, message::s_live);
+    BOOST_CHECK(!pool.remote_empty());
+    BOOST_CHECK_EQUAL(0, stats.snapshot(pool_t::object_class).in_use());
+
+    // Reallocation is served from the returned chunks without new pages,
+    // once the rest of the last carved batch is used up
+    std::set<message*> freed(v.begin(), v.end());
+    size_t reused = 0;
+    for (int i = 0; i < n; ++i) {
+        v[i] = pool.allocate();
+        reused += freed.count(v[i]);
+    }
+    BOOST_CHECK(reused + pool_t::refill_batch() > size_t(n));
+    BOOST_CHECK(pool.remote_empty());
+    BOOST_CHECK_EQUAL(pages, pool.pages());
+
+    // The owner only pays for the return queue when it isn't empty
+    {
+        pool_t p2;
+        message* m = p2.allocate();
+        BOOST_CHECK(p2.remote_empty());
+        for (size_t i = 1; i < pool_t::refill_batch(); ++i)
+            BOOST_CHECK(reinterpret_cast<char*>(m) + i*pool_t::chunk_size() ==
+                        reinterpret_cast<char*>(p2.allocate()));
+        p2.remote_free(m);
+        BOOST_CHECK_EQUAL(m, p2.allocate());
+        BOOST_CHECK(p2.remote_empty());
+    }
+
+    std::thread t3([&]() { for (auto p : v) pool.deallocate(p); });
+    t3.join();
+    BOOST_CHECK_EQUAL(size_t(n), pool.drain());
+    BOOST_CHECK_EQUAL(0u, pool.drain());
+
+    auto s = stats.snapshot(pool_t::object_class);
+    BOOST_CHECK_EQUAL(2*n, s.allocs);
+    BOOST_CHECK_EQUAL(2*n, s.frees);
+    BOOST_CHECK_EQUAL(long(pages), stats.snapshot(pool_t::page_class).allocs);
+
+    // Ownership transfer
+    std::thread t4([&]() {
+        pool.claim();
+        BOOST_CHECK(pool.is_owner());
+        pool.free(pool.allocate());
+    });
+    t4.join();
+    BOOST_CHECK(!pool.is_owner());
+    pool.claim();
+}
+
+//----------------------------------------------------------------------------
+// Pipeline: the owner allocates batches of messages that a worker frees
+//----------------------------------------------------------------------------
+namespace {
+    using namespace std::chrono;
+
+    // @return nanoseconds per message
+    template <class Alloc, class Free>
+    double pipeline(long a_count, Alloc&& a_alloc, Free&& a_free)
+    {
+        const int batch = 256;
+        std::atomic<message**> slot(nullptr);
+        std::atomic<bool>      done(false);
+        std::vector<message*>  bufs[2] = { std::vector<message*>(batch),
+                                           std::vector<message*>(batch) };
+
+        std::thread worker([&]() {
+            while (true) {
+                message** b = slot.load(std::memory_order_acquire);
+                if (!b) {
+                    if (done.load(std::memory_order_acquire) && !slot.load())
+                        break;
+                    std::this_thread::yield();
+                    continue;
+                }
+                for (int i = 0; i < batch; ++i)
+                    a_free(b[i]);
+                slot.store(nullptr, std::memory_order_release);
+            }
+        });
+
+        auto t = high_resolution_clock::now();
+        long seqno = 0;
+        for (long n = 0; n < a_count; n += batch) {
+            auto& buf = bufs[(n / batch) & 1];
+            for (int i = 0; i < batch; ++i)
+                buf[i] = a_alloc(seqno++);
+            while (slot.load(std::memory_order_acquire))
+                std::this_thread::yield();
+            slot.store(&buf[0], std::memory_order_release);
+        }
+        while (slot.load(std::memory_order_acquire))
+            std::this_thread::yield();
+        done.store(true, std::memory_order_release);
+        worker.join();
+        return double(duration_cast<nanoseconds>(high_resolution_clock::now() - t).count())
+             / seqno;
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_owner_pool_pipeline )
+{
+    const long n = ::getenv("ITERATIONS") ? atol(::getenv("ITERATIONS")) : 1000000;
+
+    pool_t pool;
+    memory::cached_allocator<char> cached;
+
+    double t_new = pipeline(n,
+        [](long i) { return new message(i); },
+        [](message* p) { delete p; });
+    double t_cached = pipeline(n,
+        [&](long i) { return new (cached.allocate(sizeof(message))) message(i); },
+        [&](message* p) { p->~message(); cached.deallocate(p, sizeof(message)); });
+    double t_owner = pipeline(n,
+        [&](long i) { return pool.create(i); },
+        [&](message* p) { pool.destroy(p); });
+
+    BOOST_CHECK_EQUAL(0, message::s_live);
+    // At most three batches are in flight
+    BOOST_CHECK(pool.pages() <= (3*256) / pool_t::chunks_per_page() + 2);
+
+    if (verbosity::level() != utxx::VERBOSE_NONE)
+        fprintf(stderr, "  ns per message allocated by owner, freed by worker:\n"
+                        "    new/delete ........: %6.1f\n"
+                        "    cached_allocator ..: %6.1f\n"
+                        "    owner_pool ........: %6.1f\n",
+                t_new, t_cached, t_owner);
+}
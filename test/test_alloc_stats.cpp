@@ -0,0 +1,258 @@
+//----------------------------------------------------------------------------
+/// \file  test_alloc_stats.cpp
+//----------------------------------------------------------------------------
+/// \brief Test cases for alloc_stats.hpp
+//----------------------------------------------------------------------------
+// Copyright (c) 2026 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <utxx/alloc_stats.hpp>
+#include <utxx/alloc_cached.hpp>
+#include <utxx/alloc_fixed_page.hpp>
+#include <utxx/alloc_fixed_pool.hpp>
+#include <utxx/allocator.hpp>
+#include <utxx/verbosity.hpp>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace utxx;
+
+BOOST_AUTO_TEST_CASE( test_alloc_stats_counters )
+{
+    memory::alloc_stats s("test", 4);
+    BOOST_CHECK_EQUAL(4u,  s.classes());
+    BOOST_CHECK_EQUAL(8u,  s.class_size(3));
+    BOOST_CHECK_EQUAL(8u,  s.class_size(10));   // clamped to the last class
+
+    for (int i = 0; i < 100; ++i) s.on_alloc(3, 1);
+    for (int i = 0; i < 40;  ++i) s.on_free(3);
+    s.on_alloc(2, 0, true);
+    s.on_exhausted(1, 2);
+    s.on_alloc(100);
+
+    auto c = s.snapshot(3);
+    BOOST_CHECK_EQUAL(101, c.allocs);
+    BOOST_CHECK_EQUAL(40,  c.frees);
+    BOOST_CHECK_EQUAL(61,  c.in_use());
+    BOOST_CHECK_EQUAL(61*8u, c.bytes_in_use());
+    BOOST_CHECK_EQUAL(100, c.retries);
+    BOOST_CHECK_EQUAL(100, c.high_water);       // the 101st came after frees
+
+    for (int i = 0; i < 61; ++i) s.on_free(3);
+    BOOST_CHECK_EQUAL(0,   s.snapshot(3).in_use());
+    BOOST_CHECK_EQUAL(100, s.snapshot(3).high_water);
+
+    auto t = s.total();
+    BOOST_CHECK_EQUAL(102, t.allocs);
+    BOOST_CHECK_EQUAL(2,   t.misses);
+    BOOST_CHECK_EQUAL(102, t.retries);
+    BOOST_CHECK_EQUAL(4u,  t.size);             // one chunk of class 2 in use
+
+    std::string d = s.to_string();
+    BOOST_CHECK(d.find("test statistics") != std::string::npos);
+
+    s.reset();
+    BOOST_CHECK_EQUAL(0, s.total().allocs);
+    BOOST_CHECK_EQUAL(0, s.snapshot(3).high_water);
+
+    memory::alloc_stats f("fixed", {24, 4096});
+    BOOST_CHECK_EQUAL(2u,    f.classes());
+    BOOST_CHECK_EQUAL(4096u, f.class_size(1));
+}
+
+BOOST_AUTO_TEST_CASE( test_alloc_stats_threads )
+{
+    // Counters of all threads are aggregated, including exited threads
+    memory::alloc_stats s("threads", 8);
+    s.latency_sampling(16);
+    std::vector<std::thread> thr;
+    const int n = 10000;
+    for (int t = 0; t < 4; ++t)
+        thr.emplace_back([&s, t]() {
+            for (int i = 0; i < n; ++i) {
+                bool timed = s.sample_start();
+                if (timed) s.sample_stop();
+                s.on_alloc(t);
+                if (i & 1) s.on_free(t);
+            }
+        });
+    for (auto& t : thr) t.join();
+
+    for (int t = 0; t < 4; ++t) {
+        auto c = s.snapshot(t);
+        BOOST_CHECK_EQUAL(n,   c.allocs);
+        BOOST_CHECK_EQUAL(n/2, c.in_use());
+        BOOST_CHECK(c.high_water >= n/2);
+    }
+    BOOST_CHECK_EQUAL(4*n/16, s.latency().count());
+}
+
+BOOST_AUTO_TEST_CASE( test_alloc_stats_cached_allocator )
+{
+    typedef memory::cached_allocator<char> alloc_t;
+    alloc_t a;
+    memory::alloc_stats s("cached");
+    a.stats(&s);
+    BOOST_CHECK_EQUAL(&s, a.stats());
+
+    std::vector<char*> v;
+    for (int i = 0; i < 100; ++i) v.push_back(a.allocate(100));
+    size_t cls = alloc_t::size_class(v[0]);
+    for (auto p : v) a.free(p);
+    for (int i = 0; i < 100; ++i) v[i] = a.allocate(100);
+
+    auto c = s.snapshot(cls);
+    BOOST_CHECK_EQUAL(128u, c.size);
+    BOOST_CHECK_EQUAL(200,  c.allocs);
+    BOOST_CHECK_EQUAL(100,  c.frees);
+    BOOST_CHECK_EQUAL(100,  c.misses);          // second round served from cache
+    BOOST_CHECK_EQUAL(100,  c.high_water);
+    BOOST_CHECK_EQUAL(100*128u, c.bytes_in_use());
+
+    for (auto p : v) a.free(p);
+    BOOST_CHECK_EQUAL(0, s.snapshot(cls).in_use());
+
+    // Per-thread magazines report the same counts
+    memory::cached_allocator<char, std::allocator<char>, 3*sizeof(long), 21,
+                             container::elimination_stack<>, 16> m;
+    memory::alloc_stats ms("magazine");
+    m.stats(&ms);
+    for (int j = 0; j < 3; ++j) {
+        for (int i = 0; i < 100; ++i) v[i] = m.allocate(100);
+        for (auto p : v) m.free(p);
+    }
+    BOOST_CHECK_EQUAL(300, ms.snapshot(cls).allocs);
+    BOOST_CHECK_EQUAL(300, ms.snapshot(cls).frees);
+    BOOST_CHECK_EQUAL(100, ms.snapshot(cls).misses);
+
+    if (verbosity::level() != utxx::VERBOSE_NONE)
+        ms.dump(std::cerr);
+}
+
+BOOST_AUTO_TEST_CASE( test_alloc_stats_fixed_pool )
+{
+    typedef memory::heap_fixed_size_object_pool pool_t;
+    std::vector<char> buf(pool_t::storage_size<32, 16>::value);
+    pool_t& pool = pool_t::create(&buf[0], buf.size(), 32);
+
+    memory::alloc_stats s("pool", {pool.object_size()});
+    std::vector<void*> v;
+    for (void* p; (p = pool.allocate(&s)) != NULL; v.push_back(p));
+
+    auto c = s.snapshot(0);
+    BOOST_CHECK_EQUAL(long(pool.capacity()), c.allocs);
+    BOOST_CHECK_EQUAL(1,  c.misses);            // the exhausted request
+    BOOST_CHECK_EQUAL(long(pool.capacity()), c.high_water);
+    BOOST_CHECK_EQUAL(pool.capacity()*32, c.bytes_in_use());
+
+    for (auto p : v) pool.free(p, &s);
+    pool.free(pool.allocate());                 // stats are optional
+    BOOST_CHECK_EQUAL(0, s.snapshot(0).in_use());
+}
+
+BOOST_AUTO_TEST_CASE( test_alloc_stats_page_allocator )
+{
+    struct obj { char data[1000]; };
+    memory::aligned_page_allocator<obj, 4096> a;
+    memory::alloc_stats s("pages", 2);
+    a.stats(&s);
+    BOOST_CHECK_EQUAL(sizeof(obj), s.class_size(0));
+    BOOST_CHECK_EQUAL(4096u, s.class_size(1));
+
+    std::vector<obj*> v;
+    for (int i = 0; i < 9; ++i) v.push_back(a.allocate(1));
+    auto objs  = s.snapshot(0);
+    auto pages = s.snapshot(1);
+    BOOST_CHECK_EQUAL(9, objs.allocs);
+    // 4 objects per page, the first page is allocated by the constructor
+    BOOST_CHECK_EQUAL(2, objs.misses);
+    BOOST_CHECK_EQUAL(2, pages.allocs);
+
+    for (auto p : v) a.deallocate(p, 1);
+    BOOST_CHECK_EQUAL(0, s.snapshot(0).in_use());
+    BOOST_CHECK_EQUAL(0, s.snapshot(1).in_use());
+}
+
+BOOST_AUTO_TEST_CASE( test_alloc_stats_pow2_allocator )
+{
+    typedef memory::pow2_allocator<> alloc_t;
+    std::vector<char> buf(alloc_t::header_size() + 64*1024);
+    alloc_t a(&buf[0], buf.size(), true);
+    memory::alloc_stats s("pow2");
+    a.stats(&s);
+
+    void* p1 = a.allocate(100);
+    void* p2 = a.allocate(100);
+    a.release(p1);
+    void* p3 = a.allocate(100);
+    BOOST_CHECK_EQUAL(p1, p3);
+    a.release(p2);
+    a.release(p3);
+    BOOST_CHECK(a.allocate(1024*1024) == NULL);
+
+    auto c = s.snapshot(7);
+    BOOST_CHECK_EQUAL(3,   c.allocs);
+    BOOST_CHECK_EQUAL(3,   c.frees);
+    BOOST_CHECK_EQUAL(2,   c.misses);
+    BOOST_CHECK_EQUAL(2,   c.high_water);
+    BOOST_CHECK_EQUAL(1,   s.snapshot(21).misses); // exhausted
+}
+
+BOOST_AUTO_TEST_CASE( test_alloc_stats_overhead )
+{
+    // Cost of statistics on the cached allocator fast path
+    using namespace std::chrono;
+    const long n = ::getenv("ITERATIONS") ? atol(::getenv("ITERATIONS")) : 1000000;
+
+    auto run = [n](memory::alloc_stats* a_stats) {
+        memory::cached_allocator<char> a;
+        a.stats(a_stats);
+        char* p[16];
+        auto t = high_resolution_clock::now();
+        for (long i = 0; i < n; i += 16) {
+            for (auto& x : p) x = a.allocate(64);
+            for (auto& x : p) a.free(x);
+        }
+        return double(duration_cast<nanoseconds>
+            (high_resolution_clock::now() - t).count()) / n;
+    };
+
+    memory::alloc_stats s("overhead"), h("latency");
+    h.latency_sampling(1024);
+    double off = run(NULL), on = run(&s), lat = run(&h);
+    BOOST_CHECK_EQUAL(n / 16 * 16, s.total().allocs);
+    BOOST_CHECK(h.latency().count() > 0);
+
+    if (verbosity::level() != utxx::VERBOSE_NONE) {
+        fprintf(stderr, "  cached_allocator alloc+free: no stats %.1f ns, "
+                        "stats %.1f ns, stats+latency %.1f ns\n", off, on, lat);
+        h.dump(std::cerr);
+    }
+}
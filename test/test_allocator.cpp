@@ -0,0 +1,311 @@
+//----------------------------------------------------------------------------
+/// \file  test_allocator.cpp
+//----------------------------------------------------------------------------
+/// \brief Test cases for allocator.hpp
+//----------------------------------------------------------------------------
+// Copyright (c) 2026 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <utxx/allocator.hpp>
+#include <utxx/verbosity.hpp>
+#include <sys/wait.h>
+#include <signal.h>
+#include <unistd.h>
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+
+using namespace utxx;
+
+BOOST_AUTO_TEST_CASE( test_allocator_shmem_manager )
+{
+    // A copy would unmap the memory twice
+    static_assert(!std::is_copy_constructible<memory::shmem_manager>::value &&
+                  !std::is_copy_assignable<memory::shmem_manager>::value,
+                  "shmem_manager must not be copyable");
+
+    const char* filename = "/tmp/test_shmem_manager.bin";
+    ::unlink(filename);
+    {
+        memory::shmem_manager shm(filename, 1024*1024,
+                                  memory::shmem_manager::TRUNCATE_SHARED_MEMORY,
+                                  true, MAP_POPULATE, memory::huge_pages::TRANSPARENT);
+        BOOST_CHECK(shm.truncated());
+        BOOST_CHECK_EQUAL(1024*1024u, shm.size());
+        BOOST_CHECK(shm.huge() != memory::huge_pages::EXPLICIT);
+
+        char* p = static_cast<char*>(shm.reserve(10));
+        BOOST_REQUIRE(p == shm.address());
+        strcpy(p, "test");
+        char* q = static_cast<char*>(shm.reserve(100));
+        BOOST_CHECK_EQUAL(64, q - p);
+        BOOST_CHECK(!shm.reserve(1024*1024));
+        BOOST_CHECK_EQUAL(1024*1024u - 192, shm.available());
+
+        // Another mapping sees the data
+        memory::shmem_manager att(filename);
+        BOOST_CHECK(!att.truncated());
+        BOOST_CHECK_EQUAL(shm.size(), att.size());
+        BOOST_CHECK_EQUAL("test", att.address());
+    }
+    BOOST_CHECK(::access(filename, F_OK) != 0);
+    BOOST_CHECK_THROW(memory::shmem_manager shm(filename), std::runtime_error);
+}
+
+namespace {
+    typedef memory::pow2_allocator<> pow2_alloc;
+
+    // Gives tests access to the shared mutex to simulate a process that
+    // dies in the middle of an update of a free list
+    struct test_pow2_alloc : public pow2_alloc {
+        test_pow2_alloc(void* a_base, size_t a_size) : pow2_alloc(a_base, a_size) {}
+
+        header& hdr() { return *static_cast<header*>(const_cast<void*>(base_address())); }
+    };
+
+    struct shared_segment {
+        void*  addr;
+        size_t size;
+        explicit shared_segment(size_t a_size) : size(a_size) {
+            addr = ::mmap(NULL, size, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+            BOOST_REQUIRE(addr != MAP_FAILED);
+        }
+        ~shared_segment() { ::munmap(addr, size); }
+    };
+
+    size_t free_chunks(pow2_alloc& a) {
+        size_t n = 0;
+        for (unsigned i = 0; i <= pow2_alloc::max_bucket; ++i)
+            n += a.freelist_size(i);
+        return n;
+    }
+
+    // Allocate and free random chunks until killed
+    void churn(pow2_alloc& a) {
+        srand(getpid());
+        std::vector<char*> v;
+        while (true) {
+            if (v.size() < 64 && (v.empty() || rand() % 2)) {
+                size_t sz = 1 + rand() % 2000;
+                char*  p  = static_cast<char*>(a.allocate(sz));
+                if (p) {
+                    memset(p, 0xAB, sz);
+                    v.push_back(p);
+                }
+            } else {
+                size_t i = rand() % v.size();
+                a.release(v[i]);
+                v[i] = v.back();
+                v.pop_back();
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_allocator_pow2 )
+{
+    shared_segment seg(1024*1024);
+    pow2_alloc a(seg.addr, seg.size, true);
+    BOOST_CHECK_EQUAL(0u, a.used_memory());
+    BOOST_CHECK_EQUAL(16u, pow2_alloc::chunk_header_size());
+
+    void* p1 = a.allocate(100);
+    void* p2 = a.allocate(100);
+    BOOST_CHECK_EQUAL(0u, reinterpret_cast<uintptr_t>(p1) & 15);
+    BOOST_CHECK_EQUAL(128u, pow2_alloc::size_of(p1));
+    BOOST_CHECK_EQUAL(getpid(), pow2_alloc::ptr_to_node(p1)->pid);
+    BOOST_CHECK_EQUAL(256u, a.used_memory());
+    a.release(p1);
+    BOOST_CHECK_EQUAL(1, a.freelist_size(7));
+    BOOST_CHECK_EQUAL(p1, a.allocate(50));
+    BOOST_CHECK_EQUAL(0, a.freelist_size(7));
+    BOOST_CHECK(!a.allocate(2*1024*1024));
+    BOOST_CHECK(a.consistent());
+
+    // Another instance attaches to the formatted segment
+    pow2_alloc b(seg.addr, seg.size);
+    b.release(p2);
+    BOOST_CHECK_EQUAL(1, a.freelist_size(7));
+    BOOST_CHECK_THROW(pow2_alloc(seg.addr, seg.size/2), badarg_error);
+    std::vector<char> junk(4096);
+    BOOST_CHECK_THROW(pow2_alloc(&junk[0], junk.size()), badarg_error);
+
+    // Own chunks are never reclaimed
+    BOOST_CHECK_EQUAL(0u, a.reclaim_resources(getpid()));
+    BOOST_CHECK_EQUAL(0u, a.recover());
+    a.release(p1);
+    BOOST_CHECK(a.consistent());
+}
+
+BOOST_AUTO_TEST_CASE( test_allocator_pow2_dead_owner )
+{
+    shared_segment seg(1024*1024);
+    pow2_alloc a(seg.addr, seg.size, true);
+    void* mine = a.allocate(1000);
+
+    // A child leaks chunks, one of which is adopted by this process
+    void** handed = static_cast<void**>(a.allocate(sizeof(void*)));
+    pid_t pid = fork();
+    if (pid == 0) {
+        for (int i = 0; i < 10; ++i)
+            a.allocate(100 * (i+1));
+        *handed = a.allocate(64);
+        _exit(0);
+    }
+    BOOST_REQUIRE(pid > 0);
+    ::waitpid(pid, NULL, 0);
+    BOOST_CHECK(!pow2_alloc::process_alive(pid));
+    BOOST_CHECK_EQUAL(pid, pow2_alloc::ptr_to_node(*handed)->pid);
+    a.adopt(*handed);
+
+    BOOST_CHECK_EQUAL(0u,  free_chunks(a));
+    BOOST_CHECK_EQUAL(10u, a.recover());
+    BOOST_CHECK_EQUAL(10u, free_chunks(a));
+    BOOST_CHECK_EQUAL(0u,  a.recover());
+    BOOST_CHECK(a.consistent());
+    BOOST_CHECK_EQUAL(getpid(), pow2_alloc::ptr_to_node(mine)->pid);
+
+    // reclaim_resources() reclaims chunks of a given process
+    pid = fork();
+    if (pid == 0) {
+        a.allocate(100);
+        _exit(0);
+    }
+    ::waitpid(pid, NULL, 0);
+    BOOST_CHECK_EQUAL(0u, a.reclaim_resources(pid+1));
+    BOOST_CHECK_EQUAL(1u, a.reclaim_resources(pid));
+    BOOST_CHECK(a.consistent());
+}
+
+BOOST_AUTO_TEST_CASE( test_allocator_pow2_owner_died_holding_lock )
+{
+    shared_segment  seg(1024*1024);
+    pow2_alloc      init(seg.addr, seg.size, true);
+    test_pow2_alloc a(seg.addr, seg.size);
+
+    std::vector<void*> v;
+    for (int i = 0; i < 8; ++i) v.push_back(init.allocate(100));
+    for (auto p : v) init.release(p);
+    BOOST_CHECK_EQUAL(8, init.freelist_size(7));
+
+    // The child dies in the middle of a pop leaving a garbage list head
+    pid_t pid = fork();
+    if (pid == 0) {
+        pthread_mutex_lock(&a.hdr().mutex);
+        a.hdr().freelist[7] = 0x7FFFFFF0;
+        _exit(0);
+    }
+    ::waitpid(pid, NULL, 0);
+
+    BOOST_CHECK_EQUAL(0, init.recoveries());
+    void* p = init.allocate(100);               // Repairs the free lists
+    BOOST_CHECK_EQUAL(1, init.recoveries());
+    BOOST_CHECK(std::find(v.begin(), v.end(), p) != v.end());
+    BOOST_CHECK_EQUAL(7, init.freelist_size(7));
+    BOOST_CHECK(init.consistent());
+    init.release(p);
+
+    // An assigned allocator recovers through itself, not through the
+    // (destroyed) source of the assignment
+    pow2_alloc b(seg.addr, seg.size);
+    {
+        pow2_alloc tmp(seg.addr, seg.size);
+        b = tmp;
+    }
+    pid = fork();
+    if (pid == 0) {
+        pthread_mutex_lock(&a.hdr().mutex);
+        _exit(0);
+    }
+    ::waitpid(pid, NULL, 0);
+    b.release(b.allocate(100));
+    BOOST_CHECK_EQUAL(2, b.recoveries());
+    BOOST_CHECK(b.consistent());
+}
+
+BOOST_AUTO_TEST_CASE( test_allocator_pow2_kill_stress )
+{
+    // Processes allocating and freeing chunks are killed at random points
+    // and replaced, while a supervisor reclaims chunks of dead processes
+    const int rounds   = ::getenv("ITERATIONS") ? atoi(::getenv("ITERATIONS")) : 40;
+    const int children = 3;
+
+    shared_segment seg(16*1024*1024);
+    pow2_alloc a(seg.addr, seg.size, true);
+
+    // Chunks of this process must survive all the recoveries
+    std::vector<char*> mine;
+    for (int i = 0; i < 100; ++i) {
+        char* p = static_cast<char*>(a.allocate(256));
+        memset(p, i, 256);
+        mine.push_back(p);
+    }
+
+    pid_t pids[children];
+    for (auto& pid : pids)
+        if ((pid = fork()) == 0)
+            churn(a);
+
+    srand(1);
+    size_t reclaimed = 0;
+    for (int i = 0; i < rounds; ++i) {
+        ::usleep(rand() % 3000);
+        pid_t& pid = pids[rand() % children];
+        ::kill(pid, SIGKILL);
+        ::waitpid(pid, NULL, 0);
+        reclaimed += a.recover();
+        if ((pid = fork()) == 0)
+            churn(a);
+    }
+
+    for (auto pid : pids) {
+        ::kill(pid, SIGKILL);
+        ::waitpid(pid, NULL, 0);
+    }
+    reclaimed += a.recover();
+    BOOST_CHECK(a.consistent());
+
+    // All chunks except this process's ones are free
+    size_t used = 0;
+    for (auto p : mine) used += pow2_alloc::size_of(p);
+    size_t free_bytes = 0;
+    for (unsigned i = 0; i <= pow2_alloc::max_bucket; ++i)
+        free_bytes += size_t(a.freelist_size(i)) << i;
+    BOOST_CHECK_EQUAL(a.used_memory(), free_bytes + used);
+
+    for (int i = 0; i < 100; ++i)
+        BOOST_REQUIRE_EQUAL(std::string(256, char(i)), std::string(mine[i], 256));
+    for (auto p : mine) a.release(p);
+    BOOST_CHECK(a.consistent());
+
+    if (verbosity::level() != utxx::VERBOSE_NONE)
+        fprintf(stderr, "  %d kills: %lu chunks reclaimed, %ld free list rebuilds, "
+                        "%lu bytes used\n", rounds, reclaimed, a.recoveries(),
+                a.used_memory());
+}
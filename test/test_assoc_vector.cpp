@@ -32,6 +32,11 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <boost/test/unit_test.hpp>
 #include <utxx/container/assoc_vector.hpp>
+#include <utxx/verbosity.hpp>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <random>
 #include <stdio.h>
 
 using namespace std;
@@ -52,3 +57,126 @@ BOOST_AUTO_TEST_CASE( test_assoc_vector )
     it = v.upper_bound(3);
     BOOST_CHECK_EQUAL(4, it->first);
 }
+
+BOOST_AUTO_TEST_CASE( test_assoc_vector_frozen )
+{
+    std::mt19937 rnd(1);
+    std::map<int, int> data;
+    for (int i = 0; data.size() < 5000; ++i)
+        data.emplace(int(rnd() % 1000000) * 2, i);   // even keys only
+
+    for (auto layout : {frozen_layout::EYTZINGER, frozen_layout::BTREE}) {
+        assoc_vector<int, int> v(data.begin(), data.end());
+        assoc_vector<int, int> ref(data.begin(), data.end());
+        v.freeze(layout);
+        BOOST_CHECK(v.frozen());
+        BOOST_CHECK(layout == v.layout());
+        BOOST_CHECK_EQUAL(0u, v.pending());
+
+        for (int i = 0; i < 20000; ++i) {
+            int  k  = rnd() % 2000010 - 5;
+            auto r1 = ref.lower_bound(k);
+            auto r2 = v.lower_bound(k);
+            BOOST_REQUIRE_EQUAL(r1 - ref.begin(), r2 - v.begin());
+            BOOST_REQUIRE_EQUAL(ref.count(k), v.count(k));
+        }
+        for (auto& kv : ref)
+            BOOST_REQUIRE_EQUAL(kv.second, v.find(kv.first)->second);
+
+        // Inserts go to the pending tail until it grows past the limit
+        size_t n = v.size();
+        for (int i = 1; i <= 31; i += 2)
+            BOOST_CHECK(v.insert(std::make_pair(i, -i)).second);
+        BOOST_CHECK(!v.insert(std::make_pair(5, 0)).second);
+        BOOST_CHECK_EQUAL(16u, v.pending());
+        BOOST_CHECK_EQUAL(n + 16, v.size());
+        v[33] = -33;
+        BOOST_CHECK_EQUAL(17u, v.pending());
+        for (int i = 1; i <= 33; i += 2)
+            BOOST_REQUIRE_EQUAL(-i, v.find(i)->second);
+        BOOST_CHECK(v.find(35) == v.end());
+
+        // Const access doesn't merge
+        const auto& cv = v;
+        BOOST_REQUIRE_EQUAL(-33, cv.find(33)->second);
+        BOOST_CHECK_EQUAL(1u, cv.count(1));
+        assoc_vector<int, int> copy(data.begin(), data.end());
+        copy.freeze(layout);
+        for (int i = 1; i <= 33; i += 2)
+            copy[i] = -i;
+        BOOST_CHECK_EQUAL(17u, copy.pending());
+        BOOST_CHECK(cv == copy);
+        BOOST_CHECK(!(cv < copy));
+        BOOST_CHECK_EQUAL(17u, cv.pending());
+        BOOST_CHECK_EQUAL(17u, copy.pending());
+        copy.merge();
+        BOOST_CHECK(cv == copy);
+        BOOST_CHECK(std::is_sorted(copy.cbegin(), copy.cend()));
+        BOOST_CHECK_EQUAL(17u, cv.pending());
+
+        // Ordered access merges
+        BOOST_CHECK(std::is_sorted(v.begin(), v.end()));
+        BOOST_CHECK_EQUAL(0u, v.pending());
+        BOOST_CHECK_EQUAL(-1, v.find(1)->second);
+
+        for (int i = 0; i < 200; ++i)
+            v[2*i+1] = i;
+        BOOST_CHECK(v.pending() <= n / 32);
+
+        // Erasing from a frozen vector
+        int k = v.lower_bound(1000)->first;
+        BOOST_CHECK_EQUAL(1u, v.erase(k));
+        BOOST_CHECK(v.find(k) == v.end());
+        BOOST_CHECK(v.lower_bound(k)->first > k);
+
+        v.thaw();
+        BOOST_CHECK(!v.frozen());
+        BOOST_CHECK(std::is_sorted(v.begin(), v.end()));
+
+        // A thawed vector forgets its frozen range
+        size_t sz = v.size();
+        v.erase(v.begin(), v.begin() + sz/2);
+        v.erase(v.begin() + 1, v.end());
+        BOOST_CHECK_EQUAL(1u, v.size());
+        BOOST_CHECK_EQUAL(0u, v.pending());
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_assoc_vector_frozen_perf )
+{
+    const size_t max_size = ::getenv("MAX_SIZE") ? atoi(::getenv("MAX_SIZE")) : 100000;
+    const size_t lookups  = ::getenv("ITERATIONS") ? atoi(::getenv("ITERATIONS")) : 1000000;
+
+    if (verbosity::level() != utxx::VERBOSE_NONE)
+        fprintf(stderr, "%10s %12s %12s %12s  (ns/lookup)\n",
+                "Size", "sorted", "eytzinger", "btree");
+
+    std::mt19937 rnd(1);
+    long sum = 0;
+
+    for (size_t n = 1000; n <= max_size; n *= 10) {
+        std::map<int64_t, int> data;
+        while (data.size() < n)
+            data.emplace(int64_t(rnd()) << 8, data.size());
+
+        assoc_vector<int64_t, int> v(data.begin(), data.end());
+        std::vector<int64_t> keys(lookups);
+        for (auto& k : keys)
+            k = (v.begin() + rnd() % n)->first;
+
+        double ns[3];
+        int    i = 0;
+        for (auto layout : {frozen_layout::NONE, frozen_layout::EYTZINGER,
+                            frozen_layout::BTREE}) {
+            v.freeze(layout);
+            auto start = std::chrono::high_resolution_clock::now();
+            for (auto k : keys)
+                sum += v.find(k)->second;
+            ns[i++] = double(std::chrono::duration_cast<std::chrono::nanoseconds>
+                (std::chrono::high_resolution_clock::now() - start).count()) / lookups;
+        }
+        if (verbosity::level() != utxx::VERBOSE_NONE)
+            fprintf(stderr, "%10zu %12.1f %12.1f %12.1f\n", n, ns[0], ns[1], ns[2]);
+    }
+    BOOST_CHECK(sum > 0);
+}
@@ -23,6 +23,11 @@
 
 #include <boost/test/auto_unit_test.hpp>
 #include <utxx/atomic_hash_array.hpp>
+#include <utxx/atomic_string_hash_array.hpp>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <thread>
+#include <vector>
 
 #if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
 #define MAP_ANONYMOUS MAP_ANON
@@ -195,3 +200,180 @@ BOOST_AUTO_TEST_CASE( test_atomic_hash_array_insert_erase_i64_str ) {
     test_map<int64_t, string>();
     test_map<int64_t, string, MmapAllocator<char>>();
 }
+
+BOOST_AUTO_TEST_CASE( test_atomic_string_hash_array_insert_erase ) {
+    using MyArr = atomic_string_hash_array<int64_t>;
+    MmapAllocator<char> alloc;
+    auto arr = MyArr::create(150, alloc);
+    map<string, int64_t> ref;
+
+    BOOST_CHECK_EQUAL(256u, arr->capacity());
+    BOOST_CHECK(arr->empty());
+
+    for (int i = 0; i < 100; ++i) {
+        auto k   = "SYM" + to_string(i % 80);
+        auto ret = arr->insert(k, i);
+        BOOST_CHECK_EQUAL(!ref.count(k), ret.second);
+        ref.insert(make_pair(k, i));
+        BOOST_REQUIRE(ret.first);
+        BOOST_CHECK_EQUAL(ref[k], *ret.first);
+        BOOST_CHECK_EQUAL(ref.size(), arr->size());
+    }
+
+    for (int i = 75; i > 0; i -= 10) {
+        auto k = "SYM" + to_string(i);
+        BOOST_CHECK_EQUAL(ref.erase(k), arr->erase(k));
+        BOOST_CHECK_EQUAL(0u, arr->erase(k));
+        BOOST_CHECK(!arr->exists(k));
+    }
+    BOOST_CHECK_EQUAL(ref.size(), arr->size());
+
+    // Re-inserting an erased key uses a new cell
+    BOOST_CHECK(arr->insert("SYM5", 500).second);
+    ref["SYM5"] = 500;
+
+    for (const auto& e : ref) {
+        auto p = arr->find(e.first);
+        BOOST_REQUIRE(p);
+        BOOST_CHECK_EQUAL(e.second, *p);
+        BOOST_CHECK_EQUAL(p, arr->find(e.first.c_str()));
+        BOOST_CHECK_EQUAL(p, arr->find(e.first.c_str(), e.first.size()));
+    }
+    BOOST_CHECK(!arr->find("SYM"));
+    BOOST_CHECK(!arr->find("SYM15X", 5));   // erased
+
+    size_t n = 0;
+    arr->for_each([&](const char* k, size_t len, int64_t& v) {
+        BOOST_CHECK_EQUAL(ref[string(k, len)], v); ++n;
+    });
+    BOOST_CHECK_EQUAL(ref.size(), n);
+
+    arr->clear();
+    BOOST_CHECK(arr->empty());
+    BOOST_CHECK_EQUAL(0u, arr->arena_used());
+    BOOST_CHECK(!arr->find("SYM1"));
+}
+
+BOOST_AUTO_TEST_CASE( test_atomic_string_hash_array_limits ) {
+    // Trivially copyable composite keys
+    struct key { int32_t exch; char sym[12]; };
+    using MyArr = atomic_string_hash_array<string>;
+    std::allocator<char> alloc;
+    {
+        auto arr = MyArr::create(100, alloc);
+        key k1{1, "IBM"}, k2{2, "IBM"};
+        BOOST_CHECK(arr->insert(k1, string("ibm.1")).second);
+        BOOST_CHECK(arr->insert(k2, string("ibm.2")).second);
+        BOOST_CHECK_EQUAL("ibm.1", *arr->find(k1));
+        BOOST_CHECK_EQUAL("ibm.2", *arr->find(k2));
+        BOOST_CHECK_EQUAL(2*sizeof(key), arr->arena_used());
+
+        // Keys longer than 64K are rejected
+        string big(MyArr::max_key_size()+1, 'x');
+        BOOST_CHECK(!arr->insert(big, string()).first);
+    }
+    {
+        // Key arena exhaustion
+        auto arr = MyArr::create(100, alloc, MyArr::config(0.8, 16, 10));
+        BOOST_CHECK(arr->insert("ABCDEFGH", string("a")).second);
+        auto r = arr->insert("IJKLMNOP", string("b"));
+        BOOST_CHECK(!r.first && !r.second);
+        BOOST_CHECK(!arr->exists("IJKLMNOP"));
+        BOOST_CHECK(arr->insert("XY", string("c")).second);
+        BOOST_CHECK_EQUAL(2u, arr->size());
+        BOOST_CHECK_EQUAL(10u, arr->arena_used());
+    }
+    {
+        // Load factor is enforced
+        auto arr = MyArr::create(10, alloc, MyArr::config(0.5));
+        BOOST_CHECK_EQUAL(32u, arr->capacity());
+        size_t i = 0;
+        while (arr->insert(to_string(i), to_string(i)).second) ++i;
+        BOOST_CHECK_EQUAL(arr->max_entries(), i);
+        BOOST_CHECK_EQUAL(16u, i);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_atomic_string_hash_array_aligned_value ) {
+    // Values aligned above the header's alignment are placed aligned
+    struct alignas(64) line { long v; };
+    using MyArr = atomic_string_hash_array<line>;
+    std::allocator<char> alloc;
+    auto arr = MyArr::create(100, alloc);
+    for (int i=0; i < 100; ++i)
+        BOOST_REQUIRE(arr->insert("K" + to_string(i), line{i}).second);
+    for (int i=0; i < 100; ++i) {
+        auto p = arr->find("K" + to_string(i));
+        BOOST_REQUIRE(p);
+        BOOST_CHECK_EQUAL(0u, reinterpret_cast<uintptr_t>(p) % 64);
+        BOOST_CHECK_EQUAL(i, p->v);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_atomic_string_hash_array_shared_memory ) {
+    // The array lives in a MAP_SHARED region: entries inserted by a child
+    // process are visible to the parent
+    using MyArr = atomic_string_hash_array<int>;
+    MmapAllocator<char> alloc;
+    auto arr = MyArr::create(1000, alloc);
+    BOOST_REQUIRE(arr->insert("PARENT", -1).second);
+
+    pid_t pid = fork();
+    BOOST_REQUIRE(pid >= 0);
+    if (pid == 0) {
+        bool ok = arr->exists("PARENT");
+        for (int i=0; i < 500; ++i)
+            ok &= arr->insert("CHILD" + to_string(i), i).second;
+        _exit(ok ? 0 : 1);
+    }
+    int status;
+    BOOST_REQUIRE_EQUAL(pid, waitpid(pid, &status, 0));
+    BOOST_REQUIRE(WIFEXITED(status));
+    BOOST_CHECK_EQUAL(0, WEXITSTATUS(status));
+
+    BOOST_CHECK_EQUAL(501u, arr->size());
+    for (int i=0; i < 500; ++i) {
+        auto p = arr->find("CHILD" + to_string(i));
+        BOOST_REQUIRE(p);
+        BOOST_CHECK_EQUAL(i, *p);
+    }
+    arr.reset();
+}
+
+BOOST_AUTO_TEST_CASE( test_atomic_string_hash_array_concurrent ) {
+    const int threads = 4;
+    const int symbols = ::getenv("ITERATIONS") ? atoi(::getenv("ITERATIONS")) : 20000;
+
+    using MyArr = atomic_string_hash_array<int>;
+    std::allocator<char> alloc;
+    auto arr = MyArr::create(symbols, alloc);
+
+    std::vector<string> keys;
+    for (int i=0; i < symbols; ++i)
+        keys.push_back("INSTR." + to_string(i) + ".XNYS");
+
+    // All threads insert the same keys in a different order, and look up
+    // every key right after inserting it
+    std::vector<int>         wins(threads);
+    std::vector<std::thread> thr;
+    for (int t=0; t < threads; ++t)
+        thr.emplace_back([&, t]() {
+            for (int j=0; j < symbols; ++j) {
+                int  i = (j * 7 + t * symbols / threads) % symbols;
+                auto r = arr->insert(keys[i], i);
+                wins[t] += r.second;
+                BOOST_REQUIRE(r.first);
+                auto p = arr->find(keys[i]);
+                BOOST_REQUIRE(p == r.first);
+                BOOST_REQUIRE_EQUAL(i, *p);
+            }
+        });
+    for (auto& t : thr) t.join();
+
+    int total = 0;
+    for (auto n : wins) total += n;
+    BOOST_CHECK_EQUAL(symbols, total);
+    BOOST_CHECK_EQUAL(size_t(symbols), arr->size());
+    for (int i=0; i < symbols; ++i)
+        BOOST_REQUIRE_EQUAL(i, *arr->find(keys[i]));
+}
@@ -16,6 +16,7 @@
 
 #include <utxx/test_helper.hpp>
 #include <utxx/atomic_hash_map.hpp>
+#include <utxx/growable_atomic_hash_map.hpp>
 #include <utxx/string.hpp>
 #include <utxx/cpu.hpp>
 #include <boost/lexical_cast.hpp>
@@ -593,3 +594,208 @@ BOOST_AUTO_TEST_CASE( test_atomic_hash_map_atomic_hash_array_insert_race) {
             BOOST_CHECK_EQUAL(arr->size(), uintptr_t(statuses[j]));
     }
 }
+
+//-----------------------------------------------------------------------------
+// growable_atomic_hash_map
+//-----------------------------------------------------------------------------
+
+using GAHM = utxx::growable_atomic_hash_map<int64_t, int64_t>;
+
+BOOST_AUTO_TEST_CASE( test_growable_atomic_hash_map_basic ) {
+    GAHM m(16);
+    int64_t v;
+
+    BOOST_CHECK_EQUAL(64u, m.capacity());
+    BOOST_CHECK(m.insert(1, 10));
+    BOOST_CHECK(!m.insert(1, 11));     // doesn't overwrite
+    BOOST_CHECK(m.find(1, v));
+    BOOST_CHECK_EQUAL(10, v);
+    BOOST_CHECK(!m.find(2, v));
+    BOOST_CHECK_EQUAL(1u, m.erase(1));
+    BOOST_CHECK_EQUAL(0u, m.erase(1));
+    BOOST_CHECK(!m.exists(1));
+    BOOST_CHECK(m.insert(1, 12));      // re-insert after erase
+    BOOST_CHECK(m.find(1, v));
+    BOOST_CHECK_EQUAL(12, v);
+    BOOST_CHECK_EQUAL(1u, m.size());
+
+    // Grow well past the initial capacity
+    const int64_t n = 100000;
+    for (int64_t i = 2; i < n; ++i)
+        BOOST_REQUIRE(m.insert(i, genVal(i)));
+    BOOST_CHECK(m.resizes() >= 10);
+    BOOST_CHECK_EQUAL(size_t(n-1), m.size());
+    BOOST_CHECK(m.capacity() >= size_t(n / 0.8));
+    for (int64_t i = 2; i < n; ++i) {
+        BOOST_REQUIRE(m.find(i, v));
+        BOOST_REQUIRE_EQUAL(genVal(i), v);
+    }
+
+    size_t count = 0;
+    m.for_each([&](int64_t k, int64_t v) { count += (k == 1 ? v == 12 : v == genVal(k)); });
+    BOOST_CHECK_EQUAL(size_t(n-1), count);
+
+    auto st = m.stats();
+    BOOST_CHECK_EQUAL(size_t(n-1), st.size);
+    BOOST_CHECK_EQUAL(0u, st.tombstones);
+    BOOST_TEST_MESSAGE("Probe length avg=" << st.avg << " max=" << st.max);
+}
+
+// Keep a sliding window of live keys: insert a new key and erase the oldest
+// one. atomic_hash_map never reuses erased cells, while the growable map
+// compacts tombstones during migrations and keeps both the capacity and
+// the probe lengths flat.
+BOOST_AUTO_TEST_CASE( test_growable_atomic_hash_map_churn ) {
+    const int64_t window = get_opt<int64_t>("window", 10000);
+    const int     rounds = get_opt<int>    ("rounds", 20);
+
+    GAHM    m(window);
+    size_t  max_cap = 0;
+    int64_t next    = 0;
+    int64_t v;
+
+    for (int64_t i = 0; i < window; ++i)
+        m.insert(next++, i);
+
+    for (int r = 0; r < rounds; ++r) {
+        auto start = nowInUsec();
+        for (int64_t i = 0; i < window; ++i) {
+            BOOST_REQUIRE(m.insert(next, next));
+            BOOST_REQUIRE_EQUAL(1u, m.erase(next - window));
+            ++next;
+        }
+        auto elapsed = nowInUsec() - start;
+        auto st      = m.stats();
+        max_cap      = std::max(max_cap, st.capacity);
+
+        BOOST_REQUIRE_EQUAL(size_t(window), m.size());
+        BOOST_REQUIRE(st.avg < 4.0);
+        BOOST_TEST_MESSAGE("Round " << r << ": capacity=" << st.capacity
+            << " tombstones=" << st.tombstones << " probe avg=" << st.avg
+            << " max=" << st.max << " resizes=" << m.resizes()
+            << " usec/op=" << double(elapsed) / (2*window));
+    }
+    // Never grows beyond what a window needs
+    BOOST_CHECK(max_cap <= 8 * size_t(window));
+    BOOST_REQUIRE(m.find(next-1, v));
+    BOOST_REQUIRE(!m.find(next-window-1, v));
+
+    // The same churn keeps growing atomic_hash_map until it's full (a smaller
+    // window is used as the cost of its operations grows with the number of
+    // submaps)
+    const int64_t ahm_window = std::max<int64_t>(100, window / 10);
+    AHMapT ahm(ahm_window);
+    int    full_round = -1;
+    next = 0;
+    try {
+        for (int r = 0; r < rounds; ++r, full_round = r)
+            for (int64_t i = 0; i < ahm_window; ++i, ++next) {
+                ahm.insert(RecordT(KeyT(next), 0));
+                if (next >= ahm_window) ahm.erase(KeyT(next - ahm_window));
+            }
+        full_round = -1;
+    } catch (utxx::atomic_hash_map_full_error&) {}
+    BOOST_TEST_MESSAGE("atomic_hash_map (window=" << ahm_window << "): capacity="
+                       << ahm.capacity() << " submaps=" << ahm.num_submaps()
+                       << (full_round < 0 ? "" : " full at round ")
+                       << (full_round < 0 ? "" : std::to_string(full_round)));
+}
+
+BOOST_AUTO_TEST_CASE( test_growable_atomic_hash_map_concurrent ) {
+    for (bool background : {false, true}) {
+        GAHM::config cfg;
+        cfg.m_background = background;
+        cfg.m_chunk_size = 64;
+        GAHM m(1000, cfg);
+
+        // Stable keys must stay visible while the table is being migrated
+        const int64_t stable   = 1000;
+        const int64_t per_thr  = get_opt<int64_t>("per-thread", 20000);
+        const int     writers  = std::max(2, numThreads);
+        for (int64_t i = 0; i < stable; ++i)
+            m.insert(-100 - i, i);
+
+        std::atomic<bool>        done(false);
+        std::atomic<long>        misses(0);
+        std::vector<std::thread> threads;
+
+        threads.emplace_back([&]() {
+            int64_t v;
+            while (!done.load(std::memory_order_relaxed))
+                for (int64_t i = 0; i < stable; ++i)
+                    if (!m.find(-100 - i, v) || v != i)
+                        ++misses;
+        });
+
+        std::vector<std::thread> wthreads;
+        for (int t = 0; t < writers; ++t)
+            wthreads.emplace_back([&, t]() {
+                // Insert a range, erase every other key, insert duplicates
+                int64_t base = int64_t(t) * per_thr;
+                for (int64_t i = 0; i < per_thr; ++i)
+                    BOOST_REQUIRE(m.insert(base + i, genVal(base + i)));
+                for (int64_t i = 0; i < per_thr; i += 2)
+                    BOOST_REQUIRE_EQUAL(1u, m.erase(base + i));
+                for (int64_t i = 1; i < per_thr; i += 2)
+                    BOOST_REQUIRE(!m.insert(base + i, 0));
+            });
+        for (auto& t : wthreads) t.join();
+        done = true;
+        for (auto& t : threads) t.join();
+
+        BOOST_CHECK_EQUAL(0, misses.load());
+        BOOST_CHECK_EQUAL(size_t(stable + writers * per_thr / 2), m.size());
+        int64_t v;
+        for (int64_t i = 0; i < writers * per_thr; ++i) {
+            bool found = m.find(i, v);
+            BOOST_REQUIRE_EQUAL(found, (i % per_thr) % 2 == 1);
+            if (found) BOOST_REQUIRE_EQUAL(genVal(i), v);
+        }
+        BOOST_TEST_MESSAGE("Background=" << background << " resizes=" << m.resizes()
+                           << " capacity=" << m.capacity());
+    }
+}
+
+// A migration into a smaller table that is being filled by new inserts
+// faster than the old table is migrated: the target overflows and must
+// forward the remaining keys to a larger table
+BOOST_AUTO_TEST_CASE( test_growable_atomic_hash_map_target_overflow ) {
+    GAHM::config cfg;
+    cfg.m_chunk_size = 1;
+    GAHM m(64, cfg);
+    int64_t v;
+
+    const int64_t n = 20000;
+    for (int64_t i = 0; i < n; ++i)
+        BOOST_REQUIRE(m.insert(i, genVal(i)));
+    for (int64_t i = 0; i < n; ++i)
+        if (i % 20)
+            BOOST_REQUIRE_EQUAL(1u, m.erase(i));
+
+    // Fill the table with tombstones until a migration starts, which will
+    // shrink the table to fit the remaining live keys
+    int64_t next = n;
+    while (!m.migrating()) {
+        BOOST_REQUIRE(m.insert(next, 0));
+        BOOST_REQUIRE_EQUAL(1u, m.erase(next++));
+    }
+    auto resizes = m.resizes();
+    auto first   = next;
+
+    // Each insert migrates one cell of the old table
+    for (; next < 8*n; ++next) {
+        BOOST_REQUIRE(m.insert(next, genVal(next)));
+        if (m.resizes() > resizes + 1) break;
+    }
+    BOOST_CHECK(m.resizes() > resizes + 1);
+
+    BOOST_CHECK_EQUAL(size_t(n / 20 + next + 1 - first), m.size());
+    for (int64_t i = 0; i < n; i += 20) {
+        BOOST_REQUIRE(m.find(i, v));
+        BOOST_REQUIRE_EQUAL(genVal(i), v);
+    }
+    for (int64_t i = first; i <= next; ++i) {
+        BOOST_REQUIRE(m.find(i, v));
+        BOOST_REQUIRE_EQUAL(genVal(i), v);
+    }
+}
@@ -33,7 +33,12 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <boost/test/unit_test.hpp>
 #include <utxx/bitmap.hpp>
+#include <utxx/verbosity.hpp>
+#include <chrono>
 #include <limits>
+#include <random>
+#include <thread>
+#include <vector>
 
 using namespace utxx;
 
@@ -334,3 +339,185 @@ BOOST_AUTO_TEST_CASE( test_bitmap_mid )
     BOOST_REQUIRE_EQUAL((int)bm.end(),   bm.prev(3));
 }
 
+
+BOOST_AUTO_TEST_CASE( test_bitmap_hierarchical )
+{
+    hierarchical_bitmap<> bm(1000000);
+
+    BOOST_REQUIRE_EQUAL(4,        bm.levels());
+    BOOST_REQUIRE_EQUAL(1000000u, bm.size());
+    BOOST_REQUIRE(bm.empty());
+    BOOST_REQUIRE_EQUAL(bm.end(), bm.first());
+    BOOST_REQUIRE_EQUAL(bm.end(), bm.last());
+    BOOST_REQUIRE_EQUAL(0u,       bm.next_clear());
+
+    bm.set(3);
+    bm.set(999999);
+    bm.set(500000);
+
+    BOOST_REQUIRE(!bm.empty());
+    BOOST_REQUIRE(bm[500000]);
+    BOOST_REQUIRE(!bm[500001]);
+    BOOST_REQUIRE_EQUAL(3u,       bm.count());
+    BOOST_REQUIRE_EQUAL(3u,       bm.first());
+    BOOST_REQUIRE_EQUAL(999999u,  bm.last());
+    BOOST_REQUIRE_EQUAL(500000u,  bm.next(3));
+    BOOST_REQUIRE_EQUAL(999999u,  bm.next(500000));
+    BOOST_REQUIRE_EQUAL(bm.end(), bm.next(999999));
+    BOOST_REQUIRE_EQUAL(500000u,  bm.prev(999999));
+    BOOST_REQUIRE_EQUAL(3u,       bm.prev(500000));
+    BOOST_REQUIRE_EQUAL(bm.end(), bm.prev(3));
+    BOOST_REQUIRE(bm.any(4, 500001));
+    BOOST_REQUIRE(!bm.any(4, 500000));
+
+    bm.clear(500000);
+    BOOST_REQUIRE_EQUAL(999999u,  bm.next(3));
+
+    // Ranges crossing word and summary word boundaries
+    bm.set(100, 300000);
+    BOOST_REQUIRE_EQUAL(300000u - 100 + 2, bm.count());
+    BOOST_REQUIRE_EQUAL(299900u,  bm.count(100, 300000));
+    BOOST_REQUIRE_EQUAL(5u,       bm.count(95, 105));
+    BOOST_REQUIRE_EQUAL(4u,       bm.next_clear(3));
+    BOOST_REQUIRE_EQUAL(300000u,  bm.next_clear(100));
+    BOOST_REQUIRE_EQUAL(300000u,  bm.next_clear(250000));
+
+    bm.clear(64, 299990);
+    BOOST_REQUIRE_EQUAL(3u,       bm.first());
+    BOOST_REQUIRE_EQUAL(299990u,  bm.next(3));
+    BOOST_REQUIRE_EQUAL(3u,       bm.prev(299990));
+    BOOST_REQUIRE_EQUAL(12u,      bm.count());
+
+    bm.fill();
+    BOOST_REQUIRE_EQUAL(1000000u, bm.count());
+    BOOST_REQUIRE_EQUAL(bm.end(), bm.next_clear());
+    bm.clear(0, bm.size());
+    BOOST_REQUIRE(bm.empty());
+
+    hierarchical_bitmap<> small(1);
+    BOOST_REQUIRE_EQUAL(1, small.levels());
+    small.set(0);
+    BOOST_REQUIRE_EQUAL(0u, small.first());
+    BOOST_REQUIRE_EQUAL(0u, small.last());
+    BOOST_REQUIRE_EQUAL(small.end(), small.next(0));
+    BOOST_REQUIRE_EQUAL(small.end(), small.next_clear());
+
+    hierarchical_bitmap<> none;
+    BOOST_REQUIRE(none.empty());
+    BOOST_REQUIRE_EQUAL(none.end(), none.first());
+    BOOST_REQUIRE_EQUAL(none.end(), none.last());
+    BOOST_REQUIRE_EQUAL(0u,         none.count());
+}
+
+BOOST_AUTO_TEST_CASE( test_bitmap_hierarchical_random )
+{
+    // Random single bit and range updates checked against std::vector<bool>
+    const size_t n = 300000;
+    std::mt19937 rnd(1);
+    hierarchical_bitmap<>        bm(n);
+    atomic_hierarchical_bitmap   abm(n);
+    std::vector<bool>            ref(n);
+
+    auto next = [&](size_t i) { while (i < n && !ref[i]) ++i; return i; };
+    auto prev = [&](size_t i) { while (i-- > 0) if (ref[i]) return i; return n; };
+
+    for (int k = 0; k < 2000; ++k) {
+        size_t a = rnd() % n;
+        size_t b = std::min(n, a + (rnd() % 4 == 0 ? rnd() % 70000 : rnd() % 200));
+        switch (rnd() % 4) {
+            case 0: bm.set(a);      abm.set(a);      ref[a] = true;  break;
+            case 1: bm.clear(a);    abm.clear(a);    ref[a] = false; break;
+            case 2: bm.set(a, b);   abm.set(a, b);
+                    std::fill(ref.begin()+a, ref.begin()+b, true);   break;
+            case 3: bm.clear(a, b); abm.clear(a, b);
+                    std::fill(ref.begin()+a, ref.begin()+b, false);  break;
+        }
+        size_t c = rnd() % n;
+        BOOST_REQUIRE_EQUAL(next(c+1),   bm.next(c));
+        BOOST_REQUIRE_EQUAL(next(c+1),   abm.next(c));
+        BOOST_REQUIRE_EQUAL(prev(c),     bm.prev(c));
+        BOOST_REQUIRE_EQUAL(prev(c),     abm.prev(c));
+        BOOST_REQUIRE_EQUAL(next(0),     bm.first());
+        BOOST_REQUIRE_EQUAL(prev(n),     bm.last());
+        size_t z = c;
+        while (z < n && ref[z]) ++z;
+        BOOST_REQUIRE_EQUAL(z,           bm.next_clear(c));
+        BOOST_REQUIRE_EQUAL(z,           abm.next_clear(c));
+        size_t lo = std::min(a, c), hi = std::max(a, c);
+        BOOST_REQUIRE_EQUAL(size_t(std::count(ref.begin()+lo, ref.begin()+hi, true)),
+                            bm.count(lo, hi));
+    }
+    BOOST_REQUIRE_EQUAL(size_t(std::count(ref.begin(), ref.end(), true)), bm.count());
+    BOOST_REQUIRE_EQUAL(bm.count(), abm.count());
+}
+
+BOOST_AUTO_TEST_CASE( test_bitmap_hierarchical_concurrent )
+{
+    // Each thread sets and clears its own interleaved bits, so summary words
+    // are shared between threads
+    const int    threads = 4;
+    const size_t n       = 1 << 20;
+    atomic_hierarchical_bitmap bm(n);
+
+    std::vector<std::thread> v;
+    for (int t = 0; t < threads; ++t)
+        v.emplace_back([&, t]() {
+            std::mt19937 rnd(t);
+            for (int k = 0; k < 200000; ++k) {
+                size_t i = (rnd() % (n / threads)) * threads + t;
+                if (k & 1) bm.clear(i); else bm.set(i);
+            }
+            // Leave every 4096th bit of this thread set
+            for (size_t i = t; i < n; i += threads)
+                if (i % 4096 == size_t(t)) bm.set(i); else bm.clear(i);
+        });
+    for (auto& t : v) t.join();
+
+    size_t cnt = 0;
+    for (size_t i = bm.first(); i != bm.end(); i = bm.next(i), ++cnt)
+        BOOST_REQUIRE_LT(i % 4096, size_t(threads));
+    BOOST_REQUIRE_EQUAL(n / 4096 * threads, cnt);
+    BOOST_REQUIRE_EQUAL(cnt, bm.count());
+}
+
+BOOST_AUTO_TEST_CASE( test_bitmap_hierarchical_perf )
+{
+    // Gap tracking over a sequence number window: bits of missing sequence
+    // numbers are set, and gaps are enumerated by scanning for set bits
+    const size_t n    = getenv("ITERATIONS") ? atoi(getenv("ITERATIONS")) : 16 << 20;
+    const size_t gaps = 1000;
+    using namespace std::chrono;
+
+    std::mt19937 rnd(1);
+    hierarchical_bitmap<> bm(n);
+    std::vector<bool>     ref(n);
+    for (size_t i = 0; i < gaps; ++i) {
+        size_t k = rnd() % n;
+        bm.set(k);
+        ref[k] = true;
+    }
+
+    auto   t = high_resolution_clock::now();
+    size_t c1 = 0;
+    for (size_t i = bm.first(); i != bm.end(); i = bm.next(i)) ++c1;
+    double d1 = duration_cast<microseconds>(high_resolution_clock::now() - t).count();
+
+    t = high_resolution_clock::now();
+    size_t c2 = 0;
+    for (size_t i = 0; i < n; ++i) c2 += ref[i];
+    double d2 = duration_cast<microseconds>(high_resolution_clock::now() - t).count();
+
+    t = high_resolution_clock::now();
+    bm.set(0, n);
+    bm.clear(n / 4, n / 2);
+    size_t c3 = bm.count();
+    double d3 = duration_cast<microseconds>(high_resolution_clock::now() - t).count();
+
+    BOOST_REQUIRE_EQUAL(c1, c2);
+    BOOST_REQUIRE_EQUAL(n - (n/2 - n/4), c3);
+
+    if (verbosity::level() != utxx::VERBOSE_NONE)
+        fprintf(stderr, "Gap scan of %lu bits (%lu gaps): hierarchical_bitmap %.0fus, "
+                "per-bit loop %.0fus; range set+clear+count %.0fus\n",
+                n, c1, d1, d2, d3);
+}
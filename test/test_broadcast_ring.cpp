@@ -0,0 +1,286 @@
+//----------------------------------------------------------------------------
+/// \file  test_broadcast_ring.cpp
+//----------------------------------------------------------------------------
+/// \brief This is a test file for validating broadcast_ring.hpp functionality.
+//----------------------------------------------------------------------------
+// Copyright (c) 2026 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <utxx/broadcast_ring.hpp>
+#include <utxx/verbosity.hpp>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace utxx;
+
+namespace {
+    using ring   = broadcast_ring<long, 4>;
+    using result = ring::read_result;
+
+    struct ring_deleter {
+        void operator()(ring* p) { ring::destroy(p); }
+    };
+    using ring_ptr = std::unique_ptr<ring, ring_deleter>;
+}
+
+BOOST_AUTO_TEST_CASE( test_broadcast_ring_basic )
+{
+    ring_ptr r(ring::create(3));
+
+    BOOST_CHECK_EQUAL(4u, r->capacity());
+    BOOST_CHECK_EQUAL(0u, r->total_count());
+    BOOST_CHECK(!r->is_externally_allocated());
+
+    ring::subscriber s1(*r), s2(*r);
+    BOOST_CHECK_EQUAL(0, s1.id());
+    BOOST_CHECK_EQUAL(1, s2.id());
+
+    long v = 0;
+    BOOST_CHECK(result::EMPTY == s1.read(v));
+
+    BOOST_CHECK(r->try_publish(10));
+    BOOST_CHECK(r->try_publish_with([](long& a) { a = 20; }));
+    BOOST_CHECK_EQUAL(2u, r->total_count());
+    BOOST_CHECK_EQUAL(2u, s1.available());
+
+    // Each subscriber sees the full stream
+    for (auto* s : {&s1, &s2}) {
+        BOOST_CHECK(result::OK == s->read(v)); BOOST_CHECK_EQUAL(10, v);
+        BOOST_CHECK(result::OK == s->read(v)); BOOST_CHECK_EQUAL(20, v);
+        BOOST_CHECK(result::EMPTY == s->read(v));
+        BOOST_CHECK_EQUAL(2u, s->cursor());
+        BOOST_CHECK_EQUAL(0u, s->overruns());
+    }
+
+    // A late subscriber only sees new items
+    ring::subscriber s3(*r);
+    BOOST_CHECK(result::EMPTY == s3.read(v));
+    r->publish(30);
+    BOOST_CHECK(result::OK == s3.read(v)); BOOST_CHECK_EQUAL(30, v);
+
+    {
+        ring::subscriber s4(*r);
+        BOOST_CHECK_EQUAL(3, s4.id());
+        BOOST_CHECK_EQUAL(-1, r->subscribe());
+    }
+    BOOST_CHECK(ring::reader_state::FREE == r->state(3));
+}
+
+BOOST_AUTO_TEST_CASE( test_broadcast_ring_overrun )
+{
+    ring_ptr r(ring::create(4));
+    ring::subscriber s(*r);
+
+    for (long i=0; i < 10; ++i)
+        r->publish(i);
+
+    // Items 0..5 were overwritten, 6..9 are still in the ring
+    long v = -1;
+    BOOST_CHECK(result::OVERRUN == s.read(v));
+    BOOST_CHECK_EQUAL(6u, s.overruns());
+    BOOST_CHECK_EQUAL(6u, s.cursor());
+
+    for (long i=6; i < 10; ++i) {
+        BOOST_CHECK(result::OK == s.read(v));
+        BOOST_CHECK_EQUAL(i, v);
+    }
+    BOOST_CHECK(result::EMPTY == s.read(v));
+    BOOST_CHECK_EQUAL(6u, s.overruns());
+}
+
+BOOST_AUTO_TEST_CASE( test_broadcast_ring_gating )
+{
+    ring_ptr r(ring::create(4));
+    ring::subscriber fast(*r);
+    ring::subscriber slow(*r, true);
+
+    for (long i=0; i < 4; ++i)
+        BOOST_CHECK(r->try_publish(i));
+
+    // The gating subscriber hasn't consumed anything yet
+    BOOST_CHECK(!r->try_publish(4));
+
+    long v;
+    BOOST_CHECK(result::OK == slow.read(v));
+    BOOST_CHECK_EQUAL(0, v);
+    BOOST_CHECK(r->try_publish(4));
+    BOOST_CHECK(!r->try_publish(5));
+
+    // The non-gating subscriber is lapped by one item
+    BOOST_CHECK(result::OVERRUN == fast.read(v));
+    BOOST_CHECK_EQUAL(1u, fast.overruns());
+    for (long i=1; i < 5; ++i) {
+        BOOST_CHECK(result::OK == fast.read(v));
+        BOOST_CHECK_EQUAL(i, v);
+    }
+
+    // Evicting the gating subscriber releases the publisher
+    r->unsubscribe(slow.id());
+    BOOST_CHECK(r->try_publish(5));
+}
+
+BOOST_AUTO_TEST_CASE( test_broadcast_ring_external_memory )
+{
+    size_t sz = ring::memory_size(8);
+    std::unique_ptr<char[]> mem(new char[sz]);
+
+    // Simulate two processes mapping the same memory
+    ring* pub = ring::create(8, mem.get(), sz, true);
+    ring* sub = ring::create(8, mem.get(), sz, false);
+
+    BOOST_CHECK(pub->is_externally_allocated());
+    BOOST_CHECK_THROW(ring::create(16, mem.get(), sz, false), badarg_error);
+
+    int id = sub->subscribe();
+    BOOST_REQUIRE(id >= 0);
+    pub->publish(123);
+
+    long v;
+    BOOST_CHECK(result::OK == sub->read(id, v));
+    BOOST_CHECK_EQUAL(123, v);
+
+    ring::destroy(sub);
+    ring::destroy(pub);
+    BOOST_CHECK(!pub);
+}
+
+BOOST_AUTO_TEST_CASE( test_broadcast_ring_subscribe_while_publishing )
+{
+    using bring = broadcast_ring<long, 2>;
+    const int rounds = ::getenv("ITERATIONS")
+                     ? atoi(::getenv("ITERATIONS")) / 100 : 1000;
+
+    std::unique_ptr<bring, void(*)(bring*)> r
+        (bring::create(4), [](bring* p) { bring::destroy(p); });
+
+    // The publisher stores the sequence number in each item
+    std::atomic<bool> done(false);
+    std::thread publisher([&]() {
+        for (long i=0; !done.load(std::memory_order_relaxed);)
+            if (r->try_publish(i))
+                ++i;
+            else
+                std::this_thread::yield();
+    });
+
+    // A gating subscriber registered while the publisher is running must
+    // never be lapped
+    long overruns = 0, mismatches = 0;
+    for (int n=0; n < rounds; ++n) {
+        int id = r->subscribe(true);
+        BOOST_REQUIRE(id >= 0);
+        for (int k=0; k < 16;) {
+            uint64_t cur = r->cursor(id);
+            long     v;
+            auto     res = r->read(id, v);
+            if (res == bring::read_result::OK) {
+                if (uint64_t(v) != cur) ++mismatches;
+                ++k;
+            } else if (res == bring::read_result::OVERRUN) {
+                ++overruns;
+                break;
+            } else
+                std::this_thread::yield();
+        }
+        r->unsubscribe(id);
+    }
+
+    done = true;
+    publisher.join();
+
+    BOOST_CHECK_EQUAL(0, overruns);
+    BOOST_CHECK_EQUAL(0, mismatches);
+}
+
+BOOST_AUTO_TEST_CASE( test_broadcast_ring_concurrent )
+{
+    using bring = broadcast_ring<long, 8>;
+    const long iterations = ::getenv("ITERATIONS")
+                          ? atol(::getenv("ITERATIONS")) : 100000;
+    const int  readers    = 3;
+
+    std::unique_ptr<bring, void(*)(bring*)> r
+        (bring::create(1024), [](bring* p) { bring::destroy(p); });
+
+    // Subscriber 0 gates the publisher, so it must see every item
+    int ids[readers];
+    for (int i=0; i < readers; ++i)
+        ids[i] = r->subscribe(i == 0);
+
+    long sums[readers]   = {0};
+    long counts[readers] = {0};
+    bool ordered[readers];
+
+    std::vector<std::thread> threads;
+    for (int i=0; i < readers; ++i) {
+        ordered[i] = true;
+        threads.emplace_back([&, i]() {
+            long v, last = -1;
+            while (last < iterations-1) {
+                auto res = r->read(ids[i], v);
+                if (res == bring::read_result::OK) {
+                    if (v <= last) ordered[i] = false;
+                    sums[i] += v; ++counts[i]; last = v;
+                } else if (res == bring::read_result::OVERRUN)
+                    continue;
+                else if (r->total_count() == uint64_t(iterations)
+                      && r->available(ids[i]) == 0)
+                    break;
+            }
+        });
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (long i=0; i < iterations; ++i)
+        r->publish(i);
+
+    for (auto& t : threads)
+        t.join();
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>
+                   (std::chrono::high_resolution_clock::now() - start).count();
+
+    BOOST_CHECK_EQUAL(iterations*(iterations-1)/2, sums[0]);
+    BOOST_CHECK_EQUAL(iterations, counts[0]);
+    BOOST_CHECK_EQUAL(0u, r->overruns(ids[0]));
+
+    for (int i=0; i < readers; ++i) {
+        BOOST_CHECK(ordered[i]);
+        BOOST_CHECK_EQUAL(uint64_t(iterations),
+                          uint64_t(counts[i]) + r->overruns(ids[i]));
+        if (verbosity::level() > VERBOSE_NONE)
+            fprintf(stderr, "  reader %d: received=%ld, overruns=%lu\n",
+                    i, counts[i], r->overruns(ids[i]));
+    }
+
+    if (verbosity::level() > VERBOSE_NONE)
+        fprintf(stderr, "  broadcast_ring: %ld items to %d readers in %ldms\n",
+                iterations, readers, elapsed);
+}
@@ -39,6 +39,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 #endif
 #include <boost/timer.hpp>
 #include <utxx/container/clustered_map.hpp>
+#include <utxx/verbosity.hpp>
+#include <chrono>
+#include <deque>
 
 #if __cplusplus >= 201103L
 #include <random>
@@ -192,3 +195,148 @@ BOOST_AUTO_TEST_CASE( test_clustered_map ) {
 }
 
 
+
+#ifndef UTXX_STANDALONE
+
+BOOST_AUTO_TEST_CASE( test_clustered_map_flat ) {
+    typedef utxx::flat_clustered_map<size_t, int, 20> fmap;
+    fmap m(1000);
+    static const int s_data[][2] = {
+        {1001, 10}, {1002, 20}, {1003, 30},
+        {1065, 40}, {1066, 50}, {1067, 60},
+        {1129, 70}
+    };
+
+    BOOST_REQUIRE(m.empty());
+    BOOST_REQUIRE(m.begin() == m.end());
+    BOOST_REQUIRE_EQUAL(1u << 20, fmap::capacity());
+
+    for (size_t i=0; i < sizeof(s_data)/sizeof(s_data[0]); i++)
+        m.insert(s_data[i][0], s_data[i][1]);
+
+    BOOST_REQUIRE_EQUAL(3u, m.group_count());
+    BOOST_REQUIRE_EQUAL(3u, m.item_count(1001));
+    BOOST_REQUIRE_EQUAL(3u, m.item_count(1040));
+    BOOST_REQUIRE_EQUAL(1u, m.item_count(1129));
+    BOOST_REQUIRE(!m.at(999));
+    BOOST_REQUIRE(!m.at(1000 + fmap::capacity()));
+    BOOST_REQUIRE(!m.at(1004));
+    BOOST_CHECK_THROW(m.insert(999), utxx::badarg_error);
+
+    int n = 0;
+    for (fmap::iterator it = m.begin(), e = m.end(); it != e; ++it, ++n) {
+        BOOST_REQUIRE_EQUAL(s_data[n][0], (int)it.key());
+        BOOST_REQUIRE_EQUAL(s_data[n][1], *it);
+        BOOST_REQUIRE_EQUAL(s_data[n][1], *m.at(it.key()));
+    }
+    BOOST_REQUIRE_EQUAL(7, n);
+
+    int j = 0;
+    m.for_each(visitor, j);
+    BOOST_REQUIRE_EQUAL(7333, j);
+
+    BOOST_REQUIRE(m.find(1066) != m.end());
+    BOOST_REQUIRE(m.find(1068) == m.end());
+    BOOST_REQUIRE(m.erase(m.find(1066)));
+    BOOST_REQUIRE(!m.erase(1066));
+    BOOST_REQUIRE(m.erase(1129));
+    BOOST_REQUIRE_EQUAL(2u, m.group_count());
+    BOOST_REQUIRE_EQUAL(0u, m.item_count(1129));
+
+    // Descending order
+    utxx::flat_clustered_map<size_t, int, 20, 6, utxx::desending> d;
+    int keys[] = {5, 63, 64, 200000, 1};
+    for (int k : keys) d[k] = k;
+    int exp[]  = {200000, 64, 63, 5, 1};
+    n = 0;
+    for (auto it = d.begin(); it != d.end(); ++it)
+        BOOST_REQUIRE_EQUAL(exp[n++], (int)it.key());
+    BOOST_REQUIRE_EQUAL(5, n);
+
+    // The bitmap of allocated groups grows with the highest group used
+    utxx::flat_clustered_map<size_t, int, 32> w;
+    size_t wkeys[] = {(1ul << 32) - 1, 5, 1ul << 31, 300000, 70};
+    for (size_t k : wkeys) w[k] = 1;
+    size_t wexp[]  = {5, 70, 300000, 1ul << 31, (1ul << 32) - 1};
+    n = 0;
+    for (auto it = w.begin(); it != w.end(); ++it)
+        BOOST_REQUIRE_EQUAL(wexp[n++], it.key());
+    BOOST_REQUIRE_EQUAL(5, n);
+    BOOST_REQUIRE_EQUAL(5u, w.group_count());
+    for (size_t k : wkeys) BOOST_REQUIRE(w.erase(k));
+    BOOST_REQUIRE(w.begin() == w.end());
+
+    m.clear();
+    BOOST_REQUIRE(m.empty());
+    BOOST_REQUIRE(m.begin() == m.end());
+}
+
+namespace {
+    // Sparse sequence numbers: a window of live keys where new sequence
+    // numbers arrive with gaps, old ones are retired, and lookups land
+    // anywhere in the window
+    template <class Map>
+    double seqno_bench(Map& a_map, const std::vector<size_t>& a_seqnos,
+                       const std::vector<size_t>& a_lookups, size_t a_window,
+                       long& a_sum)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < a_seqnos.size(); ++i) {
+            a_map[a_seqnos[i]] = i;
+            if (i >= a_window)
+                a_map.erase(a_seqnos[i - a_window]);
+            for (int j = 0; j < 4; ++j) {
+                size_t back = a_lookups[(4*i + j) % a_lookups.size()] % std::min(i+1, a_window);
+                int* p = a_map.at(a_seqnos[i - back]);
+                a_sum += p ? *p : 0;
+            }
+        }
+        return double(std::chrono::duration_cast<std::chrono::nanoseconds>
+            (std::chrono::high_resolution_clock::now() - start).count())
+            / a_seqnos.size();
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_clustered_map_flat_perf ) {
+    const size_t count  = getenv("ITERATIONS") ? atoi(getenv("ITERATIONS")) : 1000000;
+    const size_t window = 100000;
+    const size_t base   = 1000000000;
+
+    std::mt19937 rnd(1);
+    std::vector<size_t> seqnos(count), lookups(1 << 16);
+    for (size_t i = 0, s = base; i < count; ++i)
+        seqnos[i] = s += 1 + rnd() % 4;
+    for (auto& l : lookups) l = rnd();
+
+    long   sum = 0;
+    utxx::clustered_map<size_t, int>                     m1;
+    utxx::flat_clustered_map<size_t, int, 23>            m2(base);
+    std::map<size_t, int>                                m3;
+
+    double t1 = seqno_bench(m1, seqnos, lookups, window, sum);
+    double t2 = seqno_bench(m2, seqnos, lookups, window, sum);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < count; ++i) {
+        m3[seqnos[i]] = i;
+        if (i >= window) m3.erase(seqnos[i - window]);
+        for (int j = 0; j < 4; ++j) {
+            size_t back = lookups[(4*i + j) % lookups.size()] % std::min(i+1, window);
+            auto it = m3.find(seqnos[i - back]);
+            sum += it == m3.end() ? 0 : it->second;
+        }
+    }
+    double t3 = double(std::chrono::duration_cast<std::chrono::nanoseconds>
+        (std::chrono::high_resolution_clock::now() - start).count()) / count;
+
+    BOOST_REQUIRE_EQUAL(m1.group_count(), m2.group_count());
+    BOOST_REQUIRE(sum > 0);
+
+    if (utxx::verbosity::level() != utxx::VERBOSE_NONE)
+        fprintf(stderr, "Sequence numbers (1 insert + 1 erase + 4 lookups, ns):\n"
+                        "  clustered_map      %8.1f\n"
+                        "  flat_clustered_map %8.1f\n"
+                        "  std::map           %8.1f\n", t1, t2, t3);
+}
+
+#endif
@@ -0,0 +1,203 @@
+//----------------------------------------------------------------------------
+/// \file  test_concurrent_array.cpp
+//----------------------------------------------------------------------------
+/// \brief Test cases and benchmarks for concurrent_array.hpp
+//----------------------------------------------------------------------------
+// Copyright (c) 2026 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <boost/thread/barrier.hpp>
+#include <utxx/container/concurrent_array.hpp>
+#include <utxx/verbosity.hpp>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace utxx;
+using namespace utxx::container;
+
+namespace {
+    // Invariant: b == ~a and c == 3*a, so a torn read is detectable
+    struct record {
+        long a, b, c;
+        record(long x = 0) : a(x), b(~x), c(3*x) {}
+        bool valid() const { return b == ~a && c == 3*a; }
+    };
+}
+
+BOOST_AUTO_TEST_CASE( test_concurrent_array_basic )
+{
+    typedef concurrent_array<record, synch::spin_lock, 4> array_t;
+    std::vector<char> storage(array_t::storage_size(100));
+    BOOST_CHECK_THROW(array_t::create(&storage[0], storage.size()-1, 100), runtime_error);
+
+    array_t& a = array_t::create(&storage[0], storage.size(), 100);
+    BOOST_CHECK_EQUAL(100u, a.size());
+    BOOST_CHECK_EQUAL(0,    a[99].a);
+    BOOST_CHECK(a.get(5).valid());
+
+    for (size_t i = 0; i < a.size(); ++i)
+        a.set(i, record(i));
+    for (size_t i = 0; i < a.size(); ++i) {
+        BOOST_REQUIRE_EQUAL(long(i), a[i].a);
+        BOOST_REQUIRE(a[i].valid());
+    }
+
+    a.update(7, [](record& r) { r = record(r.a + 100); });
+    record r;
+    BOOST_CHECK(a.try_get(7, r));
+    BOOST_CHECK_EQUAL(107, r.a);
+    BOOST_CHECK(r.valid());
+
+    typedef concurrent_array<long, synch::spin_lock, 16, true> aligned_t;
+    std::vector<char> s2(aligned_t::storage_size(10));
+    aligned_t& b = aligned_t::create(&s2[0], s2.size(), 10);
+    b.set(9, 42);
+    BOOST_CHECK_EQUAL(42, b[9]);
+    BOOST_CHECK(aligned_t::storage_size(0) >= 16 * 64);
+}
+
+BOOST_AUTO_TEST_CASE( test_concurrent_array_torn_reads )
+{
+    typedef concurrent_array<record> array_t;
+    const size_t n = 64;
+    std::vector<char> storage(array_t::storage_size(n));
+    array_t& a = array_t::create(&storage[0], storage.size(), n);
+
+    const int writers = 2, readers = 2;
+    const long iterations = getenv("ITERATIONS") ? atol(getenv("ITERATIONS")) : 200000;
+    std::atomic<int>  done(0);
+    std::atomic<long> bad(0), reads(0);
+    std::vector<std::thread> threads;
+
+    for (int w = 0; w < writers; ++w)
+        threads.emplace_back([&, w]() {
+            for (long i = 0; i < iterations; ++i)
+                a.set((i * 7 + w) % n, record(i));
+            ++done;
+        });
+    for (int r = 0; r < readers; ++r)
+        threads.emplace_back([&, r]() {
+            long cnt = 0;
+            for (size_t i = r; done < writers || cnt < 1000; ++i, ++cnt)
+                if (!a[i % n].valid())
+                    ++bad;
+            reads += cnt;
+        });
+    for (auto& t : threads) t.join();
+
+    BOOST_CHECK_EQUAL(0, bad.load());
+    BOOST_CHECK(reads.load() > 0);
+}
+
+//----------------------------------------------------------------------------
+// Benchmark
+//----------------------------------------------------------------------------
+namespace {
+    using namespace std::chrono;
+
+    // Baseline: readers take the stripe lock like writers do
+    template <class T, int N = 16>
+    struct locked_array {
+        std::vector<T>                  data;
+        mutable synch::spin_lock        locks[N];
+
+        explicit locked_array(size_t n) : data(n) {}
+        T get(size_t i) const {
+            std::lock_guard<synch::spin_lock> g(locks[i & (N-1)]);
+            return data[i];
+        }
+        void set(size_t i, const T& v) {
+            std::lock_guard<synch::spin_lock> g(locks[i & (N-1)]);
+            data[i] = v;
+        }
+        size_t size() const { return data.size(); }
+    };
+
+    // @return reads per microsecond over all reader threads
+    template <class Array>
+    double reader_writer_mix(Array& a_array, int a_readers, long a_reads) {
+        boost::barrier    barrier(a_readers + 1);
+        std::atomic<bool> stop(false);
+        std::atomic<long> usec(0), bad(0);
+        std::vector<std::thread> threads;
+
+        // Single writer continuously updating records
+        threads.emplace_back([&]() {
+            barrier.wait();
+            for (long i = 0; !stop; ++i)
+                a_array.set(i % a_array.size(), record(i));
+        });
+        for (int r = 1; r < a_readers; ++r)
+            threads.emplace_back([&, r]() {
+                barrier.wait();
+                auto start = high_resolution_clock::now();
+                for (long i = 0; i < a_reads; ++i)
+                    if (!a_array.get((i + r*13) % a_array.size()).valid())
+                        ++bad;
+                usec = std::max<long>(usec, duration_cast<microseconds>
+                        (high_resolution_clock::now() - start).count());
+            });
+        barrier.wait();
+        auto start = high_resolution_clock::now();
+        for (long i = 0; i < a_reads; ++i)
+            if (!a_array.get(i % a_array.size()).valid())
+                ++bad;
+        long self = duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+        for (size_t i = 1; i < threads.size(); ++i) threads[i].join();
+        stop = true;
+        threads[0].join();
+
+        BOOST_REQUIRE_EQUAL(0, bad.load());
+        return double(a_readers * a_reads) / std::max(1l, std::max(self, usec.load()));
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_concurrent_array_perf )
+{
+    const long reads       = getenv("ITERATIONS")  ? atol(getenv("ITERATIONS"))  : 1000000;
+    const int  max_readers = getenv("MAX_THREADS") ? atoi(getenv("MAX_THREADS")) : 4;
+    const size_t n         = 1024;
+
+    typedef concurrent_array<record, synch::spin_lock, 16, true> array_t;
+    std::vector<char> storage(array_t::storage_size(n));
+    array_t& a = array_t::create(&storage[0], storage.size(), n);
+    locked_array<record> b(n);
+
+    if (verbosity::level() != utxx::VERBOSE_NONE)
+        fprintf(stderr, "%8s %16s %16s  (reads/us, 1 writer)\n",
+                "Readers", "seqlock", "locked");
+
+    for (int r = 1; r <= max_readers; r *= 2) {
+        double s = reader_writer_mix(a, r, reads);
+        double l = reader_writer_mix(b, r, reads);
+        if (verbosity::level() != utxx::VERBOSE_NONE)
+            fprintf(stderr, "%8d %16.1f %16.1f\n", r, s, l);
+    }
+}
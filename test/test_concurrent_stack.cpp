@@ -1,9 +1,13 @@
 #include <boost/test/unit_test.hpp>
 #include <boost/thread/barrier.hpp>
 #include <utxx/container/concurrent_stack.hpp>
+#include <utxx/alloc_cached.hpp>
 #include <utxx/verbosity.hpp>
 #include <utxx/atomic.hpp>
 #include <vector>
+#include <chrono>
+#include <algorithm>
+#include <set>
 #include <thread>
 #include <stdio.h>
 
@@ -93,7 +97,7 @@ struct sproducer {
             atomic::inc(&count);
             int_t* p = new int_t(i+1, id);
             BOOST_ASSERT(p); // , "Out of memory id=" << id << " i=" << i);
-            BOOST_ASSERT(((unsigned long)p & int_t::s_version_mask) == 0); // "Invalid alignment " << p);
+            BOOST_ASSERT(((unsigned long)p & (alignof(int_t) - 1)) == 0); // "Invalid alignment " << p);
             if (verbosity::level() >= utxx::VERBOSE_TRACE)
                 fprintf(stderr, "  %d - Allocated %p (%d,%d) prod_cnt=%ld\n", id, p, id, i+1, count);
             stack.push(p);
@@ -122,7 +126,7 @@ struct sconsumer : public sproducer {
             int_t* p = static_cast<int_t*>(stack.reset(&ts, true));
             while (p) {
                 int_t* next = static_cast<int_t*>(p->next);
-                BOOST_ASSERT(((unsigned long)p & int_t::s_version_mask) == 0); //, "Invalid alignment " << p);
+                BOOST_ASSERT(((unsigned long)p & (alignof(int_t) - 1)) == 0); //, "Invalid alignment " << p);
                 sum += p->data();
                 atomic::add(&count, 1);
                 if (verbosity::level() >= utxx::VERBOSE_TRACE)
@@ -180,3 +184,236 @@ BOOST_AUTO_TEST_CASE( test_concurrent_stack )
     BOOST_REQUIRE_EQUAL(producer_threads*iterations, cons_count);
 }
 
+
+BOOST_AUTO_TEST_CASE( test_concurrent_stack_elimination )
+{
+    elimination_stack<> stack;
+
+    int_t nodes[10];
+    for(int i=0; i < 10; i++) {
+        nodes[i].data(i+1);
+        stack.push(&nodes[i]);
+    }
+
+    BOOST_REQUIRE_EQUAL(10, stack.unsafe_size());
+    BOOST_REQUIRE_EQUAL(10u, stack.version());
+
+    for(int i=10; i > 0; i--) {
+        int_t* n = static_cast<int_t*>(stack.pop());
+        BOOST_REQUIRE_EQUAL(i, n->data());
+        BOOST_REQUIRE(!n->next);
+    }
+
+    BOOST_REQUIRE(stack.empty());
+    BOOST_REQUIRE(!stack.pop());
+    BOOST_REQUIRE_EQUAL(20u, stack.version());
+}
+
+namespace {
+    // Run a_fun() a_iterations times in each of a_threads threads.
+    // @return throughput in Mops/s measured by the slowest thread
+    template <class Fun>
+    double run_churn(int a_threads, long a_iterations, Fun&& a_fun) {
+        using namespace std::chrono;
+        boost::barrier            barrier(a_threads);
+        std::vector<long>         usec(a_threads);
+        std::vector<std::thread>  threads;
+        for (int i=0; i < a_threads; ++i)
+            threads.emplace_back([&, i]() {
+                barrier.wait();
+                auto start = high_resolution_clock::now();
+                for (long j=0; j < a_iterations; ++j)
+                    a_fun();
+                usec[i] = duration_cast<microseconds>
+                          (high_resolution_clock::now() - start).count();
+            });
+        for (auto& t : threads) t.join();
+        long max = *std::max_element(usec.begin(), usec.end());
+        return double(a_threads * a_iterations) / std::max(1l, max);
+    }
+
+    // Each thread pops a node and pushes it back
+    template <class Stack>
+    double stack_churn(Stack& a_stack, int a_threads, long a_iterations) {
+        return run_churn(a_threads, a_iterations, [&]() {
+            auto p = a_stack.pop();
+            if (p) a_stack.push(p);
+        });
+    }
+
+    // Each thread allocates and frees a block, simulating message churn
+    template <class Alloc>
+    double alloc_churn(Alloc& a_alloc, int a_threads, long a_iterations) {
+        return run_churn(a_threads, a_iterations, [&]() {
+            char* p = a_alloc.allocate(64);
+            BOOST_ASSERT(p);
+            a_alloc.free(p);
+        });
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_concurrent_stack_scalability )
+{
+    const long iterations  = ::getenv("ITERATIONS")  ? atoi(::getenv("ITERATIONS"))  : 20000;
+    const int  max_threads = ::getenv("MAX_THREADS") ? atoi(::getenv("MAX_THREADS")) : 4;
+    const int  nodes_count = 64;
+
+    versioned_stack     vstack;
+    elimination_stack<> estack;
+    std::vector<int_t>  vnodes(nodes_count), enodes(nodes_count);
+    for (int i=0; i < nodes_count; ++i) {
+        vstack.push(&vnodes[i]);
+        estack.push(&enodes[i]);
+    }
+
+    memory::cached_allocator<char, std::allocator<char>, 3*sizeof(long), 21,
+                             versioned_stack> valloc;
+    memory::cached_allocator<char> ealloc;
+    memory::cached_allocator<char, std::allocator<char>, 3*sizeof(long), 21,
+                             elimination_stack<>, 32> malloc;
+
+    if (verbosity::level() != utxx::VERBOSE_NONE)
+        fprintf(stderr, "%8s %16s %16s %16s %16s %16s  (Mops/s)\n", "Threads",
+                "versioned_stack", "elimination", "cached_alloc", "cached_alloc+el",
+                "cached_alloc+mag");
+
+    for (int n=1; n <= max_threads; n *= 2) {
+        double v  = stack_churn(vstack, n, iterations);
+        double e  = stack_churn(estack, n, iterations);
+        double va = alloc_churn(valloc, n, iterations);
+        double ea = alloc_churn(ealloc, n, iterations);
+        double ma = alloc_churn(malloc, n, iterations);
+
+        // No node may be lost or duplicated
+        BOOST_REQUIRE_EQUAL(nodes_count, vstack.unsafe_size());
+        BOOST_REQUIRE_EQUAL(nodes_count, estack.unsafe_size());
+        // All 64+16 byte blocks were returned to the size class 7 free list
+        BOOST_REQUIRE(valloc.cache_size(7) >= 1 && valloc.cache_size(7) <= n);
+        BOOST_REQUIRE(ealloc.cache_size(7) >= 1 && ealloc.cache_size(7) <= n);
+
+        if (verbosity::level() != utxx::VERBOSE_NONE)
+            fprintf(stderr, "%8d %16.2f %16.2f %16.2f %16.2f %16.2f\n",
+                    n, v, e, va, ea, ma);
+    }
+
+    BOOST_REQUIRE_EQUAL(0u, valloc.large_objects());
+    BOOST_REQUIRE_EQUAL(0u, ealloc.large_objects());
+    BOOST_REQUIRE_EQUAL(0u, malloc.large_objects());
+    // Exited threads flushed their magazines to the shared free lists,
+    // and their caches were reused by the threads of the next round
+    BOOST_REQUIRE(malloc.cache_size(7) >= 1 && malloc.cache_size(7) <= max_threads);
+    BOOST_REQUIRE(malloc.thread_caches_count() <= max_threads);
+}
+
+BOOST_AUTO_TEST_CASE( test_cached_allocator_magazine )
+{
+    typedef memory::cached_allocator<char, std::allocator<char>, 3*sizeof(long),
+                                     21, elimination_stack<>, 8> alloc_t;
+    alloc_t alloc;
+    const int n = 100;
+
+    // Without magazines the allocator has no depot
+    static_assert(sizeof(memory::cached_allocator<char>) < sizeof(alloc_t),
+                  "Depot of a cached_allocator without magazines");
+    BOOST_CHECK_EQUAL(0, memory::cached_allocator<char>().depot_size(7));
+
+    // 64 bytes + header fall in size class 7
+    std::set<char*> ptrs;
+    for (int i=0; i < n; ++i)
+        ptrs.insert(alloc.allocate(64));
+    BOOST_REQUIRE_EQUAL(n, int(ptrs.size()));
+
+    // A full magazine (16 nodes) returns a batch of 8 to the depot
+    for (auto p : ptrs) alloc.free(p);
+    BOOST_CHECK_EQUAL(11, alloc.depot_size(7));
+    BOOST_CHECK_EQUAL(12, alloc.magazine_count(7));
+    BOOST_CHECK_EQUAL(0,  alloc.cache_size(7));
+
+    // All nodes are reused
+    std::set<char*> again;
+    for (int i=0; i < n; ++i)
+        again.insert(alloc.allocate(64));
+    BOOST_CHECK(ptrs == again);
+    BOOST_CHECK_EQUAL(0, alloc.depot_size(7));
+    BOOST_CHECK_EQUAL(0, alloc.magazine_count(7));
+    for (auto p : again) alloc.free(p);
+
+    // Nodes freed by another thread travel back through the depot
+    const int m = 1000;
+    std::vector<char*> v;
+    std::thread([&]() { for (int i=0; i < m; ++i) v.push_back(alloc.allocate(64)); }).join();
+    std::thread([&]() { for (auto p : v) alloc.free(p); }).join();
+    std::set<char*> freed(v.begin(), v.end());
+    int reused = 0;
+    std::thread([&]() {
+        for (int i=0; i < m; ++i) {
+            v[i]    = alloc.allocate(64);
+            reused += freed.count(v[i]);
+        }
+    }).join();
+    for (auto p : v) alloc.free(p);
+    // Exited threads leave no nodes in their magazines, and their caches
+    // are reused by new threads
+    BOOST_CHECK_EQUAL(m, reused);
+    BOOST_CHECK_EQUAL(2, alloc.thread_caches_count());
+}
+
+namespace {
+    struct counting_allocator : std::allocator<char> {
+        template <class U> struct rebind { typedef counting_allocator other; };
+        long live = 0;
+
+        char* allocate(size_t n) {
+            ++live;
+            return std::allocator<char>::allocate(n);
+        }
+        void deallocate(char* p, size_t n) {
+            --live;
+            std::allocator<char>::deallocate(p, n);
+        }
+    };
+}
+
+BOOST_AUTO_TEST_CASE( test_cached_allocator_release )
+{
+    typedef memory::cached_allocator<char, counting_allocator, 3*sizeof(long),
+                                     21, elimination_stack<>, 8> alloc_t;
+    counting_allocator backing;
+    {
+        alloc_t alloc(backing);
+        std::vector<char*> v;
+        for (int i=0; i < 100; ++i)
+            v.push_back(alloc.allocate(64 << (i % 3)));
+
+        // Nodes end up in the magazines of the main thread and of an exited
+        // thread, in the depot and in the free lists
+        std::thread([&]() {
+            for (int i=0; i < 50; ++i) alloc.free(v[i]);
+        }).join();
+        for (int i=50; i < 100; ++i) alloc.free(v[i]);
+
+        std::thread t([&]() {
+            alloc.free(alloc.allocate(64));
+        });
+        t.join();
+        BOOST_CHECK(backing.live > 0);
+    }
+    // The destructor returned every node to the user allocator
+    BOOST_CHECK_EQUAL(0, backing.live);
+
+    // The allocator is destroyed while a thread that used it is running
+    std::atomic<int> stage(0);
+    std::thread t;
+    {
+        alloc_t alloc(backing);
+        t = std::thread([&]() {
+            alloc.free(alloc.allocate(64));
+            stage = 1;
+            while (stage != 2) std::this_thread::yield();
+        });
+        while (stage != 1) std::this_thread::yield();
+    }
+    BOOST_CHECK_EQUAL(0, backing.live);
+    stage = 2;
+    t.join();
+}
@@ -0,0 +1,315 @@
+//----------------------------------------------------------------------------
+/// \file  test_flat_hash_map.cpp
+//----------------------------------------------------------------------------
+/// \brief Test cases and benchmarks for flat_hash_map.hpp
+//----------------------------------------------------------------------------
+// Copyright (c) 2026 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <utxx/container/flat_hash_map.hpp>
+#include <utxx/alloc_cached.hpp>
+#include <utxx/hashmap.hpp>
+#include <utxx/verbosity.hpp>
+#include <chrono>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace utxx;
+
+namespace {
+    struct counted {
+        static int s_live;
+        int m_val;
+        counted(int a = 0) : m_val(a) { ++s_live; }
+        counted(const counted& a) : m_val(a.m_val) { ++s_live; }
+        ~counted() { --s_live; }
+    };
+    int counted::s_live = 0;
+}
+
+BOOST_AUTO_TEST_CASE( test_flat_hash_map_basic )
+{
+    flat_hash_map<int, int> m;
+    BOOST_CHECK(m.empty());
+    BOOST_CHECK_EQUAL(0u, m.bucket_count());
+    BOOST_CHECK(m.find(1) == m.end());
+    BOOST_CHECK(m.begin() == m.end());
+    BOOST_CHECK_EQUAL(0u, m.erase(1));
+
+    m[1] = 10;
+    BOOST_CHECK(m.insert(std::make_pair(2, 20)).second);
+    BOOST_CHECK(!m.insert(std::make_pair(2, 21)).second);
+    BOOST_CHECK(m.emplace(3, 30).second);
+    BOOST_CHECK(m.try_emplace(4, 40).second);
+    BOOST_CHECK(!m.try_emplace(4, 41).second);
+    BOOST_CHECK(!m.insert_or_assign(4, 42).second);
+
+    BOOST_CHECK_EQUAL(4u, m.size());
+    BOOST_CHECK_EQUAL(10, m.at(1));
+    BOOST_CHECK_EQUAL(20, m[2]);
+    BOOST_CHECK_EQUAL(30, m.find(3)->second);
+    BOOST_CHECK_EQUAL(42, m.find(4)->second);
+    BOOST_CHECK_EQUAL(1u, m.count(4));
+    BOOST_CHECK_EQUAL(0u, m.count(5));
+    BOOST_CHECK_THROW(m.at(5), std::out_of_range);
+
+    int sum = 0;
+    for (auto& kv : m) sum += kv.first;
+    BOOST_CHECK_EQUAL(10, sum);
+
+    const auto& cm = m;
+    flat_hash_map<int, int>::const_iterator it = cm.find(2);
+    BOOST_CHECK(it != cm.end());
+    BOOST_CHECK_EQUAL(20, it->second);
+
+    auto next = m.erase(m.find(2));
+    BOOST_CHECK(next == m.end() || next->first != 2);
+    BOOST_CHECK_EQUAL(1u, m.erase(3));
+    BOOST_CHECK_EQUAL(2u, m.size());
+
+    flat_hash_map<int, int> c(m);
+    BOOST_CHECK_EQUAL(2u, c.size());
+    BOOST_CHECK_EQUAL(10, c[1]);
+
+    flat_hash_map<int, int> mv(std::move(c));
+    BOOST_CHECK_EQUAL(2u, mv.size());
+    BOOST_CHECK(c.empty());
+
+    m.clear();
+    BOOST_CHECK(m.empty());
+    BOOST_CHECK(m.find(1) == m.end());
+    BOOST_CHECK_EQUAL(42, mv[4]);
+
+    flat_hash_map<std::string, int> s{{"IBM", 1}, {"AAPL", 2}};
+    BOOST_CHECK_EQUAL(2, s["AAPL"]);
+    BOOST_CHECK_EQUAL(0, s["MSFT"]);
+    BOOST_CHECK_EQUAL(3u, s.size());
+}
+
+BOOST_AUTO_TEST_CASE( test_flat_hash_map_random_ops )
+{
+    // Random inserts and erases checked against std::map, small key range
+    // to exercise tombstones and in-place rehashing
+    std::mt19937 rnd(1);
+    flat_hash_map<uint64_t, counted> m;
+    std::map<uint64_t, int>          ref;
+
+    for (int i = 0; i < 200000; ++i) {
+        uint64_t k = rnd() % 5000;
+        switch (rnd() % 3) {
+            case 0:
+            case 1: {
+                bool ok = m.emplace(k, counted(i)).second;
+                BOOST_REQUIRE_EQUAL(ok, ref.emplace(k, i).second);
+                break;
+            }
+            case 2:
+                BOOST_REQUIRE_EQUAL(ref.erase(k), m.erase(k));
+                break;
+        }
+        BOOST_REQUIRE_EQUAL(ref.size(), m.size());
+    }
+
+    for (auto& kv : ref) {
+        auto it = m.find(kv.first);
+        BOOST_REQUIRE(it != m.end());
+        BOOST_REQUIRE_EQUAL(kv.second, it->second.m_val);
+    }
+    size_t n = 0;
+    for (auto& kv : m) {
+        BOOST_REQUIRE_EQUAL(ref[kv.first], kv.second.m_val);
+        ++n;
+    }
+    BOOST_CHECK_EQUAL(ref.size(), n);
+    BOOST_CHECK(m.load_factor() <= m.max_load_factor());
+    BOOST_CHECK_EQUAL(int(m.size()), counted::s_live);
+
+    m.rehash(0);
+    BOOST_CHECK_EQUAL(0u, m.tombstones());
+    BOOST_CHECK_EQUAL(ref.size(), m.size());
+
+    // Erase while iterating
+    for (auto it = m.begin(); it != m.end(); )
+        it = (it->first & 1) ? m.erase(it) : std::next(it);
+    for (auto& kv : m)
+        BOOST_REQUIRE_EQUAL(0u, kv.first & 1);
+
+    m = flat_hash_map<uint64_t, counted>();
+    BOOST_CHECK_EQUAL(0, counted::s_live);
+}
+
+BOOST_AUTO_TEST_CASE( test_flat_hash_map_cached_allocator )
+{
+    using alloc_t = memory::cached_allocator<char>;
+    alloc_t alloc;
+    {
+        flat_hash_map<std::string, int, std::hash<std::string>,
+                      std::equal_to<std::string>, alloc_t> m(0, alloc);
+        for (int i = 0; i < 10000; ++i)
+            m["SYM" + std::to_string(i)] = i;
+        for (int i = 0; i < 10000; ++i)
+            BOOST_REQUIRE_EQUAL(i, m["SYM" + std::to_string(i)]);
+        BOOST_CHECK_EQUAL(&alloc, &m.get_allocator());
+
+        m.reserve(100000);
+        BOOST_CHECK(m.bucket_count() * 7 / 8 >= 100000);
+        BOOST_CHECK_EQUAL(10000u, m.size());
+    }
+    // Tables released on growth were cached by the allocator
+    size_t cached = 0;
+    for (size_t c = alloc_t::min_size_class; c <= alloc_t::max_size_class; ++c)
+        cached += alloc.cache_size(c);
+    BOOST_CHECK(cached > 0);
+}
+
+//----------------------------------------------------------------------------
+// Benchmark
+//----------------------------------------------------------------------------
+namespace {
+    using namespace std::chrono;
+
+    template <class Map, class Key>
+    struct bench_result { double insert, hit, miss, churn; };
+
+    // Returns nanoseconds per operation for each operation kind
+    template <class Map, class Key>
+    bench_result<Map, Key> bench(Map& a_map, const std::vector<Key>& a_keys,
+                                 const std::vector<Key>& a_missing, long& a_sum)
+    {
+        auto ns = [](high_resolution_clock::time_point a_start, size_t n) {
+            return double(duration_cast<nanoseconds>
+                (high_resolution_clock::now() - a_start).count()) / n;
+        };
+        bench_result<Map, Key> r;
+        size_t n = a_keys.size();
+
+        auto t = high_resolution_clock::now();
+        for (size_t i = 0; i < n; ++i)
+            a_map[a_keys[i]] = i;
+        r.insert = ns(t, n);
+
+        t = high_resolution_clock::now();
+        for (int j = 0; j < 4; ++j)
+            for (auto& k : a_keys)
+                a_sum += a_map.find(k)->second;
+        r.hit = ns(t, 4*n);
+
+        t = high_resolution_clock::now();
+        for (int j = 0; j < 4; ++j)
+            for (auto& k : a_missing)
+                a_sum += a_map.find(k) == a_map.end();
+        r.miss = ns(t, 4*n);
+
+        // Order book style churn: erase one key and insert another
+        t = high_resolution_clock::now();
+        for (size_t i = 0; i < n; ++i) {
+            a_map.erase(a_keys[i]);
+            a_map[a_missing[i]] = i;
+        }
+        r.churn = ns(t, n);
+
+        BOOST_REQUIRE_EQUAL(n, a_map.size());
+        return r;
+    }
+
+    template <class Key, class Hash = std::hash<Key>>
+    void bench_keys(const char* a_name, const std::vector<Key>& a_keys,
+                    const std::vector<Key>& a_missing)
+    {
+        memory::cached_allocator<char> alloc;
+        long sum = 0;
+        detail::basic_hash_map<Key, long, Hash>           m1;
+        flat_hash_map<Key, long, Hash>                    m2;
+        flat_hash_map<Key, long, Hash, std::equal_to<Key>,
+                      memory::cached_allocator<char>>     m3(0, alloc);
+
+        auto r1 = bench(m1, a_keys, a_missing, sum);
+        auto r2 = bench(m2, a_keys, a_missing, sum);
+        auto r3 = bench(m3, a_keys, a_missing, sum);
+
+        if (verbosity::level() == utxx::VERBOSE_NONE)
+            return;
+
+        auto print = [&](const char* a_map, double a, double b, double c, double d) {
+            fprintf(stderr, "  %-10s %-22s %8.1f %8.1f %8.1f %8.1f\n",
+                    a_name, a_map, a, b, c, d);
+        };
+        print("basic_hash_map",      r1.insert, r1.hit, r1.miss, r1.churn);
+        print("flat_hash_map",       r2.insert, r2.hit, r2.miss, r2.churn);
+        print("flat_hash_map/cached",r3.insert, r3.hit, r3.miss, r3.churn);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_flat_hash_map_perf )
+{
+    const size_t count = ::getenv("ITERATIONS") ? atoi(::getenv("ITERATIONS")) : 200000;
+
+    if (verbosity::level() != utxx::VERBOSE_NONE)
+        fprintf(stderr, "  %-10s %-22s %8s %8s %8s %8s  (ns/op, group width %d)\n",
+                "Keys", "Map", "insert", "find", "miss", "churn",
+                int(detail::ctrl_group::width));
+
+    std::mt19937_64 rnd(1);
+
+    // Sequential exchange order ids
+    {
+        std::vector<uint64_t> keys(count), missing(count);
+        uint64_t base = 1000000000ull;
+        for (size_t i = 0; i < count; ++i) {
+            keys[i]    = base + i;
+            missing[i] = base + count + i;
+        }
+        bench_keys("order_id", keys, missing);
+    }
+    // Random 64-bit ids
+    {
+        std::vector<uint64_t> keys(count), missing(count);
+        for (size_t i = 0; i < count; ++i) {
+            keys[i]    = rnd();
+            missing[i] = rnd();
+        }
+        bench_keys("random", keys, missing);
+    }
+    // Instrument symbols
+    {
+        std::vector<std::string> keys(count), missing(count);
+        auto sym = [&](size_t i) {
+            std::string s;
+            for (size_t n = i; n || s.empty(); n /= 26)
+                s += char('A' + n % 26);
+            return s + ".XNAS";
+        };
+        for (size_t i = 0; i < count; ++i) {
+            keys[i]    = sym(i);
+            missing[i] = sym(count + i);
+        }
+        bench_keys("symbol", keys, missing);
+    }
+}
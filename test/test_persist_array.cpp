@@ -42,6 +42,13 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <boost/test/unit_test.hpp>
 #include <utxx/test_helper.hpp>
+#include <chrono>
+#include <random>
+#include <unordered_map>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
 
 using namespace boost::unit_test;
 using namespace utxx;
@@ -246,3 +253,266 @@ BOOST_AUTO_TEST_CASE( test_persist_array_concurrent )
     }
     ::unlink(s_filename);
 }
+
+namespace {
+    struct order {
+        long id;
+        long qty;
+        char sym[16];
+    };
+
+    struct order_id {
+        long operator()(const order& a) const { return a.id; }
+    };
+
+    typedef persist_indexed_array<order, long, order_id> indexed_type;
+
+    static const char* s_idx_filename = "/tmp/persist_indexed_array.bin";
+
+    struct indexed_file_deleter {
+        indexed_file_deleter()  { remove(); }
+        ~indexed_file_deleter() { remove(); }
+        void remove() {
+            ::unlink(s_idx_filename);
+            ::unlink((std::string(s_idx_filename) + ".idx").c_str());
+        }
+    };
+
+    long order_key(long i) { return 1000000007l * i % 999999937l; }
+}
+
+BOOST_AUTO_TEST_CASE( test_persist_indexed_array )
+{
+    indexed_file_deleter deleter;
+    const long n = 10000;
+
+    {
+        indexed_type a;
+        BOOST_REQUIRE(a.init(s_idx_filename, n));
+        BOOST_REQUIRE(a.index_capacity() >= 2*n);
+        for (long i = 0; i < n-1; ++i) {
+            order o{order_key(i), i, "IBM"};
+            auto r = a.insert(o);
+            BOOST_REQUIRE(r.second);
+            BOOST_REQUIRE_EQUAL(size_t(i), r.first);
+        }
+        BOOST_REQUIRE(!a.insert(order{order_key(5), 0, ""}).second);
+        auto r = a.insert(order_key(n-1), [&](size_t a_id, order* p) {
+            p->id = order_key(n-1); p->qty = a_id;
+        });
+        BOOST_REQUIRE(std::get<2>(r));
+        BOOST_REQUIRE_EQUAL(size_t(n-1), std::get<1>(r));
+        BOOST_REQUIRE_EQUAL(size_t(n),   a.count());
+        BOOST_REQUIRE_EQUAL(5,           a.find(order_key(5))->qty);
+        BOOST_REQUIRE(!a.find(-1));
+        BOOST_REQUIRE_EQUAL(indexed_type::s_npos, a.find_id(-1));
+        BOOST_REQUIRE_THROW(a.insert(order{-1, 0, ""}), runtime_error);
+    }
+    // Reopen: the index is loaded as is
+    {
+        indexed_type a;
+        BOOST_REQUIRE(!a.init(s_idx_filename, n));
+        BOOST_REQUIRE_EQUAL(size_t(n), a.count());
+        for (long i = 0; i < n; ++i)
+            BOOST_REQUIRE_EQUAL(size_t(i), a.find_id(order_key(i)));
+    }
+    // Crash after a record was allocated but before it was indexed:
+    // the record is rolled back on restart
+    {
+        indexed_type a;
+        a.init(s_idx_filename, n+10);
+        {
+            persist_array<order> raw;
+            raw.init(s_idx_filename, n+10);
+            raw.add(order{-5, 0, ""});
+            BOOST_REQUIRE_EQUAL(size_t(n+1), raw.count());
+        }
+    }
+    {
+        indexed_type a;
+        a.init(s_idx_filename, n+10);
+        BOOST_REQUIRE_EQUAL(size_t(n), a.count());
+        BOOST_REQUIRE(!a.find(-5));
+        BOOST_REQUIRE(a.insert(order{-5, 0, ""}).second);
+        BOOST_REQUIRE_EQUAL(size_t(n), a.find_id(-5));
+    }
+    // Missing index and capacity growth rebuild the index from the records
+    ::unlink((std::string(s_idx_filename) + ".idx").c_str());
+    {
+        indexed_type a;
+        a.init(s_idx_filename, 4*n);
+        BOOST_REQUIRE(a.index_capacity() >= 8*n);
+        BOOST_REQUIRE_EQUAL(size_t(n+1), a.count());
+        for (long i = 0; i < n; ++i)
+            BOOST_REQUIRE_EQUAL(size_t(i), a.find_id(order_key(i)));
+        BOOST_REQUIRE_EQUAL(size_t(n), a.find_id(-5));
+    }
+    // The array lost records the index has committed (its header wasn't
+    // flushed before a crash): the index is rebuilt from the records
+    {
+        persist_array<order> raw;
+        raw.init(s_idx_filename, 4*n);
+        const_cast<persist_array<order>::header&>(raw.header_data())
+            .rec_count.store(n-2);
+    }
+    {
+        indexed_type a;
+        a.init(s_idx_filename, 4*n);
+        BOOST_REQUIRE_EQUAL(size_t(n-2), a.count());
+        for (long i = 0; i < n-2; ++i)
+            BOOST_REQUIRE_EQUAL(size_t(i), a.find_id(order_key(i)));
+        BOOST_REQUIRE(!a.find(order_key(n-2)));
+        BOOST_REQUIRE(!a.find(-5));
+        BOOST_REQUIRE(a.insert(order{-5, 0, ""}).second);
+        BOOST_REQUIRE_EQUAL(size_t(n-2), a.find_id(-5));
+    }
+    // The array holds several records past the commit mark (the index page
+    // with the commit mark wasn't flushed before a crash): they are indexed
+    {
+        persist_array<order> raw;
+        raw.init(s_idx_filename, 4*n);
+        raw.add(order{-6, 0, ""});
+        raw.add(order{-7, 0, ""});
+        raw.add(order{-8, 0, ""});
+        BOOST_REQUIRE_EQUAL(size_t(n+2), raw.count());
+    }
+    {
+        indexed_type a;
+        a.init(s_idx_filename, 4*n);
+        BOOST_REQUIRE_EQUAL(size_t(n+2), a.count());
+        BOOST_REQUIRE_EQUAL(size_t(n-2), a.find_id(-5));
+        BOOST_REQUIRE_EQUAL(size_t(n-1), a.find_id(-6));
+        BOOST_REQUIRE_EQUAL(size_t(n),   a.find_id(-7));
+        BOOST_REQUIRE_EQUAL(size_t(n+1), a.find_id(-8));
+        BOOST_REQUIRE(!a.insert(order{-7, 0, ""}).second);
+        BOOST_REQUIRE(a.insert(order{-9, 0, ""}).second);
+        BOOST_REQUIRE_EQUAL(size_t(n+2), a.find_id(-9));
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_persist_indexed_array_restart_perf )
+{
+    using namespace std::chrono;
+    indexed_file_deleter deleter;
+    const long n = getenv("ITERATIONS") ? atol(getenv("ITERATIONS")) : 1000000;
+
+    {
+        indexed_type a;
+        a.init(s_idx_filename, n);
+        for (long i = 0; i < n; ++i)
+            a.insert(order{order_key(i), i, "IBM"});
+    }
+
+    // Restart using the persistent index
+    auto t = high_resolution_clock::now();
+    long sum = 0;
+    {
+        indexed_type a;
+        a.init(s_idx_filename, n);
+        sum += a.find(order_key(n/2))->qty;
+    }
+    double d1 = duration_cast<microseconds>(high_resolution_clock::now() - t).count();
+
+    // Restart rebuilding an in-memory index by scanning the records
+    t = high_resolution_clock::now();
+    {
+        persist_array<order> a;
+        a.init(s_idx_filename, n);
+        std::unordered_map<long, size_t> idx(n);
+        a.for_each([&](size_t i, const order* o) { idx.emplace(o->id, i); });
+        sum += a[idx[order_key(n/2)]].qty;
+    }
+    double d2 = duration_cast<microseconds>(high_resolution_clock::now() - t).count();
+
+    BOOST_REQUIRE_EQUAL(n/2*2, sum);
+
+    if (verbosity::level() > VERBOSE_NONE)
+        std::cout << "Restart with " << n << " records: persistent index "
+                  << d1/1000 << "ms, scan " << d2/1000 << "ms\n";
+}
+
+namespace {
+    // Counter of data TLB read misses of the calling thread
+    struct dtlb_miss_counter {
+        int fd;
+        dtlb_miss_counter() {
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size           = sizeof(attr);
+            attr.type           = PERF_TYPE_HW_CACHE;
+            attr.config         = PERF_COUNT_HW_CACHE_DTLB
+                                | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                                | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            attr.disabled       = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv     = 1;
+            fd = ::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        }
+        ~dtlb_miss_counter() { if (fd >= 0) ::close(fd); }
+
+        void start() {
+            if (fd < 0) return;
+            ::ioctl(fd, PERF_EVENT_IOC_RESET,  0);
+            ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+        /// @return number of misses since start() or -1 if not available
+        long stop() {
+            long n;
+            if (fd < 0) return -1;
+            ::ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            return ::read(fd, &n, sizeof(n)) == sizeof(n) ? n : -1;
+        }
+    };
+}
+
+BOOST_AUTO_TEST_CASE( test_persist_array_huge_pages )
+{
+    using namespace std::chrono;
+    const long n    = getenv("ITERATIONS") ? atol(getenv("ITERATIONS")) : 4000000;
+    const long recs = 8*1024*1024;      // 64M of longs
+    std::vector<long> idx(n);
+    std::mt19937_64   rnd(1);
+    for (auto& i : idx) i = rnd() % recs;
+
+    auto run = [&](int a_map_options, memory::huge_pages a_huge, const char* a_name) {
+        ::unlink(s_filename);
+        persist_array<long, 1> a;
+        BOOST_REQUIRE(a.init(s_filename, recs, false, a.default_file_mode(),
+                             nullptr, a_map_options, a_huge));
+        BOOST_REQUIRE_EQUAL(size_t(recs), a.capacity());
+        for (long i = 0; i < recs; i += 512)
+            a[i] = i;
+        BOOST_REQUIRE_EQUAL(512, a[512]);
+        if (a_huge == memory::huge_pages::NONE)
+            BOOST_CHECK(a.huge_pages() == memory::huge_pages::NONE);
+        else
+            BOOST_CHECK(a.huge_pages() != memory::huge_pages::NONE);
+
+        dtlb_miss_counter tlb;
+        long sum = 0;
+        auto t   = high_resolution_clock::now();
+        tlb.start();
+        for (auto i : idx) sum += a[i];
+        long misses = tlb.stop();
+        double ns = double(duration_cast<nanoseconds>
+                          (high_resolution_clock::now() - t).count()) / n;
+        BOOST_REQUIRE(sum >= 0);
+
+        if (verbosity::level() > VERBOSE_NONE) {
+            std::cout << "  " << std::setw(24) << std::left << a_name << std::right
+                      << std::setw(6) << std::fixed << std::setprecision(1) << ns
+                      << " ns/read, dTLB misses: ";
+            if (misses < 0) std::cout << "n/a\n";
+            else            std::cout << misses << '\n';
+        }
+    };
+
+    if (verbosity::level() > VERBOSE_NONE)
+        std::cout << "Random reads from a 64M persist_array:\n";
+    run(0,            memory::huge_pages::NONE,        "4K pages");
+    run(MAP_POPULATE, memory::huge_pages::NONE,        "4K pages, MAP_POPULATE");
+    run(MAP_POPULATE, memory::huge_pages::TRANSPARENT, "THP, MAP_POPULATE");
+    // No hugetlbfs file: falls back to transparent huge pages
+    run(0,            memory::huge_pages::EXPLICIT,    "explicit (fallback)");
+    ::unlink(s_filename);
+}
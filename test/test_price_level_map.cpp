@@ -0,0 +1,300 @@
+//----------------------------------------------------------------------------
+/// \file  test_price_level_map.cpp
+//----------------------------------------------------------------------------
+/// \brief Test cases and benchmarks for price_level_map.hpp
+//----------------------------------------------------------------------------
+// Copyright (c) 2026 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <utxx/container/price_level_map.hpp>
+#include <utxx/verbosity.hpp>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <random>
+#include <vector>
+
+using namespace utxx;
+
+namespace {
+    struct level {
+        long qty    = 0;
+        int  orders = 0;
+    };
+
+    template <class Map, class Ref>
+    void check_same(const Map& a_map, const Ref& a_ref) {
+        BOOST_REQUIRE_EQUAL(a_ref.size(), a_map.size());
+        if (a_ref.empty()) {
+            BOOST_REQUIRE(!a_map.best());
+            return;
+        }
+        BOOST_REQUIRE_EQUAL(a_ref.begin()->first,  a_map.best_price());
+        BOOST_REQUIRE_EQUAL(a_ref.begin()->second, a_map.best()->qty);
+        auto it = a_ref.begin();
+        size_t n = a_map.for_each([&](long a_px, const level& a_lvl) {
+            BOOST_REQUIRE(it != a_ref.end());
+            BOOST_REQUIRE_EQUAL(it->first,  a_px);
+            BOOST_REQUIRE_EQUAL(it->second, a_lvl.qty);
+            ++it;
+        });
+        BOOST_REQUIRE_EQUAL(a_ref.size(), n);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_price_level_map_basic )
+{
+    price_level_map<level, price_side::BID> bids(64);
+    price_level_map<level, price_side::ASK> asks(64);
+
+    BOOST_CHECK(bids.empty());
+    BOOST_CHECK(!bids.best());
+    BOOST_CHECK(!bids.find(100));
+    BOOST_CHECK(!bids.erase(100));
+    BOOST_CHECK_THROW((price_level_map<level, price_side::ASK>(10)), badarg_error);
+
+    bids[1000].qty = 10;
+    bids[999].qty  = 20;
+    bids[1001].qty = 30;
+    asks[1002].qty = 40;
+    asks[1005].qty = 50;
+
+    BOOST_CHECK_EQUAL(3u,   bids.size());
+    BOOST_CHECK_EQUAL(1001, bids.best_price());
+    BOOST_CHECK_EQUAL(30,   bids.best()->qty);
+    BOOST_CHECK_EQUAL(1002, asks.best_price());
+    BOOST_CHECK(!bids.emplace(1000).second);
+    BOOST_CHECK_EQUAL(10,   bids.emplace(1000).first->qty);
+    BOOST_CHECK_EQUAL(20,   bids.find(999)->qty);
+
+    std::vector<long> px;
+    bids.for_each([&](long a_px, const level&) { px.push_back(a_px); });
+    BOOST_CHECK((px == std::vector<long>{1001, 1000, 999}));
+    px.clear();
+    BOOST_CHECK_EQUAL(1u, asks.for_each([&](long a_px, const level&) { px.push_back(a_px); }, 1));
+    BOOST_CHECK((px == std::vector<long>{1002}));
+
+    // Deep level goes to the outlier tree
+    bids[500].qty = 60;
+    BOOST_CHECK_EQUAL(1u,   bids.outliers());
+    BOOST_CHECK_EQUAL(60,   bids.find(500)->qty);
+    BOOST_CHECK_EQUAL(0u,   bids.recenters());
+
+    // Better price outside of the window recenters it
+    bids[2000].qty = 70;
+    BOOST_CHECK_EQUAL(1u,   bids.recenters());
+    BOOST_CHECK_EQUAL(4u,   bids.outliers());
+    BOOST_CHECK_EQUAL(2000, bids.best_price());
+    BOOST_CHECK_EQUAL(30,   bids.find(1001)->qty);
+
+    // Removing the last level in the window pulls outliers back into it
+    BOOST_CHECK(bids.erase(2000));
+    BOOST_CHECK_EQUAL(2u,   bids.recenters());
+    BOOST_CHECK_EQUAL(1u,   bids.outliers());
+    BOOST_CHECK_EQUAL(1001, bids.best_price());
+
+    BOOST_CHECK(bids.erase(1001));
+    BOOST_CHECK_EQUAL(1000, bids.best_price());
+    BOOST_CHECK(!bids.erase(1001));
+    BOOST_CHECK(bids.erase(500));
+    BOOST_CHECK_EQUAL(0u,   bids.outliers());
+
+    bids.clear();
+    BOOST_CHECK(bids.empty());
+    BOOST_CHECK(!bids.best());
+    bids[7].qty = 1;
+    BOOST_CHECK_EQUAL(7,    bids.best_price());
+}
+
+BOOST_AUTO_TEST_CASE( test_price_level_map_follow_worse )
+{
+    // The window follows the best price moving toward worse levels, so that
+    // levels behind it don't stay in the outlier tree
+    price_level_map<level, price_side::ASK> asks(64);
+    for (long px = 100; px < 200; ++px)
+        asks[px].qty = px;
+    BOOST_CHECK_EQUAL(52u, asks.outliers());
+    for (long px = 100; px < 141; ++px)
+        BOOST_REQUIRE(asks.erase(px));
+    BOOST_CHECK_EQUAL(141, asks.best_price());
+    BOOST_CHECK(asks.recenters() > 0);
+    BOOST_CHECK(asks.outliers() <= 26u);
+    BOOST_CHECK_EQUAL(59u, asks.size());
+    long next = 141;
+    asks.for_each([&](long a_px, const level& a) {
+        BOOST_REQUIRE_EQUAL(next++, a_px);
+        BOOST_REQUIRE_EQUAL(a_px,   a.qty);
+    });
+    BOOST_CHECK_EQUAL(200, next);
+}
+
+BOOST_AUTO_TEST_CASE( test_price_level_map_outlier_limit )
+{
+    price_level_map<level, price_side::ASK, 4> asks(64);
+    asks[100].qty = 1;
+    for (int i = 0; i < 4; ++i)
+        asks[1000 + i].qty = 1;
+    BOOST_CHECK_EQUAL(4u, asks.outliers());
+    BOOST_CHECK_THROW(asks[2000], runtime_error);
+    // Recentering that would overflow the outlier tree leaves the map intact
+    BOOST_CHECK_THROW(asks[0], runtime_error);
+    BOOST_CHECK_EQUAL(5u,  asks.size());
+    BOOST_CHECK_EQUAL(100, asks.best_price());
+
+    // The limit may exceed 16 bits
+    const size_t n = 70000;
+    price_level_map<level, price_side::ASK, n> wide(64);
+    wide[100].qty = 1;
+    for (size_t i = 0; i < n; ++i)
+        wide[1000 + 2*i].qty = 1;
+    BOOST_CHECK_EQUAL(n, wide.outliers());
+    BOOST_CHECK_THROW(wide[999], runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE( test_price_level_map_random )
+{
+    // Random updates with large price jumps checked against std::map
+    std::mt19937 rnd(1);
+    price_level_map<level, price_side::BID, 16384> bids(128);
+    price_level_map<level, price_side::ASK, 16384> asks(128);
+    std::map<long, long, std::greater<long>>       rbids;
+    std::map<long, long>                           rasks;
+
+    long mid = 100000;
+    for (int i = 0; i < 200000; ++i) {
+        if (rnd() % 1000 == 0)
+            mid += long(rnd() % 2001) - 1000;
+        else if (rnd() % 10 == 0)
+            mid += long(rnd() % 3) - 1;
+        long d   = rnd() % 8 == 0 ? rnd() % 1000 : rnd() % 20;
+        long qty = rnd() % 3 == 0 ? 0 : 1 + rnd() % 100;
+        bool bid = rnd() & 1;
+        long px  = bid ? mid - 1 - d : mid + 1 + d;
+
+        if (bid) {
+            if (qty) { bids[px].qty = qty; rbids[px] = qty; }
+            else     BOOST_REQUIRE_EQUAL(rbids.erase(px) == 1, bids.erase(px));
+        } else {
+            if (qty) { asks[px].qty = qty; rasks[px] = qty; }
+            else     BOOST_REQUIRE_EQUAL(rasks.erase(px) == 1, asks.erase(px));
+        }
+        BOOST_REQUIRE_EQUAL(rbids.size(), bids.size());
+        BOOST_REQUIRE_EQUAL(rasks.size(), asks.size());
+        if (!rbids.empty()) BOOST_REQUIRE_EQUAL(rbids.begin()->first, bids.best_price());
+        if (!rasks.empty()) BOOST_REQUIRE_EQUAL(rasks.begin()->first, asks.best_price());
+        if (i % 10000 == 0) {
+            check_same(bids, rbids);
+            check_same(asks, rasks);
+        }
+    }
+    check_same(bids, rbids);
+    check_same(asks, rasks);
+    BOOST_CHECK(bids.recenters() > 0);
+    BOOST_CHECK(bids.outliers()  > 0);
+}
+
+//----------------------------------------------------------------------------
+// Benchmark
+//----------------------------------------------------------------------------
+namespace {
+    struct book_event {
+        long px;
+        long qty;
+        bool bid;
+    };
+
+    // Most updates land within a few ticks of the top of the book, deletes
+    // are frequent, and the mid price drifts
+    std::vector<book_event> make_events(size_t a_count) {
+        std::mt19937 rnd(7);
+        std::geometric_distribution<long> depth(0.15);
+        std::vector<book_event> v(a_count);
+        long mid = 1000000;
+        for (auto& e : v) {
+            if (rnd() % 20 == 0)
+                mid += long(rnd() % 3) - 1;
+            long d = rnd() % 100 == 0 ? rnd() % 5000 : std::min(depth(rnd), 500l);
+            e.bid  = rnd() & 1;
+            e.px   = e.bid ? mid - 1 - d : mid + 1 + d;
+            e.qty  = rnd() % 5 < 2 ? 0 : 1 + rnd() % 1000;
+        }
+        return v;
+    }
+
+    template <class Bids, class Asks>
+    double replay(Bids& a_bids, Asks& a_asks, const std::vector<book_event>& a_events,
+                  long& a_sum)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        for (auto& e : a_events) {
+            if (e.bid) {
+                if (e.qty) a_bids[e.px].qty = e.qty;
+                else       a_bids.erase(e.px);
+            } else {
+                if (e.qty) a_asks[e.px].qty = e.qty;
+                else       a_asks.erase(e.px);
+            }
+            // Top of book is read after every update
+            if (!a_bids.empty()) a_sum += a_bids.best_price();
+            if (!a_asks.empty()) a_sum += a_asks.best_price();
+        }
+        return double(std::chrono::duration_cast<std::chrono::nanoseconds>
+            (std::chrono::high_resolution_clock::now() - start).count()) / a_events.size();
+    }
+
+    // std::map adapter exposing the price_level_map calls used by replay()
+    template <class Compare>
+    struct std_map_side : std::map<long, level, Compare> {
+        long best_price() const { return this->begin()->first; }
+    };
+}
+
+BOOST_AUTO_TEST_CASE( test_price_level_map_perf )
+{
+    const size_t count = getenv("ITERATIONS") ? atoi(getenv("ITERATIONS")) : 2000000;
+    auto events = make_events(count);
+
+    long s1 = 0, s2 = 0;
+    price_level_map<level, price_side::BID, 16384> b1;
+    price_level_map<level, price_side::ASK, 16384> a1;
+    std_map_side<std::greater<long>>               b2;
+    std_map_side<std::less<long>>                  a2;
+
+    double t1 = replay(b1, a1, events, s1);
+    double t2 = replay(b2, a2, events, s2);
+
+    BOOST_REQUIRE_EQUAL(s2, s1);
+    BOOST_REQUIRE_EQUAL(b2.size(), b1.size());
+    BOOST_REQUIRE_EQUAL(a2.size(), a1.size());
+
+    if (verbosity::level() != utxx::VERBOSE_NONE)
+        fprintf(stderr, "Book replay of %lu updates (ns/update): price_level_map %.1f "
+                "(%lu+%lu outliers, %lu recenters), std::map %.1f\n",
+                count, t1, b1.outliers(), a1.outliers(),
+                b1.recenters() + a1.recenters(), t2);
+}
@@ -0,0 +1,228 @@
+//----------------------------------------------------------------------------
+/// \file  test_rcu_snapshot.cpp
+//----------------------------------------------------------------------------
+/// \brief Test cases for rcu_snapshot.
+//----------------------------------------------------------------------------
+// Copyright (c) 2026 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <boost/thread/barrier.hpp>
+#include <utxx/rcu_snapshot.hpp>
+#include <utxx/synch.hpp>
+#include <utxx/verbosity.hpp>
+#include <shared_mutex>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace utxx;
+
+namespace {
+    struct data {
+        static std::atomic<int> s_count;
+        long a, b;                  // Invariant: a + b == 0
+
+        data(long n = 0) : a(n), b(-n) { ++s_count; }
+        data(const data& d) : a(d.a), b(d.b) { ++s_count; }
+        ~data() { a = 1; b = 1; --s_count; }   // Poison to catch use-after-free
+
+        bool valid() const { return a + b == 0; }
+    };
+
+    std::atomic<int> data::s_count(0);
+}
+
+BOOST_AUTO_TEST_CASE( test_rcu_snapshot )
+{
+    {
+        rcu_snapshot<data> s;
+        BOOST_REQUIRE(!s.read().get());
+        BOOST_REQUIRE(!s.in_read_section());
+
+        s.emplace(1);
+        BOOST_REQUIRE_EQUAL(1, s.read()->a);
+        BOOST_REQUIRE_EQUAL(0u, s.retired_count());
+        BOOST_REQUIRE_EQUAL(1, data::s_count.load());
+
+        {
+            auto g1 = s.read();
+            BOOST_REQUIRE(s.in_read_section());
+            s.publish(new data(2));
+            // The old version is still referenced by g1
+            BOOST_REQUIRE_EQUAL(1u, s.retired_count());
+            BOOST_REQUIRE_EQUAL(1, g1->a);
+            {
+                // Nested section keeps the outer epoch
+                auto g2 = s.read();
+                BOOST_REQUIRE_EQUAL(2, g2->a);
+            }
+            BOOST_REQUIRE_EQUAL(0u, s.reclaim());
+            BOOST_REQUIRE(g1->valid());
+        }
+        BOOST_REQUIRE(!s.in_read_section());
+        BOOST_REQUIRE_EQUAL(1u, s.reclaim());
+        BOOST_REQUIRE_EQUAL(1, data::s_count.load());
+
+        s.update([](data& d) { d.a += 10; d.b -= 10; });
+        BOOST_REQUIRE_EQUAL(12, s.read([](const data* d) { return d->a; }));
+        BOOST_REQUIRE_EQUAL(0u, s.retired_count());
+
+        s.synchronize();
+        BOOST_REQUIRE_EQUAL(1, data::s_count.load());
+    }
+    BOOST_REQUIRE_EQUAL(0, data::s_count.load());
+}
+
+BOOST_AUTO_TEST_CASE( test_rcu_snapshot_synchronize )
+{
+    rcu_snapshot<data> s(new data(1));
+    std::atomic<int>   stage(0);
+
+    std::thread reader([&]() {
+        auto g = s.read();
+        stage = 1;
+        while (stage.load() != 2)
+            std::this_thread::yield();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        BOOST_REQUIRE(g->valid());
+        stage = 3;
+    });
+
+    while (stage.load() != 1)
+        std::this_thread::yield();
+    s.publish(new data(2));
+    BOOST_REQUIRE_EQUAL(1u, s.retired_count());
+    stage = 2;
+    // Must wait for the reader to leave its read section
+    s.synchronize();
+    BOOST_REQUIRE_EQUAL(3, stage.load());
+    BOOST_REQUIRE_EQUAL(0u, s.retired_count());
+    reader.join();
+}
+
+BOOST_AUTO_TEST_CASE( test_rcu_snapshot_concurrent )
+{
+    const long iterations = ::getenv("ITERATIONS") ? atoi(::getenv("ITERATIONS")) : 20000;
+    const int  readers    = 4;
+
+    {
+        rcu_snapshot<data>       s(new data(0));
+        std::atomic<bool>        done(false);
+        std::atomic<long>        errors(0);
+        std::vector<std::thread> threads;
+
+        for (int i=0; i < readers; ++i)
+            threads.emplace_back([&]() {
+                long last = 0;
+                while (!done.load(std::memory_order_relaxed)) {
+                    auto g = s.read();
+                    // Versions are monotonic and never freed under a reader
+                    if (!g->valid() || g->a < last) ++errors;
+                    last = g->a;
+                }
+            });
+
+        const long updates = iterations / 10;
+        auto       incr    = [&]() {
+            for (long i=0; i < updates; ++i)
+                s.update([](data& d) { ++d.a; --d.b; });
+        };
+
+        // Two concurrent writers: no update may be lost
+        std::thread writer(incr);
+        incr();
+        writer.join();
+        done = true;
+        for (auto& t : threads) t.join();
+
+        BOOST_REQUIRE_EQUAL(0, errors.load());
+        BOOST_REQUIRE(s.read()->valid());
+        BOOST_REQUIRE_EQUAL(2*updates, s.read()->a);
+        s.synchronize();
+        BOOST_REQUIRE_EQUAL(0u, s.retired_count());
+        BOOST_REQUIRE_EQUAL(1, data::s_count.load());
+    }
+    BOOST_REQUIRE_EQUAL(0, data::s_count.load());
+}
+
+namespace {
+    // @return reads/us measured by the slowest reader
+    template <class Read>
+    double read_bench(int a_threads, long a_iterations, const Read& a_read) {
+        using namespace std::chrono;
+        boost::barrier            barrier(a_threads);
+        std::vector<long>         usec(a_threads);
+        std::vector<std::thread>  threads;
+        std::atomic<long>         sum(0);
+        for (int i=0; i < a_threads; ++i)
+            threads.emplace_back([&, i]() {
+                long n = 0;
+                barrier.wait();
+                auto start = high_resolution_clock::now();
+                for (long j=0; j < a_iterations; ++j)
+                    n += a_read();
+                usec[i] = duration_cast<microseconds>
+                          (high_resolution_clock::now() - start).count();
+                sum += n;
+            });
+        for (auto& t : threads) t.join();
+        long max = *std::max_element(usec.begin(), usec.end());
+        return double(a_threads * a_iterations) / std::max(1l, max);
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_rcu_snapshot_perf )
+{
+    const long iterations  = ::getenv("ITERATIONS")  ? atoi(::getenv("ITERATIONS"))  : 20000;
+    const int  max_threads = ::getenv("MAX_THREADS") ? atoi(::getenv("MAX_THREADS")) : 64;
+
+    rcu_snapshot<data>          rcu(new data(1));
+    data                        d(1);
+    synch::read_write_spin_lock spin;
+    std::shared_timed_mutex     rw;
+
+    if (verbosity::level() != utxx::VERBOSE_NONE)
+        fprintf(stderr, "%8s %14s %14s %14s  (Mreads/s)\n",
+                "Threads", "rcu_snapshot", "rw_spin_lock", "shared_mutex");
+
+    for (int n=1; n <= max_threads; n *= 2) {
+        double r = read_bench(n, iterations, [&]() {
+            return rcu.read()->a;
+        });
+        double l = read_bench(n, iterations, [&]() {
+            spin.read_lock(); long a = d.a; spin.read_unlock(); return a;
+        });
+        double m = read_bench(n, iterations, [&]() {
+            std::shared_lock<std::shared_timed_mutex> g(rw); return d.a;
+        });
+        if (verbosity::level() != utxx::VERBOSE_NONE)
+            fprintf(stderr, "%8d %14.2f %14.2f %14.2f\n", n, r, l, m);
+    }
+    BOOST_REQUIRE_EQUAL(0u, rcu.retired_count());
+}
@@ -30,6 +30,9 @@ Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 
 #include <boost/test/unit_test.hpp>
 #include <utxx/container/stack_container.hpp>
+#include <utxx/hashmap.hpp>
+#include <utxx/verbosity.hpp>
+#include <chrono>
 
 using namespace utxx;
 
@@ -67,4 +70,109 @@ BOOST_AUTO_TEST_CASE( test_stack_container )
     p1 = (const char*)&str + sizeof(str)-16;
     p2 = &str.container()[0];
     BOOST_CHECK(p1 != p2);
-}
\ No newline at end of file
+}
+
+BOOST_AUTO_TEST_CASE( test_stack_container_arena )
+{
+    memory::arena arena(1024);
+
+    // Overflow of the stack buffer goes to the arena
+    basic_stack_vector<int, 4> v(&arena);
+    for (int i=0; i < 4; ++i) v->push_back(i);
+    BOOST_CHECK_EQUAL(0u, arena.chunks());
+    for (int i=4; i < 100; ++i) v->push_back(i);
+    BOOST_CHECK_EQUAL(100u, v->size());
+    BOOST_CHECK(arena.chunks() > 0);
+    for (int i=0; i < 100; ++i) BOOST_REQUIRE_EQUAL(i, v[i]);
+
+    basic_stack_string<15> str(&arena);
+    str.container() = "0123456789012345678901234567890123456789";
+    BOOST_CHECK_EQUAL("0123456789012345678901234567890123456789", str.container());
+
+    // Allocations larger than a chunk get their own chunk
+    size_t chunks = arena.chunks();
+    stack_allocator<char, 1> alloc(&arena);
+    char* p = alloc.allocate(4096);
+    BOOST_CHECK_EQUAL(chunks+1, arena.chunks());
+    alloc.deallocate(p, 4096);
+
+    // The most recent allocation is returned to the arena immediately
+    p = alloc.allocate(16);
+    alloc.deallocate(p, 16);
+    BOOST_CHECK(p == alloc.allocate(16));
+
+    // Rebound allocators share the arena
+    stack_allocator<long, 1> lalloc(alloc);
+    BOOST_CHECK(&arena == lalloc.arena());
+    BOOST_CHECK((alloc != stack_allocator<char, 1>()));
+    BOOST_CHECK((alloc == stack_allocator<char, 1>(&arena)));
+
+    size_t cap = arena.capacity();
+    arena.reset();
+    BOOST_CHECK_EQUAL(cap, arena.capacity());
+    arena.release();
+    BOOST_CHECK_EQUAL(0u, arena.capacity());
+    BOOST_CHECK_EQUAL(0u, arena.chunks());
+}
+
+BOOST_AUTO_TEST_CASE( test_stack_container_arena_hash_map )
+{
+    using alloc_t = stack_allocator<std::pair<const int, int>, 1>;
+    using map_t   = detail::basic_hash_map<int, int, std::hash<int>,
+                                           std::equal_to<int>, alloc_t>;
+    memory::arena& arena = memory::arena::local();
+    arena.release();
+
+    // Per-message scratch map: after the first message the arena stops
+    // requesting memory from the heap
+    size_t chunks = 0;
+    for (int msg=0; msg < 100; ++msg) {
+        {
+            map_t m(64, alloc_t(&arena));
+            for (int i=0; i < 1000; ++i) m[i] = i + msg;
+            BOOST_REQUIRE_EQUAL(1000u, m.size());
+            BOOST_REQUIRE_EQUAL(999 + msg, m[999]);
+        }
+        if (msg == 0)
+            chunks = arena.chunks();
+        BOOST_REQUIRE_EQUAL(chunks, arena.chunks());
+        arena.reset();
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_stack_container_arena_perf )
+{
+    using namespace std::chrono;
+    const long iterations = ::getenv("ITERATIONS") ? atoi(::getenv("ITERATIONS")) : 20000;
+
+    // Build a scratch vector of 100 strings per message
+    using str_t = std::basic_string<char, std::char_traits<char>,
+                                    stack_allocator<char, 1>>;
+    auto run = [=](memory::arena* a) {
+        auto start = high_resolution_clock::now();
+        long sum = 0;
+        for (long n=0; n < iterations; ++n) {
+            {
+                basic_stack_vector<str_t, 8> v(a);
+                for (int i=0; i < 100; ++i) {
+                    v->emplace_back(stack_allocator<char, 1>(a));
+                    v->back().assign(40, 'a' + i % 26);
+                }
+                sum += v->size() + v[99].size();
+            }
+            // Rewind the arena once the message's containers are gone
+            if (a) a->reset();
+        }
+        BOOST_REQUIRE_EQUAL(iterations * 140, sum);
+        return double(duration_cast<nanoseconds>
+                     (high_resolution_clock::now() - start).count()) / iterations;
+    };
+
+    memory::arena arena;
+    double heap  = run(nullptr);
+    double arn   = run(&arena);
+
+    if (verbosity::level() != utxx::VERBOSE_NONE)
+        fprintf(stderr, "  Per message: heap %.0f ns, arena %.0f ns (%lu chunks)\n",
+                heap, arn, arena.chunks());
+}
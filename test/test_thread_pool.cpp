@@ -0,0 +1,333 @@
+//----------------------------------------------------------------------------
+/// \file  test_thread_pool.cpp
+//----------------------------------------------------------------------------
+/// \brief Test cases for chase_lev_deque and work_stealing_pool.
+//----------------------------------------------------------------------------
+// Copyright (c) 2026 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <utxx/thread_pool.hpp>
+#include <utxx/verbosity.hpp>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <deque>
+#include <chrono>
+#include <numeric>
+#include <stdexcept>
+
+using namespace utxx;
+
+BOOST_AUTO_TEST_CASE( test_chase_lev_deque )
+{
+    container::chase_lev_deque<long> q(2);
+    long v;
+
+    BOOST_REQUIRE(q.empty());
+    BOOST_REQUIRE(!q.pop(v));
+    BOOST_REQUIRE(!q.steal(v));
+    BOOST_REQUIRE_EQUAL(2u, q.capacity());
+
+    for (long i=1; i <= 10; ++i)
+        q.push(i);
+
+    BOOST_REQUIRE_EQUAL(16u, q.capacity());
+    BOOST_REQUIRE_EQUAL(10u, q.size());
+
+    // Owner pops the newest items, thieves steal the oldest ones
+    BOOST_REQUIRE(q.pop(v));    BOOST_REQUIRE_EQUAL(10, v);
+    BOOST_REQUIRE(q.steal(v));  BOOST_REQUIRE_EQUAL(1,  v);
+    BOOST_REQUIRE(q.pop(v));    BOOST_REQUIRE_EQUAL(9,  v);
+    BOOST_REQUIRE(q.steal(v));  BOOST_REQUIRE_EQUAL(2,  v);
+
+    for (long i=3; i <= 8; ++i) {
+        BOOST_REQUIRE(q.steal(v));
+        BOOST_REQUIRE_EQUAL(i, v);
+    }
+    BOOST_REQUIRE(q.empty());
+    BOOST_REQUIRE(!q.pop(v));
+    BOOST_REQUIRE(!q.steal(v));
+}
+
+BOOST_AUTO_TEST_CASE( test_chase_lev_deque_concurrent )
+{
+    const long iterations = ::getenv("ITERATIONS") ? atoi(::getenv("ITERATIONS")) : 100000;
+    const int  thieves    = 3;
+
+    container::chase_lev_deque<long> q(16);
+    std::atomic<bool>  done(false);
+    std::vector<long>  sums(thieves+1), counts(thieves+1);
+    std::vector<std::thread> threads;
+
+    for (int i=0; i < thieves; ++i)
+        threads.emplace_back([&, i]() {
+            long v;
+            while (!done.load(std::memory_order_acquire) || !q.empty())
+                if (q.steal(v)) { sums[i] += v; ++counts[i]; }
+        });
+
+    // The owner interleaves pushes and pops
+    long v;
+    for (long i=1; i <= iterations; ++i) {
+        q.push(i);
+        if ((i & 3) == 0 && q.pop(v)) { sums[thieves] += v; ++counts[thieves]; }
+    }
+    while (q.pop(v)) { sums[thieves] += v; ++counts[thieves]; }
+    done = true;
+
+    for (auto& t : threads) t.join();
+
+    BOOST_REQUIRE_EQUAL(iterations, std::accumulate(counts.begin(), counts.end(), 0l));
+    BOOST_REQUIRE_EQUAL(iterations*(iterations+1)/2,
+                        std::accumulate(sums.begin(), sums.end(), 0l));
+}
+
+BOOST_AUTO_TEST_CASE( test_cpu_topology )
+{
+    auto cpus = cpu_affinity_list();
+    auto topo = cpu_topology();
+    BOOST_REQUIRE(!cpus.empty());
+    BOOST_REQUIRE_EQUAL(cpus.size(), topo.size());
+    BOOST_REQUIRE_EQUAL(cpus[0], topo[0].cpu);
+
+    int rc = -1, cpu = -1;
+    std::thread t([&]() {
+        rc  = pin_this_thread(cpus.back());
+        cpu = current_cpu();
+    });
+    t.join();
+    BOOST_REQUIRE_EQUAL(0, rc);
+    BOOST_REQUIRE_EQUAL(cpus.back(), cpu);
+}
+
+BOOST_AUTO_TEST_CASE( test_thread_pool_submit )
+{
+    const int n = 10000;
+    std::atomic<int> count(0);
+    {
+        work_stealing_pool pool(4);
+        BOOST_REQUIRE_EQUAL(4u, pool.size());
+        BOOST_REQUIRE_EQUAL(-1, pool.current_worker());
+
+        for (int i=0; i < n; ++i)
+            pool.submit([&]() { count.fetch_add(1, std::memory_order_relaxed); });
+
+        pool.help_until([&]() { return count.load() == n; });
+        BOOST_REQUIRE_EQUAL(n, count.load());
+
+        // Tasks spawned from a worker go to its own deque: while the
+        // spawning worker waits for it (and this thread doesn't help), the
+        // task can only run if another worker steals it from that deque
+        std::atomic<int>  outer(-2), idx(-2);
+        std::atomic<long> steals(-1);
+        pool.submit([&]() {
+            unsigned long s = pool.stolen();
+            outer = pool.current_worker();
+            pool.submit([&]() { idx = pool.current_worker(); });
+            while (idx.load() == -2)
+                std::this_thread::yield();
+            steals = long(pool.stolen() - s);
+        });
+        while (steals.load() < 0)
+            std::this_thread::yield();
+        BOOST_REQUIRE(outer.load() >= 0 && outer.load() < 4);
+        BOOST_REQUIRE(idx.load()   >= 0 && idx.load()   < 4);
+        BOOST_REQUIRE_NE(outer.load(), idx.load());
+        BOOST_REQUIRE_EQUAL(1, steals.load());
+
+        // Queued tasks are executed by the destructor
+        for (int i=0; i < n; ++i)
+            pool.submit([&]() { count.fetch_add(1, std::memory_order_relaxed); });
+    }
+    BOOST_REQUIRE_EQUAL(2*n, count.load());
+}
+
+BOOST_AUTO_TEST_CASE( test_thread_pool_parallel_for )
+{
+    work_stealing_pool pool(4);
+
+    std::vector<int> v(100000);
+    pool.parallel_for(0, int(v.size()), [&](int i) { v[i] = i; });
+    for (int i=0; i < int(v.size()); ++i)
+        BOOST_REQUIRE_EQUAL(i, v[i]);
+
+    // Empty range and a range shorter than the grain
+    pool.parallel_for(5, 5, [&](int i) { v[i] = -1; });
+    pool.parallel_for(0, 3, [&](int i) { v[i] = -1; }, 10);
+    BOOST_REQUIRE_EQUAL(-1, v[2]);
+    BOOST_REQUIRE_EQUAL( 3, v[3]);
+
+    long sum = pool.parallel_reduce(0l, 100001l, 0l,
+        [](long b, long e) { long s = 0; for (long i=b; i < e; ++i) s += i; return s; },
+        [](long a, long b) { return a + b; });
+    BOOST_REQUIRE_EQUAL(100000l*100001/2, sum);
+
+    // Non-commutative reduction keeps the order of chunks
+    std::string s = pool.parallel_reduce(0, 26, std::string(),
+        [](int b, int e) { std::string r; for (int i=b; i < e; ++i) r += char('a'+i); return r; },
+        [](const std::string& a, const std::string& b) { return a + b; }, 3);
+    BOOST_REQUIRE_EQUAL("abcdefghijklmnopqrstuvwxyz", s);
+
+    // Results of chunks don't share memory, even for bool
+    bool any = pool.parallel_reduce(0, 1000, false,
+        [](int b, int e) { return b <= 777 && 777 < e; },
+        [](bool a, bool b) { return a || b; }, 1);
+    BOOST_REQUIRE(any);
+
+    BOOST_REQUIRE_THROW(
+        pool.parallel_for(0, 1000, [](int i) { if (i == 777) throw std::runtime_error("x"); }),
+        std::runtime_error);
+}
+
+namespace {
+    long fib(work_stealing_pool& a_pool, int n) {
+        if (n < 12) {
+            long a = 0, b = 1;
+            for (int i=0; i < n; ++i) { long c = a + b; a = b; b = c; }
+            return a;
+        }
+        std::atomic<bool> done(false);
+        long x;
+        a_pool.submit([&]() { x = fib(a_pool, n-1); done.store(true, std::memory_order_release); });
+        long y = fib(a_pool, n-2);
+        a_pool.help_until([&]() { return done.load(std::memory_order_acquire); });
+        return x + y;
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_thread_pool_nested )
+{
+    work_stealing_pool pool(4);
+    long res = 0;
+    std::atomic<bool> done(false);
+    pool.submit([&]() { res = fib(pool, 24); done = true; });
+    pool.help_until([&]() { return done.load(); });
+    BOOST_REQUIRE_EQUAL(46368, res);
+
+    // Nested parallel_for from within a task
+    std::atomic<long> sum(0);
+    pool.parallel_for(0, 8, [&](int) {
+        pool.parallel_for(0, 100, [&](int j) { sum.fetch_add(j); }, 10);
+    }, 1);
+    BOOST_REQUIRE_EQUAL(8*4950, sum.load());
+}
+
+namespace {
+    // Baseline for the benchmark: a single queue guarded by a mutex
+    class mutex_pool {
+        std::mutex                        m_mutex;
+        std::condition_variable           m_cond;
+        std::deque<std::function<void()>> m_queue;
+        std::vector<std::thread>          m_threads;
+        bool                              m_stop;
+    public:
+        explicit mutex_pool(unsigned a_threads) : m_stop(false) {
+            for (unsigned i=0; i < a_threads; ++i)
+                m_threads.emplace_back([this]() {
+                    while (true) {
+                        std::function<void()> f;
+                        {
+                            std::unique_lock<std::mutex> g(m_mutex);
+                            m_cond.wait(g, [this]() { return m_stop || !m_queue.empty(); });
+                            if (m_queue.empty()) return;
+                            f = std::move(m_queue.front());
+                            m_queue.pop_front();
+                        }
+                        f();
+                    }
+                });
+        }
+        ~mutex_pool() {
+            { std::lock_guard<std::mutex> g(m_mutex); m_stop = true; }
+            m_cond.notify_all();
+            for (auto& t : m_threads) t.join();
+        }
+        template <class F>
+        void submit(F&& f) {
+            { std::lock_guard<std::mutex> g(m_mutex); m_queue.emplace_back(std::forward<F>(f)); }
+            m_cond.notify_one();
+        }
+    };
+
+    template <class Pool, class Wait>
+    long bench(Pool& a_pool, long a_tasks, const Wait& a_wait) {
+        using namespace std::chrono;
+        std::atomic<long> count(0);
+        auto start = high_resolution_clock::now();
+        for (long i=0; i < a_tasks; ++i)
+            a_pool.submit([&]() { count.fetch_add(1, std::memory_order_relaxed); });
+        a_wait([&]() { return count.load(std::memory_order_relaxed) == a_tasks; });
+        return duration_cast<microseconds>(high_resolution_clock::now() - start).count();
+    }
+}
+
+BOOST_AUTO_TEST_CASE( test_thread_pool_perf )
+{
+    const long tasks   = ::getenv("ITERATIONS") ? atoi(::getenv("ITERATIONS")) : 100000;
+    const int  threads = ::getenv("THREADS")    ? atoi(::getenv("THREADS"))    : 4;
+
+    long mq, ws, wsp;
+    {
+        mutex_pool pool(threads);
+        mq = bench(pool, tasks, [](const std::function<bool()>& done) {
+            while (!done()) std::this_thread::yield();
+        });
+    }
+    {
+        work_stealing_pool pool(threads);
+        ws = bench(pool, tasks, [&](const std::function<bool()>& done) {
+            pool.help_until(done);
+        });
+    }
+    {
+        // Same tasks spawned from within the pool (fork-join pattern)
+        work_stealing_pool pool(threads);
+        std::atomic<long>  count(0);
+        auto start = std::chrono::high_resolution_clock::now();
+        pool.parallel_for(0l, long(threads), [&](long) {
+            for (long i=0, n = tasks / threads; i < n; ++i)
+                pool.submit([&]() { count.fetch_add(1, std::memory_order_relaxed); });
+        }, 1l);
+        pool.help_until([&]() { return count.load() == tasks / threads * threads; });
+        wsp = std::chrono::duration_cast<std::chrono::microseconds>
+              (std::chrono::high_resolution_clock::now() - start).count();
+
+        if (verbosity::level() != utxx::VERBOSE_NONE)
+            fprintf(stderr, "  work-stealing: executed=%lu stolen=%lu parked=%lu\n",
+                    pool.executed(), pool.stolen(), pool.parked());
+    }
+
+    if (verbosity::level() != utxx::VERBOSE_NONE) {
+        auto rate = [=](long us) { return double(tasks) / std::max(1l, us); };
+        fprintf(stderr, "Thread pool (%d threads, %ld tasks, Mtasks/s):\n"
+                        "  mutex queue:                 %8.3f\n"
+                        "  work-stealing (external):    %8.3f\n"
+                        "  work-stealing (from worker): %8.3f\n",
+                threads, tasks, rate(mq), rate(ws), rate(wsp));
+    }
+}
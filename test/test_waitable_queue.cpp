@@ -0,0 +1,165 @@
+//----------------------------------------------------------------------------
+/// \file  test_waitable_queue.cpp
+//----------------------------------------------------------------------------
+/// \brief Test cases for waitable_mpsc_queue and waitable_spsc_queue.
+//----------------------------------------------------------------------------
+// Copyright (c) 2026 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <utxx/waitable_queue.hpp>
+#include <utxx/verbosity.hpp>
+#include <chrono>
+#include <thread>
+
+using namespace utxx;
+
+BOOST_AUTO_TEST_CASE( test_waitable_queue_timeout )
+{
+    struct timespec ts = {0, 10000000}; // 10ms
+
+    waitable_mpsc_queue<int> q;
+    BOOST_CHECK(!q.wait(&ts));
+    BOOST_CHECK(!q.wait_pop_all(&ts));
+    BOOST_CHECK_EQUAL(2u, q.waiter().park_count());
+
+    // The consumer isn't parked - no wake-up calls are made
+    BOOST_CHECK(q.push(1));
+    BOOST_CHECK(q.emplace(2));
+    BOOST_CHECK_EQUAL(0u, q.waiter().wake_count());
+
+    auto n = q.wait_pop_all(&ts);
+    BOOST_REQUIRE(n);
+    BOOST_CHECK_EQUAL(1, n->data());
+    BOOST_REQUIRE(n->next());
+    BOOST_CHECK_EQUAL(2, n->next()->data());
+    q.free(n->next());
+    q.free(n);
+    BOOST_CHECK_EQUAL(2u, q.waiter().park_count());
+
+    waitable_mpsc_queue<char> cq;
+    BOOST_CHECK(cq.push("abc"));
+    BOOST_CHECK(cq.emplace<long>(10));
+    auto c = cq.wait_pop_all(&ts);
+    BOOST_REQUIRE(c);
+    BOOST_CHECK_EQUAL("abc", c->data());
+    BOOST_CHECK_EQUAL(10, c->next()->to<long>());
+    cq.clear();
+    cq.free(c->next());
+    cq.free(c);
+
+    waitable_spsc_queue<int> sq(8);
+    int v = 0;
+    BOOST_CHECK(!sq.wait_pop(v, &ts));
+    BOOST_CHECK(sq.push(5));
+    BOOST_CHECK(sq.wait_pop(v, &ts));
+    BOOST_CHECK_EQUAL(5, v);
+    BOOST_CHECK_EQUAL(0u, sq.waiter().wake_count());
+}
+
+BOOST_AUTO_TEST_CASE( test_waitable_queue_interrupt )
+{
+    waitable_spsc_queue<int> q(8);
+    bool res = true;
+
+    std::thread consumer([&]() { int v; res = q.wait_pop(v); });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    q.interrupt();
+    consumer.join();
+
+    BOOST_CHECK(!res);
+    BOOST_CHECK(q.empty());
+}
+
+BOOST_AUTO_TEST_CASE( test_waitable_queue_concurrent )
+{
+    const long iterations = ::getenv("ITERATIONS")
+                          ? atol(::getenv("ITERATIONS")) : 100000;
+    const int  producers  = 3;
+
+    // MPSC
+    {
+        waitable_mpsc_queue<long> q;
+        long sum = 0, count = 0;
+
+        std::thread consumer([&]() {
+            while (count < producers*iterations)
+                for (auto n = q.wait_pop_all(), next = n; n; n = next) {
+                    next = n->next();
+                    sum += n->data();
+                    ++count;
+                    q.free(n);
+                }
+        });
+
+        std::vector<std::thread> threads;
+        for (int i=0; i < producers; ++i)
+            threads.emplace_back([&]() {
+                for (long j=1; j <= iterations; ++j) {
+                    q.push(j);
+                    if ((j & 0x3FFF) == 0)
+                        std::this_thread::sleep_for(std::chrono::microseconds(100));
+                }
+            });
+
+        for (auto& t : threads) t.join();
+        consumer.join();
+
+        BOOST_CHECK_EQUAL(producers*iterations, count);
+        BOOST_CHECK_EQUAL(producers*iterations*(iterations+1)/2, sum);
+
+        if (verbosity::level() > VERBOSE_NONE)
+            fprintf(stderr, "  mpsc: parks=%lu, wakes=%lu\n",
+                    q.waiter().park_count(), q.waiter().wake_count());
+    }
+
+    // SPSC
+    {
+        waitable_spsc_queue<long> q(1024);
+        long sum = 0;
+
+        std::thread consumer([&]() {
+            long v;
+            for (long i=0; i < iterations; ++i)
+                if (q.wait_pop(v))
+                    sum += v;
+        });
+
+        for (long j=1; j <= iterations; ++j)
+            while (!q.push(j))
+                std::this_thread::yield();
+
+        consumer.join();
+        BOOST_CHECK_EQUAL(iterations*(iterations+1)/2, sum);
+        BOOST_CHECK(q.waiter().wake_count() <= q.waiter().park_count());
+
+        if (verbosity::level() > VERBOSE_NONE)
+            fprintf(stderr, "  spsc: parks=%lu, wakes=%lu\n",
+                    q.waiter().park_count(), q.waiter().wake_count());
+    }
+}
@@ -0,0 +1,226 @@
+//----------------------------------------------------------------------------
+/// \file  test_warmup.cpp
+//----------------------------------------------------------------------------
+/// \brief Test cases and benchmarks for warmup.hpp
+//----------------------------------------------------------------------------
+// Copyright (c) 2026 Serge Aleynikov <saleyn@gmail.com>
+// Created: 2026-10-18
+//----------------------------------------------------------------------------
+/*
+***** BEGIN LICENSE BLOCK *****
+
+This file is part of the utxx open-source project.
+
+Copyright (C) 2026 Serge Aleynikov <saleyn@gmail.com>
+
+This library is free software; you can redistribute it and/or
+modify it under the terms of the GNU Lesser General Public
+License as published by the Free Software Foundation; either
+version 2.1 of the License, or (at your option) any later version.
+
+This library is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public
+License along with this library; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+***** END LICENSE BLOCK *****
+*/
+
+#include <boost/test/unit_test.hpp>
+#include <utxx/warmup.hpp>
+#include <utxx/ring_buffer.hpp>
+#include <utxx/generation_buffer.hpp>
+#include <utxx/concurrent_spsc_queue.hpp>
+#include <utxx/persist_array.hpp>
+#include <utxx/logger/async_file_logger.hpp>
+#include <utxx/verbosity.hpp>
+#include <chrono>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace utxx;
+
+namespace {
+    struct mapping {
+        void*  addr;
+        size_t size;
+        explicit mapping(size_t a_size) : size(a_size) {
+            addr = ::mmap(NULL, size, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            BOOST_REQUIRE(addr != MAP_FAILED);
+        }
+        ~mapping() { ::munmap(addr, size); }
+        char* data() { return static_cast<char*>(addr); }
+    };
+
+    // Fails allocations once s_limit blocks are allocated
+    struct limited_allocator : public std::allocator<char> {
+        static long s_live, s_limit;
+        char* allocate(size_t n) {
+            if (s_live == s_limit)
+                throw std::bad_alloc();
+            ++s_live;
+            return std::allocator<char>::allocate(n);
+        }
+        void deallocate(char* p, size_t n) {
+            --s_live;
+            std::allocator<char>::deallocate(p, n);
+        }
+    };
+    long limited_allocator::s_live  = 0;
+    long limited_allocator::s_limit = 0;
+
+    struct limited_traits : public async_file_logger_traits {
+        using allocator = limited_allocator;
+    };
+}
+
+BOOST_AUTO_TEST_CASE( test_warmup_range )
+{
+    const size_t pg = ::sysconf(_SC_PAGESIZE);
+    mapping m(64*pg);
+
+    // An unaligned range is extended to whole pages
+    auto r = memory::warm_up(m.data() + 10, 2*pg);
+    BOOST_CHECK_EQUAL(3*pg, r.bytes);
+    BOOST_CHECK_EQUAL(3u,   r.pages);
+    BOOST_CHECK_EQUAL(3u,   r.faulted);
+    BOOST_CHECK_EQUAL(0u,   r.locked);
+    BOOST_CHECK_EQUAL(0,    r.error);
+    BOOST_CHECK(r.nsec > 0);
+
+    // Only pages that were not resident are counted as faulted
+    r = memory::warm_up(m.data(), m.size);
+    BOOST_CHECK_EQUAL(64u, r.pages);
+    BOOST_CHECK_EQUAL(61u, r.faulted);
+    r = memory::warm_up(m.data(), m.size);
+    BOOST_CHECK_EQUAL(0u,  r.faulted);
+
+    BOOST_CHECK_EQUAL(0u,  memory::warm_up(m.data(), 0).pages);
+    BOOST_CHECK_EQUAL(0u,  memory::warm_up(NULL, pg).pages);
+
+    // Locking and binding may be disallowed, in which case the error is
+    // reported and the pages are still faulted in
+    mapping m2(16*pg);
+    r = memory::warm_up(m2.data(), m2.size, memory::warmup_options(true, true, 0));
+    BOOST_CHECK_EQUAL(16u, r.faulted);
+    BOOST_CHECK(r.locked == m2.size || r.error != 0);
+    BOOST_CHECK(r.bound  == m2.size || r.error != 0);
+    BOOST_CHECK_EQUAL(0u, memory::warm_up(m2.data(), m2.size).faulted);
+    if (r.locked)
+        ::munlock(m2.data(), m2.size);
+
+    // A node past the first word of the nodemask is reported, not bound
+    mapping m3(4*pg);
+    r = memory::warm_up(m3.data(), m3.size, memory::warmup_options(true, false, 100));
+    BOOST_CHECK_EQUAL(4u, r.faulted);
+    BOOST_CHECK_EQUAL(0u, r.bound);
+    BOOST_CHECK(r.error != 0);
+
+    // Read-only memory is faulted in for reading
+    BOOST_REQUIRE_EQUAL(0, ::mprotect(m2.data(), m2.size, PROT_READ));
+    r = memory::warm_up(m2.data(), m2.size, memory::warmup_options(false));
+    BOOST_CHECK_EQUAL(16u, r.pages);
+
+    memory::warmup_report sum;
+    sum += memory::warm_up(m.data(), pg);
+    sum += memory::warm_up(m.data(), pg);
+    BOOST_CHECK_EQUAL(2u, sum.pages);
+    BOOST_CHECK(sum.to_string().find("pages=2") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE( test_warmup_containers )
+{
+    const size_t pg = ::sysconf(_SC_PAGESIZE);
+
+    typedef ring_buffer<long, 0, true> ring_t;
+    ring_t* ring = ring_t::create(64*1024, NULL, 0, true);
+    auto r = ring->prefault();
+    BOOST_CHECK(r.bytes >= ring_t::memory_size(64*1024));
+    BOOST_CHECK(r.bytes <  ring_t::memory_size(64*1024) + 2*pg);
+    BOOST_CHECK_EQUAL(0u, ring->prefault().faulted);
+
+    typedef generation_buffer<long> gen_t;
+    gen_t* gen = gen_t::create(64*1024);
+    r = gen->prefault();
+    BOOST_CHECK(r.bytes >= gen_t::memory_size(64*1024));
+    BOOST_CHECK_EQUAL(0u, gen->prefault().faulted);
+
+    concurrent_spsc_queue<long> queue(64*1024);
+    r = queue.prefault();
+    BOOST_CHECK(r.bytes >= 64*1024*sizeof(long));
+    BOOST_CHECK_EQUAL(0u, queue.prefault().faulted);
+
+    const char* filename = "/tmp/test_warmup.bin";
+    ::unlink(filename);
+    {
+        persist_array<long, 1> a;
+        BOOST_REQUIRE(a.init(filename, 64*1024));
+        r = a.prefault();
+        BOOST_CHECK(r.bytes >= 64*1024*sizeof(long));
+        BOOST_CHECK_EQUAL(0u, a.prefault().faulted);
+    }
+    {
+        persist_array<long, 1> a;
+        BOOST_REQUIRE(!a.init(filename, 64*1024, true));
+        BOOST_CHECK(a.prefault().bytes >= 64*1024*sizeof(long));
+    }
+    ::unlink(filename);
+
+    text_file_logger<> logger;
+    r = logger.prefault(memory::warmup_options(), 1000, 100);
+    BOOST_CHECK(r.bytes >= 1000*100);
+
+    // Messages allocated before a failed allocation are freed
+    {
+        text_file_logger<limited_traits> lim;
+        limited_allocator::s_limit = 10;
+        BOOST_CHECK_THROW(lim.prefault(memory::warmup_options(), 100, 100), std::bad_alloc);
+        BOOST_CHECK_EQUAL(0, limited_allocator::s_live);
+        limited_allocator::s_limit = 100;
+        BOOST_CHECK(lim.prefault(memory::warmup_options(), 100, 100).bytes >= 100*100);
+        BOOST_CHECK_EQUAL(0, limited_allocator::s_live);
+    }
+
+    // All of the above at once
+    auto all = memory::prefault_all(memory::warmup_options(), *ring, *gen, queue);
+    BOOST_CHECK_EQUAL(0u, all.faulted);
+    BOOST_CHECK(all.bytes >= ring_t::memory_size(64*1024) + gen_t::memory_size(64*1024));
+
+    ring_t::destroy(ring);
+    gen->~gen_t();
+    std::allocator<char>().deallocate(reinterpret_cast<char*>(gen),
+                                      gen_t::memory_size(64*1024));
+}
+
+BOOST_AUTO_TEST_CASE( test_warmup_perf )
+{
+    using namespace std::chrono;
+    const size_t mb = ::getenv("ITERATIONS") ? atol(::getenv("ITERATIONS")) : 64;
+    const size_t pg = ::sysconf(_SC_PAGESIZE);
+
+    // Time of the first write to every page of a cold and a warmed-up mapping
+    auto first_touch = [&](mapping& m) {
+        auto t = high_resolution_clock::now();
+        for (size_t i = 0; i < m.size; i += pg)
+            m.data()[i] = 1;
+        return double(duration_cast<nanoseconds>
+                     (high_resolution_clock::now() - t).count()) / (m.size / pg);
+    };
+
+    mapping cold(mb << 20), warm(mb << 20);
+    auto   r      = memory::warm_up(warm.addr, warm.size);
+    double t_cold = first_touch(cold);
+    double t_warm = first_touch(warm);
+
+    BOOST_CHECK_EQUAL(warm.size / pg, r.faulted);
+
+    if (verbosity::level() != utxx::VERBOSE_NONE)
+        fprintf(stderr, "  %luM warm-up: %s\n"
+                        "  ns per first write to a page: cold %.1f, warmed up %.1f\n",
+                mb, r.to_string().c_str(), t_cold, t_warm);
+}